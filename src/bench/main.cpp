@@ -0,0 +1,449 @@
+// Benchmark driver for the simulation core (built as sim_bench, not part of
+// sim). Runs every models/*.ini scenario and a set of stress cases with all
+// output suppressed, writes one CSV row per case, and optionally compares
+// the results with an earlier file to flag regressions.
+
+#include <fcntl.h>
+#include <glob.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../config/config_reader.hpp"
+#include "../runner/cohort.hpp"
+#include "../simulation/batch_integrator.hpp"
+#include "../simulation/compartment_model.hpp"
+#include "../simulation/context.hpp"
+#include "../simulation/parameters.hpp"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::setw;
+using std::string;
+using std::vector;
+
+namespace {
+
+const char* const kDefaultResults = "bench_results.csv";
+const double kDefaultThreshold = 0.10;
+// Wall-time differences below this are noise whatever the ratio.
+const double kNoiseFloor = 0.002;
+const uint64_t kCohortPatients = 1024;
+
+// Work done by one case. Counters are deterministic; wall time and RSS are
+// not.
+struct BenchResult {
+    double wall{0.0};  // seconds, best of the repeats
+    double sim_hours{0.0};
+    unsigned long rhs_evaluations{0};
+    unsigned long accepted_steps{0};
+    unsigned long rejected_steps{0};
+    unsigned long events{0};
+    long peak_rss_kb{0};
+};
+
+struct BenchCase {
+    string name;
+    std::function<BenchResult()> run;
+};
+
+// Base config with extra entries applied on top, as later lines would be.
+bool LoadScenario(const string& file, const vector<std::pair<string, double>>& overrides,
+                  ModelParameters& params) {
+    ConfigReader config;
+    if (!config.load(file)) return false;
+    for (const auto& entry : overrides) config.set(entry.first, entry.second);
+    params = LoadModelParameters(config);
+    return true;
+}
+
+void AddRun(BenchResult& result, SimulationContext& ctx) {
+    SolverStats stats = ctx.solver_stats();
+    result.sim_hours += ctx.Time();
+    result.rhs_evaluations += stats.rhs_evaluations;
+    result.accepted_steps += stats.accepted_steps;
+    result.rejected_steps += stats.rejected_steps;
+    result.events += ctx.EventsProcessed();
+}
+
+void AddBatch(BenchResult& result, const BatchSimulation& batch) {
+    const BatchStats& stats = batch.Stats();
+    for (size_t lane = 0; lane < batch.Lanes(); ++lane) result.sim_hours += batch.Summary(lane).end_time;
+    result.rhs_evaluations += stats.rhs_evaluations;
+    result.accepted_steps += stats.accepted_steps;
+    result.rejected_steps += stats.rejected_steps;
+    result.events += stats.events;
+}
+
+// With a model file, the run integrates that compartment model.
+BenchCase ScenarioCase(const string& name, const string& file,
+                       const vector<std::pair<string, double>>& overrides = {}, const string& model_file = "") {
+    return BenchCase{name, [file, overrides, model_file]() {
+                         BenchResult result;
+                         ModelParameters params;
+                         if (!LoadScenario(file, overrides, params)) std::exit(1);
+                         CompartmentModel model;
+                         if (!model_file.empty() && !LoadCompartmentModel(model_file, model)) std::exit(1);
+                         std::ostream quiet(nullptr);
+                         SimulationContext ctx(params, quiet);
+                         ctx.SetLogLevel(LogLevel::Summary);
+                         if (!model_file.empty()) ctx.UseCompartmentModel(model);
+                         ctx.Run();
+                         AddRun(result, ctx);
+                         return result;
+                     }};
+}
+
+// Log-normal variability in the three parameters the cohort examples vary.
+CohortDefinition StressCohort(const ModelParameters& base) {
+    CohortDefinition definition;
+    const char* keys[] = {"Vmax", "kin", "EC50_base"};
+    const double medians[] = {base.Vmax, base.kin, base.EC50_base};
+    const double sigmas[] = {0.3, 0.4, 0.25};
+    for (int i = 0; i < 3; ++i) {
+        ParameterDistribution distribution;
+        distribution.key = keys[i];
+        distribution.median = medians[i];
+        distribution.sigma = sigmas[i];
+        definition.parameters.push_back(distribution);
+    }
+    definition.cholesky = {1, 0, 0, 0, 1, 0, 0, 0, 1};
+    definition.seed = 7;
+    return definition;
+}
+
+BenchCase CohortCase(const string& name, const string& file, bool batched,
+                     const vector<std::pair<string, double>>& overrides = {}) {
+    return BenchCase{name, [file, batched, overrides]() {
+                         BenchResult result;
+                         ModelParameters base;
+                         if (!LoadScenario(file, overrides, base)) std::exit(1);
+                         CohortDefinition definition = StressCohort(base);
+                         if (batched) {
+                             vector<ModelParameters> lanes;
+                             for (uint64_t i = 0; i < kCohortPatients; ++i) {
+                                 lanes.push_back(SamplePatient(definition, base, i));
+                             }
+                             BatchSimulation batch(lanes);
+                             batch.Run();
+                             AddBatch(result, batch);
+                             return result;
+                         }
+                         std::ostream quiet(nullptr);
+                         for (uint64_t i = 0; i < kCohortPatients; ++i) {
+                             SimulationContext ctx(SamplePatient(definition, base, i), quiet);
+                             ctx.SetLogLevel(LogLevel::Summary);
+                             ctx.Run();
+                             AddRun(result, ctx);
+                         }
+                         return result;
+                     }};
+}
+
+// SDE sample paths of one scenario with the default ensemble noise.
+BenchCase EnsembleCase(const string& name, const string& file) {
+    return BenchCase{name, [file]() {
+                         BenchResult result;
+                         ModelParameters base;
+                         if (!LoadScenario(file, {}, base)) std::exit(1);
+                         vector<ModelParameters> lanes(kCohortPatients, base);
+                         SdeOptions sde;
+                         sde.noise.A = 0.2;
+                         sde.noise.C = 0.05;
+                         sde.noise.Tol = 0.05;
+                         BatchSimulation batch(lanes);
+                         batch.UseNoise(sde, 0);
+                         batch.Run();
+                         AddBatch(result, batch);
+                         return result;
+                     }};
+}
+
+vector<BenchCase> AllCases(const string& models_dir) {
+    vector<BenchCase> cases;
+    glob_t matches;
+    string pattern = models_dir + "/*.ini";
+    if (glob(pattern.c_str(), 0, nullptr, &matches) == 0) {
+        for (size_t i = 0; i < matches.gl_pathc; ++i) {
+            string file = matches.gl_pathv[i];
+            string name = file.substr(file.rfind('/') + 1);
+            name = name.substr(0, name.rfind('.'));
+            if (name.compare(0, 7, "config_") == 0) name = name.substr(7);
+            cases.push_back(ScenarioCase("model:" + name, file));
+        }
+    }
+    globfree(&matches);
+
+    // Stress cases on top of the shipped scenarios.
+    string stable = models_dir + "/config_stable.ini";
+    string base = models_dir + "/config_default.ini";
+    string naloxone = models_dir + "/config_naloxone_test.ini";
+    cases.push_back(ScenarioCase("stress:long_20000h", stable, {{"duration", 20000.0}}));
+    cases.push_back(ScenarioCase("stress:tiny_step", base, {{"step_max", 0.001}, {"step_min", 0.0001}}));
+    cases.push_back(ScenarioCase("stress:tight_accuracy", stable, {{"accuracy", 1e-10}, {"duration", 2000.0}}));
+    cases.push_back(ScenarioCase("stress:implicit_long", stable, {{"solver", 1.0}, {"duration", 20000.0}}));
+    cases.push_back(ScenarioCase("stress:auto_long", stable, {{"solver", 2.0}, {"duration", 20000.0}}));
+    cases.push_back(ScenarioCase("stress:state_events_auto", naloxone, {{"state_events", 1.0}, {"solver", 2.0}}));
+    // Maintenance dosing that stays below C/Km = 0.2, integrated and in
+    // closed form.
+    vector<std::pair<string, double>> maintenance = {
+        {"Emax", 80.0}, {"EC50_base", 0.02}, {"motivation_threshold", 1e9}, {"duration", 20000.0}};
+    cases.push_back(ScenarioCase("stress:maintenance_20000h", stable, maintenance));
+    maintenance.push_back({"linear_ratio", 0.5});
+    cases.push_back(ScenarioCase("stress:linear_regime", stable, maintenance));
+    // Compartment models against the hand-written kernel (long_20000h).
+    string builtin = models_dir + "/compartments/builtin.ini";
+    string transit = models_dir + "/compartments/transit.ini";
+    cases.push_back(ScenarioCase("stress:model_builtin", stable, {{"duration", 20000.0}}, builtin));
+    cases.push_back(ScenarioCase("stress:model_exponential", stable, {{"duration", 20000.0}, {"solver", 3.0}}));
+    cases.push_back(ScenarioCase("stress:transit_explicit", stable, {{"duration", 2000.0}}, transit));
+    cases.push_back(ScenarioCase("stress:transit_exponential", stable, {{"duration", 2000.0}, {"solver", 3.0}}, transit));
+    cases.push_back(CohortCase("stress:cohort_scalar", base, false));
+    cases.push_back(CohortCase("stress:cohort_batched", base, true));
+    cases.push_back(CohortCase("stress:cohort_stochastic_scalar", base, false, {{"stochastic_behavior", 1.0}}));
+    cases.push_back(CohortCase("stress:cohort_stochastic_batched", base, true, {{"stochastic_behavior", 1.0}}));
+    cases.push_back(EnsembleCase("stress:ensemble_sde", base));
+    return cases;
+}
+
+// Runs the case in a child process, so its peak RSS is its own.
+bool RunIsolated(const BenchCase& bench_case, BenchResult& result) {
+    int fds[2];
+    if (pipe(fds) != 0) return false;
+    pid_t pid = fork();
+    if (pid < 0) return false;
+    if (pid == 0) {
+        close(fds[0]);
+        // Config warnings and run logs are not part of the measurement.
+        int null_fd = open("/dev/null", O_WRONLY);
+        if (null_fd >= 0) {
+            dup2(null_fd, STDOUT_FILENO);
+            dup2(null_fd, STDERR_FILENO);
+            close(null_fd);
+        }
+        auto start = std::chrono::steady_clock::now();
+        BenchResult child = bench_case.run();
+        child.wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        ssize_t written = write(fds[1], &child, sizeof(child));
+        _exit(written == static_cast<ssize_t>(sizeof(child)) ? 0 : 1);
+    }
+    close(fds[1]);
+    ssize_t got = read(fds[0], &result, sizeof(result));
+    close(fds[0]);
+    int status = 0;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0 ||
+        got != static_cast<ssize_t>(sizeof(result))) {
+        return false;
+    }
+    result.peak_rss_kb = usage.ru_maxrss;
+    return true;
+}
+
+const char* const kHeader =
+    "case,wall_s,sim_hours,sim_hours_per_s,ns_per_step,rhs_evaluations,accepted_steps,rejected_steps,events,"
+    "peak_rss_kb";
+
+void WriteRow(std::ostream& out, const string& name, const BenchResult& r) {
+    double steps = static_cast<double>(r.accepted_steps + r.rejected_steps);
+    out << name << "," << std::setprecision(6) << r.wall << "," << r.sim_hours << ","
+        << (r.wall > 0.0 ? r.sim_hours / r.wall : 0.0) << "," << (steps > 0.0 ? r.wall * 1e9 / steps : 0.0) << ","
+        << r.rhs_evaluations << "," << r.accepted_steps << "," << r.rejected_steps << "," << r.events << ","
+        << r.peak_rss_kb << "\n";
+}
+
+bool ReadResults(const string& filename, std::map<string, BenchResult>& results, vector<string>& order) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        cerr << "Error: Cannot open benchmark results: " << filename << endl;
+        return false;
+    }
+    string line;
+    std::getline(file, line);
+    if (line != kHeader) {
+        cerr << "Error: Unexpected benchmark results header in " << filename << endl;
+        return false;
+    }
+    while (std::getline(file, line)) {
+        if (line.empty()) continue;
+        std::stringstream row(line);
+        string name, cell;
+        vector<double> cells;
+        std::getline(row, name, ',');
+        while (std::getline(row, cell, ',')) cells.push_back(std::atof(cell.c_str()));
+        if (cells.size() != 9) {
+            cerr << "Error: Malformed row in " << filename << ": " << line << endl;
+            return false;
+        }
+        BenchResult r;
+        r.wall = cells[0];
+        r.sim_hours = cells[1];
+        r.rhs_evaluations = static_cast<unsigned long>(cells[4]);
+        r.accepted_steps = static_cast<unsigned long>(cells[5]);
+        r.rejected_steps = static_cast<unsigned long>(cells[6]);
+        r.events = static_cast<unsigned long>(cells[7]);
+        r.peak_rss_kb = static_cast<long>(cells[8]);
+        results[name] = r;
+        order.push_back(name);
+    }
+    return true;
+}
+
+// Flags cases whose wall time grew by more than threshold (and the noise
+// floor); reports changed counters, which mean the work itself changed.
+int Compare(const string& baseline_file, const string& current_file, double threshold) {
+    std::map<string, BenchResult> baseline, current;
+    vector<string> baseline_order, order;
+    if (!ReadResults(baseline_file, baseline, baseline_order) || !ReadResults(current_file, current, order)) {
+        return 2;
+    }
+
+    int regressions = 0;
+    cout << "Comparing " << current_file << " against " << baseline_file << " (threshold "
+         << std::setprecision(3) << threshold * 100.0 << "%)" << endl;
+    cout << std::left << "  " << setw(28) << "case" << std::right << setw(12) << "baseline_s" << setw(12)
+         << "current_s" << setw(9) << "ratio" << "  verdict" << endl;
+    std::ios::fmtflags flags = cout.flags();
+    for (const string& name : order) {
+        const BenchResult& now = current[name];
+        cout << "  " << std::left << setw(28) << name << std::right << std::fixed;
+        auto it = baseline.find(name);
+        if (it == baseline.end()) {
+            cout << setw(12) << "-" << setw(12) << std::setprecision(4) << now.wall << setw(9) << "-"
+                 << "  new case" << endl;
+            cout.flags(flags);
+            continue;
+        }
+        const BenchResult& before = it->second;
+        double ratio = before.wall > 0.0 ? now.wall / before.wall : 1.0;
+        string verdict = "ok";
+        if (now.wall - before.wall > std::max(threshold * before.wall, kNoiseFloor)) {
+            verdict = "REGRESSION";
+            ++regressions;
+        } else if (before.wall - now.wall > std::max(threshold * before.wall, kNoiseFloor)) {
+            verdict = "faster";
+        }
+        cout << setw(12) << std::setprecision(4) << before.wall << setw(12) << now.wall << setw(9)
+             << std::setprecision(3) << ratio << "  " << verdict;
+        if (now.rhs_evaluations != before.rhs_evaluations || now.accepted_steps != before.accepted_steps ||
+            now.rejected_steps != before.rejected_steps || now.events != before.events) {
+            cout << " (work changed: rhs " << before.rhs_evaluations << " -> " << now.rhs_evaluations << ", steps "
+                 << before.accepted_steps << " -> " << now.accepted_steps << ", events " << before.events
+                 << " -> " << now.events << ")";
+        }
+        cout << endl;
+        cout.flags(flags);
+    }
+    for (const string& name : baseline_order) {
+        if (!current.count(name)) cout << "  " << name << ": missing from current results" << endl;
+    }
+    cout << (regressions ? std::to_string(regressions) + " regression(s)" : string("No regressions")) << endl;
+    return regressions ? 1 : 0;
+}
+
+void Usage(const char* program) {
+    cerr << "Usage: " << program << " [--out <results.csv>] [--repeat <n>] [--filter <substring>]"
+         << " [--models <dir>] [--compare <baseline.csv>] [--threshold <fraction>]\n"
+         << "       " << program << " compare <baseline.csv> <current.csv> [<threshold>]" << endl;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && string(argv[1]) == "compare") {
+        if (argc < 4) {
+            Usage(argv[0]);
+            return 2;
+        }
+        return Compare(argv[2], argv[3], argc > 4 ? std::atof(argv[4]) : kDefaultThreshold);
+    }
+
+    string out_file = kDefaultResults;
+    string filter;
+    string models_dir = "models";
+    string baseline_file;
+    double threshold = kDefaultThreshold;
+    int repeat = 3;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--out" && i + 1 < argc) {
+            out_file = argv[++i];
+        } else if (arg == "--repeat" && i + 1 < argc) {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (arg == "--models" && i + 1 < argc) {
+            models_dir = argv[++i];
+        } else if (arg == "--compare" && i + 1 < argc) {
+            baseline_file = argv[++i];
+        } else if (arg == "--threshold" && i + 1 < argc) {
+            threshold = std::atof(argv[++i]);
+        } else {
+            Usage(argv[0]);
+            return 2;
+        }
+    }
+
+    std::ofstream out(out_file);
+    if (!out.is_open()) {
+        cerr << "Error: Cannot open " << out_file << endl;
+        return 2;
+    }
+    out << kHeader << "\n";
+
+    cout << "Benchmark: best of " << repeat << " run(s) per case, each in its own process" << endl;
+    cout << std::left << "  " << setw(28) << "case" << std::right << setw(10) << "wall_s" << setw(14) << "sim_h/s"
+         << setw(12) << "ns/step" << setw(12) << "rhs" << setw(10) << "steps" << setw(8) << "events" << setw(11)
+         << "rss_kb" << endl;
+    for (const BenchCase& bench_case : AllCases(models_dir)) {
+        if (!filter.empty() && bench_case.name.find(filter) == string::npos) continue;
+        BenchResult best;
+        bool ok = true;
+        for (int r = 0; r < repeat && ok; ++r) {
+            BenchResult result;
+            ok = RunIsolated(bench_case, result);
+            if (ok && (r == 0 || result.wall < best.wall)) {
+                long peak = std::max(best.peak_rss_kb, result.peak_rss_kb);
+                best = result;
+                best.peak_rss_kb = peak;
+            }
+        }
+        if (!ok) {
+            cerr << "Error: Benchmark case failed: " << bench_case.name << endl;
+            return 2;
+        }
+        WriteRow(out, bench_case.name, best);
+
+        double steps = static_cast<double>(best.accepted_steps + best.rejected_steps);
+        std::ios::fmtflags flags = cout.flags();
+        cout << "  " << std::left << setw(28) << bench_case.name << std::right << std::fixed << std::setprecision(4)
+             << setw(10) << best.wall << std::setprecision(0) << setw(14)
+             << (best.wall > 0.0 ? best.sim_hours / best.wall : 0.0) << std::setprecision(1) << setw(12)
+             << (steps > 0.0 ? best.wall * 1e9 / steps : 0.0) << setw(12) << best.rhs_evaluations << setw(10)
+             << best.accepted_steps << setw(8) << best.events << setw(11) << best.peak_rss_kb << endl;
+        cout.flags(flags);
+    }
+    out.close();
+    cout << "Results written to " << out_file << endl;
+
+    if (!baseline_file.empty()) {
+        cout << endl;
+        return Compare(baseline_file, out_file, threshold);
+    }
+    return 0;
+}
@@ -58,6 +58,16 @@ double ConfigReader::get(const string& key, double default_value) const {
     return default_value;
 }
 
+void ConfigReader::set(const string& key, double value) {
+    params_[key] = value;
+}
+
+std::vector<string> ConfigReader::keys() const {
+    std::vector<string> result;
+    for (const auto& p : params_) result.push_back(p.first);
+    return result;
+}
+
 void ConfigReader::print() const {
     cout << "Loaded Configuration Parameters:" << '\n';
     for (const auto& p : params_) {
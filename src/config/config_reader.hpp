@@ -2,12 +2,16 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 class ConfigReader {
 public:
     bool load(const std::string& filename);
     double get(const std::string& key, double default_value = 0.0) const;
+    // Adds or replaces one entry, as a later line of the file would.
+    void set(const std::string& key, double value);
     void print() const;
+    std::vector<std::string> keys() const;
 
 private:
     std::map<std::string, double> params_{};
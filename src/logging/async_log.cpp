@@ -0,0 +1,188 @@
+#include "async_log.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+// Producers only wake the writer once their ring is this full; otherwise the
+// writer picks the text up on its next periodic pass.
+const size_t kWakeFraction = 2;
+const std::chrono::milliseconds kWriterPeriod(2);
+
+size_t RoundUpPowerOfTwo(size_t value) {
+    size_t result = 1;
+    while (result < value) result <<= 1;
+    return result;
+}
+
+}  // namespace
+
+LogRing::LogRing(size_t capacity) : data_(RoundUpPowerOfTwo(std::max<size_t>(capacity, 64))), mask_(data_.size() - 1) {}
+
+bool LogRing::TryPush(const char* data, size_t size) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    size_t head = head_.load(std::memory_order_acquire);
+    if (data_.size() - (tail - head) < size) {
+        return false;
+    }
+
+    size_t start = tail & mask_;
+    size_t first = std::min(size, data_.size() - start);
+    std::memcpy(&data_[start], data, first);
+    std::memcpy(&data_[0], data + first, size - first);
+    tail_.store(tail + size, std::memory_order_release);
+    return true;
+}
+
+size_t LogRing::Drain(std::string& out) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    size_t tail = tail_.load(std::memory_order_acquire);
+    size_t size = tail - head;
+    if (size == 0) return 0;
+
+    size_t start = head & mask_;
+    size_t first = std::min(size, data_.size() - start);
+    out.append(&data_[start], first);
+    out.append(&data_[0], size - first);
+    head_.store(tail, std::memory_order_release);
+    return size;
+}
+
+LogChannelBuf::LogChannelBuf(AsyncLogWriter& writer, size_t ring_bytes) : writer_(writer), ring_(ring_bytes) {}
+
+LogChannelBuf::int_type LogChannelBuf::overflow(int_type ch) {
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+        char c = traits_type::to_char_type(ch);
+        Append(&c, 1);
+    }
+    return traits_type::not_eof(ch);
+}
+
+std::streamsize LogChannelBuf::xsputn(const char* s, std::streamsize n) {
+    Append(s, static_cast<size_t>(n));
+    return n;
+}
+
+void LogChannelBuf::Append(const char* s, size_t n) {
+    if (prefix_.empty()) {
+        pending_.append(s, n);
+        return;
+    }
+    while (n > 0) {
+        if (at_line_start_) {
+            pending_ += prefix_;
+            at_line_start_ = false;
+        }
+        const char* newline = static_cast<const char*>(std::memchr(s, '\n', n));
+        size_t length = newline ? static_cast<size_t>(newline - s) + 1 : n;
+        pending_.append(s, length);
+        at_line_start_ = newline != nullptr;
+        s += length;
+        n -= length;
+    }
+}
+
+int LogChannelBuf::sync() {
+    const char* data = pending_.data();
+    size_t remaining = pending_.size();
+    while (remaining > 0) {
+        // Records larger than the ring are published in ring-sized pieces.
+        size_t chunk = std::min(remaining, ring_.Capacity());
+        while (!ring_.TryPush(data, chunk)) {
+            writer_.Wake();
+            std::this_thread::yield();
+        }
+        data += chunk;
+        remaining -= chunk;
+    }
+    if (!pending_.empty()) {
+        published_ += pending_.size();
+        pending_.clear();
+        if (ring_.Size() > ring_.Capacity() / kWakeFraction) {
+            writer_.Wake();
+        }
+    }
+    return 0;
+}
+
+LogChannel::LogChannel(AsyncLogWriter& writer, size_t ring_bytes)
+    : std::ostream(nullptr), buf_(writer, ring_bytes) {
+    rdbuf(&buf_);
+}
+
+AsyncLogWriter::AsyncLogWriter(std::ostream& sink, size_t ring_bytes)
+    : sink_(sink), ring_bytes_(ring_bytes), thread_(&AsyncLogWriter::Run, this) {}
+
+AsyncLogWriter::~AsyncLogWriter() {
+    // Producers are done by now, so the channel list is stable; publish
+    // whatever they left unflushed. This may wait for the writer to make room.
+    for (auto& entry : channels_) {
+        entry.second->flush();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+}
+
+LogChannel& AsyncLogWriter::Channel() {
+    std::thread::id id = std::this_thread::get_id();
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& entry : channels_) {
+        if (entry.first == id) return *entry.second;
+    }
+    channels_.emplace_back(id, std::unique_ptr<LogChannel>(new LogChannel(*this, ring_bytes_)));
+    return *channels_.back().second;
+}
+
+void AsyncLogWriter::Flush() {
+    Channel().flush();
+    std::unique_lock<std::mutex> lock(mutex_);
+    unsigned long ticket = ++flush_requested_;
+    wake_.notify_one();
+    drained_.wait(lock, [&] { return flush_completed_ >= ticket; });
+}
+
+void AsyncLogWriter::Wake() {
+    wake_.notify_one();
+}
+
+bool AsyncLogWriter::DrainAll(std::string& batch) {
+    bool any = false;
+    for (auto& entry : channels_) {
+        LogRing& ring = entry.second->buf().ring();
+        any = ring.Drain(batch) > 0 || any;
+    }
+    return any;
+}
+
+void AsyncLogWriter::Run() {
+    std::string batch;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        unsigned long target = flush_requested_;
+        bool stopping = stop_;
+        DrainAll(batch);
+        lock.unlock();
+
+        if (!batch.empty()) {
+            sink_.write(batch.data(), static_cast<std::streamsize>(batch.size()));
+            sink_.flush();
+            batch.clear();
+        }
+
+        lock.lock();
+        if (target > flush_completed_) {
+            flush_completed_ = target;
+            drained_.notify_all();
+        }
+        if (stopping) break;
+        if (flush_requested_ == flush_completed_ && !stop_) {
+            wake_.wait_for(lock, kWriterPeriod);
+        }
+    }
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Single-producer/single-consumer byte ring. The producing thread pushes
+// whole records; the writer thread drains whatever has been published.
+class LogRing {
+public:
+    explicit LogRing(size_t capacity);  // rounded up to a power of two
+
+    // All-or-nothing: returns false if the record does not fit right now.
+    bool TryPush(const char* data, size_t size);
+    // Appends everything published so far to out; returns the byte count.
+    size_t Drain(std::string& out);
+
+    size_t Capacity() const { return data_.size(); }
+    size_t Size() const { return tail_.load(std::memory_order_relaxed) - head_.load(std::memory_order_relaxed); }
+
+private:
+    std::vector<char> data_;
+    size_t mask_;
+    std::atomic<size_t> head_{0};  // advanced by the consumer
+    std::atomic<size_t> tail_{0};  // advanced by the producer
+};
+
+class AsyncLogWriter;
+
+// Stream buffer of one producer thread. Text accumulates locally and is
+// published to the ring on flush (std::endl, std::flush) so lines are never
+// torn; when the ring is full the producer waits for the writer.
+class LogChannelBuf : public std::streambuf {
+public:
+    LogChannelBuf(AsyncLogWriter& writer, size_t ring_bytes);
+
+    // Inserted at the start of every line, e.g. "[run 12] ".
+    void SetLinePrefix(const std::string& prefix) { prefix_ = prefix; }
+
+    LogRing& ring() { return ring_; }
+    // Bytes published to the writer so far, line prefixes included.
+    size_t BytesPublished() const { return published_; }
+
+protected:
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char* s, std::streamsize n) override;
+    int sync() override;
+
+private:
+    void Append(const char* s, size_t n);
+
+    AsyncLogWriter& writer_;
+    LogRing ring_;
+    std::string pending_{};
+    std::string prefix_{};
+    bool at_line_start_{true};
+    size_t published_{0};
+};
+
+class LogChannel : public std::ostream {
+public:
+    LogChannel(AsyncLogWriter& writer, size_t ring_bytes);
+
+    void SetLinePrefix(const std::string& prefix) { buf_.SetLinePrefix(prefix); }
+    LogChannelBuf& buf() { return buf_; }
+
+private:
+    LogChannelBuf buf_;
+};
+
+// Drains every thread's channel into one sink from a background thread, in
+// large writes and with a single flush per pass. Records from different
+// threads are kept whole but may interleave with each other.
+class AsyncLogWriter {
+public:
+    explicit AsyncLogWriter(std::ostream& sink, size_t ring_bytes = 1 << 20);
+    ~AsyncLogWriter();  // drains all channels, then joins the writer thread
+
+    AsyncLogWriter(const AsyncLogWriter&) = delete;
+    AsyncLogWriter& operator=(const AsyncLogWriter&) = delete;
+
+    // The calling thread's channel, created on first use. Channels live as
+    // long as the writer, so the reference may be cached by the caller.
+    LogChannel& Channel();
+
+    // Blocks until everything published before the call reached the sink.
+    void Flush();
+
+private:
+    friend class LogChannelBuf;
+
+    void Wake();
+    void Run();
+    bool DrainAll(std::string& batch);
+
+    std::ostream& sink_;
+    size_t ring_bytes_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable drained_;
+    std::vector<std::pair<std::thread::id, std::unique_ptr<LogChannel>>> channels_;
+    unsigned long flush_requested_{0};
+    unsigned long flush_completed_{0};
+    bool stop_{false};
+    std::thread thread_;
+};
@@ -0,0 +1,26 @@
+#include "log_level.hpp"
+
+bool ParseLogLevel(const std::string& text, LogLevel& level) {
+    if (text == "summary" || text == "quiet" || text == "0") {
+        level = LogLevel::Summary;
+    } else if (text == "events" || text == "1") {
+        level = LogLevel::Events;
+    } else if (text == "trace" || text == "2") {
+        level = LogLevel::Trace;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* LogLevelName(LogLevel level) {
+    switch (level) {
+        case LogLevel::Summary:
+            return "summary";
+        case LogLevel::Events:
+            return "events";
+        case LogLevel::Trace:
+            return "trace";
+    }
+    return "unknown";
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <string>
+
+// How much of a run is written to the log. Each level includes the ones
+// before it.
+enum class LogLevel : int {
+    Summary = 0,  // final summary only (--quiet)
+    Events = 1,   // + configuration, hourly status lines, assessments, doses, alarms
+    Trace = 2,    // + pain/motivation updates and decision rationale (default)
+};
+
+// Accepts "summary"/"quiet", "events", "trace" or the numeric level.
+bool ParseLogLevel(const std::string& text, LogLevel& level);
+const char* LogLevelName(LogLevel level);
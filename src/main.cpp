@@ -1,134 +1,337 @@
-
-#include <simlib.h>
-
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "config/config_reader.hpp"
-#include "simulation/behavior.hpp"
-#include "simulation/dynamics.hpp"
-#include "simulation/monitoring.hpp"
+#include "logging/async_log.hpp"
+#include "logging/log_level.hpp"
+#include "output/binary_trajectory.hpp"
+#include "output/chrome_trace.hpp"
+#include "output/perf_report.hpp"
+#include "runner/calibration.hpp"
+#include "runner/cohort.hpp"
+#include "runner/ensemble.hpp"
+#include "runner/fork.hpp"
+#include "runner/optimizer.hpp"
+#include "runner/responders.hpp"
+#include "runner/sensitivity.hpp"
+#include "runner/steady_state.hpp"
+#include "runner/sweep.hpp"
+#include "runner/telemetry_tail.hpp"
+#include "simulation/compartment_model.hpp"
+#include "simulation/context.hpp"
+#include "simulation/linear_propagator.hpp"
 #include "simulation/parameters.hpp"
+#include "simulation/report.hpp"
+#include "simulation/snapshot.hpp"
+#include "telemetry/telemetry_publisher.hpp"
 
 int main(int argc, char* argv[]) {
+    // --telemetry applies to every mode, so it is taken out before dispatch.
+    std::string telemetry_name;
+    std::vector<char*> args(argv, argv + argc);
+    for (size_t i = 1; i + 1 < args.size(); ++i) {
+        if (std::string(args[i]) == "--telemetry") {
+            telemetry_name = args[i + 1];
+            args.erase(args.begin() + i, args.begin() + i + 2);
+            break;
+        }
+    }
+    argc = static_cast<int>(args.size());
+    argv = args.data();
+
+    if (argc > 1 && std::string(argv[1]) == "tail") {
+        if (argc < 3) {
+            std::cerr << "Usage: " << argv[0] << " tail <telemetry_name>" << std::endl;
+            return 1;
+        }
+        return RunTelemetryTail(argv[2]);
+    }
+
+    if (argc > 1 && std::string(argv[1]) == "sweep") {
+        if (argc < 5) {
+            std::cerr << "Usage: " << argv[0] << " sweep <sweep.ini> <results.csv> <base.ini> [<base.ini> ...]"
+                      << std::endl;
+            return 1;
+        }
+        return RunSweep(argv[2], argv[3], std::vector<std::string>(argv + 4, argv + argc), telemetry_name);
+    }
+
+    if (argc > 1 && std::string(argv[1]) == "cohort") {
+        if (argc < 4) {
+            std::cerr << "Usage: " << argv[0] << " cohort <cohort.ini> <base.ini> [<output_prefix>]" << std::endl;
+            return 1;
+        }
+        return RunCohort(argv[2], argv[3], argc > 4 ? argv[4] : "", telemetry_name);
+    }
+
+    if (argc > 1 && std::string(argv[1]) == "responders") {
+        if (argc < 4) {
+            std::cerr << "Usage: " << argv[0] << " responders <population.ini> <base.ini> [<output_prefix>]"
+                      << std::endl;
+            return 1;
+        }
+        return RunResponders(argv[2], argv[3], argc > 4 ? argv[4] : "");
+    }
+
+    if (argc > 1 && std::string(argv[1]) == "ensemble") {
+        if (argc < 4) {
+            std::cerr << "Usage: " << argv[0] << " ensemble <ensemble.ini> <base.ini> [<output_prefix>]"
+                      << std::endl;
+            return 1;
+        }
+        return RunEnsemble(argv[2], argv[3], argc > 4 ? argv[4] : "");
+    }
+
+    if (argc > 1 && std::string(argv[1]) == "fork") {
+        if (argc < 4) {
+            std::cerr << "Usage: " << argv[0] << " fork <fork.ini> <base.ini> [<output_prefix>]" << std::endl;
+            return 1;
+        }
+        return RunFork(argv[2], argv[3], argc > 4 ? argv[4] : "");
+    }
+
+    if (argc > 1 && std::string(argv[1]) == "sensitivity") {
+        if (argc < 4) {
+            std::cerr << "Usage: " << argv[0] << " sensitivity <sensitivity.ini> <base.ini> [<results.csv>]"
+                      << std::endl;
+            return 1;
+        }
+        return RunSensitivity(argv[2], argv[3], argc > 4 ? argv[4] : "");
+    }
+
+    if (argc > 1 && std::string(argv[1]) == "calibrate") {
+        if (argc < 5) {
+            std::cerr << "Usage: " << argv[0] << " calibrate <calibration.ini> <base.ini> <observations.csv>"
+                      << std::endl;
+            return 1;
+        }
+        return RunCalibration(argv[2], argv[3], argv[4]);
+    }
+
+    if (argc > 1 && std::string(argv[1]) == "optimize") {
+        if (argc < 4) {
+            std::cerr << "Usage: " << argv[0] << " optimize <optimize.ini> <base.ini> [<results.csv>]" << std::endl;
+            return 1;
+        }
+        return RunOptimizer(argv[2], argv[3], argc > 4 ? argv[4] : "");
+    }
+
+    if (argc > 1 && std::string(argv[1]) == "steady") {
+        if (argc < 3) {
+            std::cerr << "Usage: " << argv[0] << " steady <config.ini>" << std::endl;
+            return 1;
+        }
+        return RunSteadyState(argv[2]);
+    }
+
     std::string config_file = "config.ini";
-    if (argc > 1) {
-        config_file = argv[1];
+    std::string binary_dir;
+    LogLevel log_level = LogLevel::Trace;
+    bool validate_linear = false;
+    bool validate_outcome = false;
+    double checkpoint_time = -1.0;
+    std::string checkpoint_file;
+    std::string restore_file;
+    std::string perf_file;
+    std::string trace_file;
+    std::string model_file;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--binary" && i + 1 < argc) {
+            binary_dir = argv[++i];
+        } else if (arg == "--checkpoint" && i + 2 < argc) {
+            checkpoint_time = std::atof(argv[++i]);
+            checkpoint_file = argv[++i];
+        } else if (arg == "--restore" && i + 1 < argc) {
+            restore_file = argv[++i];
+        } else if (arg == "--perf" && i + 1 < argc) {
+            perf_file = argv[++i];
+        } else if (arg == "--trace" && i + 1 < argc) {
+            trace_file = argv[++i];
+        } else if (arg == "--model" && i + 1 < argc) {
+            model_file = argv[++i];
+        } else if (arg == "--validate-linear") {
+            validate_linear = true;
+        } else if (arg == "--validate-outcome") {
+            validate_outcome = true;
+        } else if (arg == "--quiet") {
+            log_level = LogLevel::Summary;
+        } else if (arg == "--log-level" && i + 1 < argc && ParseLogLevel(argv[i + 1], log_level)) {
+            ++i;
+        } else if (arg.compare(0, 2, "--") == 0) {
+            std::cerr << "Usage: " << argv[0]
+                      << " [config.ini] [--binary <output_dir>] [--quiet | --log-level summary|events|trace]"
+                      << " [--validate-linear] [--validate-outcome] [--checkpoint <hours> <snapshot>] [--restore <snapshot>]"
+                      << " [--perf <report.json>] [--trace <trace.json>] [--telemetry <name>] [--model <model.ini>]"
+                      << std::endl;
+            return 1;
+        } else {
+            config_file = arg;
+        }
     }
 
-    std::cout << "========================================================================" << std::endl;
-    std::cout << "  THE DEADLY SPIRAL: Continuous PK/PD Simulation" << std::endl;
-    std::cout << "  Pharmacokinetic-Pharmacodynamic Model with Metabolic Saturation" << std::endl;
-    std::cout << "========================================================================" << std::endl;
-    std::cout << std::endl;
+    auto start = std::chrono::steady_clock::now();
+    RunOutputStats output_stats;
+
+    // All text goes through the background writer; the run itself never
+    // blocks on the terminal.
+    AsyncLogWriter log_writer(std::cout);
+    LogChannel& log = log_writer.Channel();
+    std::ostream discard(nullptr);
+    std::ostream& header = log_level >= LogLevel::Events ? static_cast<std::ostream&>(log) : discard;
+
+    header << "========================================================================" << std::endl;
+    header << "  THE DEADLY SPIRAL: Continuous PK/PD Simulation" << std::endl;
+    header << "  Pharmacokinetic-Pharmacodynamic Model with Metabolic Saturation" << std::endl;
+    header << "========================================================================" << std::endl;
+    header << std::endl;
 
     ConfigReader config;
-    std::cout << "Loading configuration from: " << config_file << std::endl;
+    header << "Loading configuration from: " << config_file << std::endl;
     if (!config.load(config_file)) {
+        log_writer.Flush();
         std::cerr << "Failed to load configuration. Exiting." << std::endl;
         return 1;
     }
-    std::cout << std::endl;
+    header << std::endl;
 
     ModelParameters params = LoadModelParameters(config);
-    PrintModelParameters(params);
-
-    Init(0, params.sim_duration);
-    SetStep(params.sim_step_min, params.sim_step_max);
-    SetAccuracy(params.sim_accuracy);
-
-    SimulationState state{};
-
-    AbsorptionDynamics dA_dt(params, state);
-    CentralDynamics dC_dt(params, state);
-    PeripheralDynamics dP_dt(params, state);
-    EffectSiteDynamics dCe_dt(params, state);
-    ToleranceDynamics dTol_dt(params, state);
-
-    Integrator A(dA_dt, params.current_dose);  // Start with initial dose in stomach
-    Integrator C(dC_dt, 0.0);
-    Integrator P(dP_dt, 0.0);
-    Integrator Ce(dCe_dt, 0.0);
-    Integrator Tol(dTol_dt, 0.0);
-
-    state.A = &A;
-    state.C = &C;
-    state.P = &P;
-    state.Ce = &Ce;
-    state.Tol = &Tol;
-
-    PetriNetState petri_state{};
-    petri_state.pain_level = 2;  // Start with moderate pain
-    petri_state.motivation = 1.0;
-    petri_state.relief_state = false;
-    petri_state.current_dose = params.current_dose;  // Initialize from config
-
-    std::cout << "Initial Conditions:" << std::endl;
-    std::cout << "  A(0) = " << A.Value() << " mg (first dose)" << std::endl;
-    std::cout << "  C(0) = " << C.Value() << " mg/L" << std::endl;
-    std::cout << "  P(0) = " << P.Value() << " mg/L" << std::endl;
-    std::cout << "  Ce(0) = " << Ce.Value() << " mg/L" << std::endl;
-    std::cout << "  Tol(0) = " << Tol.Value() << std::endl;
-    std::cout << std::endl;
-    std::cout << "========================================================================" << std::endl;
-    std::cout << "                        SIMULATION OUTPUT" << std::endl;
-    std::cout << "========================================================================" << std::endl;
-    std::cout << std::endl;
-
-    (new StatusMonitor(params, state, petri_state))->Activate(Time + params.output_interval);
-    (new PatientAssessment(params, state, petri_state))->Activate(Time + params.assessment_interval);
-
-    Run();
-
-    std::cout << std::endl;
-    std::cout << "========================================================================" << std::endl;
-    std::cout << "                        SIMULATION SUMMARY" << std::endl;
-    std::cout << "========================================================================" << std::endl;
-    std::cout << std::endl;
-    std::cout << "Final State (t=" << Time << " hours):" << std::endl;
-    std::cout << "  A(t) = " << A.Value() << " mg" << std::endl;
-    std::cout << "  C(t) = " << C.Value() << " mg/L" << std::endl;
-    std::cout << "  P(t) = " << P.Value() << " mg/L" << std::endl;
-    std::cout << "  Ce(t) = " << Ce.Value() << " mg/L" << std::endl;
-    std::cout << "  Tol(t) = " << Tol.Value() << std::endl;
-    std::cout << "  Effect = " << CalculateEffect(Ce.Value(), Tol.Value(), params) << "%" << std::endl;
-    std::cout << std::endl;
-
-    double saturation_ratio = C.Value() / params.Km;
-    std::cout << "Pharmacokinetic Analysis:" << std::endl;
-    std::cout << "  Saturation ratio (C/Km) = " << saturation_ratio << std::endl;
-    if (saturation_ratio < 0.5) {
-        std::cout << "  Status: LINEAR REGIME - First-order elimination dominates" << std::endl;
-    } else if (saturation_ratio < 3.0) {
-        std::cout << "  Status: SATURATION ZONE - Nonlinear kinetics active" << std::endl;
-        std::cout << "  WARNING: Approaching dangerous territory!" << std::endl;
+    {
+        PERF_COUNT(PerfTimer timer(output_stats.output_seconds));
+        PrintModelParameters(params, header);
+    }
+
+    CompartmentModel model;
+    if (!model_file.empty()) {
+        if (!LoadCompartmentModel(model_file, model)) {
+            log_writer.Flush();
+            std::cerr << "Failed to load compartment model. Exiting." << std::endl;
+            return 1;
+        }
+        if (!restore_file.empty()) {
+            log_writer.Flush();
+            std::cerr << "--restore cannot be combined with --model. Exiting." << std::endl;
+            return 1;
+        }
+        PrintCompartmentModel(model, header);
+    }
+
+    if (validate_linear) {
+        LinearValidation validation = ValidateLinearAgainstIntegrated(params);
+        log << "Linear Regime Validation (closed form vs. fully integrated):" << std::endl;
+        log << "  Closed-form intervals: " << validation.linear_intervals << " (" << validation.linear_time
+            << " h)" << std::endl;
+        log << "  Outcome: " << (validation.outcome_matches ? "identical" : "DIFFERENT") << std::endl;
+        log << "  Max |dC| = " << validation.max_deviation_C << " mg/L, |dCe| = " << validation.max_deviation_Ce
+            << " mg/L, |dTol| = " << validation.max_deviation_Tol << std::endl;
+        log << "  Accumulated error bound: " << validation.error_bound << std::endl;
+        return validation.outcome_matches ? 0 : 1;
+    }
+
+    if (validate_outcome) {
+        OutcomeValidation validation = ValidateOutcomeDetection(params);
+        const OutcomePrediction& prediction = validation.prediction;
+        log << "Outcome Detection Validation (early stop vs. full-length run):" << std::endl;
+        if (prediction.outcome == PredictedOutcome::None) {
+            log << "  No early stop: the outcome was not determined before t=" << params.sim_duration << " h"
+                << std::endl;
+        } else {
+            log << "  Predicted: " << PredictedOutcomeName(prediction.outcome) << " at t=" << prediction.time
+                << " h (" << validation.hours_saved << " h not simulated)" << std::endl;
+            log << "  Reason: " << prediction.reason << std::endl;
+        }
+        log << "  Full run: " << (validation.actual_alive ? "ALIVE" : "DECEASED");
+        if (!validation.actual_alive) log << " at t=" << validation.actual_time_of_death << " h";
+        log << ", " << validation.actual_escalations << " escalations (" << validation.escalations_at_prediction
+            << " before the stop)" << std::endl;
+        log << "  Prediction: " << (validation.correct ? "correct" : "WRONG") << std::endl;
+        return validation.correct ? 0 : 1;
+    }
+
+    // Binary mode: the per-sample text log is replaced by columnar .npy files.
+    BinaryTrajectoryWriter writer;
+    SimulationContext ctx(params, log);
+    ctx.SetLogLevel(binary_dir.empty() ? log_level : LogLevel::Summary);
+    if (!model_file.empty()) ctx.UseCompartmentModel(model);
+    if (!binary_dir.empty()) {
+        if (!writer.Open(binary_dir, params, config_file)) {
+            return 1;
+        }
+        ctx.AddTrajectorySink(writer);
+    }
+    // Live samples and events for `sim tail` / viewer.py --live.
+    TelemetryPublisher telemetry;
+    std::unique_ptr<TelemetrySink> telemetry_sink;
+    if (!telemetry_name.empty()) {
+        if (!telemetry.Open(telemetry_name, 1, 1)) {
+            return 1;
+        }
+        telemetry_sink.reset(new TelemetrySink(*telemetry.Channel(), 0));
+        ctx.AddTrajectorySink(*telemetry_sink);
+        telemetry.Channel()->RunStart(0, params.sim_duration);
+    }
+    // The timeline stays in memory until the run is over.
+    std::unique_ptr<TraceRecorder> tracer;
+    if (!trace_file.empty()) {
+        tracer.reset(new TraceRecorder());
+        ctx.SetTracer(*tracer);
+    }
+
+    if (!restore_file.empty()) {
+        SimulationSnapshot snapshot;
+        if (!LoadSnapshot(restore_file, snapshot)) {
+            return 1;
+        }
+        ctx.Restore(snapshot);
+        header << "Resuming from " << restore_file << " at t=" << ctx.Time() << " hours" << std::endl;
     } else {
-        std::cout << "  Status: PLATEAU REGIME - Zero-order elimination (capacity exhausted)" << std::endl;
-        std::cout << "  CRITICAL: System in deadly spiral zone!" << std::endl;
-    }
-    std::cout << std::endl;
-
-    double EC50_current = params.EC50_base * (1.0 + Tol.Value());
-    double tolerance_factor = EC50_current / params.EC50_base;
-    std::cout << "Pharmacodynamic Analysis:" << std::endl;
-    std::cout << "  Current EC50 = " << EC50_current << " mg/L (baseline: " << params.EC50_base << " mg/L)" << std::endl;
-    std::cout << "  Tolerance multiplier = " << tolerance_factor << "x" << std::endl;
-    std::cout << "  Required dose for same effect = " << tolerance_factor * params.current_dose << " mg" << std::endl;
-    std::cout << std::endl;
-
-    std::cout << "Behavioral Analysis (Petri Net):" << std::endl;
-    std::cout << "  Patient Status: " << (petri_state.patient_alive ? "ALIVE" : "DECEASED") << std::endl;
-    std::cout << "  Final Pain Level: " << petri_state.pain_level << " (0=None, 1=Mild, 2=Moderate, 3=Severe)" << std::endl;
-    std::cout << "  Total Dose Escalations: " << petri_state.dose_history.size() << std::endl;
-    if (!petri_state.dose_history.empty()) {
-        auto first_dose = petri_state.dose_history.front().dose;
-        auto last_dose = petri_state.dose_history.back().dose;
-        std::cout << "  Dose Escalation: " << first_dose << " mg → " << last_dose << " mg (" 
-                  << ((last_dose / first_dose - 1.0) * 100) << "% increase)" << std::endl;
-    }
-    std::cout << std::endl;
-
-    std::cout << "========================================================================" << std::endl;
+        PERF_COUNT(PerfTimer timer(output_stats.output_seconds));
+        PrintInitialConditions(ctx, header);
+    }
+    if (!checkpoint_file.empty()) {
+        ctx.RunUntil(checkpoint_time);
+        SimulationSnapshot snapshot;
+        if (!ctx.Checkpoint(snapshot) || !SaveSnapshot(checkpoint_file, snapshot)) {
+            log_writer.Flush();
+            std::cerr << "Failed to write checkpoint. Exiting." << std::endl;
+            return 1;
+        }
+        header << "\n>>> CHECKPOINT written to " << checkpoint_file << " at t=" << ctx.Time() << " hours <<<"
+               << std::endl;
+    }
+    ctx.Run();
+    if (telemetry_sink) {
+        telemetry.Channel()->RunEnd(0, SummarizeRun(ctx));
+        telemetry.Close();
+    }
+    {
+        PERF_COUNT(PerfTimer timer(output_stats.output_seconds));
+        if (!binary_dir.empty()) {
+            writer.Close();
+            header << "Trajectory written to " << binary_dir << "/ (" << writer.SampleCount() << " samples)"
+                   << std::endl;
+        }
+        PrintSimulationSummary(ctx);
+    }
+
+    if (tracer && !WriteChromeTrace(trace_file, *tracer, config_file)) {
+        return 1;
+    }
+
+    // Instrumented builds always leave a report next to a binary run.
+    if (perf_file.empty() && kPerfCountersEnabled && !binary_dir.empty()) perf_file = binary_dir + "/perf.json";
+    if (!perf_file.empty()) {
+        output_stats.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        output_stats.text_bytes = log.buf().BytesPublished();
+        output_stats.binary_bytes = writer.BytesWritten();
+        if (!WritePerfReport(perf_file, config_file, ctx, output_stats)) {
+            return 1;
+        }
+    }
 
     return 0;
 }
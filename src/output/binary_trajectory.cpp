@@ -0,0 +1,196 @@
+#include "binary_trajectory.hpp"
+
+#include <sys/stat.h>
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+namespace {
+
+const int kFormatVersion = 1;
+
+const NpyField kF8 = {"", 'f', 8};
+
+}  // namespace
+
+std::string JsonString(const std::string& text) {
+    std::string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') quoted.push_back('\\');
+        quoted.push_back(c);
+    }
+    return quoted + "\"";
+}
+
+BinaryTrajectoryWriter::~BinaryTrajectoryWriter() {
+    Close();
+}
+
+bool BinaryTrajectoryWriter::Open(const std::string& directory, const ModelParameters& params,
+                                  const std::string& source) {
+    Close();
+
+    if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) {
+        std::cerr << "Error: Cannot create output directory " << directory << ": " << std::strerror(errno)
+                  << std::endl;
+        return false;
+    }
+    directory_ = directory;
+    source_ = source;
+    params_ = params;
+
+    std::string base = directory + "/";
+    bool ok = time_.Open(base + "time.npy", {kF8}) && A_.Open(base + "A.npy", {kF8}) &&
+              C_.Open(base + "C.npy", {kF8}) && P_.Open(base + "P.npy", {kF8}) &&
+              Ce_.Open(base + "Ce.npy", {kF8}) && Tol_.Open(base + "Tol.npy", {kF8}) &&
+              effect_.Open(base + "Effect.npy", {kF8}) &&
+              assessments_.Open(base + "assessments.npy", {{"time", 'f', 8},
+                                                           {"effect", 'f', 8},
+                                                           {"motivation", 'f', 8},
+                                                           {"current_dose", 'f', 8},
+                                                           {"pain_level", 'i', 4},
+                                                           {"relief_state", 'i', 4},
+                                                           {"decision", 'i', 4}}) &&
+              doses_.Open(base + "doses.npy", {{"time", 'f', 8},
+                                               {"dose", 'f', 8},
+                                               {"C", 'f', 8},
+                                               {"Ce", 'f', 8},
+                                               {"Tol", 'f', 8},
+                                               {"effect", 'f', 8},
+                                               {"index", 'i', 4}}) &&
+              phases_.Open(base + "phases.npy", {{"time", 'f', 8},
+                                                 {"phase", 'i', 4},
+                                                 {"saturation_ratio", 'f', 8},
+                                                 {"C", 'f', 8}}) &&
+              naloxone_.Open(base + "naloxone.npy", {{"time", 'f', 8},
+                                                     {"outcome", 'i', 4},
+                                                     {"time_since_overdose", 'f', 8}}) &&
+              toxicity_.Open(base + "toxicity.npy", {{"time", 'f', 8},
+                                                     {"kind", 'i', 4},
+                                                     {"C", 'f', 8},
+                                                     {"effect", 'f', 8}});
+    open_ = ok;
+    if (!ok) Close();
+    return ok;
+}
+
+void BinaryTrajectoryWriter::Close() {
+    bool was_open = open_;
+    open_ = false;
+    for (NpyWriter* writer : {&time_, &A_, &C_, &P_, &Ce_, &Tol_, &effect_, &assessments_, &doses_, &phases_,
+                              &naloxone_, &toxicity_}) {
+        writer->Close();
+    }
+    if (was_open) {
+        WriteTrajectoryPyramid(directory_, {"A", "C", "P", "Ce", "Tol", "Effect"}, pyramid_);
+        WriteHeader();
+    }
+}
+
+size_t BinaryTrajectoryWriter::BytesWritten() const {
+    size_t bytes = 0;
+    for (const NpyWriter* writer : {&time_, &A_, &C_, &P_, &Ce_, &Tol_, &effect_, &assessments_, &doses_, &phases_,
+                                    &naloxone_, &toxicity_}) {
+        bytes += writer->Count() * writer->RecordSize();
+    }
+    return bytes;
+}
+
+void BinaryTrajectoryWriter::OnSample(double t, double A, double C, double P, double Ce, double Tol,
+                                      double effect) {
+    if (!open_) return;
+    time_.Append(t);
+    A_.Append(A);
+    C_.Append(C);
+    P_.Append(P);
+    Ce_.Append(Ce);
+    Tol_.Append(Tol);
+    effect_.Append(effect);
+}
+
+void BinaryTrajectoryWriter::OnAssessment(double t, double effect, const PetriNetState& petri_state,
+                                          AssessmentDecision decision) {
+    if (!open_) return;
+    unsigned char record[44];
+    NpyRecord(record) << t << effect << petri_state.motivation << petri_state.current_dose
+                      << static_cast<int32_t>(petri_state.pain_level)
+                      << static_cast<int32_t>(petri_state.relief_state ? 1 : 0) << static_cast<int32_t>(decision);
+    assessments_.Append(record);
+}
+
+void BinaryTrajectoryWriter::OnDose(const PetriNetState::DoseRecord& dose, size_t total_doses) {
+    if (!open_) return;
+    unsigned char record[52];
+    NpyRecord(record) << dose.time << dose.dose << dose.C << dose.Ce << dose.Tol << dose.effect
+                      << static_cast<int32_t>(total_doses);
+    doses_.Append(record);
+}
+
+void BinaryTrajectoryWriter::OnPhaseTransition(double t, int phase, double saturation_ratio, double C) {
+    if (!open_) return;
+    unsigned char record[28];
+    NpyRecord(record) << t << static_cast<int32_t>(phase) << saturation_ratio << C;
+    phases_.Append(record);
+}
+
+void BinaryTrajectoryWriter::OnNaloxone(double t, NaloxoneOutcome outcome, double time_since_overdose) {
+    if (!open_) return;
+    unsigned char record[20];
+    NpyRecord(record) << t << static_cast<int32_t>(outcome) << time_since_overdose;
+    naloxone_.Append(record);
+}
+
+void BinaryTrajectoryWriter::OnToxicity(double t, ToxicityKind kind, double C, double effect) {
+    if (!open_) return;
+    unsigned char record[28];
+    NpyRecord(record) << t << static_cast<int32_t>(kind) << C << effect;
+    toxicity_.Append(record);
+}
+
+bool BinaryTrajectoryWriter::WriteHeader() const {
+    std::string path = directory_ + "/header.json";
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Error: Cannot open " << path << " for writing" << std::endl;
+        return false;
+    }
+
+    file << std::setprecision(17);
+    file << "{\n";
+    file << "  \"format\": \"deadly-spiral-trajectory\",\n";
+    file << "  \"version\": " << kFormatVersion << ",\n";
+    file << "  \"source\": " << JsonString(source_) << ",\n";
+    file << "  \"samples\": " << time_.Count() << ",\n";
+    file << "  \"columns\": [\"time\", \"A\", \"C\", \"P\", \"Ce\", \"Tol\", \"Effect\"],\n";
+    file << "  \"events\": {\"assessments\": " << assessments_.Count() << ", \"doses\": " << doses_.Count()
+         << ", \"phases\": " << phases_.Count() << ", \"naloxone\": " << naloxone_.Count()
+         << ", \"toxicity\": " << toxicity_.Count() << "},\n";
+    file << "  \"pyramid\": [";
+    for (size_t i = 0; i < pyramid_.size(); ++i) {
+        const PyramidLevel& level = pyramid_[i];
+        file << (i ? ",\n" : "\n") << "    {\"level\": " << level.level << ", \"bucket\": " << level.bucket
+             << ", \"buckets\": " << level.buckets << ", \"file\": " << JsonString(level.file) << "}";
+    }
+    file << (pyramid_.empty() ? "],\n" : "\n  ],\n");
+    file << "  \"codes\": {\n";
+    file << "    \"decision\": {\"-1\": \"none\", \"0\": \"stable\", \"1\": \"increase\", \"2\": \"maintain\"},\n";
+    file << "    \"naloxone\": {\"0\": \"dispatched\", \"1\": \"arrived\", \"2\": \"revived\", "
+            "\"3\": \"window_expired\", \"4\": \"failed\"},\n";
+    file << "    \"toxicity\": {\"0\": \"toxic_warning\", \"1\": \"critical_overdose\", "
+            "\"2\": \"respiratory_arrest\"}\n";
+    file << "  },\n";
+    file << "  \"parameters\": {\n";
+    for (const std::string& key : ModelParameterKeys()) {
+        double value = 0.0;
+        GetModelParameter(params_, key, value);
+        file << "    " << JsonString(key) << ": " << value << ",\n";
+    }
+    file << "    \"petri_net_enabled\": " << (params_.petri_net_enabled ? "true" : "false") << ",\n";
+    file << "    \"naloxone_available\": " << (params_.naloxone_available ? "true" : "false") << "\n";
+    file << "  }\n";
+    file << "}\n";
+    return file.good();
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "../simulation/parameters.hpp"
+#include "../simulation/trajectory_sink.hpp"
+#include "npy_writer.hpp"
+#include "trajectory_pyramid.hpp"
+
+// text as a quoted JSON string.
+std::string JsonString(const std::string& text);
+
+// Writes a run as a directory of .npy files instead of formatted text:
+//
+//   header.json      format version, record counts and a ModelParameters snapshot
+//   time.npy, A.npy, C.npy, P.npy, Ce.npy, Tol.npy, Effect.npy
+//                    one float64 column per sampled quantity (output_interval)
+//   assessments.npy, doses.npy, phases.npy, naloxone.npy, toxicity.npy
+//                    structured arrays, one record per event
+//   pyramid_<k>.npy  min/max/LTTB summary of the columns per 2^k samples,
+//                    written on Close() for long runs (WriteTrajectoryPyramid)
+//
+// Columns load with np.load(dir + "/C.npy", mmap_mode="r"); event files go
+// straight into pandas.DataFrame(np.load(...)).
+class BinaryTrajectoryWriter : public TrajectorySink {
+public:
+    BinaryTrajectoryWriter() = default;
+    ~BinaryTrajectoryWriter() override;
+
+    bool Open(const std::string& directory, const ModelParameters& params, const std::string& source);
+    // Finalizes array shapes, builds the pyramid and writes header.json.
+    // Safe to call twice.
+    void Close();
+
+    size_t SampleCount() const { return time_.Count(); }
+    // Record bytes appended to all columns and event files (headers excluded).
+    size_t BytesWritten() const;
+
+    void OnSample(double t, double A, double C, double P, double Ce, double Tol, double effect) override;
+    void OnAssessment(double t, double effect, const PetriNetState& petri_state,
+                      AssessmentDecision decision) override;
+    void OnDose(const PetriNetState::DoseRecord& record, size_t total_doses) override;
+    void OnPhaseTransition(double t, int phase, double saturation_ratio, double C) override;
+    void OnNaloxone(double t, NaloxoneOutcome outcome, double time_since_overdose) override;
+    void OnToxicity(double t, ToxicityKind kind, double C, double effect) override;
+
+private:
+    bool WriteHeader() const;
+
+    std::string directory_{};
+    std::string source_{};
+    ModelParameters params_{};
+    bool open_{false};
+    std::vector<PyramidLevel> pyramid_{};
+
+    NpyWriter time_{}, A_{}, C_{}, P_{}, Ce_{}, Tol_{}, effect_{};
+    NpyWriter assessments_{}, doses_{}, phases_{}, naloxone_{}, toxicity_{};
+};
@@ -0,0 +1,131 @@
+#include "chrome_trace.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "binary_trajectory.hpp"
+
+namespace {
+
+const int kWallPid = 1;
+const int kSimulatedPid = 2;
+const int kRunTid = 1;
+// Timeline microseconds per simulated hour in the simulated-time view.
+const double kMicrosecondsPerHour = 1000.0;
+// A counter point is only written when the value moved by more than this
+// fraction since the last point written; long runs have millions of steps.
+const double kCounterResolution = 1e-3;
+
+struct TraceView {
+    int pid;
+    const char* name;
+    bool simulated;
+};
+
+const TraceView kViews[] = {
+    {kWallPid, "Wall clock", false},
+    {kSimulatedPid, "Simulated time (1 ms = 1 h)", true},
+};
+
+class EventWriter {
+public:
+    explicit EventWriter(std::ostream& out) : out_(out) {}
+
+    void Metadata(int pid, const char* kind, const char* name) {
+        Begin();
+        std::snprintf(buffer_, sizeof(buffer_),
+                      "{\"name\":\"%s\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", kind, pid,
+                      kRunTid, name);
+        out_ << buffer_;
+    }
+
+    void Span(int pid, const char* name, double ts, double dur, double sim_start, double sim_end) {
+        Begin();
+        std::snprintf(buffer_, sizeof(buffer_),
+                      "{\"name\":\"%s\",\"cat\":\"run\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,"
+                      "\"tid\":%d,\"args\":{\"sim_start_h\":%.9g,\"sim_end_h\":%.9g}}",
+                      name, ts, dur, pid, kRunTid, sim_start, sim_end);
+        out_ << buffer_;
+    }
+
+    void Counter(int pid, const char* name, double ts, double value) {
+        Begin();
+        std::snprintf(buffer_, sizeof(buffer_),
+                      "{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":%d,\"args\":{\"value\":%.9g}}", name, ts,
+                      pid, value);
+        out_ << buffer_;
+    }
+
+private:
+    void Begin() {
+        if (!first_) out_ << ",\n";
+        first_ = false;
+    }
+
+    std::ostream& out_;
+    char buffer_[256];
+    bool first_{true};
+};
+
+// One counter, thinned to points where its value changed noticeably.
+class CounterTrack {
+public:
+    CounterTrack(EventWriter& events, int pid, const char* name) : events_(events), pid_(pid), name_(name) {}
+
+    void Add(double ts, double value, bool force) {
+        if (!written_ || force || std::fabs(value - last_) > kCounterResolution * std::fabs(last_)) {
+            events_.Counter(pid_, name_, ts, value);
+            last_ = value;
+            written_ = true;
+        }
+    }
+
+private:
+    EventWriter& events_;
+    int pid_;
+    const char* name_;
+    double last_{0.0};
+    bool written_{false};
+};
+
+}  // namespace
+
+bool WriteChromeTrace(const std::string& path, const TraceRecorder& recorder, const std::string& source) {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Error: Cannot open " << path << " for writing" << std::endl;
+        return false;
+    }
+
+    file << "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"source\":" << JsonString(source) << "},\n"
+         << "\"traceEvents\":[\n";
+    EventWriter events(file);
+    for (const TraceView& view : kViews) {
+        events.Metadata(view.pid, "process_name", view.name);
+        events.Metadata(view.pid, "thread_name", "run");
+
+        for (const TraceRecorder::Span& span : recorder.spans()) {
+            double ts = view.simulated ? span.sim_start * kMicrosecondsPerHour : span.wall_start;
+            double dur = view.simulated ? span.sim_duration * kMicrosecondsPerHour : span.wall_duration;
+            events.Span(view.pid, TraceSpanName(span.kind), ts, dur, span.sim_start,
+                        span.sim_start + span.sim_duration);
+        }
+        const std::vector<TraceRecorder::Sample>& samples = recorder.samples();
+        CounterTrack step(events, view.pid, "step [h]");
+        CounterTrack saturation(events, view.pid, "C/Km");
+        CounterTrack tolerance(events, view.pid, "Tol");
+        for (size_t i = 0; i < samples.size(); ++i) {
+            const TraceRecorder::Sample& sample = samples[i];
+            double ts = view.simulated ? sample.sim_time * kMicrosecondsPerHour : sample.wall_time;
+            bool last = i + 1 == samples.size();
+            step.Add(ts, sample.step, last);
+            saturation.Add(ts, sample.saturation_ratio, last);
+            tolerance.Add(ts, sample.Tol, last);
+        }
+    }
+    file << "\n]}\n";
+    return file.good();
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <string>
+
+#include "../simulation/trace.hpp"
+
+// Writes a recorded run as Chrome trace-event JSON, loadable in
+// chrome://tracing and ui.perfetto.dev. The run appears twice, as two
+// processes: "Wall clock" places every span and counter at the real time it
+// was recorded, "Simulated time" at the simulated time, scaled so that one
+// millisecond on the timeline is one simulated hour. Each view has the spans
+// on one track and counter tracks for the step size, C/Km and Tol; counter
+// points where the value barely changed are left out.
+bool WriteChromeTrace(const std::string& path, const TraceRecorder& recorder, const std::string& source);
@@ -0,0 +1,124 @@
+#include "npy_writer.hpp"
+
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+const size_t kBufferBytes = 1 << 16;
+const size_t kHeaderAlign = 64;  // numpy pads headers so the data is 64-byte aligned
+const char kMagic[] = "\x93NUMPY";
+
+char ByteOrder() {
+    const uint16_t probe = 1;
+    unsigned char first;
+    std::memcpy(&first, &probe, 1);
+    return first == 1 ? '<' : '>';
+}
+
+}  // namespace
+
+NpyWriter::~NpyWriter() {
+    Close();
+}
+
+bool NpyWriter::Open(const std::string& path, const std::vector<NpyField>& fields) {
+    Close();
+
+    char order = ByteOrder();
+    std::ostringstream descr;
+    record_size_ = 0;
+    if (fields.size() == 1 && fields[0].name.empty()) {
+        descr << "'" << order << fields[0].kind << fields[0].size << "'";
+        record_size_ = fields[0].size;
+    } else {
+        descr << "[";
+        for (size_t i = 0; i < fields.size(); ++i) {
+            if (i > 0) descr << ", ";
+            descr << "('" << fields[i].name << "', '" << order << fields[i].kind << fields[i].size << "')";
+            record_size_ += fields[i].size;
+        }
+        descr << "]";
+    }
+    descr_ = descr.str();
+
+    file_ = std::fopen(path.c_str(), "wb");
+    if (!file_) {
+        std::cerr << "Error: Cannot open " << path << " for writing" << std::endl;
+        return false;
+    }
+    path_ = path;
+    count_ = 0;
+    buffer_.clear();
+    buffer_.reserve(kBufferBytes);
+
+    // Size the header for the widest possible shape so it never has to grow.
+    header_size_ = 0;
+    header_size_ = Header(static_cast<size_t>(-1)).size();
+    std::string header = Header(0);
+    std::fwrite(header.data(), 1, header.size(), file_);
+    return true;
+}
+
+void NpyWriter::Close() {
+    if (!file_) return;
+
+    Flush();
+    std::string header = Header(count_);
+    std::fseek(file_, 0, SEEK_SET);
+    std::fwrite(header.data(), 1, header.size(), file_);
+    if (std::fclose(file_) != 0) {
+        std::cerr << "Error: Failed to finish writing " << path_ << std::endl;
+    }
+    file_ = nullptr;
+}
+
+void NpyWriter::Append(const void* record) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(record);
+    buffer_.insert(buffer_.end(), bytes, bytes + record_size_);
+    ++count_;
+    if (buffer_.size() >= kBufferBytes) {
+        Flush();
+    }
+}
+
+void NpyWriter::Append(double value) {
+    Append(&value);
+}
+
+std::string NpyWriter::Header(size_t count) const {
+    std::ostringstream dict;
+    dict << "{'descr': " << descr_ << ", 'fortran_order': False, 'shape': (" << count << ",), }";
+    std::string text = dict.str();
+
+    // magic (6) + version (2) + header length (2) + dict + padding + '\n'
+    size_t prefix = sizeof(kMagic) - 1 + 4;
+    size_t total = header_size_;
+    if (total == 0) {
+        total = (prefix + text.size() + 1 + kHeaderAlign - 1) / kHeaderAlign * kHeaderAlign;
+    }
+    text.append(total - prefix - text.size() - 1, ' ');
+    text.push_back('\n');
+
+    std::string header(kMagic, sizeof(kMagic) - 1);
+    header.push_back(1);
+    header.push_back(0);
+    uint16_t length = static_cast<uint16_t>(text.size());
+    header.push_back(static_cast<char>(length & 0xFF));
+    header.push_back(static_cast<char>(length >> 8));
+    return header + text;
+}
+
+void NpyWriter::Flush() {
+    if (!buffer_.empty()) {
+        std::fwrite(buffer_.data(), 1, buffer_.size(), file_);
+        buffer_.clear();
+    }
+}
+
+NpyRecord& NpyRecord::Put(const void* value, size_t size) {
+    std::memcpy(data_, value, size);
+    data_ += size;
+    return *this;
+}
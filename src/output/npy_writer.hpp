@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// One field of an .npy record. Kinds follow numpy's type characters
+// ('f' float, 'i' signed integer); size is in bytes.
+struct NpyField {
+    std::string name;
+    char kind;
+    int size;
+};
+
+// Streams fixed-size records into a NumPy .npy (format 1.0) file. The header
+// reserves room for any record count and is rewritten with the final shape on
+// Close(), so the file can be appended to without knowing its length upfront.
+// A single unnamed field produces a plain 1-D array, anything else a
+// structured array readable with np.load() / pandas.DataFrame().
+class NpyWriter {
+public:
+    NpyWriter() = default;
+    ~NpyWriter();
+
+    NpyWriter(const NpyWriter&) = delete;
+    NpyWriter& operator=(const NpyWriter&) = delete;
+
+    bool Open(const std::string& path, const std::vector<NpyField>& fields);
+    void Close();
+    bool IsOpen() const { return file_ != nullptr; }
+
+    // Appends one record of RecordSize() bytes in field order, host byte order.
+    void Append(const void* record);
+    void Append(double value);  // shortcut for single-field f8 files
+
+    size_t RecordSize() const { return record_size_; }
+    size_t Count() const { return count_; }
+
+private:
+    std::string Header(size_t count) const;
+    void Flush();
+
+    std::FILE* file_{nullptr};
+    std::string path_{};
+    std::string descr_{};
+    size_t header_size_{0};
+    size_t record_size_{0};
+    size_t count_{0};
+    std::vector<unsigned char> buffer_{};
+};
+
+// Packs fields into a record buffer back to back, without padding, matching
+// the offsets NpyWriter declares in the header.
+class NpyRecord {
+public:
+    explicit NpyRecord(unsigned char* data) : data_(data) {}
+
+    NpyRecord& operator<<(double value) { return Put(&value, sizeof(value)); }
+    NpyRecord& operator<<(int32_t value) { return Put(&value, sizeof(value)); }
+
+private:
+    NpyRecord& Put(const void* value, size_t size);
+
+    unsigned char* data_;
+};
@@ -0,0 +1,78 @@
+#include "perf_report.hpp"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+#include "../simulation/context.hpp"
+#include "binary_trajectory.hpp"
+
+namespace {
+
+const int kFormatVersion = 1;
+
+const char* const kBlockNames[] = {"A", "C", "P", "Ce", "Tol"};
+const size_t kModelBlocks = 5;
+
+const char* const kEventNames[kPerfEventKinds] = {"StatusMonitor", "PatientAssessment", "NaloxoneRescue",
+                                                  "DosingEvent", "other"};
+
+}  // namespace
+
+bool WritePerfReport(const std::string& path, const std::string& source, SimulationContext& ctx,
+                     const RunOutputStats& output) {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Error: Cannot open " << path << " for writing" << std::endl;
+        return false;
+    }
+
+    SolverStats stats = ctx.solver_stats();
+    const PerfCounters& perf = ctx.perf_counters();
+
+    file << std::setprecision(9);
+    file << "{\n";
+    file << "  \"format\": \"deadly-spiral-perf\",\n";
+    file << "  \"version\": " << kFormatVersion << ",\n";
+    file << "  \"source\": " << JsonString(source) << ",\n";
+    file << "  \"instrumented\": " << (kPerfCountersEnabled ? "true" : "false") << ",\n";
+    file << "  \"simulated_hours\": " << ctx.Time() << ",\n";
+    file << "  \"solver\": {\"accepted_steps\": " << stats.accepted_steps
+         << ", \"rejected_steps\": " << stats.rejected_steps << ", \"rhs_evaluations\": " << stats.rhs_evaluations
+         << ", \"jacobian_evaluations\": " << stats.jacobian_evaluations
+         << ", \"stiffness_switches\": " << stats.stiffness_switches << ", \"state_events\": " << stats.state_events
+         << ", \"linear_intervals\": " << stats.linear_intervals << "},\n";
+
+    if (kPerfCountersEnabled) {
+        file << "  \"rhs_calls\": {";
+        unsigned long sensitivity_calls = 0;
+        for (size_t i = 0; i < perf.block_evaluations.size(); ++i) {
+            if (i < kModelBlocks) {
+                file << "\"" << kBlockNames[i] << "\": " << perf.block_evaluations[i] << ", ";
+            } else {
+                sensitivity_calls += perf.block_evaluations[i];
+            }
+        }
+        file << "\"sensitivities\": " << sensitivity_calls << ", \"through_kernel\": " << perf.kernel_evaluations
+             << "},\n";
+        // Steps cut short to land on an event are left out of the extremes.
+        bool stepped = perf.free_steps > 0;
+        file << "  \"step_size\": {\"steps\": " << perf.free_steps << ", \"min\": " << (stepped ? perf.min_step : 0.0)
+             << ", \"max\": " << perf.max_step << "},\n";
+        file << "  \"events\": {";
+        for (int kind = 0; kind < kPerfEventKinds; ++kind) {
+            file << "\"" << kEventNames[kind] << "\": " << perf.events[kind] << ", ";
+        }
+        file << "\"total\": " << ctx.EventsProcessed() << "},\n";
+        file << "  \"seconds\": {\"wall\": " << output.wall_seconds << ", \"integration\": "
+             << perf.integration_seconds << ", \"events\": " << perf.event_seconds
+             << ", \"output\": " << output.output_seconds << "},\n";
+    } else {
+        file << "  \"events\": {\"total\": " << ctx.EventsProcessed() << "},\n";
+        file << "  \"seconds\": {\"wall\": " << output.wall_seconds << "},\n";
+    }
+    file << "  \"bytes_written\": {\"text\": " << output.text_bytes << ", \"binary\": " << output.binary_bytes
+         << "}\n";
+    file << "}\n";
+    return file.good();
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+class SimulationContext;
+
+// What the driver knows about a run beyond the context's own counters.
+struct RunOutputStats {
+    double wall_seconds{0.0};
+    double output_seconds{0.0};  // configuration header, final summary, closing files
+    size_t text_bytes{0};
+    size_t binary_bytes{0};
+};
+
+// Writes the run's counters and timers as JSON. Solver totals and the event
+// count are always present; per-block evaluations, step sizes, events by
+// type and the integration/event timers only in PERF_COUNTERS builds
+// ("instrumented": true).
+bool WritePerfReport(const std::string& path, const std::string& source, SimulationContext& ctx,
+                     const RunOutputStats& output);
@@ -0,0 +1,184 @@
+#include "trajectory_pyramid.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+#include "npy_writer.hpp"
+
+namespace {
+
+const int kFirstLevel = 3;
+const size_t kMinBuckets = 512;
+const size_t kMinSamples = 4096;
+
+}  // namespace
+
+NpyColumn::~NpyColumn() {
+    Close();
+}
+
+bool NpyColumn::Open(const std::string& path) {
+    Close();
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        std::cerr << "Error: Cannot open " << path << ": " << std::strerror(errno) << std::endl;
+        if (fd >= 0) close(fd);
+        return false;
+    }
+    bytes_ = static_cast<size_t>(info.st_size);
+    memory_ = bytes_ > 0 ? mmap(nullptr, bytes_, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (memory_ == MAP_FAILED) {
+        std::cerr << "Error: Cannot map " << path << ": " << std::strerror(errno) << std::endl;
+        memory_ = nullptr;
+        return false;
+    }
+
+    // magic (6) + version (2) + header length (2, or 4 from format 2.0) + dict
+    const unsigned char* bytes = static_cast<const unsigned char*>(memory_);
+    size_t offset = 0;
+    if (bytes_ >= 10 && std::memcmp(bytes, "\x93NUMPY", 6) == 0) {
+        if (bytes[6] == 1) {
+            offset = 10 + (bytes[8] | bytes[9] << 8);
+        } else if (bytes_ >= 12) {
+            offset = 12 + (bytes[8] | bytes[9] << 8 | bytes[10] << 16 | static_cast<size_t>(bytes[11]) << 24);
+        }
+    }
+    std::string dict(reinterpret_cast<const char*>(bytes), offset < bytes_ ? offset : 0);
+    if (offset == 0 || offset > bytes_ || dict.find("'<f8'") == std::string::npos) {
+        std::cerr << "Error: " << path << " is not a float64 .npy column" << std::endl;
+        Close();
+        return false;
+    }
+    data_ = reinterpret_cast<const double*>(bytes + offset);
+    size_ = (bytes_ - offset) / sizeof(double);
+    return true;
+}
+
+void NpyColumn::Close() {
+    if (memory_) munmap(memory_, bytes_);
+    memory_ = nullptr;
+    bytes_ = 0;
+    data_ = nullptr;
+    size_ = 0;
+}
+
+bool WriteTrajectoryPyramid(const std::string& directory, const std::vector<std::string>& columns,
+                            std::vector<PyramidLevel>& levels) {
+    levels.clear();
+    std::string base = directory + "/";
+
+    NpyColumn time;
+    if (!time.Open(base + "time.npy")) return false;
+    size_t n = time.size();
+    if (n <= kMinSamples) return true;
+
+    std::vector<std::unique_ptr<NpyColumn>> values;
+    for (const std::string& name : columns) {
+        values.emplace_back(new NpyColumn());
+        if (!values.back()->Open(base + name + ".npy")) return false;
+        if (values.back()->size() != n) {
+            std::cerr << "Error: " << base << name << ".npy has " << values.back()->size() << " samples, time.npy "
+                      << n << std::endl;
+            return false;
+        }
+    }
+
+    std::vector<NpyField> fields = {{"t0", 'f', 8}, {"t1", 'f', 8}};
+    for (const std::string& name : columns) {
+        fields.push_back({name + "_min", 'f', 8});
+        fields.push_back({name + "_max", 'f', 8});
+        fields.push_back({name + "_t", 'f', 8});
+        fields.push_back({name, 'f', 8});
+    }
+
+    const double* t = time.data();
+    size_t width = columns.size();
+    std::vector<double> record(2 + 4 * width);
+    std::vector<double> previous_t(width), previous_v(width);
+
+    for (int k = kFirstLevel;; ++k) {
+        size_t bucket = size_t(1) << k;
+        size_t buckets = (n + bucket - 1) / bucket;
+        if (buckets < kMinBuckets) break;
+
+        PyramidLevel level;
+        level.level = k;
+        level.bucket = bucket;
+        level.buckets = buckets;
+        level.file = "pyramid_" + std::to_string(k) + ".npy";
+
+        NpyWriter writer;
+        if (!writer.Open(base + level.file, fields)) return false;
+
+        // Largest-triangle-three-buckets: each bucket keeps the sample that
+        // spans the largest triangle with the sample kept for the previous
+        // bucket and the mean of the next one. The first sample anchors the
+        // start, the last one stands in for the bucket after the end.
+        for (size_t c = 0; c < width; ++c) {
+            previous_t[c] = t[0];
+            previous_v[c] = values[c]->data()[0];
+        }
+        for (size_t b = 0; b < buckets; ++b) {
+            size_t begin = b * bucket;
+            size_t end = std::min(begin + bucket, n);
+            size_t next_end = std::min(end + bucket, n);
+
+            double next_t = t[n - 1];
+            if (end < n) {
+                next_t = 0.0;
+                for (size_t i = end; i < next_end; ++i) next_t += t[i];
+                next_t /= static_cast<double>(next_end - end);
+            }
+
+            record[0] = t[begin];
+            record[1] = t[end - 1];
+            for (size_t c = 0; c < width; ++c) {
+                const double* v = values[c]->data();
+                double next_v = v[n - 1];
+                if (end < n) {
+                    next_v = 0.0;
+                    for (size_t i = end; i < next_end; ++i) next_v += v[i];
+                    next_v /= static_cast<double>(next_end - end);
+                }
+
+                double low = v[begin], high = v[begin];
+                size_t chosen = begin;
+                double largest = -1.0;
+                for (size_t i = begin; i < end; ++i) {
+                    if (v[i] < low) low = v[i];
+                    if (v[i] > high) high = v[i];
+                    double area = std::fabs((previous_t[c] - next_t) * (v[i] - previous_v[c]) -
+                                            (previous_t[c] - t[i]) * (next_v - previous_v[c]));
+                    if (area > largest) {
+                        largest = area;
+                        chosen = i;
+                    }
+                }
+                previous_t[c] = t[chosen];
+                previous_v[c] = v[chosen];
+
+                double* out = &record[2 + 4 * c];
+                out[0] = low;
+                out[1] = high;
+                out[2] = t[chosen];
+                out[3] = v[chosen];
+            }
+            writer.Append(record.data());
+        }
+        writer.Close();
+        levels.push_back(level);
+    }
+    return true;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Read-only memory map of a 1-D float64 .npy column, as written by
+// NpyWriter with a single unnamed f8 field.
+class NpyColumn {
+public:
+    NpyColumn() = default;
+    ~NpyColumn();
+
+    NpyColumn(const NpyColumn&) = delete;
+    NpyColumn& operator=(const NpyColumn&) = delete;
+
+    bool Open(const std::string& path);
+    void Close();
+
+    const double* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    void* memory_{nullptr};
+    size_t bytes_{0};
+    const double* data_{nullptr};
+    size_t size_{0};
+};
+
+// One level of a trajectory pyramid: the samples cut into buckets of
+// 2^level consecutive samples (the last one may be shorter).
+struct PyramidLevel {
+    int level;
+    size_t bucket;
+    size_t buckets;
+    std::string file;
+};
+
+// Builds the multi-resolution summary of the sampled columns of a
+// BinaryTrajectoryWriter directory. Level k holds, per bucket of 2^k
+// samples, the time span t0/t1 and for every column its min, its max and one
+// representative sample (<col>_t, <col>) chosen by largest-triangle-three-
+// buckets, so a plot of any level keeps the peaks and the shape of the full
+// column. Levels go from 2^3 up to the coarsest one that still has 512
+// buckets; short runs (up to 4096 samples) get no pyramid. Event files are
+// never summarized: they are small and always loaded whole.
+bool WriteTrajectoryPyramid(const std::string& directory, const std::vector<std::string>& columns,
+                            std::vector<PyramidLevel>& levels);
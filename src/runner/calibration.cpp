@@ -0,0 +1,516 @@
+#include "calibration.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+#include "../simulation/context.hpp"
+#include "../simulation/parameters.hpp"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::setw;
+using std::string;
+using std::vector;
+
+namespace {
+
+const char* const kQuantityNames[kObservedQuantities] = {"A", "C", "P", "Ce", "Tol", "Effect"};
+const char* const kSigmaKeys[kObservedQuantities] = {"sigma_A",  "sigma_C",   "sigma_P",
+                                                     "sigma_Ce", "sigma_Tol", "sigma_effect"};
+
+// Default range around the initial value when fitting ln(p).
+const double kLogRange = 1000.0;
+// Levenberg-Marquardt damping and stopping rules.
+const double kInitialDamping = 1e-3;
+const double kMaxDamping = 1e10;
+const double kCostTolerance = 1e-10;
+const double kStepTolerance = 1e-10;
+// Relative step of the central differences in check_gradient.
+const double kDifferenceStep = 1e-4;
+
+string Lowercase(string text) {
+    for (char& c : text) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return text;
+}
+
+string Trim(const string& text) {
+    size_t first = text.find_first_not_of(" \t\r");
+    if (first == string::npos) return "";
+    size_t last = text.find_last_not_of(" \t\r");
+    return text.substr(first, last - first + 1);
+}
+
+// Records the observed quantities and their sensitivities when the run
+// passes each observation time.
+class ObservationSampler : public ScheduledEvent {
+public:
+    ObservationSampler(SimulationContext& ctx, const vector<ObservationRow>& rows, vector<double>& values,
+                       vector<double>* gradients)
+        : ScheduledEvent(ctx), rows_(rows), values_(values), gradients_(gradients) {}
+
+    void Start() {
+        if (!rows_.empty()) Activate(rows_[0].time);
+    }
+
+    void Behavior() override {
+        while (next_ < rows_.size() && rows_[next_].time <= ctx_.Time()) Record(next_++);
+        if (next_ < rows_.size()) Activate(rows_[next_].time);
+    }
+
+    bool Complete() const { return next_ == rows_.size(); }
+
+private:
+    void Record(size_t row) {
+        const SimulationState& state = ctx_.state();
+        double* values = &values_[row * kObservedQuantities];
+        values[0] = state.A->Value();
+        values[1] = state.C->Value();
+        values[2] = state.P->Value();
+        values[3] = state.Ce->Value();
+        values[4] = state.Tol->Value();
+        values[5] = CalculateEffect(state.Ce->Value(), state.Tol->Value(), ctx_.params());
+
+        ForwardSensitivities* sensitivities = ctx_.sensitivities();
+        if (!gradients_ || !sensitivities) return;
+        size_t columns = sensitivities->Count();
+        double* gradients = &(*gradients_)[row * kObservedQuantities * columns];
+        for (size_t column = 0; column < columns; ++column) {
+            for (int q = 0; q < 5; ++q) gradients[q * columns + column] = sensitivities->Value(q, column);
+            gradients[5 * columns + column] = sensitivities->Effect(column);
+        }
+    }
+
+    const vector<ObservationRow>& rows_;
+    vector<double>& values_;
+    vector<double>* gradients_;
+    size_t next_{0};
+};
+
+// Solves A x = b in place by Gaussian elimination with partial pivoting;
+// returns false when A is singular.
+bool SolveLinear(vector<double> A, vector<double>& b, size_t n) {
+    for (size_t k = 0; k < n; ++k) {
+        size_t pivot = k;
+        for (size_t i = k + 1; i < n; ++i) {
+            if (std::fabs(A[i * n + k]) > std::fabs(A[pivot * n + k])) pivot = i;
+        }
+        if (A[pivot * n + k] == 0.0) return false;
+        if (pivot != k) {
+            for (size_t j = 0; j < n; ++j) std::swap(A[k * n + j], A[pivot * n + j]);
+            std::swap(b[k], b[pivot]);
+        }
+        for (size_t i = k + 1; i < n; ++i) {
+            double factor = A[i * n + k] / A[k * n + k];
+            for (size_t j = k; j < n; ++j) A[i * n + j] -= factor * A[k * n + j];
+            b[i] -= factor * b[k];
+        }
+    }
+    for (size_t k = n; k-- > 0;) {
+        for (size_t j = k + 1; j < n; ++j) b[k] -= A[k * n + j] * b[j];
+        b[k] /= A[k * n + k];
+    }
+    return true;
+}
+
+// Weighted residuals (model - observed) / sigma of every observed cell, as a
+// function of the fitted parameters in the coordinates x (ln p when
+// log_parameters is set).
+class CalibrationProblem {
+public:
+    CalibrationProblem(const CalibrationDefinition& definition, const ModelParameters& base,
+                       const vector<ObservationRow>& rows)
+        : definition_(definition), base_(base), rows_(rows) {
+        base_.solver = SolverKind::Explicit;
+        base_.linear_ratio = 0.0;
+        for (const auto& parameter : definition_.parameters) parameters_.push_back(parameter.parameter);
+        for (size_t row = 0; row < rows_.size(); ++row) {
+            for (int q = 0; q < kObservedQuantities; ++q) {
+                if (!std::isnan(rows_[row].values[q])) cells_.push_back(row * kObservedQuantities + q);
+            }
+        }
+    }
+
+    size_t Parameters() const { return parameters_.size(); }
+    size_t Residuals() const { return cells_.size(); }
+    unsigned long Simulations() const { return simulations_; }
+    unsigned long GradientSimulations() const { return gradient_simulations_; }
+
+    double ToCoordinate(double value) const {
+        return definition_.log_parameters ? std::log(value) : value;
+    }
+    double FromCoordinate(size_t j, double x) const {
+        const CalibrationParameter& parameter = definition_.parameters[j];
+        double value = definition_.log_parameters ? std::exp(x) : x;
+        return std::min(std::max(value, parameter.min), parameter.max);
+    }
+
+    // Fills r and, if given, the row-major Jacobian dr/dx; returns false when
+    // the run ended (overdose without rescue) before the last observation.
+    bool Evaluate(const vector<double>& x, vector<double>& r, vector<double>* J) {
+        ModelParameters params = base_;
+        for (size_t j = 0; j < x.size(); ++j) {
+            SetModelParameter(params, definition_.parameters[j].key, FromCoordinate(j, x[j]));
+        }
+
+        size_t p = parameters_.size();
+        vector<double> values(rows_.size() * kObservedQuantities);
+        vector<double> gradients(J ? rows_.size() * kObservedQuantities * p : 0);
+        std::ostream quiet(nullptr);
+        SimulationContext ctx(params, quiet);
+        ctx.SetLogLevel(LogLevel::Summary);
+        if (J) ctx.EnableSensitivities(parameters_);
+        ObservationSampler& sampler = ctx.CreateEvent<ObservationSampler>(rows_, values, J ? &gradients : nullptr);
+        sampler.Start();
+        ctx.Run();
+        ++simulations_;
+        if (J) ++gradient_simulations_;
+        if (!sampler.Complete()) return false;
+
+        r.assign(cells_.size(), 0.0);
+        if (J) J->assign(cells_.size() * p, 0.0);
+        for (size_t k = 0; k < cells_.size(); ++k) {
+            size_t row = cells_[k] / kObservedQuantities;
+            int q = static_cast<int>(cells_[k] % kObservedQuantities);
+            double sigma = definition_.sigma[q];
+            r[k] = (values[cells_[k]] - rows_[row].values[q]) / sigma;
+            if (!J) continue;
+            for (size_t j = 0; j < p; ++j) {
+                double dvalue = gradients[(row * kObservedQuantities + q) * p + j];
+                // dp/dx = p for x = ln p.
+                double dp_dx = definition_.log_parameters ? FromCoordinate(j, x[j]) : 1.0;
+                (*J)[k * p + j] = dvalue * dp_dx / sigma;
+            }
+        }
+        return true;
+    }
+
+private:
+    const CalibrationDefinition& definition_;
+    ModelParameters base_;
+    const vector<ObservationRow>& rows_;
+    vector<SensitivityParameter> parameters_;
+    vector<size_t> cells_;  // row * kObservedQuantities + quantity of each residual
+    unsigned long simulations_{0};
+    unsigned long gradient_simulations_{0};
+};
+
+double Cost(const vector<double>& r) {
+    double sum = 0.0;
+    for (double value : r) sum += value * value;
+    return 0.5 * sum;
+}
+
+// Largest difference between the sensitivity Jacobian and central
+// differences, per parameter, relative to the largest entry of its column.
+void CheckGradient(CalibrationProblem& problem, const CalibrationDefinition& definition, const vector<double>& x,
+                   const vector<double>& J) {
+    size_t p = problem.Parameters();
+    size_t m = problem.Residuals();
+    cout << "Gradient check against central differences:" << endl;
+    for (size_t j = 0; j < p; ++j) {
+        double h = kDifferenceStep * std::max(1.0, std::fabs(x[j]));
+        vector<double> plus = x, minus = x, r_plus, r_minus;
+        plus[j] += h;
+        minus[j] -= h;
+        if (!problem.Evaluate(plus, r_plus, nullptr) || !problem.Evaluate(minus, r_minus, nullptr)) {
+            cout << "  " << setw(28) << std::left << definition.parameters[j].key << std::right
+                 << "  run ended early; not checked" << endl;
+            continue;
+        }
+        double scale = 0.0, deviation = 0.0;
+        for (size_t k = 0; k < m; ++k) {
+            double difference = (r_plus[k] - r_minus[k]) / (2.0 * h);
+            scale = std::max(scale, std::fabs(difference));
+            deviation = std::max(deviation, std::fabs(difference - J[k * p + j]));
+        }
+        cout << "  " << setw(28) << std::left << definition.parameters[j].key << std::right
+             << "  max |dr/dx| " << std::scientific << std::setprecision(3) << scale << "  relative deviation "
+             << (scale > 0.0 ? deviation / scale : deviation) << std::fixed << endl;
+    }
+    cout << endl;
+}
+
+}  // namespace
+
+bool LoadCalibrationDefinition(const ConfigReader& config, const ModelParameters& base,
+                               CalibrationDefinition& definition) {
+    for (int q = 0; q < kObservedQuantities; ++q) {
+        definition.sigma[q] = config.get(kSigmaKeys[q], definition.sigma[q]);
+        if (definition.sigma[q] <= 0.0) {
+            cerr << "Error: " << kSigmaKeys[q] << " must be positive\n";
+            return false;
+        }
+    }
+    definition.max_iterations = static_cast<int>(config.get("max_iterations", 50.0));
+    definition.log_parameters = config.get("log_parameters", 1.0) != 0.0;
+    definition.check_gradient = config.get("check_gradient", 0.0) != 0.0;
+
+    const string suffix = ".fit";
+    for (const string& entry : config.keys()) {
+        if (entry.size() <= suffix.size() || entry.compare(entry.size() - suffix.size(), suffix.size(), suffix) != 0 ||
+            config.get(entry, 0.0) == 0.0) {
+            continue;
+        }
+        CalibrationParameter parameter;
+        parameter.key = entry.substr(0, entry.size() - suffix.size());
+        if (!FindSensitivityParameter(parameter.key, parameter.parameter) ||
+            !GetModelParameter(base, parameter.key, parameter.initial)) {
+            cerr << "Error: Parameter cannot be calibrated: " << parameter.key << "\n";
+            return false;
+        }
+        parameter.initial = config.get(parameter.key + ".initial", parameter.initial);
+        double default_min = definition.log_parameters ? parameter.initial / kLogRange
+                                                       : -std::numeric_limits<double>::infinity();
+        double default_max = definition.log_parameters ? parameter.initial * kLogRange
+                                                       : std::numeric_limits<double>::infinity();
+        parameter.min = config.get(parameter.key + ".min", default_min);
+        parameter.max = config.get(parameter.key + ".max", default_max);
+        if ((definition.log_parameters && (parameter.initial <= 0.0 || parameter.min <= 0.0)) ||
+            parameter.initial < parameter.min || parameter.initial > parameter.max) {
+            cerr << "Error: Invalid initial value or range for calibration parameter: " << parameter.key << "\n";
+            return false;
+        }
+        definition.parameters.push_back(parameter);
+    }
+    if (definition.parameters.empty()) {
+        cerr << "Error: No parameters selected for calibration (<key>.fit = 1)\n";
+        return false;
+    }
+    return true;
+}
+
+bool LoadObservations(const string& filename, vector<ObservationRow>& rows) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        cerr << "Error: Cannot open observations file: " << filename << "\n";
+        return false;
+    }
+
+    string line;
+    if (!std::getline(file, line)) {
+        cerr << "Error: Empty observations file: " << filename << "\n";
+        return false;
+    }
+    // Column index of each cell in the header: -1 time, -2 ignored.
+    vector<int> columns;
+    bool has_time = false;
+    std::stringstream header(line);
+    string cell;
+    while (std::getline(header, cell, ',')) {
+        string name = Lowercase(Trim(cell));
+        int column = -2;
+        if (name == "time" || name == "t") {
+            column = -1;
+            has_time = true;
+        }
+        for (int q = 0; q < kObservedQuantities; ++q) {
+            if (name == Lowercase(kQuantityNames[q])) column = q;
+        }
+        columns.push_back(column);
+    }
+    if (!has_time) {
+        cerr << "Error: Observations need a time column\n";
+        return false;
+    }
+
+    int line_number = 1;
+    while (std::getline(file, line)) {
+        ++line_number;
+        if (Trim(line).empty()) continue;
+        ObservationRow row;
+        std::fill(row.values, row.values + kObservedQuantities, std::numeric_limits<double>::quiet_NaN());
+        std::stringstream fields(line);
+        size_t index = 0;
+        bool has_row_time = false;
+        while (std::getline(fields, cell, ',') && index < columns.size()) {
+            int column = columns[index++];
+            cell = Trim(cell);
+            if (column == -2 || cell.empty()) continue;
+            char* end = nullptr;
+            double value = std::strtod(cell.c_str(), &end);
+            if (*end != '\0') {
+                cerr << "Error: Invalid number '" << cell << "' on line " << line_number << "\n";
+                return false;
+            }
+            if (column == -1) {
+                row.time = value;
+                has_row_time = true;
+            } else {
+                row.values[column] = value;
+            }
+        }
+        if (!has_row_time || (!rows.empty() && row.time < rows.back().time)) {
+            cerr << "Error: Missing or decreasing time on line " << line_number << "\n";
+            return false;
+        }
+        rows.push_back(row);
+    }
+    return true;
+}
+
+int RunCalibration(const string& definition_file, const string& base_file, const string& observations_file) {
+    ConfigReader definition_config;
+    ConfigReader base_config;
+    if (!base_config.load(base_file)) {
+        cerr << "Failed to load configuration. Exiting." << endl;
+        return 1;
+    }
+    ModelParameters base = LoadModelParameters(base_config);
+    CalibrationDefinition definition;
+    if (!definition_config.load(definition_file) || !LoadCalibrationDefinition(definition_config, base, definition)) {
+        cerr << "Failed to load calibration definition. Exiting." << endl;
+        return 1;
+    }
+    vector<ObservationRow> rows;
+    if (!LoadObservations(observations_file, rows)) {
+        cerr << "Failed to load observations. Exiting." << endl;
+        return 1;
+    }
+    if (!rows.empty() && rows.back().time > base.sim_duration) {
+        cerr << "Error: Observations extend past the simulation duration (" << base.sim_duration << " h). Exiting."
+             << endl;
+        return 1;
+    }
+
+    CalibrationProblem problem(definition, base, rows);
+    size_t p = problem.Parameters();
+    size_t m = problem.Residuals();
+    if (m < p) {
+        cerr << "Error: " << m << " observations cannot determine " << p << " parameters. Exiting." << endl;
+        return 1;
+    }
+
+    cout << "Calibration: " << p << " parameters from " << m << " observations at " << rows.size()
+         << " times, Levenberg-Marquardt with forward sensitivities"
+         << (definition.log_parameters ? " (log parameters)" : "") << endl;
+    for (const auto& parameter : definition.parameters) {
+        cout << "  " << parameter.key << ": initial " << parameter.initial << ", range [" << parameter.min << ", "
+             << parameter.max << "]" << endl;
+    }
+    cout << endl;
+
+    auto start = std::chrono::steady_clock::now();
+    vector<double> x(p), r, J;
+    for (size_t j = 0; j < p; ++j) x[j] = problem.ToCoordinate(definition.parameters[j].initial);
+    if (!problem.Evaluate(x, r, &J)) {
+        cerr << "Error: The run at the initial parameters ends before the last observation. Exiting." << endl;
+        return 1;
+    }
+    double cost = Cost(r);
+
+    std::ios::fmtflags flags = cout.flags();
+    if (definition.check_gradient) CheckGradient(problem, definition, x, J);
+
+    double damping = kInitialDamping;
+    int iteration = 0;
+    bool converged = false;
+    cout << "  iter          cost      damping" << endl;
+    cout << "  " << setw(4) << iteration << "  " << std::scientific << std::setprecision(5) << setw(12) << cost
+         << "            -" << endl;
+    while (iteration < definition.max_iterations && !converged) {
+        ++iteration;
+        vector<double> H(p * p, 0.0), g(p, 0.0);
+        for (size_t k = 0; k < m; ++k) {
+            for (size_t i = 0; i < p; ++i) {
+                g[i] += J[k * p + i] * r[k];
+                for (size_t j = 0; j < p; ++j) H[i * p + j] += J[k * p + i] * J[k * p + j];
+            }
+        }
+
+        bool accepted = false;
+        while (!accepted && damping < kMaxDamping) {
+            // Marquardt scaling: damp each direction by its own curvature.
+            vector<double> A = H, step(p);
+            for (size_t i = 0; i < p; ++i) {
+                A[i * p + i] += damping * std::max(H[i * p + i], 1e-12);
+                step[i] = -g[i];
+            }
+            if (!SolveLinear(A, step, p)) {
+                damping *= 10.0;
+                continue;
+            }
+            vector<double> trial(p);
+            double step_norm = 0.0, x_norm = 0.0;
+            for (size_t j = 0; j < p; ++j) {
+                trial[j] = problem.ToCoordinate(problem.FromCoordinate(j, x[j] + step[j]));
+                step_norm += (trial[j] - x[j]) * (trial[j] - x[j]);
+                x_norm += x[j] * x[j];
+            }
+            if (std::sqrt(step_norm) <= kStepTolerance * (std::sqrt(x_norm) + kStepTolerance)) {
+                converged = true;
+                break;
+            }
+
+            vector<double> trial_r, trial_J;
+            if (problem.Evaluate(trial, trial_r, &trial_J) && Cost(trial_r) < cost) {
+                double trial_cost = Cost(trial_r);
+                converged = cost - trial_cost <= kCostTolerance * cost;
+                x = trial;
+                r = trial_r;
+                J = trial_J;
+                cost = trial_cost;
+                damping = std::max(damping / 10.0, 1e-12);
+                accepted = true;
+            } else {
+                damping *= 10.0;
+            }
+        }
+        if (!accepted && !converged) break;
+        cout << "  " << setw(4) << iteration << "  " << setw(12) << cost << "  " << std::setprecision(1)
+             << damping << std::setprecision(5) << endl;
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    cout.flags(flags);
+
+    cout << endl
+         << (converged ? "Converged" : (iteration >= definition.max_iterations ? "Stopped at max_iterations"
+                                                                                : "Stopped: no further decrease"))
+         << " after " << iteration << " iterations" << endl;
+
+    // Covariance s^2 (J^T J)^-1 with s^2 the reduced chi-square, so the
+    // standard errors stay meaningful when the sigmas are only relative
+    // weights.
+    double s2 = m > p ? 2.0 * cost / static_cast<double>(m - p) : 1.0;
+    vector<double> H(p * p, 0.0);
+    for (size_t k = 0; k < m; ++k) {
+        for (size_t i = 0; i < p; ++i) {
+            for (size_t j = 0; j < p; ++j) H[i * p + j] += J[k * p + i] * J[k * p + j];
+        }
+    }
+    cout << std::setprecision(6);
+    cout << "  cost " << cost << ", reduced chi-square " << s2 << endl << endl;
+    cout << "  " << setw(28) << std::left << "parameter" << std::right << setw(14) << "estimate" << setw(14)
+         << "std. error" << setw(14) << "initial" << endl;
+    for (size_t j = 0; j < p; ++j) {
+        vector<double> column(p, 0.0);
+        column[j] = 1.0;
+        double value = problem.FromCoordinate(j, x[j]);
+        cout << "  " << setw(28) << std::left << definition.parameters[j].key << std::right << setw(14) << value;
+        if (SolveLinear(H, column, p) && column[j] >= 0.0) {
+            double error = std::sqrt(s2 * column[j]);
+            // First-order propagation from ln p to p.
+            if (definition.log_parameters) error *= value;
+            cout << setw(14) << error;
+        } else {
+            cout << setw(14) << "-";
+        }
+        cout << setw(14) << definition.parameters[j].initial << endl;
+    }
+
+    cout << endl
+         << "  " << problem.Simulations() << " simulations (" << problem.GradientSimulations()
+         << " with sensitivities) in " << std::setprecision(3) << elapsed
+         << " s; forward differences would need " << problem.Simulations() + problem.GradientSimulations() * p
+         << endl;
+    cout.flags(flags);
+    return 0;
+}
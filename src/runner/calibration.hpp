@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "../config/config_reader.hpp"
+#include "../simulation/forward_sensitivity.hpp"
+
+// Observed quantities, in the column order of ObservationRow::values.
+enum class ObservedQuantity : int { A = 0, C, P, Ce, Tol, Effect };
+const int kObservedQuantities = 6;
+
+// One line of the observations CSV; missing cells are NaN.
+struct ObservationRow {
+    double time{};
+    double values[kObservedQuantities];
+};
+
+// A ModelParameters field (by config key) estimated from the observations.
+struct CalibrationParameter {
+    std::string key;
+    SensitivityParameter parameter{};
+    double initial{};  // value from the base config unless <key>.initial is set
+    double min{};
+    double max{};
+};
+
+struct CalibrationDefinition {
+    std::vector<CalibrationParameter> parameters;
+    // Measurement standard deviation per quantity; residuals are weighted by
+    // 1 / sigma.
+    double sigma[kObservedQuantities]{1.0, 0.01, 0.01, 0.01, 0.01, 1.0};
+    int max_iterations{50};
+    bool log_parameters{true};  // fit ln(p); keeps positive parameters positive
+    bool check_gradient{false};  // compare the first Jacobian with finite differences
+};
+
+// Reads parameters declared as <key>.fit = 1, with optional <key>.initial,
+// <key>.min and <key>.max, plus optional "sigma_<quantity>",
+// "max_iterations", "log_parameters" and "check_gradient" entries.
+bool LoadCalibrationDefinition(const ConfigReader& config, const ModelParameters& base,
+                               CalibrationDefinition& definition);
+
+// Reads a CSV whose header names "time" and any of A, C, P, Ce, Tol and
+// Effect. Empty cells are missing observations.
+bool LoadObservations(const std::string& filename, std::vector<ObservationRow>& rows);
+
+// Fits the selected parameters of base_file to the observations by
+// Levenberg-Marquardt with gradients from the forward sensitivity equations,
+// and reports the estimates with their standard errors.
+int RunCalibration(const std::string& definition_file, const std::string& base_file,
+                   const std::string& observations_file);
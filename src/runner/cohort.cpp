@@ -0,0 +1,364 @@
+#include "cohort.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <set>
+
+#include "../simulation/batch_integrator.hpp"
+#include "../simulation/context.hpp"
+#include "../telemetry/telemetry_publisher.hpp"
+#include "thread_pool.hpp"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+namespace {
+
+const size_t kMaxEscalationBin = 64;
+const size_t kMaxVariedParameters = 64;
+const double kTwoPi = 6.283185307179586;
+
+// SplitMix64: tiny, statistically solid and trivially seekable per patient.
+class PatientRandom {
+public:
+    PatientRandom(uint64_t seed, uint64_t index) : state_(seed ^ (index * 0x9E3779B97F4A7C15ULL)) {
+        Next();
+    }
+
+    uint64_t Next() {
+        uint64_t z = (state_ += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    double Uniform() {
+        return (static_cast<double>(Next() >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+    }
+
+    double Normal() {
+        // Box-Muller, both values used.
+        if (has_spare_) {
+            has_spare_ = false;
+            return spare_;
+        }
+        double r = std::sqrt(-2.0 * std::log(Uniform()));
+        double phi = kTwoPi * Uniform();
+        spare_ = r * std::sin(phi);
+        has_spare_ = true;
+        return r * std::cos(phi);
+    }
+
+private:
+    uint64_t state_;
+    double spare_{0.0};
+    bool has_spare_{false};
+};
+
+bool CholeskyFactor(vector<double>& matrix, size_t n) {
+    for (size_t j = 0; j < n; ++j) {
+        double diagonal = matrix[j * n + j];
+        for (size_t k = 0; k < j; ++k) diagonal -= matrix[j * n + k] * matrix[j * n + k];
+        if (diagonal <= 0.0) return false;
+        matrix[j * n + j] = std::sqrt(diagonal);
+        for (size_t i = j + 1; i < n; ++i) {
+            double value = matrix[i * n + j];
+            for (size_t k = 0; k < j; ++k) value -= matrix[i * n + k] * matrix[j * n + k];
+            matrix[i * n + j] = value / matrix[j * n + j];
+        }
+        for (size_t k = j + 1; k < n; ++k) matrix[j * n + k] = 0.0;
+    }
+    return true;
+}
+
+}  // namespace
+
+bool LoadCohortDefinition(const ConfigReader& config, const ModelParameters& base,
+                          CohortDefinition& definition) {
+    definition.patients = static_cast<uint64_t>(config.get("patients", 1000.0));
+    definition.seed = static_cast<uint64_t>(config.get("seed", 1.0));
+    definition.batch = static_cast<uint64_t>(config.get("batch", 256.0));
+    definition.threads = static_cast<unsigned>(config.get("threads", 0.0));
+    definition.histogram_bin = config.get("histogram_bin", 12.0);
+    definition.batch_engine = config.get("batch_engine", 1.0) != 0.0;
+    definition.validate_batch = static_cast<uint64_t>(config.get("validate_batch", 0.0));
+    if (definition.batch == 0) definition.batch = 1;
+    if (definition.histogram_bin <= 0.0) definition.histogram_bin = 12.0;
+    if (definition.patients == 0) {
+        cerr << "Error: patients must be at least 1" << endl;
+        return false;
+    }
+
+    std::set<string> keys;
+    for (const string& entry : config.keys()) {
+        if (entry.compare(0, 5, "corr.") == 0) continue;
+        size_t dot = entry.rfind('.');
+        if (dot != string::npos) keys.insert(entry.substr(0, dot));
+    }
+
+    for (const string& key : keys) {
+        ParameterDistribution distribution;
+        distribution.key = key;
+        if (!GetModelParameter(base, key, distribution.median)) {
+            cerr << "Error: Unknown cohort parameter: " << key << "\n";
+            return false;
+        }
+        distribution.median = config.get(key + ".median", distribution.median);
+        double cv = config.get(key + ".cv", 0.0);
+        distribution.sigma = config.get(key + ".sd_log", std::sqrt(std::log(1.0 + cv * cv)));
+        if (distribution.median <= 0.0 || distribution.sigma < 0.0) {
+            cerr << "Error: Invalid log-normal distribution for: " << key << "\n";
+            return false;
+        }
+        definition.parameters.push_back(distribution);
+    }
+
+    size_t n = definition.parameters.size();
+    if (n > kMaxVariedParameters) {
+        cerr << "Error: Too many varied cohort parameters (max " << kMaxVariedParameters << ")\n";
+        return false;
+    }
+    vector<double> correlation(n * n, 0.0);
+    for (size_t i = 0; i < n; ++i) correlation[i * n + i] = 1.0;
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+            if (i == j) continue;
+            string key = "corr." + definition.parameters[i].key + "." + definition.parameters[j].key;
+            double rho = config.get(key, 0.0);
+            if (rho != 0.0) {
+                correlation[i * n + j] = rho;
+                correlation[j * n + i] = rho;
+            }
+        }
+    }
+    if (!CholeskyFactor(correlation, n)) {
+        cerr << "Error: Cohort correlation matrix is not positive definite\n";
+        return false;
+    }
+    definition.cholesky = correlation;
+    return true;
+}
+
+ModelParameters SamplePatient(const CohortDefinition& definition, const ModelParameters& base,
+                              uint64_t index) {
+    ModelParameters params = base;
+    params.behavior_stream = static_cast<double>(index);  // one behavior stream per patient
+    size_t n = definition.parameters.size();
+    if (n == 0) return params;
+
+    PatientRandom random(definition.seed, index);
+    double eps[kMaxVariedParameters];
+    for (size_t i = 0; i < n; ++i) eps[i] = random.Normal();
+    for (size_t i = 0; i < n; ++i) {
+        double z = 0.0;
+        for (size_t k = 0; k <= i; ++k) z += definition.cholesky[i * n + k] * eps[k];
+        const ParameterDistribution& d = definition.parameters[i];
+        SetModelParameter(params, d.key, d.median * std::exp(d.sigma * z));
+    }
+    return params;
+}
+
+CohortStatistics::CohortStatistics(double duration, double bin_width)
+    : bin_width_(bin_width),
+      death_histogram_(static_cast<size_t>(std::ceil(duration / bin_width)) + 1, 0),
+      escalation_histogram_(kMaxEscalationBin + 1, 0) {}
+
+void CohortStatistics::Add(const RunSummary& summary) {
+    ++patients_;
+    peak_ratio_sum_ += summary.peak_saturation_ratio;
+    escalation_sum_ += summary.escalations;
+    size_t escalation_bin = static_cast<size_t>(summary.escalations);
+    if (escalation_bin > kMaxEscalationBin) escalation_bin = kMaxEscalationBin;
+    ++escalation_histogram_[escalation_bin];
+
+    if (!summary.patient_alive) {
+        ++overdoses_;
+        death_time_sum_ += summary.time_of_death;
+        size_t bin = static_cast<size_t>(summary.time_of_death / bin_width_);
+        if (bin >= death_histogram_.size()) bin = death_histogram_.size() - 1;
+        ++death_histogram_[bin];
+    }
+}
+
+void CohortStatistics::Merge(const CohortStatistics& other) {
+    patients_ += other.patients_;
+    overdoses_ += other.overdoses_;
+    death_time_sum_ += other.death_time_sum_;
+    peak_ratio_sum_ += other.peak_ratio_sum_;
+    escalation_sum_ += other.escalation_sum_;
+    for (size_t i = 0; i < death_histogram_.size(); ++i) death_histogram_[i] += other.death_histogram_[i];
+    for (size_t i = 0; i < escalation_histogram_.size(); ++i) {
+        escalation_histogram_[i] += other.escalation_histogram_[i];
+    }
+}
+
+double CohortStatistics::TimeToOverdoseQuantile(double q) const {
+    if (overdoses_ == 0) return 0.0;
+    double target = q * static_cast<double>(overdoses_);
+    double cumulative = 0.0;
+    for (size_t i = 0; i < death_histogram_.size(); ++i) {
+        double count = static_cast<double>(death_histogram_[i]);
+        if (count > 0.0 && cumulative + count >= target) {
+            return (i + (target - cumulative) / count) * bin_width_;
+        }
+        cumulative += count;
+    }
+    return death_histogram_.size() * bin_width_;
+}
+
+void CohortStatistics::Print(std::ostream& out) const {
+    double n = static_cast<double>(patients_);
+    double p = n > 0.0 ? overdoses_ / n : 0.0;
+
+    // Wilson score interval, 95%.
+    double z = 1.96;
+    double denominator = 1.0 + z * z / n;
+    double center = (p + z * z / (2.0 * n)) / denominator;
+    double half_width = z * std::sqrt(p * (1.0 - p) / n + z * z / (4.0 * n * n)) / denominator;
+
+    out << "Cohort Outcome:" << endl;
+    out << "  Patients simulated: " << patients_ << endl;
+    out << "  Overdoses: " << overdoses_ << " (" << std::setprecision(4) << (p * 100.0) << "%";
+    if (n > 0.0) {
+        out << ", 95% CI " << ((center - half_width) * 100.0) << "% - " << ((center + half_width) * 100.0) << "%";
+    }
+    out << ")" << endl;
+    if (overdoses_ > 0) {
+        out << "  Time to overdose: mean = " << (death_time_sum_ / overdoses_) << " h" << endl;
+        out << "    5% = " << TimeToOverdoseQuantile(0.05) << " h, 25% = " << TimeToOverdoseQuantile(0.25)
+            << " h, median = " << TimeToOverdoseQuantile(0.50) << " h, 75% = "
+            << TimeToOverdoseQuantile(0.75) << " h, 95% = " << TimeToOverdoseQuantile(0.95) << " h" << endl;
+    }
+    out << "  Mean peak C/Km: " << (n > 0.0 ? peak_ratio_sum_ / n : 0.0) << endl;
+    out << "  Escalations: mean = " << (n > 0.0 ? escalation_sum_ / n : 0.0) << endl;
+    for (size_t i = 0; i < escalation_histogram_.size(); ++i) {
+        if (escalation_histogram_[i] == 0) continue;
+        out << "    " << (i == kMaxEscalationBin ? ">=" : "") << i << " escalations: "
+            << escalation_histogram_[i] << " patients" << endl;
+    }
+}
+
+bool CohortStatistics::WriteHistograms(const string& prefix) const {
+    std::ofstream deaths(prefix + "_time_to_overdose.csv");
+    std::ofstream escalations(prefix + "_escalations.csv");
+    if (!deaths.is_open() || !escalations.is_open()) {
+        cerr << "Error: Cannot write cohort histograms with prefix: " << prefix << endl;
+        return false;
+    }
+
+    deaths << "bin_start,bin_end,overdoses\n";
+    for (size_t i = 0; i < death_histogram_.size(); ++i) {
+        deaths << i * bin_width_ << "," << (i + 1) * bin_width_ << "," << death_histogram_[i] << "\n";
+    }
+    escalations << "escalations,patients\n";
+    for (size_t i = 0; i < escalation_histogram_.size(); ++i) {
+        escalations << i << "," << escalation_histogram_[i] << "\n";
+    }
+    return true;
+}
+
+int RunCohort(const string& cohort_file, const string& base_file, const string& output_prefix,
+              const string& telemetry_name) {
+    ConfigReader base_config;
+    ConfigReader cohort_config;
+    if (!base_config.load(base_file) || !cohort_config.load(cohort_file)) {
+        cerr << "Failed to load configuration. Exiting." << endl;
+        return 1;
+    }
+
+    ModelParameters base = LoadModelParameters(base_config);
+    CohortDefinition definition;
+    if (!LoadCohortDefinition(cohort_config, base, definition)) {
+        cerr << "Failed to load cohort definition. Exiting." << endl;
+        return 1;
+    }
+
+    bool batched = definition.batch_engine && BatchSimulation::Supports(base);
+    WorkStealingPool pool(definition.threads);
+    uint64_t batches = (definition.patients + definition.batch - 1) / definition.batch;
+    cout << "Cohort: " << definition.patients << " patients, " << definition.parameters.size()
+         << " varied parameter(s), " << batches << " batches on " << pool.Size() << " threads" << endl;
+    cout << "Engine: " << (batched ? "batched SIMD (" : "per-patient SimulationContext")
+         << (batched ? SelectBatchKernels().name : "") << (batched ? ")" : "") << endl;
+    for (const auto& d : definition.parameters) {
+        cout << "  " << d.key << ": log-normal, median = " << d.median << ", sd_log = " << d.sigma << endl;
+    }
+    cout << endl;
+
+    CohortStatistics total(base.sim_duration, definition.histogram_bin);
+    std::mutex total_mutex;
+
+    TelemetryPublisher telemetry;
+    if (!telemetry_name.empty() && !telemetry.Open(telemetry_name, pool.Size(), definition.patients)) {
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    pool.ParallelFor(static_cast<size_t>(batches), [&](size_t batch) {
+        CohortStatistics local(base.sim_duration, definition.histogram_bin);
+        uint64_t first = batch * definition.batch;
+        uint64_t last = std::min(first + definition.batch, definition.patients);
+        TelemetryChannel* channel = telemetry_name.empty() ? nullptr : telemetry.Channel();
+        auto add = [&](uint64_t patient, const RunSummary& summary) {
+            local.Add(summary);
+            if (channel) {
+                channel->RunEnd(static_cast<uint32_t>(patient), summary);
+            } else if (!telemetry_name.empty()) {
+                telemetry.CountUnassigned();
+            }
+        };
+        if (batched) {
+            vector<ModelParameters> lanes;
+            lanes.reserve(static_cast<size_t>(last - first));
+            for (uint64_t patient = first; patient < last; ++patient) {
+                lanes.push_back(SamplePatient(definition, base, patient));
+            }
+            BatchSimulation batch(lanes);
+            batch.Run();
+            for (size_t lane = 0; lane < lanes.size(); ++lane) add(first + lane, batch.Summary(lane));
+        } else {
+            std::ostream quiet(nullptr);
+            for (uint64_t patient = first; patient < last; ++patient) {
+                SimulationContext ctx(SamplePatient(definition, base, patient), quiet);
+                ctx.Run();
+                add(patient, SummarizeRun(ctx));
+            }
+        }
+        std::lock_guard<std::mutex> lock(total_mutex);
+        total.Merge(local);
+    });
+    telemetry.Close();
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    total.Print(cout);
+    cout << endl;
+    cout << "Cohort complete: " << total.Patients() << " patients in " << elapsed << " s ("
+         << (elapsed > 0.0 ? total.Patients() / elapsed : 0.0) << " patients/s)" << endl;
+
+    if (definition.validate_batch > 0 && BatchSimulation::Supports(base)) {
+        vector<ModelParameters> lanes;
+        uint64_t count = std::min(definition.validate_batch, definition.patients);
+        for (uint64_t patient = 0; patient < count; ++patient) {
+            lanes.push_back(SamplePatient(definition, base, patient));
+        }
+        BatchValidation validation = ValidateBatchAgainstScalar(lanes);
+        cout << endl;
+        cout << "Batch Engine Validation (" << validation.lanes << " patients vs. SimulationContext):" << endl;
+        cout << "  Outcome mismatches: " << validation.outcome_mismatches << endl;
+        cout << "  Max deviation: " << validation.max_deviation << " x local error tolerance" << endl;
+    }
+
+    if (!output_prefix.empty()) {
+        if (!total.WriteHistograms(output_prefix)) return 1;
+        cout << "Histograms written to: " << output_prefix << "_*.csv" << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../config/config_reader.hpp"
+#include "../simulation/parameters.hpp"
+#include "../simulation/report.hpp"
+
+// Log-normal inter-individual variability of one ModelParameters field.
+// ln(X) ~ N(ln(median), sigma^2); the median defaults to the base value.
+struct ParameterDistribution {
+    std::string key;
+    double median{};
+    double sigma{};
+};
+
+struct CohortDefinition {
+    std::vector<ParameterDistribution> parameters;
+    std::vector<double> cholesky;  // lower-triangular factor of the log-space correlation, row-major
+    uint64_t patients{1000};
+    uint64_t seed{1};
+    uint64_t batch{256};      // patients per pool task
+    unsigned threads{0};      // 0 = all hardware threads
+    double histogram_bin{12.0};
+    bool batch_engine{true};   // run each batch through BatchSimulation when possible
+    uint64_t validate_batch{0};  // patients re-run on both engines for comparison
+};
+
+// Reads "patients", "seed", "batch", "threads", "histogram_bin",
+// "batch_engine", "validate_batch" and, per
+// varied parameter, <key>.cv or <key>.sd_log (plus optional <key>.median).
+// Correlations between log-parameters are given as corr.<key_a>.<key_b>.
+bool LoadCohortDefinition(const ConfigReader& config, const ModelParameters& base,
+                          CohortDefinition& definition);
+
+// Draws the parameters of patient `index`. Each patient has its own stream
+// derived from (seed, index), so results do not depend on scheduling; the
+// patient's behavior_stream is `index` as well.
+ModelParameters SamplePatient(const CohortDefinition& definition, const ModelParameters& base,
+                              uint64_t index);
+
+// Fixed-size aggregate of run outcomes; memory does not grow with the cohort.
+class CohortStatistics {
+public:
+    CohortStatistics(double duration, double bin_width);
+
+    void Add(const RunSummary& summary);
+    void Merge(const CohortStatistics& other);
+
+    uint64_t Patients() const { return patients_; }
+    uint64_t Overdoses() const { return overdoses_; }
+    double TimeToOverdoseQuantile(double q) const;
+    void Print(std::ostream& out) const;
+    bool WriteHistograms(const std::string& prefix) const;
+
+private:
+    double bin_width_;
+    uint64_t patients_{0};
+    uint64_t overdoses_{0};
+    double death_time_sum_{0.0};
+    double peak_ratio_sum_{0.0};
+    double escalation_sum_{0.0};
+    std::vector<uint64_t> death_histogram_;
+    std::vector<uint64_t> escalation_histogram_;
+};
+
+// With a telemetry name, every finished patient is published live as a
+// RunEnd record.
+int RunCohort(const std::string& cohort_file, const std::string& base_file,
+              const std::string& output_prefix, const std::string& telemetry = "");
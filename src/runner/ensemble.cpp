@@ -0,0 +1,287 @@
+#include "ensemble.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+#include "thread_pool.hpp"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+namespace {
+
+// Log-spaced C bins from 1e-4 to 10 times C_critical; values outside land in
+// the first or last bin.
+const size_t kBandBins = 256;
+const double kBandDecadesBelow = 4.0;
+const double kBandDecadesAbove = 1.0;
+const double kBandQuantiles[] = {0.05, 0.25, 0.50, 0.75, 0.95};
+
+// Ensemble aggregates. Band point p is the StatusMonitor time
+// (p + 1) * stride * output_interval.
+class EnsembleBands : public BatchMonitorSink {
+public:
+    EnsembleBands(const ModelParameters& base, size_t band_points)
+        : interval_(base.output_interval),
+          log_low_(std::log10(base.C_critical) - kBandDecadesBelow),
+          log_step_((kBandDecadesBelow + kBandDecadesAbove) / kBandBins) {
+        // Monitors strictly before the end of the run.
+        uint64_t monitors = static_cast<uint64_t>(std::ceil(base.sim_duration / interval_ - 1e-9));
+        monitors = monitors > 0 ? monitors - 1 : 0;
+        stride_ = std::max<uint64_t>(1, (monitors + band_points - 1) / std::max<size_t>(band_points, 1));
+        points_ = static_cast<size_t>(monitors / stride_);
+        alive_.assign(points_, 0);
+        C_sum_.assign(points_, 0.0);
+        Tol_sum_.assign(points_, 0.0);
+        crossings_.assign(points_, 0);
+        histogram_.assign(points_ * kBandBins, 0);
+    }
+
+    void OnMonitor(size_t /*lane*/, double time, double C, double Tol) override {
+        uint64_t monitor = static_cast<uint64_t>(std::llround(time / interval_));
+        if (monitor == 0 || monitor % stride_ != 0) return;
+        size_t point = static_cast<size_t>(monitor / stride_ - 1);
+        if (point >= points_) return;
+        ++alive_[point];
+        C_sum_[point] += C;
+        Tol_sum_[point] += Tol;
+        ++histogram_[point * kBandBins + Bin(C)];
+    }
+
+    void AddPath(double crossing_time, bool alive) {
+        ++paths_;
+        if (!alive) ++deaths_;
+        if (crossing_time < 0.0) return;
+        ++crossed_;
+        crossing_time_sum_ += crossing_time;
+        // Counted at the first band point not before the crossing.
+        double point = std::ceil(crossing_time / (stride_ * interval_) - 1e-9) - 1.0;
+        if (point < static_cast<double>(points_)) ++crossings_[static_cast<size_t>(std::max(point, 0.0))];
+    }
+
+    void Merge(const EnsembleBands& other) {
+        paths_ += other.paths_;
+        deaths_ += other.deaths_;
+        crossed_ += other.crossed_;
+        crossing_time_sum_ += other.crossing_time_sum_;
+        for (size_t p = 0; p < points_; ++p) {
+            alive_[p] += other.alive_[p];
+            C_sum_[p] += other.C_sum_[p];
+            Tol_sum_[p] += other.Tol_sum_[p];
+            crossings_[p] += other.crossings_[p];
+        }
+        for (size_t i = 0; i < histogram_.size(); ++i) histogram_[i] += other.histogram_[i];
+    }
+
+    void Print(std::ostream& out) const {
+        double n = static_cast<double>(paths_);
+        double p = n > 0.0 ? crossed_ / n : 0.0;
+
+        // Wilson score interval, 95%.
+        double z = 1.96;
+        double denominator = 1.0 + z * z / n;
+        double center = (p + z * z / (2.0 * n)) / denominator;
+        double half_width = z * std::sqrt(p * (1.0 - p) / n + z * z / (4.0 * n * n)) / denominator;
+
+        out << "Ensemble Outcome:" << endl;
+        out << "  Paths simulated: " << paths_ << endl;
+        out << "  Crossed C_critical: " << crossed_ << " (" << std::setprecision(4) << (p * 100.0)
+            << "%, 95% CI " << ((center - half_width) * 100.0) << "% - " << ((center + half_width) * 100.0)
+            << "%)" << endl;
+        if (crossed_ > 0) out << "  Time of first crossing: mean = " << (crossing_time_sum_ / crossed_) << " h" << endl;
+        out << "  Deaths: " << deaths_ << " (" << (n > 0.0 ? deaths_ / n * 100.0 : 0.0) << "%)" << endl;
+
+        if (points_ == 0) return;
+        out << endl;
+        out << "Ensemble Bands (C over surviving paths, mg/L):" << endl;
+        out << "  " << std::setw(10) << "t (h)" << std::setw(8) << "alive" << std::setw(10) << "p05"
+            << std::setw(10) << "p50" << std::setw(10) << "p95" << std::setw(12) << "P(crossed)" << endl;
+        size_t every = std::max<size_t>(1, points_ / 10);
+        uint64_t crossed = 0;
+        for (size_t point = 0; point < points_; ++point) {
+            crossed += crossings_[point];
+            if ((point + 1) % every != 0 && point + 1 != points_) continue;
+            out << "  " << std::setw(10) << Time(point) << std::setw(8) << alive_[point] << std::setw(10)
+                << Quantile(point, 0.05) << std::setw(10) << Quantile(point, 0.50) << std::setw(10)
+                << Quantile(point, 0.95) << std::setw(12) << (n > 0.0 ? crossed / n : 0.0) << endl;
+        }
+    }
+
+    bool WriteBands(const string& path) const {
+        std::ofstream file(path);
+        if (!file.is_open()) {
+            cerr << "Error: Cannot write ensemble bands: " << path << endl;
+            return false;
+        }
+        file << "time,alive,C_mean,C_p05,C_p25,C_p50,C_p75,C_p95,Tol_mean,p_crossed\n";
+        double n = static_cast<double>(paths_);
+        uint64_t crossed = 0;
+        for (size_t point = 0; point < points_; ++point) {
+            crossed += crossings_[point];
+            double alive = static_cast<double>(alive_[point]);
+            file << Time(point) << "," << alive_[point] << ",";
+            if (alive_[point] > 0) {
+                file << C_sum_[point] / alive;
+                for (double q : kBandQuantiles) file << "," << Quantile(point, q);
+                file << "," << Tol_sum_[point] / alive;
+            } else {
+                file << ",,,,,,";
+            }
+            file << "," << (n > 0.0 ? crossed / n : 0.0) << "\n";
+        }
+        return true;
+    }
+
+private:
+    size_t Bin(double C) const {
+        if (C <= 0.0) return 0;
+        double bin = std::floor((std::log10(C) - log_low_) / log_step_);
+        if (bin < 0.0) return 0;
+        if (bin >= static_cast<double>(kBandBins)) return kBandBins - 1;
+        return static_cast<size_t>(bin);
+    }
+
+    double Time(size_t point) const { return (point + 1) * stride_ * interval_; }
+
+    // Interpolated log-linearly within the bin that holds the quantile.
+    double Quantile(size_t point, double q) const {
+        if (alive_[point] == 0) return 0.0;
+        const uint32_t* bins = &histogram_[point * kBandBins];
+        double target = q * static_cast<double>(alive_[point]);
+        double cumulative = 0.0;
+        for (size_t i = 0; i < kBandBins; ++i) {
+            double count = static_cast<double>(bins[i]);
+            if (count > 0.0 && cumulative + count >= target) {
+                return std::pow(10.0, log_low_ + (i + (target - cumulative) / count) * log_step_);
+            }
+            cumulative += count;
+        }
+        return std::pow(10.0, log_low_ + kBandBins * log_step_);
+    }
+
+    double interval_;
+    double log_low_;
+    double log_step_;
+    uint64_t stride_{1};
+    size_t points_{0};
+    vector<uint64_t> alive_;
+    vector<double> C_sum_;
+    vector<double> Tol_sum_;
+    vector<uint64_t> crossings_;  // first crossings since the previous point
+    vector<uint32_t> histogram_;  // points x kBandBins
+    uint64_t paths_{0};
+    uint64_t deaths_{0};
+    uint64_t crossed_{0};
+    double crossing_time_sum_{0.0};
+};
+
+}  // namespace
+
+bool LoadEnsembleDefinition(const ConfigReader& config, EnsembleDefinition& definition) {
+    definition.paths = static_cast<uint64_t>(config.get("paths", 1000.0));
+    definition.batch = static_cast<uint64_t>(config.get("batch", 256.0));
+    definition.threads = static_cast<unsigned>(config.get("threads", 0.0));
+    definition.band_points = static_cast<size_t>(config.get("band_points", 500.0));
+    definition.sde.seed = static_cast<uint64_t>(config.get("seed", 1.0));
+    definition.sde.noise.A = config.get("sigma_A", 0.2);
+    definition.sde.noise.C = config.get("sigma_C", 0.05);
+    definition.sde.noise.Tol = config.get("sigma_Tol", 0.05);
+    definition.sde.milstein = config.get("milstein", 1.0) != 0.0;
+    definition.sde.accuracy = config.get("accuracy", 1e-3);
+    if (definition.batch == 0) definition.batch = 1;
+    if (definition.band_points == 0) definition.band_points = 1;
+
+    if (definition.paths == 0) {
+        cerr << "Error: paths must be at least 1" << endl;
+        return false;
+    }
+    const PhysiologicalNoise& noise = definition.sde.noise;
+    if (noise.A < 0.0 || noise.C < 0.0 || noise.Tol < 0.0) {
+        cerr << "Error: sigma_A, sigma_C and sigma_Tol must not be negative" << endl;
+        return false;
+    }
+    if (definition.sde.accuracy <= 0.0) {
+        cerr << "Error: accuracy must be positive" << endl;
+        return false;
+    }
+    return true;
+}
+
+int RunEnsemble(const string& ensemble_file, const string& base_file, const string& output_prefix) {
+    ConfigReader base_config;
+    ConfigReader ensemble_config;
+    if (!base_config.load(base_file) || !ensemble_config.load(ensemble_file)) {
+        cerr << "Failed to load configuration. Exiting." << endl;
+        return 1;
+    }
+
+    ModelParameters base = LoadModelParameters(base_config);
+    EnsembleDefinition definition;
+    if (!LoadEnsembleDefinition(ensemble_config, definition)) {
+        cerr << "Failed to load ensemble definition. Exiting." << endl;
+        return 1;
+    }
+    if (!BatchSimulation::Supports(base)) {
+        cerr << "Error: The SDE mode runs on the batched engine, which does not support this scenario "
+             << "(naloxone, a non-explicit solver, state_events, linear_ratio or outcome_detection)" << endl;
+        return 1;
+    }
+
+    WorkStealingPool pool(definition.threads);
+    uint64_t batches = (definition.paths + definition.batch - 1) / definition.batch;
+    const PhysiologicalNoise& noise = definition.sde.noise;
+    cout << "Ensemble: " << definition.paths << " paths, " << batches << " batches on " << pool.Size()
+         << " threads" << endl;
+    cout << "Scheme: " << (definition.sde.milstein ? "Milstein" : "Euler-Maruyama")
+         << ", adaptive (step doubling), accuracy = " << definition.sde.accuracy << ", kernel "
+         << SelectBatchKernels().name << endl;
+    cout << "  Noise: sigma_A = " << noise.A << ", sigma_C = " << noise.C << ", sigma_Tol = " << noise.Tol
+         << " (1/sqrt(h))" << endl;
+    cout << endl;
+
+    EnsembleBands total(base, definition.band_points);
+    std::mutex total_mutex;
+
+    auto start = std::chrono::steady_clock::now();
+    pool.ParallelFor(static_cast<size_t>(batches), [&](size_t batch) {
+        uint64_t first = batch * definition.batch;
+        uint64_t last = std::min(first + definition.batch, definition.paths);
+        vector<ModelParameters> lanes(static_cast<size_t>(last - first), base);
+        for (uint64_t path = first; path < last; ++path) {
+            lanes[path - first].behavior_stream = static_cast<double>(path);
+        }
+
+        EnsembleBands local(base, definition.band_points);
+        BatchSimulation simulation(lanes);
+        simulation.UseNoise(definition.sde, first);
+        simulation.SetMonitorSink(&local);
+        simulation.Run();
+        for (size_t lane = 0; lane < lanes.size(); ++lane) {
+            local.AddPath(simulation.CrossingTime(lane), simulation.Summary(lane).patient_alive);
+        }
+
+        std::lock_guard<std::mutex> lock(total_mutex);
+        total.Merge(local);
+    });
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    total.Print(cout);
+    cout << endl;
+    cout << "Ensemble complete: " << definition.paths << " paths in " << elapsed << " s ("
+         << (elapsed > 0.0 ? definition.paths / elapsed : 0.0) << " paths/s)" << endl;
+
+    if (!output_prefix.empty()) {
+        if (!total.WriteBands(output_prefix + "_bands.csv")) return 1;
+        cout << "Bands written to: " << output_prefix << "_bands.csv" << endl;
+    }
+    return 0;
+}
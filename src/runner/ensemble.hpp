@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "../config/config_reader.hpp"
+#include "../simulation/batch_integrator.hpp"
+
+// Sample paths of one scenario under physiological noise (SDE mode).
+struct EnsembleDefinition {
+    uint64_t paths{1000};
+    uint64_t batch{256};     // paths per BatchSimulation
+    unsigned threads{0};     // 0 = all hardware threads
+    size_t band_points{500};  // time points of the ensemble bands
+    SdeOptions sde;
+};
+
+// Reads "paths", "seed", "batch", "threads", "band_points", "sigma_A",
+// "sigma_C", "sigma_Tol", "milstein" and "accuracy".
+bool LoadEnsembleDefinition(const ConfigReader& config, EnsembleDefinition& definition);
+
+// Runs every path through the batched engine in SDE mode. Only aggregates are
+// kept: per band time point a histogram of C over the surviving paths, from
+// which the quantile bands are read, and the time of each path's first
+// crossing of C_critical. Bands go to <output_prefix>_bands.csv.
+int RunEnsemble(const std::string& ensemble_file, const std::string& base_file,
+                const std::string& output_prefix);
@@ -0,0 +1,167 @@
+#include "fork.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+
+#include "../simulation/context.hpp"
+#include "../simulation/parameters.hpp"
+#include "../simulation/report.hpp"
+#include "thread_pool.hpp"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::setw;
+using std::string;
+using std::vector;
+
+namespace {
+
+// Config switches that are not ModelParameters fields by key.
+const char* const kSwitchKeys[] = {"solver", "state_events", "petri_net_enabled", "naloxone_available",
+                                   "stochastic_behavior"};
+
+bool IsConfigKey(const string& key) {
+    ModelParameters probe{};
+    double unused = 0.0;
+    if (GetModelParameter(probe, key, unused)) return true;
+    for (const char* name : kSwitchKeys) {
+        if (key == name) return true;
+    }
+    return false;
+}
+
+}  // namespace
+
+bool LoadForkDefinition(const ConfigReader& config, ForkDefinition& definition) {
+    definition.time = config.get("time", 0.0);
+    definition.threads = static_cast<unsigned>(config.get("threads", 0.0));
+    if (definition.time < 0.0) {
+        cerr << "Error: Fork time must not be negative\n";
+        return false;
+    }
+
+    std::map<string, ForkBranch> branches;
+    for (const string& entry : config.keys()) {
+        size_t dot = entry.find('.');
+        if (dot == string::npos) continue;
+        string name = entry.substr(0, dot);
+        string key = entry.substr(dot + 1);
+        if (!IsConfigKey(key)) {
+            cerr << "Error: Unknown parameter in fork branch " << name << ": " << key << "\n";
+            return false;
+        }
+        ForkBranch& branch = branches[name];
+        branch.name = name;
+        branch.overrides.emplace_back(key, config.get(entry));
+    }
+    for (const auto& entry : branches) definition.branches.push_back(entry.second);
+    if (definition.branches.empty()) {
+        cerr << "Error: No fork branches (<branch>.<key> = value)\n";
+        return false;
+    }
+    return true;
+}
+
+int RunFork(const string& fork_file, const string& base_file, const string& output_prefix) {
+    ConfigReader fork_config;
+    ConfigReader base_config;
+    ForkDefinition definition;
+    if (!fork_config.load(fork_file) || !LoadForkDefinition(fork_config, definition)) {
+        cerr << "Failed to load fork definition. Exiting." << endl;
+        return 1;
+    }
+    if (!base_config.load(base_file)) {
+        cerr << "Failed to load configuration. Exiting." << endl;
+        return 1;
+    }
+    ModelParameters base = LoadModelParameters(base_config);
+
+    // The shared prefix.
+    auto start = std::chrono::steady_clock::now();
+    SimulationSnapshot snapshot;
+    {
+        std::ostream quiet(nullptr);
+        SimulationContext ctx(base, quiet);
+        ctx.SetLogLevel(LogLevel::Summary);
+        ctx.RunUntil(definition.time);
+        if (!ctx.Checkpoint(snapshot)) {
+            cerr << "Error: The run cannot be checkpointed. Exiting." << endl;
+            return 1;
+        }
+    }
+    double prefix_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const vector<ForkBranch>& branches = definition.branches;
+    WorkStealingPool pool(definition.threads);
+    cout << "Fork: " << base_file << " simulated to t=" << snapshot.time << " h once, then " << branches.size()
+         << " branches on " << pool.Size() << " threads" << endl;
+    const PetriNetState& marking = snapshot.petri_state;
+    cout << "  State at fork: C=" << snapshot.state[1] << " mg/L, Tol=" << snapshot.state[4]
+         << ", dose=" << marking.current_dose << " mg, " << marking.dose_history.size() << " doses, "
+         << (snapshot.stopped ? (marking.patient_alive ? "run ended" : "DECEASED") : "running") << endl;
+    cout << endl;
+
+    vector<RunSummary> summaries(branches.size());
+    vector<bool> failed(branches.size(), false);
+    start = std::chrono::steady_clock::now();
+    pool.ParallelFor(branches.size(), [&](size_t b) {
+        ConfigReader config = base_config;
+        for (const auto& entry : branches[b].overrides) config.set(entry.first, entry.second);
+        ModelParameters params = LoadModelParameters(config);
+
+        std::ofstream log_file;
+        std::ostream quiet(nullptr);
+        if (!output_prefix.empty()) {
+            log_file.open(output_prefix + branches[b].name + ".log");
+            if (!log_file.is_open()) {
+                failed[b] = true;
+                return;
+            }
+        }
+        SimulationContext ctx(params, output_prefix.empty() ? quiet : log_file);
+        ctx.SetLogLevel(output_prefix.empty() ? LogLevel::Summary : LogLevel::Events);
+        ctx.Restore(snapshot);
+        ctx.Run();
+        if (!output_prefix.empty()) PrintSimulationSummary(ctx, log_file);
+        summaries[b] = SummarizeRun(ctx);
+    });
+    double branch_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::ios::fmtflags flags = cout.flags();
+    cout << std::left << "  " << setw(20) << "branch" << std::right << setw(10) << "outcome" << setw(10)
+         << "death_h" << setw(10) << "end_h" << setw(12) << "peak_C/Km" << setw(10) << "final_Tol" << setw(12)
+         << "escalations" << setw(8) << "doses" << "   overrides" << endl;
+    cout << std::fixed;
+    for (size_t b = 0; b < branches.size(); ++b) {
+        const RunSummary& s = summaries[b];
+        cout << "  " << std::left << setw(20) << branches[b].name << std::right;
+        if (failed[b]) {
+            cout << "  cannot open " << output_prefix << branches[b].name << ".log" << endl;
+            continue;
+        }
+        cout << setw(10) << (s.patient_alive ? "ALIVE" : "DECEASED") << std::setprecision(2) << setw(10);
+        if (s.patient_alive) {
+            cout << "-";
+        } else {
+            cout << s.time_of_death;
+        }
+        cout << setw(10) << s.end_time << setw(12) << std::setprecision(3) << s.peak_saturation_ratio
+             << setw(10) << s.final_Tol << setw(12) << s.escalations << setw(8) << s.doses << "  ";
+        cout.flags(flags);
+        for (const auto& entry : branches[b].overrides) cout << " " << entry.first << "=" << entry.second;
+        cout << std::fixed << endl;
+    }
+    cout.flags(flags);
+    cout << endl
+         << "Prefix " << prefix_seconds << " s once instead of " << branches.size() << " times; branches "
+         << branch_seconds << " s" << endl;
+    if (!output_prefix.empty()) cout << "Branch logs written to " << output_prefix << "<branch>.log" << endl;
+    for (bool f : failed) {
+        if (f) return 1;
+    }
+    return 0;
+}
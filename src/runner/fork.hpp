@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "../config/config_reader.hpp"
+
+// One branch: config entries that replace the base config's from the fork
+// time on.
+struct ForkBranch {
+    std::string name;
+    std::vector<std::pair<std::string, double>> overrides;
+};
+
+struct ForkDefinition {
+    double time{0.0};     // hours simulated once, before branching
+    unsigned threads{0};  // 0 = all hardware threads
+    std::vector<ForkBranch> branches;
+};
+
+// Reads "time", optional "threads" and branches declared as
+// <branch>.<config key> = value (e.g. rescue.naloxone_available = 1).
+bool LoadForkDefinition(const ConfigReader& config, ForkDefinition& definition);
+
+// Simulates base_file up to the fork time once, checkpoints it and continues
+// every branch from the snapshot with its overrides, in parallel. With an
+// output prefix, each branch's event log goes to <prefix><branch>.log.
+int RunFork(const std::string& fork_file, const std::string& base_file, const std::string& output_prefix);
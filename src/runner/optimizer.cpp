@@ -0,0 +1,323 @@
+#include "optimizer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <set>
+
+#include "../simulation/context.hpp"
+#include "../simulation/parameters.hpp"
+#include "../simulation/report.hpp"
+#include "sobol_sequence.hpp"
+#include "thread_pool.hpp"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::setw;
+using std::string;
+using std::vector;
+
+namespace {
+
+// First step of the compass search, as a fraction of each range.
+const double kInitialPattern = 0.25;
+
+double VariableValue(const RegimenVariable& variable, double unit) {
+    if (variable.geometric) return variable.min * std::pow(variable.max / variable.min, unit);
+    return variable.min + (variable.max - variable.min) * unit;
+}
+
+double VariableUnit(const RegimenVariable& variable, double value) {
+    double unit = variable.geometric ? std::log(value / variable.min) / std::log(variable.max / variable.min)
+                                     : (value - variable.min) / (variable.max - variable.min);
+    return std::isfinite(unit) ? std::min(std::max(unit, 0.0), 1.0) : 0.0;
+}
+
+// Outcome of one candidate regimen.
+struct RegimenResult {
+    vector<double> unit;  // position in [0, 1]^d
+    const char* stage{""};
+    bool feasible{false};
+    double mean_effect{0.0};  // time-averaged effect over the simulated span, %
+    double end_time{0.0};     // where the run stopped; the breach time if infeasible
+    double peak_ratio{0.0};   // max C/Km over the simulated span
+    int doses{0};
+    int escalations{0};
+};
+
+// Samples the effect for the time average and stops the run as soon as the
+// highest C reached so far (tracked at every accepted step, so no peak
+// between two checks is missed) breaks a constraint.
+class ConstraintMonitor : public ScheduledEvent {
+public:
+    ConstraintMonitor(SimulationContext& ctx, double limit_C, double interval)
+        : ScheduledEvent(ctx), limit_C_(limit_C), interval_(interval) {}
+
+    void Start() {
+        last_time_ = ctx_.Time();
+        last_effect_ = Effect();
+        Activate(ctx_.Time() + interval_);
+    }
+
+    void Behavior() override {
+        Sample();
+        if (breached_) {
+            ctx_.Stop();
+            return;
+        }
+        Activate(ctx_.Time() + interval_);
+    }
+
+    // Closes the average at the end of the run.
+    void Sample() {
+        double effect = Effect();
+        integral_ += 0.5 * (effect + last_effect_) * (ctx_.Time() - last_time_);
+        last_time_ = ctx_.Time();
+        last_effect_ = effect;
+        if (ctx_.PeakConcentration() > limit_C_) breached_ = true;
+    }
+
+    bool Breached() const { return breached_; }
+    double Integral() const { return integral_; }
+
+private:
+    double Effect() const {
+        const SimulationState& state = ctx_.state();
+        return ctx_.kernel().Effect(state.Ce->Value(), state.Tol->Value());
+    }
+
+    double limit_C_;
+    double interval_;
+    double last_time_{0.0};
+    double last_effect_{0.0};
+    double integral_{0.0};
+    bool breached_{false};
+};
+
+RegimenResult EvaluateRegimen(const OptimizerDefinition& definition, const ModelParameters& base,
+                              const vector<double>& unit) {
+    ModelParameters params = base;
+    for (size_t i = 0; i < unit.size(); ++i) {
+        SetModelParameter(params, definition.variables[i].key, VariableValue(definition.variables[i], unit[i]));
+    }
+
+    std::ostream quiet(nullptr);
+    SimulationContext ctx(params, quiet);
+    ctx.SetLogLevel(LogLevel::Summary);
+    double limit_C = std::min(definition.max_saturation_ratio * params.Km, params.C_toxic);
+    ConstraintMonitor& monitor = ctx.CreateEvent<ConstraintMonitor>(limit_C, definition.check_interval);
+    monitor.Start();
+    ctx.Run();
+    monitor.Sample();
+
+    RunSummary summary = SummarizeRun(ctx);
+    RegimenResult result;
+    result.unit = unit;
+    result.feasible = !monitor.Breached() && summary.patient_alive;
+    result.end_time = ctx.Time();
+    result.mean_effect = ctx.Time() > 0.0 ? monitor.Integral() / ctx.Time() : 0.0;
+    result.peak_ratio = summary.peak_saturation_ratio;
+    result.doses = summary.doses;
+    result.escalations = summary.escalations;
+    return result;
+}
+
+bool Better(const RegimenResult& a, const RegimenResult& b) {
+    if (a.feasible != b.feasible) return a.feasible;
+    if (a.feasible) return a.mean_effect > b.mean_effect;
+    return a.end_time > b.end_time;  // of two infeasible ones, the later breach
+}
+
+}  // namespace
+
+bool LoadOptimizerDefinition(const ConfigReader& config, OptimizerDefinition& definition) {
+    definition.max_saturation_ratio = config.get("max_saturation_ratio", 1.0);
+    definition.check_interval = config.get("check_interval", 0.25);
+    definition.samples = static_cast<uint64_t>(config.get("samples", 64.0));
+    definition.seed = static_cast<uint64_t>(config.get("seed", 0.0));
+    definition.max_iterations = static_cast<int>(config.get("max_iterations", 40.0));
+    definition.tolerance = config.get("tolerance", 1e-3);
+    definition.threads = static_cast<unsigned>(config.get("threads", 0.0));
+    if (definition.max_saturation_ratio <= 0.0 || definition.check_interval <= 0.0 || definition.tolerance <= 0.0) {
+        cerr << "Error: max_saturation_ratio, check_interval and tolerance must be positive\n";
+        return false;
+    }
+
+    std::set<string> keys;
+    for (const string& entry : config.keys()) {
+        size_t dot = entry.rfind('.');
+        if (dot == string::npos) continue;
+        keys.insert(entry.substr(0, dot));
+    }
+
+    ModelParameters probe{};
+    for (const string& key : keys) {
+        double unused = 0.0;
+        if (!GetModelParameter(probe, key, unused)) {
+            cerr << "Error: Unknown regimen variable: " << key << "\n";
+            return false;
+        }
+        RegimenVariable variable;
+        variable.key = key;
+        variable.min = config.get(key + ".min", 0.0);
+        variable.max = config.get(key + ".max", variable.min);
+        variable.geometric = config.get(key + ".log", 0.0) != 0.0;
+        if (variable.max <= variable.min || (variable.geometric && variable.min <= 0.0)) {
+            cerr << "Error: Invalid range for regimen variable: " << key << "\n";
+            return false;
+        }
+        definition.variables.push_back(variable);
+    }
+    if (definition.variables.empty() || definition.variables.size() > SobolSequence::kMaxDimensions) {
+        cerr << "Error: Between 1 and " << SobolSequence::kMaxDimensions << " regimen variables are supported\n";
+        return false;
+    }
+    return true;
+}
+
+int RunOptimizer(const string& definition_file, const string& base_file, const string& results_file) {
+    ConfigReader definition_config;
+    ConfigReader base_config;
+    OptimizerDefinition definition;
+    if (!definition_config.load(definition_file) || !LoadOptimizerDefinition(definition_config, definition)) {
+        cerr << "Failed to load optimizer definition. Exiting." << endl;
+        return 1;
+    }
+    if (!base_config.load(base_file)) {
+        cerr << "Failed to load configuration. Exiting." << endl;
+        return 1;
+    }
+    ModelParameters base = LoadModelParameters(base_config);
+    const vector<RegimenVariable>& variables = definition.variables;
+    size_t d = variables.size();
+
+    WorkStealingPool pool(definition.threads);
+    cout << "Regimen optimizer: " << d << " variables, maximize time-averaged effect over " << base.sim_duration
+         << " h subject to C/Km <= " << definition.max_saturation_ratio << " and C <= C_toxic, on " << pool.Size()
+         << " threads" << endl;
+    for (const auto& variable : variables) {
+        double value = 0.0;
+        GetModelParameter(base, variable.key, value);
+        cout << "  " << variable.key << ": " << (variable.geometric ? "log " : "") << "[" << variable.min << ", "
+             << variable.max << "], base " << value << endl;
+    }
+    cout << endl;
+
+    vector<RegimenResult> evaluated;
+    auto evaluate = [&](const vector<vector<double>>& points, const char* stage) {
+        vector<RegimenResult> results(points.size());
+        pool.ParallelFor(points.size(), [&](size_t i) {
+            results[i] = EvaluateRegimen(definition, base, points[i]);
+            results[i].stage = stage;
+        });
+        evaluated.insert(evaluated.end(), results.begin(), results.end());
+        return results;
+    };
+
+    auto start = std::chrono::steady_clock::now();
+
+    // Global stage: the base regimen (clamped into the box) and a Sobol
+    // sample of the box.
+    vector<vector<double>> points(1, vector<double>(d));
+    for (size_t i = 0; i < d; ++i) {
+        double value = 0.0;
+        GetModelParameter(base, variables[i].key, value);
+        points[0][i] = VariableUnit(variables[i], value);
+    }
+    SobolSequence sobol(static_cast<unsigned>(d), definition.seed);
+    for (uint64_t s = 0; s < definition.samples; ++s) {
+        points.emplace_back(d);
+        sobol.Next(points.back().data());
+    }
+    vector<RegimenResult> results = evaluate(points, "global");
+    RegimenResult best = results[0];
+    for (const auto& result : results) {
+        if (Better(result, best)) best = result;
+    }
+    cout << "Global stage: " << results.size() << " candidates, "
+         << std::count_if(results.begin(), results.end(), [](const RegimenResult& r) { return r.feasible; })
+         << " feasible" << endl;
+
+    // Local stage: compass search around the best point, all 2d neighbours
+    // of a round in parallel; the pattern halves when none improves.
+    int iteration = 0;
+    double pattern = kInitialPattern;
+    if (best.feasible) {
+        while (iteration < definition.max_iterations && pattern >= definition.tolerance) {
+            ++iteration;
+            points.clear();
+            for (size_t i = 0; i < d; ++i) {
+                for (double direction : {-1.0, 1.0}) {
+                    vector<double> point = best.unit;
+                    point[i] = std::min(std::max(point[i] + direction * pattern, 0.0), 1.0);
+                    if (point[i] != best.unit[i]) points.push_back(point);
+                }
+            }
+            bool improved = false;
+            for (const auto& result : evaluate(points, "local")) {
+                if (Better(result, best)) {
+                    best = result;
+                    improved = true;
+                }
+            }
+            if (!improved) pattern *= 0.5;
+        }
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t infeasible = 0;
+    double saved_hours = 0.0;
+    for (const auto& result : evaluated) {
+        if (result.feasible) continue;
+        ++infeasible;
+        saved_hours += base.sim_duration - result.end_time;
+    }
+
+    std::ios::fmtflags flags = cout.flags();
+    cout << "Local stage: " << iteration << " rounds, final pattern " << pattern << endl << endl;
+    cout << std::fixed << std::setprecision(4);
+    if (!best.feasible) {
+        cout << "No feasible regimen found; the latest breach was at t = " << best.end_time << " h" << endl;
+    } else {
+        cout << "Best regimen: mean effect " << best.mean_effect << "%, peak C/Km " << best.peak_ratio << ", "
+             << best.doses << " doses, " << best.escalations << " escalations" << endl;
+        cout << "  " << std::left << setw(28) << "variable" << std::right << setw(14) << "optimum" << setw(14)
+             << "base" << endl;
+        for (size_t i = 0; i < d; ++i) {
+            double value = 0.0;
+            GetModelParameter(base, variables[i].key, value);
+            cout << "  " << std::left << setw(28) << variables[i].key << std::right << setw(14)
+                 << VariableValue(variables[i], best.unit[i]) << setw(14) << value << endl;
+        }
+    }
+    cout << endl;
+    cout.flags(flags);
+
+    cout << "Optimizer complete: " << evaluated.size() << " candidates (" << infeasible << " infeasible, stopped "
+         << "at the breach, " << saved_hours << " simulated hours skipped) in " << elapsed << " s" << endl;
+
+    if (!results_file.empty()) {
+        std::ofstream out(results_file);
+        if (!out.is_open()) {
+            cerr << "Error: Cannot open results file: " << results_file << endl;
+            return 1;
+        }
+        out << "candidate,stage";
+        for (const auto& variable : variables) out << "," << variable.key;
+        out << ",feasible,mean_effect,end_time,peak_C_over_Km,doses,escalations\n";
+        out.precision(10);
+        for (size_t c = 0; c < evaluated.size(); ++c) {
+            const RegimenResult& result = evaluated[c];
+            out << c << "," << result.stage;
+            for (size_t i = 0; i < d; ++i) out << "," << VariableValue(variables[i], result.unit[i]);
+            out << "," << (result.feasible ? 1 : 0) << "," << result.mean_effect << "," << result.end_time << ","
+                << result.peak_ratio << "," << result.doses << "," << result.escalations << "\n";
+        }
+        cout << "Results written to: " << results_file << endl;
+    }
+    return best.feasible ? 0 : 1;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../config/config_reader.hpp"
+
+// A ModelParameters field (by config key) the optimizer may set within
+// [min, max].
+struct RegimenVariable {
+    std::string key;
+    double min{};
+    double max{};
+    bool geometric{false};
+};
+
+struct OptimizerDefinition {
+    std::vector<RegimenVariable> variables;
+    // Constraints over the whole horizon: C/Km never above
+    // max_saturation_ratio and C never above the candidate's C_toxic.
+    double max_saturation_ratio{1.0};
+    double check_interval{0.25};  // hours between constraint checks and effect samples
+    uint64_t samples{64};         // Sobol points of the global stage
+    uint64_t seed{0};
+    int max_iterations{40};       // rounds of the local pattern search
+    double tolerance{1e-3};       // smallest pattern step, as a fraction of each range
+    unsigned threads{0};          // 0 = all hardware threads
+};
+
+// Reads variables declared as <key>.min / <key>.max, with optional
+// <key>.log = 1 for a geometric scale, plus optional
+// "max_saturation_ratio", "check_interval", "samples", "seed",
+// "max_iterations", "tolerance" and "threads" entries.
+bool LoadOptimizerDefinition(const ConfigReader& config, OptimizerDefinition& definition);
+
+// Searches the regimen variables around base_file for the highest
+// time-averaged effect that keeps C/Km and C within the constraints over
+// the full duration: a Sobol sample of the box, then a parallel compass
+// search from the best feasible point. Candidates run concurrently on a
+// work-stealing pool; one that breaches a constraint is stopped there
+// instead of being run to the end. Prints the best regimen and, if
+// results_file is given, writes one CSV row per evaluated candidate.
+int RunOptimizer(const std::string& definition_file, const std::string& base_file,
+                 const std::string& results_file);
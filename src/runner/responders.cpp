@@ -0,0 +1,357 @@
+#include "responders.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "../simulation/calendar_queue.hpp"
+#include "../simulation/context.hpp"
+#include "../simulation/report.hpp"
+#include "thread_pool.hpp"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+namespace {
+
+// One entry of the population calendar: a patient calling for naloxone or a
+// responder becoming free again. Stored by value, so scheduling allocates
+// nothing once the calendar has grown to the population.
+struct PopulationEvent {
+    enum Kind : int { Call = 0, Release = 1 };
+
+    double time;
+    unsigned long long sequence;
+    Kind kind;
+    uint64_t index;  // patient for calls, responder for releases
+
+    bool operator<(const PopulationEvent& other) const {
+        if (time != other.time) return time < other.time;
+        return sequence < other.sequence;
+    }
+};
+
+// Naloxone outcomes of one patient.
+class RescueTally : public TrajectorySink {
+public:
+    void OnNaloxone(double /*t*/, NaloxoneOutcome outcome, double /*time_since_overdose*/) override {
+        if (outcome == NaloxoneOutcome::Revived) ++revived;
+        if (outcome == NaloxoneOutcome::WindowExpired) ++expired;
+        if (outcome == NaloxoneOutcome::Failed) ++failed;
+    }
+
+    uint64_t revived{0};
+    uint64_t expired{0};
+    uint64_t failed{0};
+};
+
+// A patient whose run is paused on a call or will be resumed by a
+// dispatch. The tally is declared first so it outlives the context.
+struct PopulationPatient {
+    RescueTally tally;
+    std::unique_ptr<SimulationContext> ctx;
+};
+
+class ResponderStatistics {
+public:
+    ResponderStatistics(double duration, double bin_width)
+        : duration_(duration),
+          bin_width_(bin_width),
+          delay_histogram_(static_cast<size_t>(std::ceil(duration / bin_width)) + 1, 0) {}
+
+    void Call() { ++calls_; }
+
+    void Queue(size_t length) {
+        ++queued_;
+        max_queue_ = std::max(max_queue_, length);
+    }
+
+    void Drop() { ++dropped_; }
+
+    void Dispatch(double now, double wait, double delay, double released) {
+        ++dispatched_;
+        wait_sum_ += wait;
+        wait_max_ = std::max(wait_max_, wait);
+        size_t bin = static_cast<size_t>(delay / bin_width_);
+        if (bin >= delay_histogram_.size()) bin = delay_histogram_.size() - 1;
+        ++delay_histogram_[bin];
+        if (now < duration_) busy_ += std::min(released, duration_) - now;
+    }
+
+    void Add(const RescueTally& tally) {
+        revived_ += tally.revived;
+        expired_ += tally.expired;
+        failed_ += tally.failed;
+    }
+
+    double DelayQuantile(double q) const {
+        if (dispatched_ == 0) return 0.0;
+        double target = q * static_cast<double>(dispatched_);
+        double cumulative = 0.0;
+        for (size_t i = 0; i < delay_histogram_.size(); ++i) {
+            double count = static_cast<double>(delay_histogram_[i]);
+            if (count > 0.0 && cumulative + count >= target) {
+                return (i + (target - cumulative) / count) * bin_width_;
+            }
+            cumulative += count;
+        }
+        return delay_histogram_.size() * bin_width_;
+    }
+
+    void Print(std::ostream& out, const ResponderDefinition& definition) const {
+        double calls = static_cast<double>(calls_);
+        out << "Responder Pool:" << endl;
+        out << "  Responders: " << definition.responders << " (travel " << (definition.travel_time * 60.0)
+            << " min, busy " << (definition.service_time * 60.0) << " min on scene)" << endl;
+        out << "  Calls: " << calls_ << ", dispatched: " << dispatched_ << ", had to wait: " << queued_ << " ("
+            << (calls > 0.0 ? 100.0 * queued_ / calls : 0.0) << "%), closed unanswered: " << dropped_ << endl;
+        if (dispatched_ > 0) {
+            out << "  Wait for a responder: mean = " << (wait_sum_ / dispatched_ * 60.0)
+                << " min, max = " << (wait_max_ * 60.0) << " min" << endl;
+            out << "  Response delay: median = " << (DelayQuantile(0.50) * 60.0) << " min, 90% = "
+                << (DelayQuantile(0.90) * 60.0) << " min, 99% = " << (DelayQuantile(0.99) * 60.0) << " min"
+                << endl;
+        }
+        out << "  Rescues: revived " << revived_ << ", window expired " << expired_ << ", failed " << failed_
+            << endl;
+        out << "  Longest queue: " << max_queue_ << " calls, utilization: "
+            << (100.0 * busy_ / (definition.responders * duration_)) << "%" << endl;
+    }
+
+    bool WriteHistogram(const string& prefix) const {
+        std::ofstream file(prefix + "_response_delay.csv");
+        if (!file.is_open()) {
+            cerr << "Error: Cannot write response-delay histogram with prefix: " << prefix << endl;
+            return false;
+        }
+        size_t last = 0;
+        for (size_t i = 0; i < delay_histogram_.size(); ++i) {
+            if (delay_histogram_[i] > 0) last = i + 1;
+        }
+        file << "delay_start_min,delay_end_min,calls\n";
+        for (size_t i = 0; i < last; ++i) {
+            file << i * bin_width_ * 60.0 << "," << (i + 1) * bin_width_ * 60.0 << "," << delay_histogram_[i]
+                 << "\n";
+        }
+        return true;
+    }
+
+private:
+    double duration_;
+    double bin_width_;
+    uint64_t calls_{0};
+    uint64_t dispatched_{0};
+    uint64_t queued_{0};
+    uint64_t dropped_{0};
+    uint64_t revived_{0};
+    uint64_t expired_{0};
+    uint64_t failed_{0};
+    size_t max_queue_{0};
+    double wait_sum_{0.0};
+    double wait_max_{0.0};
+    double busy_{0.0};
+    vector<uint64_t> delay_histogram_;
+};
+
+}  // namespace
+
+bool LoadResponderDefinition(const ConfigReader& config, const ModelParameters& base,
+                             ResponderDefinition& definition) {
+    if (!LoadCohortDefinition(config, base, definition.cohort)) return false;
+    definition.responders = static_cast<unsigned>(config.get("responders", 10.0));
+    definition.travel_time = config.get("travel_time", base.naloxone_response_delay);
+    definition.service_time = config.get("service_time", 1.0);
+    definition.drop_expired = config.get("drop_expired", 1.0) != 0.0;
+    definition.delay_bin = config.get("delay_bin", 1.0 / 60.0);
+    if (definition.responders == 0) {
+        cerr << "Error: At least one responder is required\n";
+        return false;
+    }
+    if (definition.travel_time < 0.0 || definition.service_time < 0.0 || definition.delay_bin <= 0.0) {
+        cerr << "Error: Responder times must not be negative and delay_bin must be positive\n";
+        return false;
+    }
+    return true;
+}
+
+int RunResponders(const string& population_file, const string& base_file, const string& output_prefix) {
+    ConfigReader base_config;
+    ConfigReader population_config;
+    if (!base_config.load(base_file) || !population_config.load(population_file)) {
+        cerr << "Failed to load configuration. Exiting." << endl;
+        return 1;
+    }
+
+    ModelParameters base = LoadModelParameters(base_config);
+    base.naloxone_available = true;  // the pool is the naloxone supply
+    ResponderDefinition definition;
+    if (!LoadResponderDefinition(population_config, base, definition)) {
+        cerr << "Failed to load responder definition. Exiting." << endl;
+        return 1;
+    }
+    const CohortDefinition& cohort = definition.cohort;
+
+    WorkStealingPool pool(cohort.threads);
+    cout << "Population: " << cohort.patients << " patients, " << cohort.parameters.size()
+         << " varied parameter(s), " << definition.responders << " shared responders, " << pool.Size()
+         << " threads" << endl;
+    for (const auto& d : cohort.parameters) {
+        cout << "  " << d.key << ": log-normal, median = " << d.median << ", sd_log = " << d.sigma << endl;
+    }
+    cout << endl;
+
+    CohortStatistics total(base.sim_duration, cohort.histogram_bin);
+    ResponderStatistics statistics(base.sim_duration, definition.delay_bin);
+    vector<std::unique_ptr<PopulationPatient>> patients(static_cast<size_t>(cohort.patients));
+    // Contexts log at Summary level, which nothing reaches, so the stream is
+    // never written to from two threads.
+    std::ostream quiet(nullptr);
+    auto start = std::chrono::steady_clock::now();
+
+    // Patients do not interact before their first call, so every run is
+    // taken up to it (or to its end) in parallel. Only callers stay in memory.
+    std::mutex total_mutex;
+    uint64_t batches = (cohort.patients + cohort.batch - 1) / cohort.batch;
+    pool.ParallelFor(static_cast<size_t>(batches), [&](size_t batch) {
+        CohortStatistics local(base.sim_duration, cohort.histogram_bin);
+        uint64_t first = batch * cohort.batch;
+        uint64_t last = std::min(first + cohort.batch, cohort.patients);
+        for (uint64_t index = first; index < last; ++index) {
+            std::unique_ptr<PopulationPatient> patient(new PopulationPatient());
+            patient->ctx.reset(new SimulationContext(SamplePatient(cohort, base, index), quiet));
+            SimulationContext& ctx = *patient->ctx;
+            ctx.SetLogLevel(LogLevel::Summary);
+            ctx.UseSharedResponders();
+            ctx.AddTrajectorySink(patient->tally);
+            ctx.Run();
+            if (ctx.AwaitingResponder()) {
+                patients[index] = std::move(patient);
+            } else {
+                local.Add(SummarizeRun(ctx));
+            }
+        }
+        std::lock_guard<std::mutex> lock(total_mutex);
+        total.Merge(local);
+    });
+
+    // From here on the calendar is processed in time order. Calls are pushed
+    // in patient order, so ties and therefore results do not depend on the
+    // number of threads.
+    CalendarQueue<PopulationEvent> calendar;
+    unsigned long long sequence = 0;
+    unsigned long long processed = 0;
+    double now = 0.0;
+    for (uint64_t index = 0; index < cohort.patients; ++index) {
+        if (patients[index]) {
+            calendar.Push(PopulationEvent{patients[index]->ctx->Time(), sequence++, PopulationEvent::Call, index});
+        }
+    }
+
+    vector<uint64_t> free_responders;
+    for (unsigned r = definition.responders; r-- > 0;) free_responders.push_back(r);
+    std::deque<uint64_t> waiting;
+    // Dispatched patients whose runs continue. A revived patient cannot call
+    // again before its rescue, so they only have to be advanced before the
+    // calendar moves past the earliest arrival, and are advanced together.
+    vector<uint64_t> resumed;
+    double resume_before = HUGE_VAL;
+
+    auto finish = [&](uint64_t index) {
+        total.Add(SummarizeRun(*patients[index]->ctx));
+        statistics.Add(patients[index]->tally);
+        patients[index].reset();
+    };
+    auto dispatch = [&](uint64_t index, uint64_t responder, double now) {
+        SimulationContext& ctx = *patients[index]->ctx;
+        double arrival = now + definition.travel_time;
+        double released = arrival + definition.service_time;
+        statistics.Dispatch(now, now - ctx.Time(), arrival - ctx.Time(), released);
+        ctx.DispatchResponder(arrival);
+        calendar.Push(PopulationEvent{released, sequence++, PopulationEvent::Release, responder});
+        resumed.push_back(index);
+        resume_before = std::min(resume_before, arrival);
+    };
+
+    while (!calendar.Empty() || !resumed.empty()) {
+        if (!resumed.empty() && (calendar.Empty() || calendar.Top().time >= resume_before)) {
+            if (resumed.size() == 1) {
+                patients[resumed[0]]->ctx->Run();
+            } else {
+                pool.ParallelFor(resumed.size(), [&](size_t i) { patients[resumed[i]]->ctx->Run(); });
+            }
+            for (uint64_t index : resumed) {
+                SimulationContext& ctx = *patients[index]->ctx;
+                if (ctx.AwaitingResponder()) {
+                    if (ctx.Time() < now) {
+                        cerr << "Error: patient " << index << " called at t=" << ctx.Time()
+                             << " h, before the calendar time t=" << now << " h" << endl;
+                        return 1;
+                    }
+                    calendar.Push(PopulationEvent{ctx.Time(), sequence++, PopulationEvent::Call, index});
+                } else {
+                    finish(index);
+                }
+            }
+            resumed.clear();
+            resume_before = HUGE_VAL;
+            continue;
+        }
+
+        PopulationEvent event = calendar.Top();
+        calendar.Pop();
+        now = event.time;
+        ++processed;
+        if (event.kind == PopulationEvent::Call) {
+            statistics.Call();
+            if (!free_responders.empty()) {
+                uint64_t responder = free_responders.back();
+                free_responders.pop_back();
+                dispatch(event.index, responder, event.time);
+            } else {
+                waiting.push_back(event.index);
+                statistics.Queue(waiting.size());
+            }
+            continue;
+        }
+
+        bool assigned = false;
+        while (!waiting.empty() && !assigned) {
+            uint64_t index = waiting.front();
+            waiting.pop_front();
+            SimulationContext& ctx = *patients[index]->ctx;
+            if (definition.drop_expired && event.time - ctx.Time() > ctx.params().naloxone_effective_window) {
+                statistics.Drop();
+                ctx.Stop();
+                finish(index);
+                continue;
+            }
+            dispatch(index, event.index, event.time);
+            assigned = true;
+        }
+        if (!assigned) free_responders.push_back(event.index);
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    total.Print(cout);
+    cout << endl;
+    statistics.Print(cout, definition);
+    cout << endl;
+    cout << "Population complete: " << total.Patients() << " patients, " << processed << " calendar events in "
+         << elapsed << " s (" << (elapsed > 0.0 ? total.Patients() / elapsed : 0.0) << " patients/s)" << endl;
+
+    if (!output_prefix.empty()) {
+        if (!total.WriteHistograms(output_prefix) || !statistics.WriteHistogram(output_prefix)) return 1;
+        cout << "Histograms written to: " << output_prefix << "_*.csv" << endl;
+    }
+    return 0;
+}
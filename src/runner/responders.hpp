@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+
+#include "../config/config_reader.hpp"
+#include "../simulation/parameters.hpp"
+#include "cohort.hpp"
+
+// A cohort sharing a limited pool of naloxone responders. The patients are
+// sampled as in a cohort; the responder keys come from the same file.
+struct ResponderDefinition {
+    CohortDefinition cohort;
+    unsigned responders{10};
+    double travel_time{0.0};   // h from dispatch to arrival; defaults to naloxone_response_delay
+    double service_time{1.0};  // h a responder stays busy after arriving
+    bool drop_expired{true};   // close queued calls older than naloxone_effective_window
+    double delay_bin{1.0 / 60.0};  // h per response-delay histogram bin
+};
+
+// Reads the cohort keys plus "responders", "travel_time", "service_time",
+// "drop_expired" and "delay_bin".
+bool LoadResponderDefinition(const ConfigReader& config, const ModelParameters& base,
+                             ResponderDefinition& definition);
+
+// Runs every patient of the cohort against one event calendar of calls and
+// responder releases. A call is served first-come first-served by the next
+// free responder, so the response delay is the queueing wait plus the
+// travel time instead of the fixed naloxone_response_delay.
+int RunResponders(const std::string& population_file, const std::string& base_file,
+                  const std::string& output_prefix);
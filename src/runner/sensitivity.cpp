@@ -0,0 +1,463 @@
+#include "sensitivity.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <set>
+
+#include "../simulation/batch_integrator.hpp"
+#include "../simulation/context.hpp"
+#include "../simulation/parameters.hpp"
+#include "../simulation/report.hpp"
+#include "sobol_sequence.hpp"
+#include "thread_pool.hpp"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::setw;
+using std::string;
+using std::vector;
+
+namespace {
+
+const int kOutputs = 3;
+const char* const kOutputNames[kOutputs] = {"time_to_overdose", "peak_C_over_Km", "final_Tol"};
+
+// Runs without an overdose count as reaching the end of the simulation.
+void Outputs(const RunSummary& summary, double duration, double out[kOutputs]) {
+    out[0] = summary.patient_alive ? duration : summary.time_of_death;
+    out[1] = summary.peak_saturation_ratio;
+    out[2] = summary.final_Tol;
+}
+
+double FactorValue(const SensitivityFactor& factor, double unit) {
+    if (factor.geometric) return factor.min * std::pow(factor.max / factor.min, unit);
+    return factor.min + (factor.max - factor.min) * unit;
+}
+
+// Runs every point on the pool, batch_lanes points per task through
+// BatchSimulation where it supports them, one SimulationContext otherwise.
+vector<RunSummary> Evaluate(WorkStealingPool& pool, size_t total, unsigned batch_lanes,
+                            const std::function<ModelParameters(size_t)>& point_params) {
+    size_t per_task = batch_lanes > 0 ? batch_lanes : 1;
+    size_t tasks = (total + per_task - 1) / per_task;
+    vector<RunSummary> summaries(total);
+    pool.ParallelFor(tasks, [&](size_t task) {
+        size_t first = task * per_task;
+        size_t last = std::min(first + per_task, total);
+        std::ostream quiet(nullptr);
+
+        vector<ModelParameters> lanes;
+        vector<size_t> lane_points;
+        for (size_t index = first; index < last; ++index) {
+            ModelParameters params = point_params(index);
+            if (batch_lanes > 0 && BatchSimulation::Supports(params)) {
+                lanes.push_back(params);
+                lane_points.push_back(index);
+                continue;
+            }
+            SimulationContext ctx(params, quiet);
+            ctx.Run();
+            summaries[index] = SummarizeRun(ctx);
+        }
+
+        if (!lanes.empty()) {
+            BatchSimulation batch(lanes);
+            batch.Run();
+            for (size_t lane = 0; lane < lanes.size(); ++lane) {
+                summaries[lane_points[lane]] = batch.Summary(lane);
+            }
+        }
+    });
+    return summaries;
+}
+
+// Saltelli design: base matrices A and B from one 2d-dimensional Sobol
+// sequence, and for each factor i the matrix AB_i (A with column i from B).
+// Run j * (d + 2) + k is row j of A (k = 0), B (k = 1) or AB_{k-2}.
+class SaltelliDesign {
+public:
+    SaltelliDesign(size_t factors, uint64_t samples, uint64_t seed)
+        : d_(factors), n_(samples), points_(samples * 2 * factors) {
+        SobolSequence sequence(static_cast<unsigned>(2 * d_), seed);
+        for (size_t j = 0; j < n_; ++j) sequence.Next(&points_[j * 2 * d_]);
+    }
+
+    size_t Runs() const { return n_ * (d_ + 2); }
+
+    double Unit(size_t run, size_t factor) const {
+        size_t j = run / (d_ + 2);
+        size_t k = run % (d_ + 2);
+        bool from_b = k == 1 || (k >= 2 && k - 2 == factor);
+        return points_[j * 2 * d_ + (from_b ? d_ : 0) + factor];
+    }
+
+    string Role(size_t run, const vector<SensitivityFactor>& factors) const {
+        size_t k = run % (d_ + 2);
+        if (k == 0) return "A";
+        if (k == 1) return "B";
+        return "AB:" + factors[k - 2].key;
+    }
+
+private:
+    size_t d_;
+    size_t n_;
+    vector<double> points_;
+};
+
+// Morris design: r trajectories of d + 1 points on a p-level grid. Each
+// starts at a quasi-random grid point and moves one factor at a time, in a
+// random order, by +-Delta = p / (2 (p - 1)).
+class MorrisDesign {
+public:
+    MorrisDesign(size_t factors, uint64_t trajectories, int levels, uint64_t seed)
+        : d_(factors),
+          r_(trajectories),
+          delta_(levels / (2.0 * (levels - 1))),
+          points_(trajectories * (factors + 1) * factors),
+          moves_(trajectories * factors) {
+        SobolSequence sequence(static_cast<unsigned>(d_), seed);
+        std::mt19937_64 random(seed);
+        vector<double> start(d_);
+        vector<size_t> order(d_);
+        for (size_t t = 0; t < r_; ++t) {
+            sequence.Next(start.data());
+            for (size_t i = 0; i < d_; ++i) {
+                int level = std::min(levels - 1, static_cast<int>(start[i] * levels));
+                start[i] = static_cast<double>(level) / (levels - 1);
+            }
+            std::iota(order.begin(), order.end(), 0);
+            std::shuffle(order.begin(), order.end(), random);
+
+            double* point = &points_[t * (d_ + 1) * d_];
+            std::copy(start.begin(), start.end(), point);
+            for (size_t s = 0; s < d_; ++s) {
+                double* next = point + d_;
+                std::copy(point, point + d_, next);
+                size_t factor = order[s];
+                double step = next[factor] + delta_ <= 1.0 + 1e-12 ? delta_ : -delta_;
+                next[factor] += step;
+                moves_[t * d_ + s] = Move{factor, step};
+                point = next;
+            }
+        }
+    }
+
+    struct Move {
+        size_t factor;
+        double step;
+    };
+
+    size_t Runs() const { return r_ * (d_ + 1); }
+    size_t Trajectories() const { return r_; }
+    double Unit(size_t run, size_t factor) const { return points_[run * d_ + factor]; }
+    const Move& MoveAt(size_t trajectory, size_t step) const { return moves_[trajectory * d_ + step]; }
+
+    string Role(size_t run) const {
+        return "t" + std::to_string(run / (d_ + 1)) + "." + std::to_string(run % (d_ + 1));
+    }
+
+private:
+    size_t d_;
+    size_t r_;
+    double delta_;
+    vector<double> points_;
+    vector<Move> moves_;
+};
+
+struct SobolIndices {
+    double mean{0.0};
+    double variance{0.0};
+    vector<double> first, total;        // S_i and S_Ti
+    vector<double> first_ci, total_ci;  // bootstrap 95% half-widths
+};
+
+// First-order indices by Saltelli (2010), total indices by Jansen (1999),
+// over the base rows listed in rows. The first-order estimator is not shift
+// invariant; centring f(B) on the mean removes most of its variance.
+void EstimateSobol(const vector<double>& y, size_t d, const vector<size_t>& rows, vector<double>& first,
+                   vector<double>& total, double& mean, double& variance) {
+    size_t stride = d + 2;
+    double sum = 0.0;
+    double sum_sq = 0.0;
+    for (size_t j : rows) {
+        double a = y[j * stride];
+        double b = y[j * stride + 1];
+        sum += a + b;
+        sum_sq += a * a + b * b;
+    }
+    double count = 2.0 * rows.size();
+    mean = sum / count;
+    variance = std::max(sum_sq / count - mean * mean, 0.0);
+
+    first.assign(d, 0.0);
+    total.assign(d, 0.0);
+    if (variance <= 0.0) return;
+    for (size_t i = 0; i < d; ++i) {
+        double first_sum = 0.0;
+        double total_sum = 0.0;
+        for (size_t j : rows) {
+            double a = y[j * stride];
+            double b = y[j * stride + 1];
+            double ab = y[j * stride + 2 + i];
+            first_sum += (b - mean) * (ab - a);
+            total_sum += (a - ab) * (a - ab);
+        }
+        first[i] = first_sum / rows.size() / variance;
+        total[i] = total_sum / (2.0 * rows.size()) / variance;
+    }
+}
+
+SobolIndices SobolAnalysis(const vector<double>& y, size_t d, size_t n, unsigned bootstrap, uint64_t seed) {
+    SobolIndices indices;
+    vector<size_t> rows(n);
+    std::iota(rows.begin(), rows.end(), 0);
+    EstimateSobol(y, d, rows, indices.first, indices.total, indices.mean, indices.variance);
+    indices.first_ci.assign(d, 0.0);
+    indices.total_ci.assign(d, 0.0);
+    if (bootstrap < 2 || indices.variance <= 0.0) return indices;
+
+    vector<double> first_sq(d, 0.0), total_sq(d, 0.0), first_sum(d, 0.0), total_sum(d, 0.0);
+    std::mt19937_64 random(seed + 1);
+    std::uniform_int_distribution<size_t> pick(0, n - 1);
+    vector<double> first, total;
+    double mean, variance;
+    for (unsigned b = 0; b < bootstrap; ++b) {
+        for (size_t& row : rows) row = pick(random);
+        EstimateSobol(y, d, rows, first, total, mean, variance);
+        for (size_t i = 0; i < d; ++i) {
+            first_sum[i] += first[i];
+            first_sq[i] += first[i] * first[i];
+            total_sum[i] += total[i];
+            total_sq[i] += total[i] * total[i];
+        }
+    }
+    for (size_t i = 0; i < d; ++i) {
+        double first_mean = first_sum[i] / bootstrap;
+        double total_mean = total_sum[i] / bootstrap;
+        indices.first_ci[i] = 1.96 * std::sqrt(std::max(first_sq[i] / bootstrap - first_mean * first_mean, 0.0));
+        indices.total_ci[i] = 1.96 * std::sqrt(std::max(total_sq[i] / bootstrap - total_mean * total_mean, 0.0));
+    }
+    return indices;
+}
+
+struct MorrisEffects {
+    vector<double> mu, mu_star, sigma;
+};
+
+// Elementary effects per unit of the normalized factor range.
+MorrisEffects MorrisAnalysis(const vector<double>& y, const MorrisDesign& design, size_t d) {
+    MorrisEffects effects;
+    effects.mu.assign(d, 0.0);
+    effects.mu_star.assign(d, 0.0);
+    effects.sigma.assign(d, 0.0);
+    vector<double> sum_sq(d, 0.0);
+    size_t r = design.Trajectories();
+    for (size_t t = 0; t < r; ++t) {
+        for (size_t s = 0; s < d; ++s) {
+            const MorrisDesign::Move& move = design.MoveAt(t, s);
+            size_t run = t * (d + 1) + s;
+            double effect = (y[run + 1] - y[run]) / move.step;
+            effects.mu[move.factor] += effect;
+            effects.mu_star[move.factor] += std::fabs(effect);
+            sum_sq[move.factor] += effect * effect;
+        }
+    }
+    for (size_t i = 0; i < d; ++i) {
+        effects.mu[i] /= r;
+        effects.mu_star[i] /= r;
+        if (r > 1) effects.sigma[i] = std::sqrt(std::max((sum_sq[i] - r * effects.mu[i] * effects.mu[i]) / (r - 1), 0.0));
+    }
+    return effects;
+}
+
+// Factor indices ordered by descending key.
+vector<size_t> Ranking(const vector<double>& key) {
+    vector<size_t> order(key.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return key[a] > key[b]; });
+    return order;
+}
+
+}  // namespace
+
+bool LoadSensitivityDefinition(const ConfigReader& config, SensitivityDefinition& definition) {
+    int method = static_cast<int>(config.get("method", 0.0));
+    if (method != 0 && method != 1) {
+        cerr << "Error: Invalid sensitivity method: " << method << " (0 = Sobol, 1 = Morris)\n";
+        return false;
+    }
+    definition.method = static_cast<SensitivityMethod>(method);
+    definition.samples = static_cast<uint64_t>(config.get("samples", 1024.0));
+    definition.levels = static_cast<int>(config.get("levels", 4.0));
+    definition.seed = static_cast<uint64_t>(config.get("seed", 0.0));
+    definition.threads = static_cast<unsigned>(config.get("threads", 0.0));
+    definition.batch_lanes = static_cast<unsigned>(config.get("batch_lanes", 256.0));
+    definition.bootstrap = static_cast<unsigned>(config.get("bootstrap", 200.0));
+    if (definition.samples < 2 || definition.levels < 2 || definition.levels % 2 != 0) {
+        cerr << "Error: samples must be >= 2 and levels an even number >= 2\n";
+        return false;
+    }
+
+    std::set<string> keys;
+    for (const string& entry : config.keys()) {
+        size_t dot = entry.rfind('.');
+        if (dot == string::npos) continue;
+        keys.insert(entry.substr(0, dot));
+    }
+
+    ModelParameters probe{};
+    for (const string& key : keys) {
+        double unused = 0.0;
+        if (!GetModelParameter(probe, key, unused)) {
+            cerr << "Error: Unknown sensitivity parameter: " << key << "\n";
+            return false;
+        }
+        SensitivityFactor factor;
+        factor.key = key;
+        factor.min = config.get(key + ".min", 0.0);
+        factor.max = config.get(key + ".max", factor.min);
+        factor.geometric = config.get(key + ".log", 0.0) != 0.0;
+        if (factor.max <= factor.min || (factor.geometric && factor.min <= 0.0)) {
+            cerr << "Error: Invalid range for sensitivity parameter: " << key << "\n";
+            return false;
+        }
+        definition.factors.push_back(factor);
+    }
+
+    size_t dimensions = definition.factors.size() * (definition.method == SensitivityMethod::Sobol ? 2 : 1);
+    if (definition.factors.empty() || dimensions > SobolSequence::kMaxDimensions) {
+        cerr << "Error: Between 1 and " << SobolSequence::kMaxDimensions
+             << (definition.method == SensitivityMethod::Sobol ? " / 2" : "") << " factors are supported\n";
+        return false;
+    }
+    return true;
+}
+
+int RunSensitivity(const string& definition_file, const string& base_file, const string& results_file) {
+    ConfigReader definition_config;
+    ConfigReader base_config;
+    SensitivityDefinition definition;
+    if (!definition_config.load(definition_file) || !LoadSensitivityDefinition(definition_config, definition)) {
+        cerr << "Failed to load sensitivity definition. Exiting." << endl;
+        return 1;
+    }
+    if (!base_config.load(base_file)) {
+        cerr << "Failed to load configuration. Exiting." << endl;
+        return 1;
+    }
+    ModelParameters base = LoadModelParameters(base_config);
+
+    const vector<SensitivityFactor>& factors = definition.factors;
+    size_t d = factors.size();
+    bool sobol = definition.method == SensitivityMethod::Sobol;
+    std::unique_ptr<SaltelliDesign> saltelli;
+    std::unique_ptr<MorrisDesign> morris;
+    if (sobol) {
+        saltelli.reset(new SaltelliDesign(d, definition.samples, definition.seed));
+    } else {
+        morris.reset(new MorrisDesign(d, definition.samples, definition.levels, definition.seed));
+    }
+    size_t total = sobol ? saltelli->Runs() : morris->Runs();
+    auto unit = [&](size_t run, size_t factor) {
+        return sobol ? saltelli->Unit(run, factor) : morris->Unit(run, factor);
+    };
+    auto point_params = [&](size_t run) {
+        ModelParameters params = base;
+        for (size_t i = 0; i < d; ++i) SetModelParameter(params, factors[i].key, FactorValue(factors[i], unit(run, i)));
+        return params;
+    };
+
+    WorkStealingPool pool(definition.threads);
+    bool batched = definition.batch_lanes > 0 && BatchSimulation::Supports(base);
+    if (sobol) {
+        cout << "Sensitivity: Saltelli design on a Sobol sequence, N = " << definition.samples << " x (" << d
+             << " + 2) = " << total << " runs on " << pool.Size() << " threads" << endl;
+    } else {
+        cout << "Sensitivity: Morris elementary effects, r = " << definition.samples << " trajectories x (" << d
+             << " + 1) = " << total << " runs, " << definition.levels << " levels, on " << pool.Size()
+             << " threads" << endl;
+    }
+    cout << "Engine: " << (batched ? "batched SIMD (" : "per-run SimulationContext")
+         << (batched ? SelectBatchKernels().name : "") << (batched ? ")" : "") << endl;
+    for (const auto& factor : factors) {
+        cout << "  " << factor.key << ": " << (factor.geometric ? "log-uniform" : "uniform") << " [" << factor.min
+             << ", " << factor.max << "]" << endl;
+    }
+    cout << endl;
+
+    auto start = std::chrono::steady_clock::now();
+    vector<RunSummary> summaries = Evaluate(pool, total, definition.batch_lanes, point_params);
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    vector<vector<double>> outputs(kOutputs, vector<double>(total));
+    for (size_t run = 0; run < total; ++run) {
+        double values[kOutputs];
+        Outputs(summaries[run], base.sim_duration, values);
+        for (int k = 0; k < kOutputs; ++k) outputs[k][run] = values[k];
+    }
+
+    std::ios::fmtflags flags = cout.flags();
+    cout << std::fixed << std::setprecision(4);
+    for (int k = 0; k < kOutputs; ++k) {
+        if (sobol) {
+            SobolIndices indices =
+                SobolAnalysis(outputs[k], d, definition.samples, definition.bootstrap, definition.seed);
+            cout << kOutputNames[k] << ": mean " << indices.mean << ", variance " << indices.variance << endl;
+            if (indices.variance <= 0.0) {
+                cout << "  constant over the design; no indices" << endl << endl;
+                continue;
+            }
+            cout << "  " << std::left << setw(28) << "parameter" << std::right << setw(10) << "S1" << setw(10)
+                 << "+-95%" << setw(10) << "ST" << setw(10) << "+-95%" << endl;
+            for (size_t i : Ranking(indices.total)) {
+                cout << "  " << std::left << setw(28) << factors[i].key << std::right << setw(10)
+                     << indices.first[i] << setw(10) << indices.first_ci[i] << setw(10) << indices.total[i]
+                     << setw(10) << indices.total_ci[i] << endl;
+            }
+        } else {
+            MorrisEffects effects = MorrisAnalysis(outputs[k], *morris, d);
+            cout << kOutputNames[k] << " (effects per unit of normalized range):" << endl;
+            cout << "  " << std::left << setw(28) << "parameter" << std::right << setw(12) << "mu*" << setw(12)
+                 << "mu" << setw(12) << "sigma" << endl;
+            for (size_t i : Ranking(effects.mu_star)) {
+                cout << "  " << std::left << setw(28) << factors[i].key << std::right << setw(12)
+                     << effects.mu_star[i] << setw(12) << effects.mu[i] << setw(12) << effects.sigma[i] << endl;
+            }
+        }
+        cout << endl;
+    }
+    cout.flags(flags);
+
+    cout << "Sensitivity complete: " << total << " runs in " << elapsed << " s ("
+         << (elapsed > 0.0 ? total / elapsed : 0.0) << " runs/s)" << endl;
+
+    if (!results_file.empty()) {
+        std::ofstream results(results_file);
+        if (!results.is_open()) {
+            cerr << "Error: Cannot open results file: " << results_file << endl;
+            return 1;
+        }
+        results << "run,role";
+        for (const auto& factor : factors) results << "," << factor.key;
+        for (int k = 0; k < kOutputs; ++k) results << "," << kOutputNames[k];
+        results << "\n";
+        results.precision(10);
+        for (size_t run = 0; run < total; ++run) {
+            results << run << "," << (sobol ? saltelli->Role(run, factors) : morris->Role(run));
+            for (size_t i = 0; i < d; ++i) results << "," << FactorValue(factors[i], unit(run, i));
+            for (int k = 0; k < kOutputs; ++k) results << "," << outputs[k][run];
+            results << "\n";
+        }
+        cout << "Results written to: " << results_file << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../config/config_reader.hpp"
+
+enum class SensitivityMethod : int {
+    Sobol = 0,   // Saltelli design on a Sobol sequence; first-order and total indices
+    Morris = 1,  // elementary effects along one-at-a-time trajectories
+};
+
+// A ModelParameters field (by config key) varied over [min, max].
+struct SensitivityFactor {
+    std::string key;
+    double min{};
+    double max{};
+    bool geometric{false};
+};
+
+struct SensitivityDefinition {
+    SensitivityMethod method{SensitivityMethod::Sobol};
+    std::vector<SensitivityFactor> factors;
+    uint64_t samples{1024};  // Saltelli base samples N, or Morris trajectories r
+    int levels{4};           // Morris grid levels p
+    uint64_t seed{0};        // 0 = plain Sobol points; otherwise a random digital shift
+    unsigned threads{0};     // 0 = all hardware threads
+    unsigned batch_lanes{256};  // > 0: points per BatchSimulation; 0 = one SimulationContext each
+    unsigned bootstrap{200};    // resamples for the Sobol confidence intervals
+};
+
+// Reads factors declared as <key>.min / <key>.max, with optional
+// <key>.log = 1 for log-uniform sampling, plus optional "method"
+// (0 Sobol, 1 Morris), "samples", "levels", "seed", "threads",
+// "batch_lanes" and "bootstrap" entries.
+bool LoadSensitivityDefinition(const ConfigReader& config, SensitivityDefinition& definition);
+
+// Evaluates the design around base_file on a work-stealing pool, prints the
+// indices of time-to-overdose, peak C/Km and final Tol, and, if
+// results_file is given, writes one CSV row per run.
+int RunSensitivity(const std::string& definition_file, const std::string& base_file,
+                   const std::string& results_file);
@@ -0,0 +1,95 @@
+#include "sobol_sequence.hpp"
+
+#include <random>
+
+namespace {
+
+struct DirectionNumbers {
+    unsigned degree;  // s, degree of the primitive polynomial
+    unsigned coefficients;  // a, its inner coefficients as bits
+    unsigned m[7];  // initial direction numbers m_1..m_s
+};
+
+// Dimensions 2..37; dimension 1 is the van der Corput sequence.
+const DirectionNumbers kDirectionNumbers[SobolSequence::kMaxDimensions - 1] = {
+    {1, 0, {1}},
+    {2, 1, {1, 3}},
+    {3, 1, {1, 3, 1}},
+    {3, 2, {1, 1, 1}},
+    {4, 1, {1, 1, 3, 3}},
+    {4, 4, {1, 3, 5, 13}},
+    {5, 2, {1, 1, 5, 5, 17}},
+    {5, 4, {1, 1, 5, 5, 5}},
+    {5, 7, {1, 1, 7, 11, 19}},
+    {5, 11, {1, 1, 5, 1, 1}},
+    {5, 13, {1, 1, 1, 3, 11}},
+    {5, 14, {1, 3, 5, 5, 31}},
+    {6, 1, {1, 3, 3, 9, 7, 49}},
+    {6, 13, {1, 1, 1, 15, 21, 21}},
+    {6, 16, {1, 3, 1, 13, 27, 49}},
+    {6, 19, {1, 1, 1, 15, 7, 5}},
+    {6, 22, {1, 3, 1, 15, 13, 25}},
+    {6, 25, {1, 1, 5, 5, 19, 61}},
+    {7, 1, {1, 3, 7, 11, 23, 15, 103}},
+    {7, 4, {1, 3, 7, 13, 13, 15, 69}},
+    {7, 7, {1, 1, 3, 13, 7, 35, 63}},
+    {7, 8, {1, 3, 5, 9, 1, 25, 53}},
+    {7, 14, {1, 3, 1, 13, 9, 35, 107}},
+    {7, 19, {1, 3, 1, 5, 27, 61, 31}},
+    {7, 21, {1, 1, 5, 11, 19, 41, 61}},
+    {7, 28, {1, 3, 5, 3, 3, 13, 69}},
+    {7, 31, {1, 1, 7, 13, 1, 19, 1}},
+    {7, 32, {1, 3, 7, 5, 13, 19, 59}},
+    {7, 37, {1, 1, 3, 9, 25, 29, 41}},
+    {7, 41, {1, 3, 5, 13, 23, 1, 55}},
+    {7, 42, {1, 3, 7, 3, 13, 59, 17}},
+    {7, 50, {1, 3, 1, 3, 5, 53, 69}},
+    {7, 55, {1, 1, 5, 5, 23, 33, 13}},
+    {7, 56, {1, 1, 7, 7, 1, 61, 123}},
+    {7, 59, {1, 1, 7, 9, 13, 61, 49}},
+    {7, 62, {1, 3, 3, 5, 3, 55, 33}},
+};
+
+}  // namespace
+
+SobolSequence::SobolSequence(unsigned dimensions, uint64_t seed)
+    : dimensions_(dimensions),
+      directions_(static_cast<size_t>(dimensions) * kBits),
+      state_(dimensions, 0),
+      shift_(dimensions, 0) {
+    for (unsigned d = 0; d < dimensions_; ++d) {
+        uint32_t* v = &directions_[static_cast<size_t>(d) * kBits];
+        if (d == 0) {
+            for (unsigned k = 0; k < kBits; ++k) v[k] = 1u << (kBits - 1 - k);
+            continue;
+        }
+        const DirectionNumbers& entry = kDirectionNumbers[d - 1];
+        unsigned s = entry.degree;
+        for (unsigned k = 0; k < kBits; ++k) {
+            if (k < s) {
+                v[k] = entry.m[k] << (kBits - 1 - k);
+                continue;
+            }
+            v[k] = v[k - s] ^ (v[k - s] >> s);
+            for (unsigned l = 1; l < s; ++l) {
+                if ((entry.coefficients >> (s - 1 - l)) & 1u) v[k] ^= v[k - l];
+            }
+        }
+    }
+
+    if (seed != 0) {
+        std::mt19937_64 random(seed);
+        for (uint32_t& shift : shift_) shift = static_cast<uint32_t>(random() >> 32);
+    }
+}
+
+void SobolSequence::Next(double* point) {
+    // Gray code: point i differs from point i - 1 in the direction number of
+    // the lowest set bit of i.
+    ++index_;
+    unsigned bit = static_cast<unsigned>(__builtin_ctzll(index_));
+    for (unsigned d = 0; d < dimensions_; ++d) {
+        state_[d] ^= directions_[static_cast<size_t>(d) * kBits + bit];
+        point[d] = static_cast<double>(state_[d] ^ shift_[d]) / 4294967296.0;
+    }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Sobol low-discrepancy sequence in Gray-code order, with the Joe-Kuo
+// (new-joe-kuo-6.21201) direction numbers for the first kMaxDimensions
+// dimensions.
+class SobolSequence {
+public:
+    static const unsigned kMaxDimensions = 37;
+
+    // A non-zero seed applies a random digital shift (XOR) per dimension,
+    // which randomizes the points while keeping their net structure.
+    explicit SobolSequence(unsigned dimensions, uint64_t seed = 0);
+
+    // Writes the next point of [0, 1)^dimensions. The all-zero first point
+    // is skipped.
+    void Next(double* point);
+
+    unsigned Dimensions() const { return dimensions_; }
+
+private:
+    static const unsigned kBits = 32;
+
+    unsigned dimensions_;
+    uint64_t index_{0};
+    std::vector<uint32_t> directions_;  // kBits per dimension
+    std::vector<uint32_t> state_;
+    std::vector<uint32_t> shift_;
+};
@@ -0,0 +1,112 @@
+#include "steady_state.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+#include "../config/config_reader.hpp"
+#include "../simulation/parameters.hpp"
+#include "../simulation/periodic_orbit.hpp"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::fixed;
+using std::setprecision;
+using std::setw;
+
+namespace {
+
+const int kDriftPoints = 8;
+// Orbit considered settled once the slowest mode has decayed to this.
+const double kSettled = 1e-3;
+
+void PrintMultiplier(const char* label, std::complex<double> multiplier) {
+    cout << "    " << setw(6) << label << "  " << setprecision(4) << std::abs(multiplier);
+    if (multiplier.imag() != 0.0) {
+        cout << "  (" << multiplier.real() << (multiplier.imag() < 0 ? " - " : " + ")
+             << std::fabs(multiplier.imag()) << "i)";
+    }
+    cout << endl;
+}
+
+}  // namespace
+
+int RunSteadyState(const std::string& config_file) {
+    ConfigReader config;
+    if (!config.load(config_file)) {
+        cerr << "Failed to load configuration. Exiting." << endl;
+        return 1;
+    }
+    ModelParameters params = LoadModelParameters(config);
+
+    cout << fixed << setprecision(2);
+    cout << "Periodic steady state: " << params.current_dose << " mg every " << params.dosing_interval << " h"
+         << endl;
+
+    auto start = std::chrono::steady_clock::now();
+    PeriodicOrbit orbit = SolvePeriodicOrbit(params);
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (orbit.exceeds_capacity) {
+        cout << "  No steady state: dose rate " << params.current_dose / params.dosing_interval
+             << " mg/h reaches the elimination capacity Vmax = " << params.Vmax << " mg/h." << endl;
+        cout << "  C rises without bound under this regimen." << endl;
+        return 0;
+    }
+    if (!orbit.converged) {
+        cout << "  Newton shooting did not converge (" << orbit.iterations << " iterations, residual "
+             << std::scientific << setprecision(2) << orbit.residual << fixed << ")" << endl;
+        return 1;
+    }
+
+    double Tol_star = orbit.trough[4];
+    cout << "  Newton iterations: " << orbit.iterations << ", residual " << std::scientific << setprecision(2)
+         << orbit.residual << fixed << ", solved in " << setprecision(1) << elapsed * 1000.0 << " ms" << endl;
+    cout << setprecision(3);
+    cout << "  C:      trough " << setw(8) << orbit.C_min << "  peak " << setw(8) << orbit.C_max << " mg/L" << endl;
+    cout << "  Ce:     trough " << setw(8) << orbit.Ce_min << "  peak " << setw(8) << orbit.Ce_max << " mg/L" << endl;
+    cout << "  Effect: trough " << setw(8) << orbit.effect_min << "  peak " << setw(8) << orbit.effect_max << " %"
+         << endl;
+    cout << "  Peak C/Km = " << orbit.C_max / params.Km
+         << (orbit.C_max > params.Km ? " (above Km: elimination saturated at peak)" : " (below Km)") << endl;
+    cout << "  Tol = " << Tol_star << " (EC50 x" << 1.0 + Tol_star << ")" << endl;
+
+    cout << "  Floquet multipliers:" << endl;
+    PrintMultiplier("A", orbit.multipliers[0]);
+    PrintMultiplier("C/P", orbit.multipliers[1]);
+    PrintMultiplier("C/P", orbit.multipliers[2]);
+    PrintMultiplier("Ce", orbit.multipliers[3]);
+    PrintMultiplier("Tol", orbit.multipliers[4]);
+    bool stable = orbit.spectral_radius < 1.0;
+    cout << "  Stability: " << (stable ? "stable" : "UNSTABLE") << " (spectral radius " << setprecision(4)
+         << orbit.spectral_radius << ")";
+    if (stable && orbit.spectral_radius > 0.0) {
+        double cycles = std::ceil(std::log(kSettled) / std::log(orbit.spectral_radius));
+        cout << ", settles to 0.1% in " << setprecision(0) << cycles << " doses ("
+             << setprecision(1) << cycles * params.dosing_interval / 24.0 << " days)";
+    }
+    cout << endl << endl;
+
+    cout << "Tolerance drift along the slow manifold (from Tol = 0):" << endl;
+    cout << "  " << setw(10) << "time (h)" << setw(10) << "Tol" << setw(16) << "trough effect" << setw(14)
+         << "peak effect" << endl;
+    for (const ToleranceDriftPoint& point : ContinueOnTolerance(params, orbit, 0.0, kDriftPoints)) {
+        cout << "  " << setprecision(1) << setw(10) << point.time << setprecision(3) << setw(10) << point.Tol
+             << setw(15) << point.effect_trough << "%" << setw(13) << point.effect_peak << "%" << endl;
+    }
+    double relief_loss = TimeToReliefLoss(params, orbit, 0.0);
+    cout << setprecision(1);
+    if (relief_loss < 0.0) {
+        cout << "  Peak effect stays above the relief threshold (" << params.effect_relief_threshold << "%)"
+             << endl;
+    } else if (relief_loss == 0.0) {
+        cout << "  Peak effect is below the relief threshold (" << params.effect_relief_threshold
+             << "%) from the first dose on" << endl;
+    } else {
+        cout << "  Peak effect falls below the relief threshold (" << params.effect_relief_threshold
+             << "%) after " << relief_loss << " h (" << relief_loss / 24.0 << " days)" << endl;
+    }
+    return 0;
+}
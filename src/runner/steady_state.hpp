@@ -0,0 +1,8 @@
+#pragma once
+
+#include <string>
+
+// Solves the periodic steady state of the fixed regimen in config_file
+// (initial_dose every dosing_interval) and reports trough/peak C, Ce and
+// effect, the Floquet multipliers and the slow drift of tolerance.
+int RunSteadyState(const std::string& config_file);
@@ -0,0 +1,312 @@
+#include "sweep.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <string>
+
+#include "../logging/async_log.hpp"
+#include "../simulation/batch_integrator.hpp"
+#include "../simulation/context.hpp"
+#include "../simulation/parameters.hpp"
+#include "../simulation/report.hpp"
+#include "../telemetry/telemetry_publisher.hpp"
+#include "thread_pool.hpp"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+namespace {
+
+struct SweepPoint {
+    size_t base;
+    vector<double> values;
+};
+
+SweepPoint PointAt(const SweepDefinition& definition, size_t grid_size, size_t index) {
+    SweepPoint point;
+    point.base = index / grid_size;
+    size_t rest = index % grid_size;
+    point.values.resize(definition.axes.size());
+    for (size_t a = definition.axes.size(); a-- > 0;) {
+        const vector<double>& values = definition.axes[a].values;
+        point.values[a] = values[rest % values.size()];
+        rest /= values.size();
+    }
+    return point;
+}
+
+}  // namespace
+
+bool LoadSweepDefinition(const ConfigReader& config, SweepDefinition& definition) {
+    definition.threads = static_cast<unsigned>(config.get("threads", 0.0));
+    definition.batch_lanes = static_cast<unsigned>(config.get("batch_lanes", 0.0));
+    definition.warmup = config.get("warmup", 0.0);
+    definition.validate_outcomes = config.get("validate_outcomes", 0.0) != 0.0;
+    double log_level = config.get("log_level", 0.0);
+    if (!ParseLogLevel(std::to_string(static_cast<int>(log_level)), definition.log_level)) {
+        cerr << "Error: Invalid sweep log_level: " << log_level << "\n";
+        return false;
+    }
+
+    std::set<string> keys;
+    for (const string& entry : config.keys()) {
+        size_t dot = entry.rfind('.');
+        if (dot == string::npos) continue;
+        keys.insert(entry.substr(0, dot));
+    }
+
+    ModelParameters probe{};
+    for (const string& key : keys) {
+        double unused = 0.0;
+        if (!GetModelParameter(probe, key, unused)) {
+            cerr << "Error: Unknown sweep parameter: " << key << "\n";
+            return false;
+        }
+        // The dose in the Petri-net marking comes from the warm-up snapshot,
+        // so an initial_dose axis would only relabel identical runs.
+        if (definition.warmup > 0.0 && key == "initial_dose") {
+            cerr << "Error: Sweep parameter initial_dose cannot be combined with warmup\n";
+            return false;
+        }
+
+        double min = config.get(key + ".min", 0.0);
+        double max = config.get(key + ".max", min);
+        int steps = static_cast<int>(config.get(key + ".steps", 1.0));
+        bool geometric = config.get(key + ".log", 0.0) != 0.0;
+        if (steps < 1 || (geometric && (min <= 0.0 || max <= 0.0))) {
+            cerr << "Error: Invalid range for sweep parameter: " << key << "\n";
+            return false;
+        }
+
+        SweepAxis axis;
+        axis.key = key;
+        for (int i = 0; i < steps; ++i) {
+            double f = steps > 1 ? static_cast<double>(i) / (steps - 1) : 0.0;
+            axis.values.push_back(geometric ? min * std::pow(max / min, f) : min + (max - min) * f);
+        }
+        definition.axes.push_back(axis);
+    }
+    return true;
+}
+
+int RunSweep(const string& sweep_file, const string& results_file, const vector<string>& base_files,
+             const string& telemetry_name) {
+    ConfigReader sweep_config;
+    SweepDefinition definition;
+    if (!sweep_config.load(sweep_file) || !LoadSweepDefinition(sweep_config, definition)) {
+        cerr << "Failed to load sweep definition. Exiting." << endl;
+        return 1;
+    }
+
+    vector<ModelParameters> bases;
+    for (const string& file : base_files) {
+        ConfigReader config;
+        if (!config.load(file)) {
+            cerr << "Failed to load configuration. Exiting." << endl;
+            return 1;
+        }
+        bases.push_back(LoadModelParameters(config));
+    }
+
+    // A warm-up runs each base config once; its points all continue from
+    // that snapshot with their own parameters.
+    vector<SimulationSnapshot> warmups(definition.warmup > 0.0 ? bases.size() : 0);
+    for (size_t b = 0; b < warmups.size(); ++b) {
+        std::ostream quiet(nullptr);
+        SimulationContext ctx(bases[b], quiet);
+        ctx.SetLogLevel(LogLevel::Summary);
+        ctx.RunUntil(definition.warmup);
+        if (!ctx.Checkpoint(warmups[b])) {
+            cerr << "Error: Cannot snapshot the warm-up of " << base_files[b] << ". Exiting." << endl;
+            return 1;
+        }
+    }
+
+    size_t grid_size = 1;
+    for (const auto& axis : definition.axes) grid_size *= axis.values.size();
+    size_t total = grid_size * bases.size();
+
+    WorkStealingPool pool(definition.threads);
+    cout << "Sweep: " << bases.size() << " base config(s) x " << grid_size << " grid points = "
+         << total << " runs on " << pool.Size() << " threads" << endl;
+    if (!warmups.empty()) {
+        cout << "Shared warm-up: first " << definition.warmup << " h simulated once per base config" << endl;
+    }
+
+    auto point_params = [&](size_t index) {
+        SweepPoint point = PointAt(definition, grid_size, index);
+        ModelParameters params = bases[point.base];
+        for (size_t a = 0; a < definition.axes.size(); ++a) {
+            SetModelParameter(params, definition.axes[a].key, point.values[a]);
+        }
+        return params;
+    };
+
+    size_t per_task = definition.batch_lanes > 0 ? definition.batch_lanes : 1;
+    size_t tasks = (total + per_task - 1) / per_task;
+    vector<RunSummary> summaries(total);
+    // Per-run logs go through one background writer; every line carries its
+    // run index so concurrent runs stay readable.
+    std::unique_ptr<AsyncLogWriter> log_writer;
+    if (definition.log_level > LogLevel::Summary) {
+        log_writer.reset(new AsyncLogWriter(cout));
+    }
+    TelemetryPublisher telemetry;
+    if (!telemetry_name.empty() && !telemetry.Open(telemetry_name, pool.Size(), total)) {
+        return 1;
+    }
+    auto publish = [&](size_t index) {
+        if (telemetry_name.empty()) return;
+        TelemetryChannel* channel = telemetry.Channel();
+        if (channel) {
+            channel->RunEnd(static_cast<uint32_t>(index), summaries[index]);
+        } else {
+            telemetry.CountUnassigned();
+        }
+    };
+    auto start = std::chrono::steady_clock::now();
+    pool.ParallelFor(tasks, [&](size_t task) {
+        size_t first = task * per_task;
+        size_t last = std::min(first + per_task, total);
+        std::ostream quiet(nullptr);
+
+        vector<ModelParameters> lanes;
+        vector<size_t> lane_points;
+        for (size_t index = first; index < last; ++index) {
+            ModelParameters params = point_params(index);
+            const SimulationSnapshot* warmup = warmups.empty() ? nullptr : &warmups[index / grid_size];
+            if (!warmup && definition.batch_lanes > 0 && BatchSimulation::Supports(params)) {
+                lanes.push_back(params);
+                lane_points.push_back(index);
+                continue;
+            }
+            if (log_writer) {
+                LogChannel& log = log_writer->Channel();
+                log.SetLinePrefix("[run " + std::to_string(index) + "] ");
+                SimulationContext ctx(params, log);
+                ctx.SetLogLevel(definition.log_level);
+                if (warmup) ctx.Restore(*warmup);
+                ctx.Run();
+                log.flush();
+                summaries[index] = SummarizeRun(ctx);
+                publish(index);
+                continue;
+            }
+            SimulationContext ctx(params, quiet);
+            if (warmup) ctx.Restore(*warmup);
+            ctx.Run();
+            summaries[index] = SummarizeRun(ctx);
+            publish(index);
+        }
+
+        if (!lanes.empty()) {
+            BatchSimulation batch(lanes);
+            batch.Run();
+            for (size_t lane = 0; lane < lanes.size(); ++lane) {
+                summaries[lane_points[lane]] = batch.Summary(lane);
+                publish(lane_points[lane]);
+            }
+        }
+    });
+    log_writer.reset();
+    telemetry.Close();
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Points stopped by outcome detection, and optionally the same points
+    // run to full length to check the predictions.
+    bool detection = false;
+    vector<size_t> early;
+    double saved_hours = 0.0;
+    for (size_t index = 0; index < total; ++index) {
+        ModelParameters params = point_params(index);
+        detection = detection || params.outcome_detection;
+        if (summaries[index].predicted == PredictedOutcome::None) continue;
+        early.push_back(index);
+        saved_hours += params.sim_duration - summaries[index].end_time;
+    }
+    // Full-length results of early[k]; char, not bool, since the runs write
+    // neighbouring entries from different threads.
+    bool validate = definition.validate_outcomes;
+    vector<RunSummary> full(validate ? early.size() : 0);
+    vector<char> correct(full.size(), 1);
+    if (validate) {
+        pool.ParallelFor(early.size(), [&](size_t k) {
+            size_t index = early[k];
+            ModelParameters params = point_params(index);
+            params.outcome_detection = false;
+            std::ostream quiet(nullptr);
+            SimulationContext ctx(params, quiet);
+            const SimulationSnapshot* warmup = warmups.empty() ? nullptr : &warmups[index / grid_size];
+            if (warmup) ctx.Restore(*warmup);
+            ctx.Run();
+            full[k] = SummarizeRun(ctx);
+            const RunSummary& predicted = summaries[index];
+            correct[k] = predicted.predicted == PredictedOutcome::Stable
+                             ? full[k].patient_alive && full[k].escalations == predicted.escalations
+                             : !full[k].patient_alive;
+        });
+    }
+
+    std::ofstream results(results_file);
+    if (!results.is_open()) {
+        cerr << "Error: Cannot open results file: " << results_file << endl;
+        return 1;
+    }
+
+    results << "config";
+    for (const auto& axis : definition.axes) results << "," << axis.key;
+    results << ",outcome,time_of_death,end_time,peak_C_over_Km,final_Tol,escalations,doses";
+    if (detection) results << ",predicted,reason";
+    if (validate) results << ",full_outcome,full_time_of_death,prediction_correct";
+    results << "\n";
+    results.precision(10);
+    size_t k = 0;  // next entry of early
+    for (size_t index = 0; index < total; ++index) {
+        SweepPoint point = PointAt(definition, grid_size, index);
+        const RunSummary& s = summaries[index];
+        results << base_files[point.base];
+        for (double value : point.values) results << "," << value;
+        results << "," << (s.patient_alive ? "ALIVE" : "DECEASED") << ",";
+        if (!s.patient_alive) results << s.time_of_death;
+        results << "," << s.end_time << "," << s.peak_saturation_ratio << "," << s.final_Tol
+                << "," << s.escalations << "," << s.doses;
+        if (detection) {
+            results << "," << PredictedOutcomeName(s.predicted) << ",\"" << s.prediction_reason << "\"";
+        }
+        if (validate) {
+            if (k == early.size() || early[k] != index) {
+                results << ",,,";
+            } else {
+                results << "," << (full[k].patient_alive ? "ALIVE" : "DECEASED") << ",";
+                if (!full[k].patient_alive) results << full[k].time_of_death;
+                results << "," << (correct[k] ? 1 : 0);
+                ++k;
+            }
+        }
+        results << "\n";
+    }
+
+    cout << "Sweep complete: " << total << " runs in " << elapsed << " s ("
+         << (elapsed > 0.0 ? total / elapsed : 0.0) << " runs/s)" << endl;
+    if (detection) {
+        size_t stable = 0;
+        for (size_t index : early) stable += summaries[index].predicted == PredictedOutcome::Stable ? 1 : 0;
+        cout << "Outcome detection: " << early.size() << " runs stopped early (" << stable << " stable, "
+             << early.size() - stable << " collapse), " << saved_hours << " simulated hours skipped" << endl;
+    }
+    if (validate) {
+        size_t wrong = static_cast<size_t>(std::count(correct.begin(), correct.end(), 0));
+        cout << "Outcome validation: " << early.size() - wrong << " of " << early.size()
+             << " predictions confirmed by full-length runs" << endl;
+    }
+    cout << "Results written to: " << results_file << endl;
+    return 0;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "../config/config_reader.hpp"
+#include "../logging/log_level.hpp"
+
+// One grid axis: a ModelParameters field (by config key) and its values.
+struct SweepAxis {
+    std::string key;
+    std::vector<double> values;
+};
+
+struct SweepDefinition {
+    std::vector<SweepAxis> axes;
+    unsigned threads{0};  // 0 = all hardware threads
+    unsigned batch_lanes{0};  // > 0: points per BatchSimulation; 0 = one SimulationContext each
+    LogLevel log_level{LogLevel::Summary};  // per-run text log; Summary = none
+    double warmup{0.0};  // > 0: hours simulated once per base config and shared by its points
+    bool validate_outcomes{false};  // rerun early-stopped points to full length and check their predictions
+};
+
+// Reads axes declared as <key>.min / <key>.max / <key>.steps, with optional
+// <key>.log = 1 for geometric spacing, plus optional "threads",
+// "batch_lanes", "log_level" (0 summary, 1 events, 2 trace), "warmup" and
+// "validate_outcomes" entries. An initial_dose axis is rejected with a warm-up.
+bool LoadSweepDefinition(const ConfigReader& config, SweepDefinition& definition);
+
+// Expands the grid around every base config, runs all points on a
+// work-stealing pool and writes one CSV row per point to results_file.
+// With a telemetry name, every finished point is published live as a
+// RunEnd record.
+int RunSweep(const std::string& sweep_file, const std::string& results_file,
+             const std::vector<std::string>& base_files, const std::string& telemetry = "");
@@ -0,0 +1,82 @@
+#include "telemetry_tail.hpp"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "../telemetry/telemetry_reader.hpp"
+
+using std::cout;
+using std::endl;
+
+namespace {
+
+const std::chrono::milliseconds kPollInterval(50);
+
+const char* KindName(uint32_t kind) {
+    switch (static_cast<TelemetryKind>(kind)) {
+        case TelemetryKind::Sample:
+            return "sample";
+        case TelemetryKind::Assessment:
+            return "assessment";
+        case TelemetryKind::Dose:
+            return "dose";
+        case TelemetryKind::Phase:
+            return "phase";
+        case TelemetryKind::Naloxone:
+            return "naloxone";
+        case TelemetryKind::Toxicity:
+            return "toxicity";
+        case TelemetryKind::RunStart:
+            return "run_start";
+        case TelemetryKind::RunEnd:
+            return "run_end";
+    }
+    return "unknown";
+}
+
+}  // namespace
+
+int RunTelemetryTail(const std::string& name) {
+    TelemetryReader reader;
+    bool waiting_reported = false;
+    while (!reader.Open(name)) {
+        if (!waiting_reported) {
+            std::cerr << "Waiting for telemetry segment " << name << "..." << endl;
+            waiting_reported = true;
+        }
+        std::this_thread::sleep_for(kPollInterval);
+    }
+
+    std::vector<TelemetryRecord> records;
+    uint64_t runs_done = 0;
+    cout << std::fixed;
+    while (true) {
+        // Read the flag first: everything published before it was set is
+        // picked up by this Poll().
+        bool finished = reader.Finished();
+        records.clear();
+        reader.Poll(records);
+        for (const TelemetryRecord& record : records) {
+            cout << "[run " << record.run << "] " << std::setprecision(3) << std::setw(10) << record.t << "h "
+                 << std::setw(10) << KindName(record.kind) << std::setprecision(4);
+            for (double value : record.values) cout << " " << value;
+            if (static_cast<TelemetryKind>(record.kind) == TelemetryKind::RunEnd) {
+                ++runs_done;
+                if (reader.TotalRuns() > 1) cout << "  (" << runs_done << "/" << reader.TotalRuns() << ")";
+            }
+            cout << "\n";
+        }
+        cout.flush();
+        if (finished) break;
+        if (records.empty()) std::this_thread::sleep_for(kPollInterval);
+    }
+
+    cout << "Telemetry ended: " << runs_done << " run(s) completed, " << reader.Overruns()
+         << " record(s) lost to overruns";
+    if (reader.Unassigned() > 0) cout << ", " << reader.Unassigned() << " from threads without a lane";
+    cout << endl;
+    return 0;
+}
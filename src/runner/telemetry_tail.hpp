@@ -0,0 +1,8 @@
+#pragma once
+
+#include <string>
+
+// Follows the live telemetry segment `name` of a running sim (started with
+// --telemetry <name>) and prints its records as text until the run ends.
+// Waits for the segment to appear when it does not exist yet.
+int RunTelemetryTail(const std::string& name);
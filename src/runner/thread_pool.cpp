@@ -0,0 +1,108 @@
+#include "thread_pool.hpp"
+
+WorkStealingPool::WorkStealingPool(unsigned threads) {
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+
+    for (unsigned i = 0; i < threads; ++i) {
+        queues_.emplace_back(new WorkerQueue());
+    }
+    for (unsigned i = 0; i < threads; ++i) {
+        workers_.emplace_back(&WorkStealingPool::WorkerLoop, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        shutdown_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) worker.join();
+}
+
+void WorkStealingPool::ParallelFor(size_t count, const std::function<void(size_t)>& body) {
+    if (count == 0) return;
+
+    // Reset before enqueueing: a worker still draining the queues after the
+    // previous job may pick up these tasks before it sees the new job.
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        remaining_ = count;
+        error_ = nullptr;
+    }
+
+    // Contiguous blocks per worker keep neighbouring grid points together;
+    // stealing evens out whatever imbalance the run lengths create.
+    size_t n = queues_.size();
+    for (size_t w = 0; w < n; ++w) {
+        size_t begin = count * w / n;
+        size_t end = count * (w + 1) / n;
+        std::lock_guard<std::mutex> lock(queues_[w]->mutex);
+        for (size_t i = begin; i < end; ++i) {
+            queues_[w]->tasks.push_back(Task{&body, i});
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    ++job_;
+    wake_.notify_all();
+    done_.wait(lock, [this] { return remaining_ == 0; });
+
+    if (error_) {
+        std::exception_ptr error = error_;
+        error_ = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+bool WorkStealingPool::PopLocal(unsigned id, Task& task) {
+    WorkerQueue& queue = *queues_[id];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) return false;
+    task = queue.tasks.back();
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool WorkStealingPool::Steal(unsigned thief, Task& task) {
+    size_t n = queues_.size();
+    for (size_t offset = 1; offset < n; ++offset) {
+        WorkerQueue& victim = *queues_[(thief + offset) % n];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.tasks.empty()) continue;
+        task = victim.tasks.front();
+        victim.tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingPool::Execute(const Task& task) {
+    try {
+        (*task.body)(task.index);
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!error_) error_ = std::current_exception();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--remaining_ == 0) done_.notify_all();
+}
+
+void WorkStealingPool::WorkerLoop(unsigned id) {
+    unsigned long seen_job = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this, seen_job] { return shutdown_ || job_ != seen_job; });
+            if (shutdown_) return;
+            seen_job = job_;
+        }
+
+        Task task;
+        while (PopLocal(id, task) || Steal(id, task)) {
+            Execute(task);
+        }
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads with one task deque per worker. A worker pops
+// from the back of its own deque and, once empty, steals from the front of
+// the others, so a few long runs cannot leave the remaining cores idle the
+// way a static partition does.
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(unsigned threads = 0);  // 0 = all hardware threads
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    unsigned Size() const { return static_cast<unsigned>(workers_.size()); }
+
+    // Runs body(i) for every i in [0, count) and blocks until all are done.
+    // body must be safe to call concurrently. The first exception thrown by
+    // body is rethrown here once the remaining tasks have finished.
+    void ParallelFor(size_t count, const std::function<void(size_t)>& body);
+
+private:
+    struct Task {
+        const std::function<void(size_t)>* body;
+        size_t index;
+    };
+
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void WorkerLoop(unsigned id);
+    bool PopLocal(unsigned id, Task& task);
+    bool Steal(unsigned thief, Task& task);
+    void Execute(const Task& task);
+
+    std::vector<std::thread> workers_{};
+    std::vector<std::unique_ptr<WorkerQueue>> queues_{};
+
+    std::mutex mutex_{};
+    std::condition_variable wake_{};
+    std::condition_variable done_{};
+    unsigned long job_{0};
+    size_t remaining_{0};
+    bool shutdown_{false};
+    std::exception_ptr error_{};
+};
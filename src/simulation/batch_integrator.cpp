@@ -0,0 +1,550 @@
+#include "batch_integrator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <ostream>
+
+#include "context.hpp"
+#include "decision_logic.hpp"
+#include "decision_rules.hpp"
+#include "philox.hpp"
+
+namespace {
+
+// Philox blocks of the SDE mode; 0 and 1 are the behavior draws.
+const uint32_t kNoiseBlock = kBehaviorBlocks;
+
+size_t PadLanes(size_t lanes) {
+    return (lanes + kBatchLaneAlign - 1) / kBatchLaneAlign * kBatchLaneAlign;
+}
+
+}  // namespace
+
+BatchSimulation::BatchSimulation(const std::vector<ModelParameters>& lanes)
+    : kernels_(SelectBatchKernels()), lanes_(lanes.size()), padded_(PadLanes(lanes.size())), params_(lanes) {
+    // Padding lanes copy lane 0 so the kernel never divides by zero; h = 0
+    // keeps them frozen.
+    std::vector<ModelParameters> padded(params_);
+    if (!padded.empty()) padded.resize(padded_, padded.front());
+
+    ka_.resize(padded_);
+    Vd_.resize(padded_);
+    kcp_.resize(padded_);
+    kpc_.resize(padded_);
+    Vmax_.resize(padded_);
+    Km_.resize(padded_);
+    keo_tau_.resize(padded_);
+    kin_.resize(padded_);
+    kout_.resize(padded_);
+    EC50_signal_.resize(padded_);
+    accuracy_.resize(padded_);
+    for (size_t i = 0; i < padded.size(); ++i) {
+        const ModelParameters& p = padded[i];
+        ka_[i] = p.ka;
+        Vd_[i] = p.Vd;
+        kcp_[i] = p.kcp;
+        kpc_[i] = p.kpc;
+        Vmax_[i] = p.Vmax;
+        Km_[i] = p.Km;
+        keo_tau_[i] = p.keo / p.tau_e;
+        kin_[i] = p.kin;
+        kout_[i] = p.kout;
+        EC50_signal_[i] = p.EC50_signal;
+        accuracy_[i] = p.sim_accuracy;
+    }
+
+    for (int s = 0; s < 5; ++s) {
+        y_[s].assign(padded_, 0.0);
+        y1_[s].assign(padded_, 0.0);
+    }
+    h_.assign(padded_, 0.0);
+    error_ratio_.assign(padded_, 0.0);
+
+    time_.assign(lanes_, 0.0);
+    step_.resize(lanes_);
+    last_.assign(lanes_, 0);
+    retry_.assign(lanes_, 0);
+    done_.assign(lanes_, 0);
+    peak_C_.assign(lanes_, 0.0);
+    next_monitor_.resize(lanes_);
+    next_assessment_.resize(lanes_);
+    monitor_sequence_.assign(lanes_, 0);
+    assessment_sequence_.assign(lanes_, 1);
+    sequence_.assign(lanes_, 2);
+
+    pain_level_.assign(lanes_, 2);  // Start with moderate pain
+    relief_state_.assign(lanes_, 0);
+    motivation_.assign(lanes_, 1.0);
+    time_since_last_dose_.assign(lanes_, 0.0);
+    current_dose_.resize(lanes_);
+    patient_alive_.assign(lanes_, 1);
+    time_overdose_detected_.assign(lanes_, 0.0);
+    doses_.assign(lanes_, 0);
+    escalations_.assign(lanes_, 0);
+    last_recorded_dose_.resize(lanes_);
+    behavior_key_.resize(lanes_);
+    behavior_stream_.resize(lanes_);
+    assessments_.assign(lanes_, 0);
+    interval_.resize(lanes_);
+
+    for (size_t i = 0; i < lanes_; ++i) {
+        const ModelParameters& p = params_[i];
+        y_[0][i] = p.current_dose;  // Start with initial dose in stomach
+        step_[i] = p.sim_step_max;
+        next_monitor_[i] = p.output_interval;
+        interval_[i] = p.assessment_interval;
+        if (p.stochastic_behavior) {
+            stochastic_ = true;
+            interval_[i] *= DrawBehavior(p, 0).interval_scale;
+        }
+        next_assessment_[i] = interval_[i];
+        current_dose_[i] = p.current_dose;
+        last_recorded_dose_[i] = p.current_dose;
+        behavior_key_[i] = BehaviorKey(p);
+        behavior_stream_[i] = BehaviorStream(p);
+    }
+
+    gather_Ce_.resize(padded_);
+    gather_Tol_.resize(padded_);
+    gather_EC50_.resize(padded_);
+    gather_n_.resize(padded_);
+    gather_Emax_.resize(padded_);
+    effect_.resize(padded_);
+    if (stochastic_) {
+        gather_key_.resize(padded_);
+        gather_stream_.resize(padded_);
+        gather_counter_.resize(padded_);
+        for (uint32_t block = 0; block < kBehaviorBlocks; ++block) {
+            for (int w = 0; w < 4; ++w) words_[block][w].resize(padded_);
+        }
+        draws_.resize(padded_);
+    }
+}
+
+void BatchSimulation::UseNoise(const SdeOptions& options, uint64_t first_path) {
+    noisy_ = true;
+    sde_ = options;
+    // Step doubling of a strong order 1 scheme: the error of a doubled step
+    // grows by about 2^1.5.
+    grow_below_ = 1.0 / 4.0;
+    accuracy_.assign(padded_, options.accuracy);
+
+    noise_key_.assign(padded_, options.seed);
+    noise_stream_.resize(padded_);
+    for (size_t i = 0; i < padded_; ++i) noise_stream_[i] = first_path + (i < lanes_ ? i : 0);
+    noise_counter_.assign(padded_, 0);
+    for (int block = 0; block < 2; ++block) {
+        for (int w = 0; w < 4; ++w) noise_words_[block][w].resize(padded_);
+    }
+    for (int d = 0; d < 3; ++d) {
+        dW1_[d].assign(padded_, 0.0);
+        dW2_[d].assign(padded_, 0.0);
+    }
+    segment_.resize(lanes_);
+    bridge_.assign(lanes_, std::vector<NoiseSegment>());
+    crossing_.assign(lanes_, -1.0);
+}
+
+void BatchSimulation::DrawNoise() {
+    BatchRandomArgs args;
+    args.key = noise_key_.data();
+    args.stream = noise_stream_.data();
+    args.counter = noise_counter_.data();
+    for (uint32_t block = 0; block < 2; ++block) {
+        args.block = kNoiseBlock + block;
+        for (int w = 0; w < 4; ++w) args.out[w] = noise_words_[block][w].data();
+        kernels_.random(args, padded_);
+    }
+}
+
+double BatchSimulation::TakeNoise(size_t lane, double h) {
+    NoiseSegment& segment = segment_[lane];
+    std::vector<NoiseSegment>& bridge = bridge_[lane];
+
+    // Normals 0-2 are the increments of a fresh segment, 3-5 the midpoint of
+    // the step; a Box-Muller pair is only formed when one of them is used.
+    double normal[6];
+    for (int pair = bridge.empty() ? 0 : 1; pair < 3; ++pair) {
+        const std::vector<uint32_t>* block = noise_words_[pair / 2];
+        int w = 2 * (pair % 2);
+        PhiloxNormalPair(block[w][lane], block[w + 1][lane], normal + 2 * pair);
+    }
+
+    if (bridge.empty()) {
+        segment.dt = h;
+        for (int d = 0; d < 3; ++d) segment.dW[d] = std::sqrt(h) * normal[d];
+    } else if (bridge.back().dt <= h * (1.0 + 1e-9)) {
+        // The whole pending segment (the step shrinks to it if shorter).
+        segment = bridge.back();
+        bridge.pop_back();
+    } else {
+        // Brownian bridge: the first h of the pending segment, given its end.
+        NoiseSegment& pending = bridge.back();
+        uint32_t counter[4] = {noise_counter_[lane], kNoiseBlock + 2, static_cast<uint32_t>(noise_stream_[lane]),
+                               static_cast<uint32_t>(noise_stream_[lane] >> 32)};
+        uint32_t words[4];
+        double z[4];
+        Philox4x32(counter, noise_key_[lane], words);
+        PhiloxNormals(words, z);
+        double r = h / pending.dt;
+        double spread = std::sqrt(r * (1.0 - r) * pending.dt);
+        segment.dt = h;
+        for (int d = 0; d < 3; ++d) {
+            segment.dW[d] = r * pending.dW[d] + spread * z[d];
+            pending.dW[d] -= segment.dW[d];
+        }
+        pending.dt -= h;
+    }
+
+    // Midpoint of the segment for the two half steps.
+    double spread = 0.5 * std::sqrt(segment.dt);
+    for (int d = 0; d < 3; ++d) {
+        dW1_[d][lane] = 0.5 * segment.dW[d] + spread * normal[3 + d];
+        dW2_[d][lane] = segment.dW[d] - dW1_[d][lane];
+    }
+    ++noise_counter_[lane];
+    return segment.dt;
+}
+
+void BatchSimulation::RejectNoise(size_t lane) {
+    // The retry takes the first half; the second follows it.
+    NoiseSegment first, second;
+    first.dt = second.dt = 0.5 * segment_[lane].dt;
+    for (int d = 0; d < 3; ++d) {
+        first.dW[d] = dW1_[d][lane];
+        second.dW[d] = dW2_[d][lane];
+    }
+    bridge_[lane].push_back(second);
+    bridge_[lane].push_back(first);
+}
+
+bool BatchSimulation::NextEvent(size_t lane, bool& is_monitor) const {
+    double monitor = next_monitor_[lane];
+    double assessment = next_assessment_[lane];
+    if (monitor != assessment) {
+        is_monitor = monitor < assessment;
+    } else {
+        is_monitor = monitor_sequence_[lane] < assessment_sequence_[lane];
+    }
+    return (is_monitor ? monitor : assessment) <= time_[lane];
+}
+
+double BatchSimulation::Target(size_t lane) const {
+    double next = std::min(next_monitor_[lane], next_assessment_[lane]);
+    return std::min(next, params_[lane].sim_duration);
+}
+
+void BatchSimulation::Run() {
+    BatchStepArgs args;
+    args.ka = ka_.data();
+    args.Vd = Vd_.data();
+    args.kcp = kcp_.data();
+    args.kpc = kpc_.data();
+    args.Vmax = Vmax_.data();
+    args.Km = Km_.data();
+    args.keo_tau = keo_tau_.data();
+    args.kin = kin_.data();
+    args.kout = kout_.data();
+    args.EC50_signal = EC50_signal_.data();
+    args.accuracy = accuracy_.data();
+    for (int s = 0; s < 5; ++s) {
+        args.y0[s] = y_[s].data();
+        args.y1[s] = y1_[s].data();
+    }
+    args.h = h_.data();
+    args.error_ratio = error_ratio_.data();
+
+    BatchNoiseArgs noise;
+    noise.sigma[0] = sde_.noise.A;
+    noise.sigma[1] = sde_.noise.C;
+    noise.sigma[2] = sde_.noise.Tol;
+    noise.milstein = sde_.milstein ? 1.0 : 0.0;
+    for (int d = 0; d < 3; ++d) {
+        noise.dW1[d] = dW1_[d].data();
+        noise.dW2[d] = dW2_[d].data();
+    }
+
+    std::vector<uint32_t> due;
+    due.reserve(lanes_);
+
+    size_t active = 0;
+    for (size_t i = 0; i < lanes_; ++i) {
+        done_[i] = time_[i] >= params_[i].sim_duration;
+        if (!done_[i]) ++active;
+    }
+
+    while (active > 0) {
+        if (noisy_) DrawNoise();
+        for (size_t i = 0; i < lanes_; ++i) {
+            if (done_[i]) {
+                h_[i] = 0.0;
+                continue;
+            }
+            double remaining = Target(i) - time_[i];
+            if (retry_[i]) {
+                // A rejected step retries with the halved step, unclipped,
+                // exactly like the inner loop of SimulationContext::IntegrateTo.
+                h_[i] = step_[i];
+                last_[i] = 0;
+            } else {
+                h_[i] = std::min(step_[i], remaining);
+                last_[i] = h_[i] >= remaining;
+            }
+            if (noisy_) {
+                h_[i] = TakeNoise(i, h_[i]);
+                last_[i] = !retry_[i] && h_[i] >= remaining;
+            }
+        }
+
+        if (noisy_) {
+            kernels_.sde(args, noise, padded_);
+        } else {
+            kernels_.step(args, padded_);
+        }
+
+        due.clear();
+        for (size_t i = 0; i < lanes_; ++i) {
+            if (done_[i]) continue;
+            const ModelParameters& p = params_[i];
+            double h = h_[i];
+            double ratio = error_ratio_[i];
+            stats_.rhs_evaluations += noisy_ ? 3 : 6;
+
+            if (ratio > 1.0 && h > p.sim_step_min) {
+                ++stats_.rejected_steps;
+                step_[i] = std::max(h / 2.0, p.sim_step_min);
+                retry_[i] = 1;
+                if (noisy_) RejectNoise(i);
+                continue;
+            }
+
+            ++stats_.accepted_steps;
+            double target = Target(i);
+            for (int s = 0; s < 5; ++s) y_[s][i] = y1_[s][i];
+            time_[i] = last_[i] ? target : time_[i] + h;
+            if (y_[1][i] > peak_C_[i]) peak_C_[i] = y_[1][i];
+            retry_[i] = 0;
+            if (noisy_ && crossing_[i] < 0.0 && y_[1][i] > p.C_critical) crossing_[i] = time_[i];
+            if (ratio < grow_below_ && h >= step_[i]) step_[i] = std::min(step_[i] * 2.0, p.sim_step_max);
+
+            if (time_[i] >= p.sim_duration) {
+                done_[i] = 1;
+                --active;
+            } else if (time_[i] >= target) {
+                due.push_back(static_cast<uint32_t>(i));
+            }
+        }
+
+        ProcessEvents(due);
+        for (uint32_t lane : due) {
+            if (done_[lane]) --active;
+        }
+    }
+}
+
+void BatchSimulation::ProcessEvents(std::vector<uint32_t>& due) {
+    std::vector<uint32_t> monitors;
+    std::vector<uint32_t> assessments;
+    std::vector<uint32_t> pending(due);
+
+    // Each round runs the earliest pending event of every due lane, grouped
+    // by type, until no lane has an event left at its current time.
+    while (!pending.empty()) {
+        monitors.clear();
+        assessments.clear();
+        for (uint32_t lane : pending) {
+            bool is_monitor = false;
+            if (done_[lane] || !NextEvent(lane, is_monitor)) continue;
+            (is_monitor ? monitors : assessments).push_back(lane);
+        }
+        if (monitors.empty() && assessments.empty()) break;
+
+        ProcessMonitors(monitors);
+        ProcessAssessments(assessments);
+        stats_.events += monitors.size() + assessments.size();
+
+        pending.clear();
+        pending.insert(pending.end(), monitors.begin(), monitors.end());
+        pending.insert(pending.end(), assessments.begin(), assessments.end());
+    }
+}
+
+void BatchSimulation::ComputeEffects(const std::vector<uint32_t>& lanes) {
+    size_t n = lanes.size();
+    size_t padded = PadLanes(n);
+    for (size_t j = 0; j < padded; ++j) {
+        uint32_t lane = lanes[j < n ? j : 0];
+        const ModelParameters& p = params_[lane];
+        gather_Ce_[j] = y_[3][lane];
+        gather_Tol_[j] = y_[4][lane];
+        gather_EC50_[j] = p.EC50_base;
+        gather_n_[j] = p.n_Hill;
+        gather_Emax_[j] = p.Emax;
+    }
+
+    BatchEffectArgs args;
+    args.Ce = gather_Ce_.data();
+    args.Tol = gather_Tol_.data();
+    args.EC50_base = gather_EC50_.data();
+    args.n_Hill = gather_n_.data();
+    args.Emax = gather_Emax_.data();
+    args.effect = effect_.data();
+    kernels_.effect(args, padded);
+}
+
+void BatchSimulation::DrawBehaviors(const std::vector<uint32_t>& lanes) {
+    size_t n = lanes.size();
+    size_t padded = PadLanes(n);
+    for (size_t j = 0; j < padded; ++j) {
+        uint32_t lane = lanes[j < n ? j : 0];
+        gather_key_[j] = behavior_key_[lane];
+        gather_stream_[j] = behavior_stream_[lane];
+        gather_counter_[j] = assessments_[lane];
+    }
+
+    BatchRandomArgs args;
+    args.key = gather_key_.data();
+    args.stream = gather_stream_.data();
+    args.counter = gather_counter_.data();
+    for (uint32_t block = 0; block < kBehaviorBlocks; ++block) {
+        args.block = block;
+        for (int w = 0; w < 4; ++w) args.out[w] = words_[block][w].data();
+        kernels_.random(args, padded);
+    }
+
+    for (size_t j = 0; j < n; ++j) {
+        const ModelParameters& p = params_[lanes[j]];
+        if (!p.stochastic_behavior) {
+            draws_[j] = BehaviorDraws();
+            continue;
+        }
+        uint32_t block0[4], block1[4];
+        for (int w = 0; w < 4; ++w) {
+            block0[w] = words_[0][w][j];
+            block1[w] = words_[1][w][j];
+        }
+        draws_[j] = BehaviorDrawsFromWords(p, block0, block1);
+    }
+}
+
+void BatchSimulation::ProcessMonitors(const std::vector<uint32_t>& lanes) {
+    if (lanes.empty()) return;
+    ComputeEffects(lanes);
+
+    for (size_t j = 0; j < lanes.size(); ++j) {
+        uint32_t i = lanes[j];
+        const ModelParameters& p = params_[i];
+        // CheckToxicity: critical overdose or respiratory arrest ends the run.
+        bool fatal = (y_[1][i] > p.C_critical) | (effect_[j] > p.Effect_resp_critical);
+        if (monitor_sink_) monitor_sink_->OnMonitor(i, time_[i], y_[1][i], y_[4][i]);
+
+        patient_alive_[i] = fatal ? 0 : patient_alive_[i];
+        time_overdose_detected_[i] = fatal ? time_[i] : time_overdose_detected_[i];
+        done_[i] = fatal ? 1 : done_[i];
+        next_monitor_[i] = time_[i] + p.output_interval;
+        monitor_sequence_[i] = sequence_[i]++;
+    }
+}
+
+void BatchSimulation::ProcessAssessments(const std::vector<uint32_t>& lanes) {
+    if (lanes.empty()) return;
+    ComputeEffects(lanes);
+    for (uint32_t lane : lanes) ++assessments_[lane];
+    if (stochastic_) DrawBehaviors(lanes);
+
+    for (size_t j = 0; j < lanes.size(); ++j) {
+        uint32_t i = lanes[j];
+        const ModelParameters& p = params_[i];
+        double effect = effect_[j];
+        bool stochastic = p.stochastic_behavior;
+        BehaviorDraws draws = stochastic ? draws_[j] : BehaviorDraws();
+        double perceived_effect = effect + (stochastic ? p.pain_noise * draws.pain_noise : 0.0);
+
+        // UpdatePainLevel / UpdateMotivation
+        int pain = PainLevelFromEffect(perceived_effect);
+        bool relief = ReliefAtPainLevel(pain);
+        double motivation = UpdatedMotivation(motivation_[i], pain, relief, interval_[i], p);
+
+        // CheckToxicity
+        bool fatal = (y_[1][i] > p.C_critical) | (effect > p.Effect_resp_critical);
+
+        // ShouldIncreaseDose / MaintainDose as masks.
+        bool enabled = p.petri_net_enabled && !fatal;
+        bool motivated = stochastic ? draws.escalation < EscalationProbability(motivation, p)
+                                    : motivation > p.motivation_threshold;
+        bool escalate = enabled && pain >= 2 && !relief && motivated &&
+                        time_since_last_dose_[i] >= p.min_dosing_interval &&
+                        effect < p.effect_relief_threshold;
+        bool maintain_due = enabled && !escalate && relief && effect >= p.effect_relief_threshold;
+        bool maintain = maintain_due && !(stochastic && draws.missed < p.missed_dose_probability);
+        bool extra = enabled && !escalate && !maintain_due && stochastic && draws.extra < p.extra_dose_probability;
+
+        double escalated = EscalatedDose(current_dose_[i], EscalationFactor(y_[4][i], p), p);
+        double maintained = MaintainedDose(current_dose_[i], time_[i], p);
+
+        double dose = escalate ? escalated : maintain ? maintained : current_dose_[i];
+        bool dosed = escalate || maintain || extra;
+
+        y_[0][i] = dosed ? y_[0][i] + dose : y_[0][i];
+        current_dose_[i] = dose;
+        motivation = escalate ? MotivationAfterEscalation(motivation, p) : motivation;
+        relief = escalate ? true : relief;
+        escalations_[i] += (dosed && dose > last_recorded_dose_[i]) ? 1 : 0;
+        last_recorded_dose_[i] = dosed ? dose : last_recorded_dose_[i];
+        doses_[i] += dosed ? 1 : 0;
+        double next_interval = p.assessment_interval * draws.interval_scale;
+        time_since_last_dose_[i] = (dosed ? 0.0 : time_since_last_dose_[i]) + next_interval;
+
+        pain_level_[i] = pain;
+        relief_state_[i] = relief;
+        motivation_[i] = motivation;
+
+        patient_alive_[i] = fatal ? 0 : patient_alive_[i];
+        time_overdose_detected_[i] = fatal ? time_[i] : time_overdose_detected_[i];
+        done_[i] = fatal ? 1 : done_[i];
+        next_assessment_[i] = time_[i] + next_interval;
+        interval_[i] = next_interval;
+        assessment_sequence_[i] = sequence_[i]++;
+    }
+}
+
+RunSummary BatchSimulation::Summary(size_t lane) const {
+    RunSummary summary;
+    summary.patient_alive = patient_alive_[lane] != 0;
+    summary.time_of_death = summary.patient_alive ? 0.0 : time_overdose_detected_[lane];
+    summary.end_time = time_[lane];
+    summary.peak_saturation_ratio = peak_C_[lane] / params_[lane].Km;
+    summary.final_Tol = y_[4][lane];
+    summary.escalations = escalations_[lane];
+    summary.doses = doses_[lane];
+    return summary;
+}
+
+BatchValidation ValidateBatchAgainstScalar(const std::vector<ModelParameters>& lanes) {
+    BatchSimulation batch(lanes);
+    batch.Run();
+
+    BatchValidation validation;
+    validation.lanes = lanes.size();
+    std::ostream quiet(nullptr);
+    for (size_t i = 0; i < lanes.size(); ++i) {
+        SimulationContext ctx(lanes[i], quiet);
+        ctx.Run();
+        RunSummary expected = SummarizeRun(ctx);
+        RunSummary actual = batch.Summary(i);
+
+        if (expected.patient_alive != actual.patient_alive || expected.escalations != actual.escalations) {
+            ++validation.outcome_mismatches;
+        }
+
+        double accuracy = lanes[i].sim_accuracy;
+        double pairs[3][2] = {{expected.end_time, actual.end_time},
+                              {expected.peak_saturation_ratio, actual.peak_saturation_ratio},
+                              {expected.final_Tol, actual.final_Tol}};
+        for (const auto& pair : pairs) {
+            double deviation = std::fabs(pair[0] - pair[1]) / (accuracy * (1.0 + std::fabs(pair[0])));
+            if (deviation > validation.max_deviation) validation.max_deviation = deviation;
+        }
+    }
+    return validation;
+}
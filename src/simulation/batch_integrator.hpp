@@ -0,0 +1,175 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "batch_kernels.hpp"
+#include "behavior_random.hpp"
+#include "dynamics.hpp"
+#include "parameters.hpp"
+#include "report.hpp"
+
+// Settings of the SDE mode of BatchSimulation.
+struct SdeOptions {
+    PhysiologicalNoise noise;
+    uint64_t seed{1};       // Philox key of the Wiener increments
+    bool milstein{true};    // false: Euler-Maruyama
+    double accuracy{1e-3};  // local error tolerance, replacing sim_accuracy
+};
+
+// Work done by BatchSimulation::Run(), summed over the lanes, counted like
+// SolverStats: six right-hand sides per Runge-Kutta-England step, three per
+// step-doubled SDE step, and one event per StatusMonitor or assessment.
+struct BatchStats {
+    unsigned long accepted_steps{0};
+    unsigned long rejected_steps{0};
+    unsigned long rhs_evaluations{0};
+    unsigned long events{0};
+};
+
+// Receives the state of a lane at each of its StatusMonitor events.
+class BatchMonitorSink {
+public:
+    virtual ~BatchMonitorSink() {}
+    virtual void OnMonitor(size_t lane, double time, double C, double Tol) = 0;
+};
+
+// Advances many patients at once. State, parameters and Petri net marking are
+// kept as one array per quantity (structure of arrays); every iteration takes
+// one adaptive Runge-Kutta-England step in all lanes through a SIMD kernel,
+// with step-size control, the StatusMonitor/PatientAssessment schedule and the
+// dosing decisions tracked per lane. Output is not produced; the result of a
+// lane is its RunSummary, which matches what SimulationContext reports for the
+// same parameters.
+class BatchSimulation {
+public:
+    explicit BatchSimulation(const std::vector<ModelParameters>& lanes);
+
+    // Naloxone rescue spawns extra events per lane, and the lanes only
+    // implement the explicit method with polled thresholds, no closed-form
+    // intervals and no outcome detection; everything else is left to
+    // SimulationContext.
+    static bool Supports(const ModelParameters& params) {
+        return !params.naloxone_available && params.solver == SolverKind::Explicit && !params.state_events &&
+               params.linear_ratio <= 0.0 && !params.outcome_detection;
+    }
+
+    // Turns the lanes into sample paths of the SDE with options.noise; lane i
+    // draws its increments from Philox stream first_path + i. Each iteration
+    // then takes one adaptive Milstein (or Euler-Maruyama) step in all lanes,
+    // with the error estimated by step doubling. Increments of rejected or
+    // clipped steps are split by Brownian bridge and kept for the following
+    // steps, so a path follows one Brownian motion whatever steps it takes.
+    // Call before Run().
+    void UseNoise(const SdeOptions& options, uint64_t first_path);
+    void SetMonitorSink(BatchMonitorSink* sink) { monitor_sink_ = sink; }
+
+    void Run();
+
+    size_t Lanes() const { return lanes_; }
+    RunSummary Summary(size_t lane) const;
+    const char* KernelName() const { return kernels_.name; }
+    const BatchStats& Stats() const { return stats_; }
+    // SDE mode: time of the first accepted step with C above C_critical, or
+    // a negative value if the path never crossed.
+    double CrossingTime(size_t lane) const { return crossing_[lane]; }
+
+private:
+    // Wiener increments of A, C and Tol over dt.
+    struct NoiseSegment {
+        double dt;
+        double dW[3];
+    };
+
+    double Target(size_t lane) const;
+    bool NextEvent(size_t lane, bool& is_monitor) const;
+    void ProcessEvents(std::vector<uint32_t>& due);
+    void ProcessMonitors(const std::vector<uint32_t>& lanes);
+    void ProcessAssessments(const std::vector<uint32_t>& lanes);
+    void ComputeEffects(const std::vector<uint32_t>& lanes);
+    void DrawBehaviors(const std::vector<uint32_t>& lanes);
+    void DrawNoise();
+    double TakeNoise(size_t lane, double h);
+    void RejectNoise(size_t lane);
+
+    const BatchKernels& kernels_;
+    size_t lanes_;
+    size_t padded_;
+    std::vector<ModelParameters> params_;
+
+    // Kernel inputs (per-lane parameters, padded).
+    std::vector<double> ka_, Vd_, kcp_, kpc_, Vmax_, Km_, keo_tau_, kin_, kout_, EC50_signal_,
+        accuracy_;
+    std::vector<double> y_[5];
+    std::vector<double> y1_[5];
+    std::vector<double> h_;
+    std::vector<double> error_ratio_;
+
+    // Integration control.
+    std::vector<double> time_;
+    std::vector<double> step_;
+    std::vector<uint8_t> last_;
+    std::vector<uint8_t> retry_;
+    std::vector<uint8_t> done_;
+    std::vector<double> peak_C_;
+    BatchStats stats_;
+    double grow_below_{1.0 / 64.0};  // error ratio under which the step doubles
+
+    // Event schedule; equal times run in scheduling order, as in Calendar.
+    std::vector<double> next_monitor_;
+    std::vector<double> next_assessment_;
+    std::vector<uint64_t> monitor_sequence_;
+    std::vector<uint64_t> assessment_sequence_;
+    std::vector<uint64_t> sequence_;
+
+    // Petri net marking.
+    std::vector<int> pain_level_;
+    std::vector<uint8_t> relief_state_;
+    std::vector<double> motivation_;
+    std::vector<double> time_since_last_dose_;
+    std::vector<double> current_dose_;
+    std::vector<uint8_t> patient_alive_;
+    std::vector<double> time_overdose_detected_;
+    std::vector<int> doses_;
+    std::vector<int> escalations_;
+    std::vector<double> last_recorded_dose_;
+
+    // Stochastic behavior: Philox key and stream, assessments so far and the
+    // interval that led to the pending assessment.
+    bool stochastic_{false};
+    std::vector<uint64_t> behavior_key_, behavior_stream_;
+    std::vector<uint32_t> assessments_;
+    std::vector<double> interval_;
+
+    // Gathered inputs/outputs of the effect kernel for lanes with due events.
+    std::vector<double> gather_Ce_, gather_Tol_, gather_EC50_, gather_n_, gather_Emax_, effect_;
+    std::vector<uint64_t> gather_key_, gather_stream_;
+    std::vector<uint32_t> gather_counter_;
+    std::vector<uint32_t> words_[kBehaviorBlocks][4];
+    std::vector<BehaviorDraws> draws_;
+
+    // SDE mode: Philox key and stream, increments of the current step's two
+    // halves, the current step's segment and the bridge stack of segments
+    // still ahead (next one at the back).
+    bool noisy_{false};
+    SdeOptions sde_;
+    std::vector<uint64_t> noise_key_, noise_stream_;
+    std::vector<uint32_t> noise_counter_;
+    std::vector<uint32_t> noise_words_[2][4];
+    std::vector<double> dW1_[3], dW2_[3];
+    std::vector<NoiseSegment> segment_;
+    std::vector<std::vector<NoiseSegment>> bridge_;
+    std::vector<double> crossing_;
+    BatchMonitorSink* monitor_sink_{nullptr};
+};
+
+// Deviation of BatchSimulation from SimulationContext over the same lanes.
+// Deviations are in units of the lane's local error tolerance,
+// accuracy * (1 + |x|), for end time, peak C and final Tol.
+struct BatchValidation {
+    size_t lanes{0};
+    size_t outcome_mismatches{0};  // alive flag or escalation count differ
+    double max_deviation{0.0};
+};
+
+BatchValidation ValidateBatchAgainstScalar(const std::vector<ModelParameters>& lanes);
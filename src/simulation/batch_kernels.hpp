@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Structure-of-arrays views used by the batched integrator. Every pointer
+// addresses `lanes` consecutive doubles; lanes is padded to kBatchLaneAlign.
+const size_t kBatchLaneAlign = 8;
+
+struct BatchStepArgs {
+    // Per-lane model parameters.
+    const double* ka;
+    const double* Vd;
+    const double* kcp;
+    const double* kpc;
+    const double* Vmax;
+    const double* Km;
+    const double* keo_tau;  // keo / tau_e
+    const double* kin;
+    const double* kout;
+    const double* EC50_signal;
+    const double* accuracy;
+
+    // State at the start of the step (A, C, P, Ce, Tol) and the step size.
+    // Lanes with h == 0 are idle: their outputs are unspecified.
+    const double* y0[5];
+    const double* h;
+
+    // Proposed state after the step and max(|err| / tolerance) per lane.
+    double* y1[5];
+    double* error_ratio;
+};
+
+struct BatchEffectArgs {
+    const double* Ce;
+    const double* Tol;
+    const double* EC50_base;
+    const double* n_Hill;
+    const double* Emax;
+    double* effect;
+};
+
+// Philox4x32-10 blocks for the stochastic behavior mode. Lane j gets the
+// block of counter (counter[j], block, stream[j]) under key[j], the same
+// words Philox4x32 returns for BehaviorCounter(stream[j], counter[j], block).
+// Arrays hold `lanes` entries, padded like the others.
+struct BatchRandomArgs {
+    const uint64_t* key;
+    const uint64_t* stream;
+    const uint32_t* counter;
+    uint32_t block;
+    uint32_t* out[4];
+};
+
+// Wiener increments of the SDE mode over the two halves of every lane's step,
+// for A, C and Tol in that order, and the noise intensities of all lanes.
+struct BatchNoiseArgs {
+    double sigma[3];
+    double milstein;  // 1 adds the Milstein correction, 0 leaves Euler-Maruyama
+    const double* dW1[3];
+    const double* dW2[3];
+};
+
+// One Runge-Kutta-England step for every lane (same scheme as
+// RungeKuttaEngland::Step, with per-lane h).
+typedef void (*BatchStepKernel)(const BatchStepArgs& args, size_t lanes);
+// Hill effect of CalculateEffect for every lane.
+typedef void (*BatchEffectKernel)(const BatchEffectArgs& args, size_t lanes);
+typedef void (*BatchRandomKernel)(const BatchRandomArgs& args, size_t lanes);
+// One stochastic step for every lane: the step over h and two half steps are
+// compared, y1 is the half-step result and error_ratio their difference in
+// units of the tolerance.
+typedef void (*BatchSdeKernel)(const BatchStepArgs& args, const BatchNoiseArgs& noise, size_t lanes);
+
+struct BatchKernels {
+    const char* name;
+    BatchStepKernel step;
+    BatchEffectKernel effect;
+    BatchRandomKernel random;
+    BatchSdeKernel sde;
+};
+
+// Implementations, one translation unit per instruction set. The AVX ones
+// return false when that translation unit was built without the ISA.
+void GetBatchKernelsScalar(BatchKernels& kernels);
+bool GetBatchKernelsAvx2(BatchKernels& kernels);
+bool GetBatchKernelsAvx512(BatchKernels& kernels);
+
+// Widest kernel set supported by both the build and the running CPU.
+const BatchKernels& SelectBatchKernels();
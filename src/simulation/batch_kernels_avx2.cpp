@@ -0,0 +1,16 @@
+// Built with -mavx2 -mfma on x86-64 (see Makefile); a stub elsewhere.
+#include "batch_kernels_impl.hpp"
+
+bool GetBatchKernelsAvx2(BatchKernels& kernels) {
+#if defined(__AVX2__)
+    kernels.name = "avx2";
+    kernels.step = &StepLanes<VecD4>;
+    kernels.effect = &EffectLanes<VecD4>;
+    kernels.random = &RandomLanes<kBatchLaneAlign>;
+    kernels.sde = &SdeLanes<VecD4>;
+    return true;
+#else
+    (void)kernels;
+    return false;
+#endif
+}
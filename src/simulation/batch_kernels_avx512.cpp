@@ -0,0 +1,16 @@
+// Built with -mavx512f on x86-64 (see Makefile); a stub elsewhere.
+#include "batch_kernels_impl.hpp"
+
+bool GetBatchKernelsAvx512(BatchKernels& kernels) {
+#if defined(__AVX512F__)
+    kernels.name = "avx512";
+    kernels.step = &StepLanes<VecD8>;
+    kernels.effect = &EffectLanes<VecD8>;
+    kernels.random = &RandomLanes<kBatchLaneAlign>;
+    kernels.sde = &SdeLanes<VecD8>;
+    return true;
+#else
+    (void)kernels;
+    return false;
+#endif
+}
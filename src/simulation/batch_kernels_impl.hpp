@@ -0,0 +1,290 @@
+#pragma once
+
+// Lane-generic kernel bodies, included once per instruction-set translation
+// unit. Everything is in an anonymous namespace so the differently-compiled
+// instantiations never get merged by the linker.
+
+#include <cmath>
+#include <cstddef>
+
+#include "batch_kernels.hpp"
+#include "philox.hpp"
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+struct VecD1 {
+    static const size_t kWidth = 1;
+    double v;
+
+    static VecD1 Load(const double* p) { return VecD1{*p}; }
+    static VecD1 Broadcast(double x) { return VecD1{x}; }
+    void Store(double* p) const { *p = v; }
+
+    friend VecD1 operator+(VecD1 a, VecD1 b) { return VecD1{a.v + b.v}; }
+    friend VecD1 operator-(VecD1 a, VecD1 b) { return VecD1{a.v - b.v}; }
+    friend VecD1 operator*(VecD1 a, VecD1 b) { return VecD1{a.v * b.v}; }
+    friend VecD1 operator/(VecD1 a, VecD1 b) { return VecD1{a.v / b.v}; }
+    friend VecD1 Max(VecD1 a, VecD1 b) { return VecD1{a.v > b.v ? a.v : b.v}; }
+    friend VecD1 Abs(VecD1 a) { return VecD1{std::fabs(a.v)}; }
+};
+
+#if defined(__AVX2__)
+struct VecD4 {
+    static const size_t kWidth = 4;
+    __m256d v;
+
+    static VecD4 Load(const double* p) { return VecD4{_mm256_loadu_pd(p)}; }
+    static VecD4 Broadcast(double x) { return VecD4{_mm256_set1_pd(x)}; }
+    void Store(double* p) const { _mm256_storeu_pd(p, v); }
+
+    friend VecD4 operator+(VecD4 a, VecD4 b) { return VecD4{_mm256_add_pd(a.v, b.v)}; }
+    friend VecD4 operator-(VecD4 a, VecD4 b) { return VecD4{_mm256_sub_pd(a.v, b.v)}; }
+    friend VecD4 operator*(VecD4 a, VecD4 b) { return VecD4{_mm256_mul_pd(a.v, b.v)}; }
+    friend VecD4 operator/(VecD4 a, VecD4 b) { return VecD4{_mm256_div_pd(a.v, b.v)}; }
+    friend VecD4 Max(VecD4 a, VecD4 b) { return VecD4{_mm256_max_pd(a.v, b.v)}; }
+    friend VecD4 Abs(VecD4 a) { return VecD4{_mm256_andnot_pd(_mm256_set1_pd(-0.0), a.v)}; }
+};
+#endif
+
+#if defined(__AVX512F__)
+struct VecD8 {
+    static const size_t kWidth = 8;
+    __m512d v;
+
+    static VecD8 Load(const double* p) { return VecD8{_mm512_loadu_pd(p)}; }
+    static VecD8 Broadcast(double x) { return VecD8{_mm512_set1_pd(x)}; }
+    void Store(double* p) const { _mm512_storeu_pd(p, v); }
+
+    friend VecD8 operator+(VecD8 a, VecD8 b) { return VecD8{_mm512_add_pd(a.v, b.v)}; }
+    friend VecD8 operator-(VecD8 a, VecD8 b) { return VecD8{_mm512_sub_pd(a.v, b.v)}; }
+    friend VecD8 operator*(VecD8 a, VecD8 b) { return VecD8{_mm512_mul_pd(a.v, b.v)}; }
+    friend VecD8 operator/(VecD8 a, VecD8 b) { return VecD8{_mm512_div_pd(a.v, b.v)}; }
+    // Masked form: the unmasked one trips GCC's -Wmaybe-uninitialized.
+    friend VecD8 Max(VecD8 a, VecD8 b) { return VecD8{_mm512_mask_max_pd(a.v, 0xFF, a.v, b.v)}; }
+    friend VecD8 Abs(VecD8 a) { return VecD8{_mm512_abs_pd(a.v)}; }
+};
+#endif
+
+template <class V>
+struct LaneParams {
+    V ka, Vd, kcp, kpc, Vmax, Km, keo_tau, kin, kout, EC50_signal;
+};
+
+// Right-hand side of dynamics.cpp for W lanes, times h. The C < 0 and Ce < 0
+// guards of MichaelisMentenElimination/ToleranceSignal become max(x, 0),
+// which yields the same zero flux without a branch.
+template <class V>
+inline void Rates(const LaneParams<V>& p, const V y[5], V h, V k[5]) {
+    const V zero = V::Broadcast(0.0);
+    V C_pos = Max(y[1], zero);
+    V Ce_pos = Max(y[3], zero);
+
+    V absorption = p.ka * y[0];
+    V elimination = (p.Vmax * C_pos) / (p.Km + C_pos);
+    V peripheral_out = p.kcp * y[1];
+    V peripheral_in = p.kpc * y[2];
+    V signal = Ce_pos / (p.EC50_signal + Ce_pos);
+
+    k[0] = h * (zero - absorption);
+    k[1] = h * (absorption / p.Vd - elimination / p.Vd - peripheral_out + peripheral_in);
+    k[2] = h * (peripheral_out - peripheral_in);
+    k[3] = h * (p.keo_tau * (y[1] - y[3]));
+    k[4] = h * (p.kin * signal - p.kout * y[4]);
+}
+
+template <class V>
+void StepLanes(const BatchStepArgs& a, size_t lanes) {
+    const V two = V::Broadcast(2.0);
+    const V one = V::Broadcast(1.0);
+
+    for (size_t i = 0; i < lanes; i += V::kWidth) {
+        LaneParams<V> p;
+        p.ka = V::Load(a.ka + i);
+        p.Vd = V::Load(a.Vd + i);
+        p.kcp = V::Load(a.kcp + i);
+        p.kpc = V::Load(a.kpc + i);
+        p.Vmax = V::Load(a.Vmax + i);
+        p.Km = V::Load(a.Km + i);
+        p.keo_tau = V::Load(a.keo_tau + i);
+        p.kin = V::Load(a.kin + i);
+        p.kout = V::Load(a.kout + i);
+        p.EC50_signal = V::Load(a.EC50_signal + i);
+        // Chunks made only of finished lanes cost nothing.
+        bool idle = true;
+        for (size_t j = 0; j < V::kWidth; ++j) idle = idle && a.h[i + j] == 0.0;
+        if (idle) continue;
+        V h = V::Load(a.h + i);
+
+        V y0[5], y[5], k1[5], k2[5], k3[5], k4[5], k5[5], k6[5];
+        for (int s = 0; s < 5; ++s) y0[s] = V::Load(a.y0[s] + i);
+
+        Rates(p, y0, h, k1);
+        for (int s = 0; s < 5; ++s) y[s] = y0[s] + k1[s] / two;
+        Rates(p, y, h, k2);
+        for (int s = 0; s < 5; ++s) y[s] = y0[s] + (k1[s] + k2[s]) / V::Broadcast(4.0);
+        Rates(p, y, h, k3);
+        for (int s = 0; s < 5; ++s) y[s] = y0[s] - k2[s] + two * k3[s];
+        Rates(p, y, h, k4);
+        for (int s = 0; s < 5; ++s) {
+            y[s] = y0[s] + (V::Broadcast(7.0) * k1[s] + V::Broadcast(10.0) * k2[s] + k4[s]) /
+                               V::Broadcast(27.0);
+        }
+        Rates(p, y, h, k5);
+        for (int s = 0; s < 5; ++s) {
+            y[s] = y0[s] + (V::Broadcast(28.0) * k1[s] - V::Broadcast(125.0) * k2[s] +
+                            V::Broadcast(546.0) * k3[s] + V::Broadcast(54.0) * k4[s] -
+                            V::Broadcast(378.0) * k5[s]) / V::Broadcast(625.0);
+        }
+        Rates(p, y, h, k6);
+
+        V accuracy = V::Load(a.accuracy + i);
+        V ratio = V::Broadcast(0.0);
+        for (int s = 0; s < 5; ++s) {
+            V y1 = y0[s] + (k1[s] + V::Broadcast(4.0) * k3[s] + k4[s]) / V::Broadcast(6.0);
+            V err = (V::Broadcast(-42.0) * k1[s] - V::Broadcast(224.0) * k3[s] -
+                     V::Broadcast(21.0) * k4[s] + V::Broadcast(162.0) * k5[s] +
+                     V::Broadcast(125.0) * k6[s]) / V::Broadcast(336.0);
+            ratio = Max(ratio, Abs(err) / (accuracy * (one + Abs(y1))));
+            y1.Store(a.y1[s] + i);
+        }
+        ratio.Store(a.error_ratio + i);
+    }
+}
+
+// Milstein step of dX = f dt + sigma X dW on A, C and Tol; the other states
+// have no noise and take the Euler step.
+template <class V>
+inline void MilsteinStep(const LaneParams<V>& p, const V y[5], V h, const V sigma[3], const V dW[3],
+                         V milstein, V out[5]) {
+    const int kNoisy[3] = {0, 1, 4};
+    V k[5];
+    Rates(p, y, h, k);
+    for (int s = 0; s < 5; ++s) out[s] = y[s] + k[s];
+    for (int d = 0; d < 3; ++d) {
+        int s = kNoisy[d];
+        V g = sigma[d] * y[s];
+        V correction = V::Broadcast(0.5) * milstein * sigma[d] * g * (dW[d] * dW[d] - h);
+        out[s] = out[s] + g * dW[d] + correction;
+    }
+}
+
+template <class V>
+void SdeLanes(const BatchStepArgs& a, const BatchNoiseArgs& n, size_t lanes) {
+    const V one = V::Broadcast(1.0);
+    const V half = V::Broadcast(0.5);
+    const V milstein = V::Broadcast(n.milstein);
+    V sigma[3];
+    for (int d = 0; d < 3; ++d) sigma[d] = V::Broadcast(n.sigma[d]);
+
+    for (size_t i = 0; i < lanes; i += V::kWidth) {
+        bool idle = true;
+        for (size_t j = 0; j < V::kWidth; ++j) idle = idle && a.h[i + j] == 0.0;
+        if (idle) continue;
+
+        LaneParams<V> p;
+        p.ka = V::Load(a.ka + i);
+        p.Vd = V::Load(a.Vd + i);
+        p.kcp = V::Load(a.kcp + i);
+        p.kpc = V::Load(a.kpc + i);
+        p.Vmax = V::Load(a.Vmax + i);
+        p.Km = V::Load(a.Km + i);
+        p.keo_tau = V::Load(a.keo_tau + i);
+        p.kin = V::Load(a.kin + i);
+        p.kout = V::Load(a.kout + i);
+        p.EC50_signal = V::Load(a.EC50_signal + i);
+        V h = V::Load(a.h + i);
+
+        V y0[5], full[5], mid[5], y1[5], dW1[3], dW2[3], dW[3];
+        for (int s = 0; s < 5; ++s) y0[s] = V::Load(a.y0[s] + i);
+        for (int d = 0; d < 3; ++d) {
+            dW1[d] = V::Load(n.dW1[d] + i);
+            dW2[d] = V::Load(n.dW2[d] + i);
+            dW[d] = dW1[d] + dW2[d];
+        }
+
+        MilsteinStep(p, y0, h, sigma, dW, milstein, full);
+        MilsteinStep(p, y0, half * h, sigma, dW1, milstein, mid);
+        MilsteinStep(p, mid, half * h, sigma, dW2, milstein, y1);
+
+        V accuracy = V::Load(a.accuracy + i);
+        V ratio = V::Broadcast(0.0);
+        for (int s = 0; s < 5; ++s) {
+            ratio = Max(ratio, Abs(full[s] - y1[s]) / (accuracy * (one + Abs(y1[s]))));
+            y1[s].Store(a.y1[s] + i);
+        }
+        ratio.Store(a.error_ratio + i);
+    }
+}
+
+// Hill effect with tolerance-shifted EC50. Integer exponents 1..8 shared by
+// a whole vector use repeated multiplication; anything else uses pow per lane.
+template <class V>
+void EffectLanes(const BatchEffectArgs& a, size_t lanes) {
+    const V zero = V::Broadcast(0.0);
+    const V one = V::Broadcast(1.0);
+
+    for (size_t i = 0; i < lanes; i += V::kWidth) {
+        double n = a.n_Hill[i];
+        bool uniform = true;
+        for (size_t j = 1; j < V::kWidth; ++j) uniform = uniform && a.n_Hill[i + j] == n;
+        int power = static_cast<int>(n);
+
+        if (uniform && power >= 1 && power <= 8 && static_cast<double>(power) == n) {
+            V Ce = Max(V::Load(a.Ce + i), zero);
+            V EC50 = V::Load(a.EC50_base + i) * (one + Max(V::Load(a.Tol + i), zero));
+            V Ce_n = Ce;
+            V EC50_n = EC50;
+            for (int j = 1; j < power; ++j) {
+                Ce_n = Ce_n * Ce;
+                EC50_n = EC50_n * EC50;
+            }
+            (V::Load(a.Emax + i) * Ce_n / (EC50_n + Ce_n)).Store(a.effect + i);
+            continue;
+        }
+
+        for (size_t j = i; j < i + V::kWidth; ++j) {
+            double Ce = a.Ce[j] < 0 ? 0.0 : a.Ce[j];
+            double Tol = a.Tol[j] < 0 ? 0.0 : a.Tol[j];
+            double Ce_n = std::pow(Ce, a.n_Hill[j]);
+            double EC50_n = std::pow(a.EC50_base[j] * (1.0 + Tol), a.n_Hill[j]);
+            a.effect[j] = a.Emax[j] * Ce_n / (EC50_n + Ce_n);
+        }
+    }
+}
+
+// Philox over W lanes at a time. The fixed-width inner loops are plain
+// integer code with 32x32->64 multiplies, which the compiler vectorizes for
+// whatever instruction set this unit is built with.
+template <size_t W>
+void RandomLanes(const BatchRandomArgs& a, size_t lanes) {
+    for (size_t i = 0; i < lanes; i += W) {
+        uint32_t c0[W], c1[W], c2[W], c3[W], k0[W], k1[W];
+        for (size_t j = 0; j < W; ++j) {
+            c0[j] = a.counter[i + j];
+            c1[j] = a.block;
+            c2[j] = static_cast<uint32_t>(a.stream[i + j]);
+            c3[j] = static_cast<uint32_t>(a.stream[i + j] >> 32);
+            k0[j] = static_cast<uint32_t>(a.key[i + j]);
+            k1[j] = static_cast<uint32_t>(a.key[i + j] >> 32);
+        }
+        for (int round = 0; round < kPhiloxRounds; ++round) {
+            for (size_t j = 0; j < W; ++j) {
+                PhiloxRound(c0[j], c1[j], c2[j], c3[j], k0[j], k1[j]);
+                k0[j] += kPhiloxW0;
+                k1[j] += kPhiloxW1;
+            }
+        }
+        for (size_t j = 0; j < W; ++j) {
+            a.out[0][i + j] = c0[j];
+            a.out[1][i + j] = c1[j];
+            a.out[2][i + j] = c2[j];
+            a.out[3][i + j] = c3[j];
+        }
+    }
+}
+
+}  // namespace
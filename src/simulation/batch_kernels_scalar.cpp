@@ -0,0 +1,28 @@
+#include "batch_kernels_impl.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BATCH_HAVE_CPU_DISPATCH 1
+#endif
+
+void GetBatchKernelsScalar(BatchKernels& kernels) {
+    kernels.name = "scalar";
+    kernels.step = &StepLanes<VecD1>;
+    kernels.effect = &EffectLanes<VecD1>;
+    kernels.random = &RandomLanes<kBatchLaneAlign>;
+    kernels.sde = &SdeLanes<VecD1>;
+}
+
+const BatchKernels& SelectBatchKernels() {
+    static const BatchKernels selected = [] {
+        BatchKernels kernels;
+        GetBatchKernelsScalar(kernels);
+#if defined(BATCH_HAVE_CPU_DISPATCH)
+        __builtin_cpu_init();
+        BatchKernels candidate;
+        if (__builtin_cpu_supports("avx512f") && GetBatchKernelsAvx512(candidate)) return candidate;
+        if (__builtin_cpu_supports("avx2") && GetBatchKernelsAvx2(candidate)) return candidate;
+#endif
+        return kernels;
+    }();
+    return selected;
+}
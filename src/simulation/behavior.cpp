@@ -3,19 +3,27 @@
 #include <iomanip>
 #include <iostream>
 
+#include "behavior_random.hpp"
+#include "context.hpp"
 #include "decision_logic.hpp"
 #include "dose_management.hpp"
 #include "monitoring.hpp"
 #include "monitoring_support.hpp"
 #include "pain_assessment.hpp"
 
-using std::cout;
 using std::endl;
 using std::fixed;
 using std::setprecision;
 using std::setw;
 
+PatientAssessment::PatientAssessment(SimulationContext& ctx)
+    : ScheduledEvent(ctx),
+      params_(ctx.params()),
+      cont_state_(ctx.state()),
+      petri_state_(ctx.petri_state()) {}
+
 void PatientAssessment::Behavior() {
+    TraceSpan span(ctx_, TraceSpanKind::PatientAssessment);
     if (!petri_state_.patient_alive) {
         return;
     }
@@ -24,43 +32,87 @@ void PatientAssessment::Behavior() {
     double Tol_val = cont_state_.Tol->Value();
     double effect = CalculateEffect(Ce_val, Tol_val, params_);
     
-    UpdatePainLevel(effect, petri_state_);
-    UpdateMotivation(params_.assessment_interval, params_, petri_state_);
+    std::ostream& out = ctx_.log(LogLevel::Events);
+    std::ostream& trace = ctx_.log(LogLevel::Trace);
+
+    // Time since the previous assessment, and this assessment's draws.
+    ++petri_state_.assessments;
+    double interval = params_.assessment_interval;
+    double perceived_effect = effect;
+    BehaviorDraws draws;
+    if (params_.stochastic_behavior) {
+        interval *= DrawBehavior(params_, petri_state_.assessments - 1).interval_scale;
+        draws = DrawBehavior(params_, petri_state_.assessments);
+        perceived_effect += params_.pain_noise * draws.pain_noise;
+    }
+
+    UpdatePainLevel(perceived_effect, petri_state_, trace);
+    UpdateMotivation(interval, params_, petri_state_, trace);
     
-    MonitorSaturation(params_, cont_state_);
+    MonitorSaturation(ctx_);
 
-    cout << "\n========== PATIENT ASSESSMENT at t=" << Time << " hours ==========" << endl;
-    cout << "Current Effect: " << fixed << setprecision(2) << effect << "%" << endl;
-    cout << "Pain Level: " << petri_state_.pain_level
-         << " (0=None, 1=Mild, 2=Moderate, 3=Severe)" << endl;
-    cout << "Relief State: " << (petri_state_.relief_state ? "YES" : "NO") << endl;
-    cout << "Motivation: " << setprecision(2) << petri_state_.motivation << endl;
-    cout << "Current Dose: " << petri_state_.current_dose << " mg" << endl;
+    out << "\n========== PATIENT ASSESSMENT at t=" << ctx_.Time() << " hours ==========" << endl;
+    out << "Current Effect: " << fixed << setprecision(2) << effect << "%" << endl;
+    out << "Pain Level: " << petri_state_.pain_level
+        << " (0=None, 1=Mild, 2=Moderate, 3=Severe)" << endl;
+    out << "Relief State: " << (petri_state_.relief_state ? "YES" : "NO") << endl;
+    out << "Motivation: " << setprecision(2) << petri_state_.motivation << endl;
+    out << "Current Dose: " << petri_state_.current_dose << " mg" << endl;
     
-    if (CheckToxicity(cont_state_, params_)) {
+    if (!params_.state_events && CheckToxicity(ctx_)) {
         petri_state_.patient_alive = false;
-        petri_state_.time_overdose_detected = Time;
-        cout << "\n!!! SIMULATION TERMINATED - PATIENT DECEASED !!!" << endl;
-        Stop();
+        petri_state_.time_overdose_detected = ctx_.Time();
+        for (TrajectorySink* sink : ctx_.trajectory_sinks()) {
+            sink->OnAssessment(ctx_.Time(), effect, petri_state_, AssessmentDecision::None);
+        }
+        out << "\n!!! SIMULATION TERMINATED - PATIENT DECEASED !!!" << endl;
+        ctx_.Stop();
         return;
     }
     
+    AssessmentDecision decision = AssessmentDecision::None;
     if (params_.petri_net_enabled) {
-        if (ShouldIncreaseDose(effect, params_, petri_state_)) {
-            ExecuteDoseIncrease(params_, cont_state_, petri_state_);
+        // Missed and extra doses are reported as Stable and Maintain: the
+        // dose history tells them apart.
+        bool stochastic = params_.stochastic_behavior;
+        if (ShouldIncreaseDose(effect, params_, petri_state_, draws.escalation, trace)) {
+            decision = AssessmentDecision::Increase;
+            ExecuteDoseIncrease(ctx_);
         } else if (petri_state_.relief_state && effect >= params_.effect_relief_threshold) {
-            MaintainDose(params_, cont_state_, petri_state_);
+            if (stochastic && draws.missed < params_.missed_dose_probability) {
+                decision = AssessmentDecision::Stable;
+                out << "Decision: MISSED DOSE - maintenance dose not taken" << endl;
+            } else {
+                decision = AssessmentDecision::Maintain;
+                MaintainDose(ctx_);
+            }
+        } else if (stochastic && draws.extra < params_.extra_dose_probability) {
+            decision = AssessmentDecision::Maintain;
+            TakeExtraDose(ctx_);
         } else {
-            cout << "Decision: STABLE - No dose adjustment needed" << endl;
+            decision = AssessmentDecision::Stable;
+            out << "Decision: STABLE - No dose adjustment needed" << endl;
         }
     }
+    for (TrajectorySink* sink : ctx_.trajectory_sinks()) {
+        sink->OnAssessment(ctx_.Time(), effect, petri_state_, decision);
+    }
     
-    cout << "================================================" << endl;
-    petri_state_.time_since_last_dose += params_.assessment_interval;
-    
-    Activate(Time + params_.assessment_interval);
-}
+    out << "================================================" << endl;
+    double next_interval = params_.assessment_interval * draws.interval_scale;
+    petri_state_.time_since_last_dose += next_interval;
 
-void PatientAssessment::CheckAndApplyNaloxonePublic() {
-    CheckAndApplyNaloxone(params_, cont_state_, petri_state_);
+    // The stable rule assumes the same decision every cycle, which random
+    // behavior does not give.
+    if (params_.outcome_detection && !params_.stochastic_behavior &&
+        ctx_.outcome_detector().Observe(params_, ctx_.Time(), effect, cont_state_.C->Value(), Tol_val, decision)) {
+        const OutcomePrediction& prediction = ctx_.outcome_prediction();
+        out << "\n>>> OUTCOME DETERMINED at t=" << ctx_.Time() << " hours: "
+            << PredictedOutcomeName(prediction.outcome) << " <<<" << endl;
+        out << prediction.reason << endl;
+        ctx_.Stop();
+        return;
+    }
+    
+    Activate(ctx_.Time() + next_interval);
 }
@@ -1,9 +1,9 @@
 #pragma once
 
-#include <simlib.h>
-
+#include <cstdint>
 #include <vector>
 
+#include "calendar.hpp"
 #include "dynamics.hpp"
 #include "parameters.hpp"
 
@@ -15,6 +15,7 @@ struct PetriNetState {
     bool patient_alive{true};
     double current_dose{10.0};
     double time_overdose_detected{0.0};
+    uint32_t assessments{0};  // assessments run so far; the stochastic draw counter
 
     struct DoseRecord {
         double time;
@@ -27,15 +28,11 @@ struct PetriNetState {
     std::vector<DoseRecord> dose_history;
 };
 
-class PatientAssessment : public Event {
+class PatientAssessment : public ScheduledEvent {
 public:
-    PatientAssessment(const ModelParameters& params, SimulationState& cont_state,
-                      PetriNetState& petri_state)
-        : params_(params), cont_state_(cont_state), petri_state_(petri_state) {}
+    explicit PatientAssessment(SimulationContext& ctx);
 
     void Behavior() override;
-    
-    void CheckAndApplyNaloxonePublic();
 
 private:
     const ModelParameters& params_;
@@ -0,0 +1,51 @@
+#include "behavior_random.hpp"
+
+#include <cmath>
+
+#include "philox.hpp"
+
+namespace {
+
+const double kTwoPi = 6.283185307179586;
+
+}  // namespace
+
+uint64_t BehaviorKey(const ModelParameters& params) {
+    return static_cast<uint64_t>(params.behavior_seed);
+}
+
+uint64_t BehaviorStream(const ModelParameters& params) {
+    return static_cast<uint64_t>(params.behavior_stream);
+}
+
+void BehaviorCounter(uint64_t stream, uint32_t assessment, uint32_t block, uint32_t counter[4]) {
+    counter[0] = assessment;
+    counter[1] = block;
+    counter[2] = static_cast<uint32_t>(stream);
+    counter[3] = static_cast<uint32_t>(stream >> 32);
+}
+
+BehaviorDraws BehaviorDrawsFromWords(const ModelParameters& params, const uint32_t block0[4],
+                                     const uint32_t block1[4]) {
+    BehaviorDraws draws;
+    draws.interval_scale = 1.0 + params.assessment_jitter * (2.0 * PhiloxUniform(block0[0]) - 1.0);
+    draws.escalation = PhiloxUniform(block0[1]);
+    draws.missed = PhiloxUniform(block0[2]);
+    draws.extra = PhiloxUniform(block0[3]);
+    // Box-Muller; block1[2..3] are left for later draws.
+    double r = std::sqrt(-2.0 * std::log(PhiloxUniform(block1[0])));
+    draws.pain_noise = r * std::cos(kTwoPi * PhiloxUniform(block1[1]));
+    return draws;
+}
+
+BehaviorDraws DrawBehavior(const ModelParameters& params, uint32_t assessment) {
+    uint64_t key = BehaviorKey(params);
+    uint64_t stream = BehaviorStream(params);
+    uint32_t counter[4];
+    uint32_t blocks[kBehaviorBlocks][4];
+    for (uint32_t block = 0; block < kBehaviorBlocks; ++block) {
+        BehaviorCounter(stream, assessment, block, counter);
+        Philox4x32(counter, key, blocks[block]);
+    }
+    return BehaviorDrawsFromWords(params, blocks[0], blocks[1]);
+}
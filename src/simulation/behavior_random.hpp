@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+
+#include "parameters.hpp"
+
+// Random inputs of one assessment in the stochastic behavior mode
+// (stochastic_behavior = 1).
+//
+// Draw set k of a run is Philox4x32-10 under key behavior_seed of the
+// counters (k, block, behavior_stream) for blocks 0 and 1. It depends on
+// nothing but those three numbers: a run is bit-reproducible however runs
+// are spread over threads, a restored snapshot continues the same stream,
+// and SimulationContext and BatchSimulation draw identical numbers. Set k is
+// used by the k-th assessment; its interval_scale times the interval to the
+// next one (set 0 times the interval to the first).
+struct BehaviorDraws {
+    double interval_scale{1.0};  // uniform on [1 - assessment_jitter, 1 + assessment_jitter]
+    double escalation{0.0};      // uniform; escalate when below EscalationProbability
+    double missed{0.0};          // uniform; a maintenance dose is skipped when below missed_dose_probability
+    double extra{0.0};           // uniform; an extra dose is taken when below extra_dose_probability
+    double pain_noise{0.0};      // standard normal
+};
+
+const uint32_t kBehaviorBlocks = 2;
+
+uint64_t BehaviorKey(const ModelParameters& params);
+uint64_t BehaviorStream(const ModelParameters& params);
+// Counter of one block of draw set `assessment` in `stream`.
+void BehaviorCounter(uint64_t stream, uint32_t assessment, uint32_t block, uint32_t counter[4]);
+
+// Draw set from its two Philox output blocks.
+BehaviorDraws BehaviorDrawsFromWords(const ModelParameters& params, const uint32_t block0[4],
+                                     const uint32_t block1[4]);
+BehaviorDraws DrawBehavior(const ModelParameters& params, uint32_t assessment);
@@ -0,0 +1,69 @@
+#include "calendar.hpp"
+
+#include <algorithm>
+
+#include "context.hpp"
+
+void ScheduledEvent::Activate(double time) {
+    ctx_.Schedule(*this, time);
+}
+
+void ScheduledEvent::Cancel() {
+    ctx_.CancelEvent(*this);
+}
+
+void Calendar::Schedule(ScheduledEvent& event, double time) {
+    ++event.generation_;
+    event.scheduled_ = true;
+    entries_.Push(Entry{time, sequence_++, event.generation_, &event});
+}
+
+void Calendar::Cancel(ScheduledEvent& event) {
+    ++event.generation_;
+    event.scheduled_ = false;
+}
+
+void Calendar::DropStale() {
+    while (!entries_.Empty() && entries_.Top().generation != entries_.Top().event->generation_) {
+        entries_.Pop();
+    }
+}
+
+bool Calendar::Empty() {
+    DropStale();
+    return entries_.Empty();
+}
+
+double Calendar::NextTime() {
+    DropStale();
+    return entries_.Top().time;
+}
+
+ScheduledEvent* Calendar::PopNext() {
+    DropStale();
+    if (entries_.Empty()) return nullptr;
+    ScheduledEvent* event = entries_.Top().event;
+    entries_.Pop();
+    ++event->generation_;
+    event->scheduled_ = false;
+    return event;
+}
+
+void Calendar::Clear() {
+    entries_.ForEach([](const Entry& entry) {
+        ++entry.event->generation_;
+        entry.event->scheduled_ = false;
+    });
+    entries_.Clear();
+}
+
+std::vector<std::pair<double, ScheduledEvent*>> Calendar::Pending() const {
+    std::vector<Entry> entries;
+    entries_.ForEach([&entries](const Entry& entry) {
+        if (entry.generation == entry.event->generation_) entries.push_back(entry);
+    });
+    std::sort(entries.begin(), entries.end());
+    std::vector<std::pair<double, ScheduledEvent*>> pending;
+    for (const Entry& entry : entries) pending.emplace_back(entry.time, entry.event);
+    return pending;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include "calendar_queue.hpp"
+
+class SimulationContext;
+
+// Discrete event bound to a single SimulationContext. Mirrors SIMLIB's Event
+// (Behavior + Activate) without the process-global calendar.
+class ScheduledEvent {
+public:
+    explicit ScheduledEvent(SimulationContext& ctx) : ctx_(ctx) {}
+    virtual ~ScheduledEvent() = default;
+
+    virtual void Behavior() = 0;
+
+    void Activate(double time);
+    void Cancel();
+    // Activated and neither run nor cancelled since.
+    bool Scheduled() const { return scheduled_; }
+
+protected:
+    SimulationContext& ctx_;
+
+private:
+    friend class Calendar;
+
+    unsigned long generation_{0};
+    bool scheduled_{false};
+};
+
+// Time-ordered event list. Events at equal times run in activation order;
+// re-activating or cancelling an event invalidates its older entries.
+class Calendar {
+public:
+    void Schedule(ScheduledEvent& event, double time);
+    void Cancel(ScheduledEvent& event);
+
+    bool Empty();
+    double NextTime();
+    ScheduledEvent* PopNext();
+    void Clear();
+    // Live entries (time, event) in the order they will run.
+    std::vector<std::pair<double, ScheduledEvent*>> Pending() const;
+    // Calls visit(time, event) for every live entry, in no particular order.
+    template <typename Visit>
+    void ForEach(Visit visit) const {
+        entries_.ForEach([&visit](const Entry& entry) {
+            if (entry.generation == entry.event->generation_) visit(entry.time, entry.event);
+        });
+    }
+
+private:
+    struct Entry {
+        double time;
+        unsigned long long sequence;
+        unsigned long generation;
+        ScheduledEvent* event;
+
+        bool operator<(const Entry& other) const {
+            if (time != other.time) return time < other.time;
+            return sequence < other.sequence;
+        }
+    };
+
+    void DropStale();
+
+    CalendarQueue<Entry> entries_{};
+    unsigned long long sequence_{0};
+};
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+// Brown's calendar queue: a priority queue of timed entries spread over a
+// ring of buckets ("days") of equal width, each kept sorted. Push and pop
+// are O(1) on average as long as the bucket width tracks the spacing of the
+// earliest entries, so the ring is resized (and the width re-estimated)
+// whenever the queue grows or shrinks by a factor of two. This keeps a
+// calendar holding one entry per patient of a large population as cheap as
+// the few entries of a single run.
+//
+// Entry needs a `double time` member (>= 0) and an operator< that orders by
+// time and breaks ties; entries are stored by value.
+template <typename Entry>
+class CalendarQueue {
+public:
+    CalendarQueue() : buckets_(kMinBuckets) {}
+
+    bool Empty() const { return size_ == 0; }
+    size_t Size() const { return size_; }
+
+    void Push(const Entry& entry) {
+        unsigned long long day = Day(entry.time);
+        if (size_ == 0 || day < day_) {
+            day_ = day;
+            cursor_ = static_cast<size_t>(day % buckets_.size());
+        }
+        Insert(entry, day);
+        if (++size_ > 2 * buckets_.size()) Resize(2 * buckets_.size());
+    }
+
+    // Earliest entry; the queue must not be empty.
+    const Entry& Top() {
+        Locate();
+        return buckets_[cursor_].back();
+    }
+
+    void Pop() {
+        Locate();
+        buckets_[cursor_].pop_back();
+        if (--size_ < buckets_.size() / 2 && buckets_.size() > kMinBuckets) Resize(buckets_.size() / 2);
+    }
+
+    void Clear() {
+        for (auto& bucket : buckets_) bucket.clear();
+        size_ = 0;
+        day_ = 0;
+        cursor_ = 0;
+    }
+
+    // Calls visit(entry) for every entry, in no particular order.
+    template <typename Visit>
+    void ForEach(Visit visit) const {
+        for (const auto& bucket : buckets_) {
+            for (const Entry& entry : bucket) visit(entry);
+        }
+    }
+
+private:
+    static const size_t kMinBuckets = 2;
+    // Entries sampled to estimate the spacing, and the multiple of the
+    // spacing used as bucket width (Brown's choice of three).
+    static const size_t kWidthSample = 25;
+    static constexpr double kWidthFactor = 3.0;
+    // Far beyond any simulated time, far below overflow.
+    static constexpr double kMaxDay = 1e18;
+
+    unsigned long long Day(double time) const {
+        double day = time / width_;
+        if (!(day > 0.0)) return 0;
+        if (day >= kMaxDay) day = kMaxDay;
+        return static_cast<unsigned long long>(day);
+    }
+
+    // Buckets are sorted latest first, so the earliest entry is at the back.
+    void Insert(const Entry& entry, unsigned long long day) {
+        std::vector<Entry>& bucket = buckets_[static_cast<size_t>(day % buckets_.size())];
+        auto position = std::lower_bound(bucket.begin(), bucket.end(), entry,
+                                         [](const Entry& a, const Entry& b) { return b < a; });
+        bucket.insert(position, entry);
+    }
+
+    // Moves the cursor to the bucket holding the earliest entry. Entries of
+    // later years sharing a bucket are skipped by comparing days; after a
+    // full turn without a hit the earliest bucket is searched for directly.
+    void Locate() {
+        size_t n = buckets_.size();
+        for (size_t turn = 0; turn < n; ++turn) {
+            const std::vector<Entry>& bucket = buckets_[cursor_];
+            if (!bucket.empty() && Day(bucket.back().time) <= day_) return;
+            cursor_ = (cursor_ + 1) % n;
+            ++day_;
+        }
+        const Entry* earliest = nullptr;
+        for (size_t i = 0; i < n; ++i) {
+            if (buckets_[i].empty()) continue;
+            if (!earliest || buckets_[i].back() < *earliest) {
+                earliest = &buckets_[i].back();
+                cursor_ = i;
+            }
+        }
+        day_ = Day(earliest->time);
+    }
+
+    void Resize(size_t count) {
+        std::vector<Entry> entries;
+        entries.reserve(size_);
+        for (auto& bucket : buckets_) {
+            entries.insert(entries.end(), bucket.begin(), bucket.end());
+            bucket.clear();
+        }
+
+        // Mean spacing of the earliest entries, ignoring gaps far above it
+        // (an isolated late event must not flatten the whole calendar).
+        size_t sample = entries.size() < kWidthSample ? entries.size() : kWidthSample;
+        if (sample > 1) {
+            std::partial_sort(entries.begin(), entries.begin() + sample, entries.end());
+            double span = entries[sample - 1].time - entries[0].time;
+            double mean = span / (sample - 1);
+            double total = 0.0;
+            size_t gaps = 0;
+            for (size_t i = 1; i < sample; ++i) {
+                double gap = entries[i].time - entries[i - 1].time;
+                if (gap <= 2.0 * mean) {
+                    total += gap;
+                    ++gaps;
+                }
+            }
+            if (total > 0.0) width_ = kWidthFactor * total / gaps;
+        }
+
+        buckets_.assign(count, std::vector<Entry>());
+        size_ = entries.size();
+        day_ = 0;
+        cursor_ = 0;
+        bool first = true;
+        for (const Entry& entry : entries) {
+            unsigned long long day = Day(entry.time);
+            if (first || day < day_) {
+                day_ = day;
+                cursor_ = static_cast<size_t>(day % count);
+                first = false;
+            }
+            Insert(entry, day);
+        }
+    }
+
+    std::vector<std::vector<Entry>> buckets_;
+    double width_{1.0};
+    size_t size_{0};
+    // Bucket and absolute day no entry is earlier than.
+    size_t cursor_{0};
+    unsigned long long day_{0};
+};
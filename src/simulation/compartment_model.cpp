@@ -0,0 +1,497 @@
+#include "compartment_model.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using std::cerr;
+using std::endl;
+using std::string;
+using std::vector;
+
+namespace {
+
+enum class Section { None, Compartments, Roles, Fluxes };
+
+string Trim(const string& text) {
+    size_t first = text.find_first_not_of(" \t\r\n");
+    if (first == string::npos) return "";
+    size_t last = text.find_last_not_of(" \t\r\n");
+    return text.substr(first, last - first + 1);
+}
+
+bool IsIdentifier(const string& text) {
+    if (text.empty() || !(std::isalpha(static_cast<unsigned char>(text[0])) || text[0] == '_')) return false;
+    for (char c : text) {
+        if (!(std::isalnum(static_cast<unsigned char>(c)) || c == '_')) return false;
+    }
+    return true;
+}
+
+bool IsParameterKey(const string& key) {
+    double value;
+    return GetModelParameter(ModelParameters{}, key, value);
+}
+
+// "a * b / c" with a, b, c numbers or parameter keys.
+bool ParseExpression(const string& text, ModelExpression& expression, string& error) {
+    expression = ModelExpression{};
+    bool divide = false;
+    size_t pos = 0;
+    while (true) {
+        size_t op = text.find_first_of("*/", pos);
+        string atom = Trim(text.substr(pos, op == string::npos ? string::npos : op - pos));
+        if (atom.empty()) {
+            error = "missing value in '" + text + "'";
+            return false;
+        }
+        char* end = nullptr;
+        double number = std::strtod(atom.c_str(), &end);
+        if (end && *end == '\0') {
+            expression.constant = divide ? expression.constant / number : expression.constant * number;
+        } else if (IsParameterKey(atom)) {
+            (divide ? expression.denominator : expression.numerator).push_back(atom);
+        } else {
+            error = "unknown parameter '" + atom + "'";
+            return false;
+        }
+        if (op == string::npos) return true;
+        divide = text[op] == '/';
+        pos = op + 1;
+    }
+}
+
+string ExpressionText(const ModelExpression& expression) {
+    std::ostringstream text;
+    bool first = true;
+    if (expression.constant != 1.0 || expression.numerator.empty()) {
+        text << expression.constant;
+        first = false;
+    }
+    for (const string& key : expression.numerator) {
+        text << (first ? "" : " * ") << key;
+        first = false;
+    }
+    for (const string& key : expression.denominator) text << " / " << key;
+    return text.str();
+}
+
+ModelExpression Constant(double value) {
+    ModelExpression expression;
+    expression.constant = value;
+    return expression;
+}
+
+ModelExpression Parameter(const char* key) {
+    ModelExpression expression;
+    expression.numerator.push_back(key);
+    return expression;
+}
+
+CompartmentFlux LinearFlux(size_t from, size_t to, bool transfer, const ModelExpression& rate) {
+    CompartmentFlux flux;
+    flux.from = from;
+    flux.to = to;
+    flux.transfer = transfer;
+    flux.rate = rate;
+    return flux;
+}
+
+CompartmentFlux HillFlux(size_t from, size_t to, bool transfer, const ModelExpression& Vmax,
+                         const ModelExpression& K, const ModelExpression& n) {
+    CompartmentFlux flux = LinearFlux(from, to, transfer, Vmax);
+    flux.hill = true;
+    flux.K = K;
+    flux.n = n;
+    return flux;
+}
+
+size_t FindCompartment(const CompartmentModel& model, const string& name) {
+    for (size_t i = 0; i < model.compartments.size(); ++i) {
+        if (model.compartments[i].name == name) return i;
+    }
+    return kNoCompartment;
+}
+
+bool ParseFlux(const CompartmentModel& model, const string& line, CompartmentFlux& flux, string& error) {
+    size_t arrow = line.find("->");
+    size_t signal = line.find("=>");
+    if (arrow == string::npos || (signal != string::npos && signal < arrow)) arrow = signal;
+    size_t equals = arrow == string::npos ? string::npos : line.find('=', arrow + 2);
+    if (arrow == string::npos || equals == string::npos) {
+        error = "expected 'from -> to = value' or 'from => to = value'";
+        return false;
+    }
+    string from = Trim(line.substr(0, arrow));
+    string to = Trim(line.substr(arrow + 2, equals - arrow - 2));
+    string value = Trim(line.substr(equals + 1));
+
+    flux = CompartmentFlux{};
+    flux.transfer = line[arrow] == '-';
+    flux.from = FindCompartment(model, from);
+    if (flux.from == kNoCompartment) {
+        error = "unknown compartment '" + from + "'";
+        return false;
+    }
+    if (to != "out") {
+        flux.to = FindCompartment(model, to);
+        if (flux.to == kNoCompartment) {
+            error = "unknown compartment '" + to + "'";
+            return false;
+        }
+        if (flux.to == flux.from) {
+            error = "flux from '" + from + "' into itself";
+            return false;
+        }
+    } else if (!flux.transfer) {
+        error = "a signal (=>) needs a target compartment";
+        return false;
+    }
+
+    std::istringstream words(value);
+    string kind;
+    words >> kind;
+    if (kind != "mm" && kind != "hill") return ParseExpression(value, flux.rate, error);
+
+    vector<string> args;
+    string arg;
+    while (words >> arg) args.push_back(arg);
+    size_t expected = kind == "mm" ? 2 : 3;
+    if (args.size() != expected) {
+        error = kind == "mm" ? "expected 'mm Vmax Km'" : "expected 'hill Vmax K n'";
+        return false;
+    }
+    flux.hill = true;
+    if (!ParseExpression(args[0], flux.rate, error) || !ParseExpression(args[1], flux.K, error)) return false;
+    if (kind == "mm") {
+        flux.n = Constant(1.0);
+        return true;
+    }
+    return ParseExpression(args[2], flux.n, error);
+}
+
+}  // namespace
+
+double ModelExpression::Evaluate(const ModelParameters& params) const {
+    double value = constant;
+    double parameter;
+    for (const string& key : numerator) {
+        if (GetModelParameter(params, key, parameter)) value *= parameter;
+    }
+    for (const string& key : denominator) {
+        if (GetModelParameter(params, key, parameter)) value /= parameter;
+    }
+    return value;
+}
+
+bool LoadCompartmentModel(const string& filename, CompartmentModel& model) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        cerr << "Error: Cannot open model file: " << filename << "\n";
+        return false;
+    }
+
+    model = CompartmentModel{};
+    model.source = filename;
+    Section section = Section::None;
+    string line;
+    int number = 0;
+    auto fail = [&](const string& message) {
+        cerr << "Error: " << filename << ":" << number << ": " << message << "\n";
+        return false;
+    };
+
+    while (std::getline(file, line)) {
+        ++number;
+        size_t comment = line.find('#');
+        if (comment != string::npos) line = line.substr(0, comment);
+        line = Trim(line);
+        if (line.empty()) continue;
+
+        if (line[0] == '[') {
+            if (line == "[compartments]") {
+                section = Section::Compartments;
+            } else if (line == "[roles]") {
+                section = Section::Roles;
+            } else if (line == "[fluxes]") {
+                section = Section::Fluxes;
+            } else {
+                return fail("unknown section " + line);
+            }
+            continue;
+        }
+
+        string error;
+        size_t equals = line.find('=');
+        switch (section) {
+            case Section::None:
+                return fail("entry outside [compartments], [roles] or [fluxes]");
+
+            case Section::Compartments: {
+                Compartment compartment;
+                compartment.name = Trim(line.substr(0, equals));
+                if (!IsIdentifier(compartment.name) || compartment.name == "out") {
+                    return fail("invalid compartment name '" + compartment.name + "'");
+                }
+                if (FindCompartment(model, compartment.name) != kNoCompartment) {
+                    return fail("compartment '" + compartment.name + "' declared twice");
+                }
+                if (equals != string::npos &&
+                    !ParseExpression(line.substr(equals + 1), compartment.volume, error)) {
+                    return fail(error);
+                }
+                model.compartments.push_back(compartment);
+                break;
+            }
+
+            case Section::Roles: {
+                if (equals == string::npos) return fail("expected 'role = compartment'");
+                string role = Trim(line.substr(0, equals));
+                string name = Trim(line.substr(equals + 1));
+                size_t index = FindCompartment(model, name);
+                if (index == kNoCompartment) return fail("unknown compartment '" + name + "'");
+                if (role == "dose") {
+                    model.dose = index;
+                } else if (role == "central") {
+                    model.central = index;
+                } else if (role == "peripheral") {
+                    model.peripheral = index;
+                } else if (role == "effect") {
+                    model.effect = index;
+                } else if (role == "tolerance") {
+                    model.tolerance = index;
+                } else {
+                    return fail("unknown role '" + role + "'");
+                }
+                break;
+            }
+
+            case Section::Fluxes: {
+                CompartmentFlux flux;
+                if (!ParseFlux(model, line, flux, error)) return fail(error);
+                model.fluxes.push_back(flux);
+                break;
+            }
+        }
+    }
+
+    if (model.dose == kNoCompartment || model.central == kNoCompartment || model.effect == kNoCompartment ||
+        model.tolerance == kNoCompartment) {
+        cerr << "Error: " << filename << ": roles dose, central, effect and tolerance are required\n";
+        return false;
+    }
+    const ModelExpression& dose_volume = model.compartments[model.dose].volume;
+    if (dose_volume.constant != 1.0 || !dose_volume.numerator.empty() || !dose_volume.denominator.empty()) {
+        cerr << "Error: " << filename << ": doses are amounts, so the dose compartment '"
+             << model.compartments[model.dose].name << "' cannot have a volume\n";
+        return false;
+    }
+    return true;
+}
+
+CompartmentModel BuiltinCompartmentModel() {
+    CompartmentModel model;
+    model.source = "built-in";
+    const char* names[] = {"A", "C", "P", "Ce", "Tol"};
+    for (const char* name : names) {
+        Compartment compartment;
+        compartment.name = name;
+        model.compartments.push_back(compartment);
+    }
+    // P is a concentration on the central volume scale in dynamics.cpp.
+    model.compartments[1].volume = Parameter("Vd");
+    model.compartments[2].volume = Parameter("Vd");
+    model.dose = 0;
+    model.central = 1;
+    model.peripheral = 2;
+    model.effect = 3;
+    model.tolerance = 4;
+
+    ModelExpression ke = Parameter("keo");
+    ke.denominator.push_back("tau_e");
+    model.fluxes.push_back(LinearFlux(0, 1, true, Parameter("ka")));
+    model.fluxes.push_back(LinearFlux(1, 2, true, Parameter("kcp")));
+    model.fluxes.push_back(LinearFlux(2, 1, true, Parameter("kpc")));
+    model.fluxes.push_back(HillFlux(1, kNoCompartment, true, Parameter("Vmax"), Parameter("Km"), Constant(1.0)));
+    model.fluxes.push_back(LinearFlux(1, 3, false, ke));
+    model.fluxes.push_back(LinearFlux(3, kNoCompartment, true, ke));
+    model.fluxes.push_back(HillFlux(3, 4, false, Parameter("kin"), Parameter("EC50_signal"), Constant(1.0)));
+    model.fluxes.push_back(LinearFlux(4, kNoCompartment, true, Parameter("kout")));
+    return model;
+}
+
+void PrintCompartmentModel(const CompartmentModel& model, std::ostream& out) {
+    const char* const roles[] = {"dose", "central", "peripheral", "effect", "tolerance"};
+    const size_t indices[] = {model.dose, model.central, model.peripheral, model.effect, model.tolerance};
+    size_t hill = 0;
+    for (const CompartmentFlux& flux : model.fluxes) hill += flux.hill ? 1 : 0;
+
+    out << "Compartment model (" << model.source << "): " << model.Size() << " compartments, "
+        << model.fluxes.size() - hill << " linear and " << hill << " Hill fluxes" << endl;
+    out << "  ";
+    for (size_t i = 0; i < model.Size(); ++i) {
+        const Compartment& compartment = model.compartments[i];
+        out << (i ? ", " : "") << compartment.name;
+        if (!compartment.volume.numerator.empty() || compartment.volume.constant != 1.0) {
+            out << " (V = " << ExpressionText(compartment.volume) << ")";
+        }
+        for (int role = 0; role < 5; ++role) {
+            if (indices[role] == i) out << " [" << roles[role] << "]";
+        }
+    }
+    out << endl;
+    for (const CompartmentFlux& flux : model.fluxes) {
+        out << "  " << model.compartments[flux.from].name << (flux.transfer ? " -> " : " => ")
+            << (flux.to == kNoCompartment ? "out" : model.compartments[flux.to].name) << ": ";
+        if (flux.hill) {
+            out << "hill Vmax = " << ExpressionText(flux.rate) << ", K = " << ExpressionText(flux.K)
+                << ", n = " << ExpressionText(flux.n);
+        } else {
+            out << ExpressionText(flux.rate);
+        }
+        out << endl;
+    }
+    out << endl;
+}
+
+CompartmentKernel::CompartmentKernel(const CompartmentModel& model, const ModelParameters& params)
+    : n_(model.Size()) {
+    vector<double> volume(n_);
+    for (size_t i = 0; i < n_; ++i) volume[i] = model.compartments[i].volume.Evaluate(params);
+
+    // Linear fluxes are summed into a dense matrix first; models are small
+    // enough for that, and the kernel only keeps the non-zeros.
+    vector<double> L(n_ * n_, 0.0);
+    vector<bool> nonlinear(n_, false);
+    for (const CompartmentFlux& flux : model.fluxes) {
+        size_t from = flux.from;
+        size_t to = flux.to;
+        if (flux.hill) {
+            if (flux.transfer) nonlinear[from] = true;
+            if (to != kNoCompartment) nonlinear[to] = true;
+            continue;
+        }
+        double k = flux.rate.Evaluate(params);
+        if (flux.transfer) {
+            L[from * n_ + from] -= k;
+            if (to != kNoCompartment) L[to * n_ + from] += k * volume[from] / volume[to];
+        } else {
+            L[to * n_ + from] += k;
+        }
+    }
+
+    row_start_.push_back(0);
+    for (size_t row = 0; row < n_; ++row) {
+        for (size_t col = 0; col < n_; ++col) {
+            if (L[row * n_ + col] == 0.0) continue;
+            columns_.push_back(col);
+            values_.push_back(L[row * n_ + col]);
+        }
+        row_start_.push_back(columns_.size());
+    }
+
+    vector<size_t> slot(n_, kNoCompartment);
+    for (size_t row = 0; row < n_; ++row) {
+        if (!nonlinear[row]) continue;
+        slot[row] = nonlinear_rows_.size();
+        nonlinear_rows_.push_back(row);
+    }
+    for (const CompartmentFlux& flux : model.fluxes) {
+        if (!flux.hill) continue;
+        HillTerm term;
+        term.from = flux.from;
+        term.to = flux.to;
+        term.from_slot = flux.transfer ? slot[flux.from] : kNoCompartment;
+        term.to_slot = flux.to == kNoCompartment ? kNoCompartment : slot[flux.to];
+        term.from_scale = flux.transfer ? -1.0 / volume[flux.from] : 0.0;
+        term.to_scale = (flux.transfer && flux.to != kNoCompartment) ? 1.0 / volume[flux.to] : 1.0;
+        term.Vmax = flux.rate.Evaluate(params);
+        term.K = flux.K.Evaluate(params);
+        term.n = flux.n.Evaluate(params);
+        term.K_n = term.n == 1.0 ? term.K : std::pow(term.K, term.n);
+        hill_.push_back(term);
+    }
+
+    work_.assign(7 * n_, 0.0);
+}
+
+double CompartmentKernel::HillRate(const HillTerm& term, double x) const {
+    if (x < 0) return 0.0;
+    if (term.n == 1.0) return (term.Vmax * x) / (term.K + x);
+    double x_n = std::pow(x, term.n);
+    return term.Vmax * x_n / (term.K_n + x_n);
+}
+
+double CompartmentKernel::HillSlope(const HillTerm& term, double x) const {
+    if (x < 0) return 0.0;
+    if (term.n == 1.0) {
+        double denominator = term.K + x;
+        return term.Vmax * term.K / (denominator * denominator);
+    }
+    if (x == 0.0) return term.n < 1.0 ? HUGE_VAL : 0.0;
+    double x_n = std::pow(x, term.n);
+    double denominator = term.K_n + x_n;
+    return term.Vmax * term.n * (x_n / x) * term.K_n / (denominator * denominator);
+}
+
+void CompartmentKernel::Derivatives(const double* y, double* dy) const {
+    for (size_t row = 0; row < n_; ++row) {
+        double sum = 0.0;
+        for (size_t k = row_start_[row]; k < row_start_[row + 1]; ++k) sum += values_[k] * y[columns_[k]];
+        dy[row] = sum;
+    }
+    for (const HillTerm& term : hill_) {
+        double rate = HillRate(term, y[term.from]);
+        if (term.from_slot != kNoCompartment) dy[term.from] += rate * term.from_scale;
+        if (term.to != kNoCompartment) dy[term.to] += rate * term.to_scale;
+    }
+}
+
+double CompartmentKernel::EnglandStep(const double* y0, double h, double accuracy, double* y1) const {
+    auto rhs = [this](const double* y, double* dy) { Derivatives(y, dy); };
+    return RungeKuttaEnglandStep(rhs, n_, n_, y0, h, accuracy, work_.data(), y1);
+}
+
+void CompartmentKernel::Nonlinear(const double* y, double* g) const {
+    std::fill(g, g + nonlinear_rows_.size(), 0.0);
+    for (const HillTerm& term : hill_) {
+        double rate = HillRate(term, y[term.from]);
+        if (term.from_slot != kNoCompartment) g[term.from_slot] += rate * term.from_scale;
+        if (term.to_slot != kNoCompartment) g[term.to_slot] += rate * term.to_scale;
+    }
+}
+
+void CompartmentKernel::LinearMatrix(vector<double>& L) const {
+    L.assign(n_ * n_, 0.0);
+    for (size_t row = 0; row < n_; ++row) {
+        for (size_t k = row_start_[row]; k < row_start_[row + 1]; ++k) L[row * n_ + columns_[k]] = values_[k];
+    }
+}
+
+void CompartmentKernel::Jacobian(const double* y, vector<double>& J) const {
+    LinearMatrix(J);
+    for (const HillTerm& term : hill_) {
+        double slope = HillSlope(term, y[term.from]);
+        if (term.from_slot != kNoCompartment) J[term.from * n_ + term.from] += slope * term.from_scale;
+        if (term.to != kNoCompartment) J[term.to * n_ + term.from] += slope * term.to_scale;
+    }
+}
+
+double CompartmentBlock::Value() {
+    size_t n = kernel_.Size();
+    vector<double> y(n), dy(n);
+    for (size_t i = 0; i < n; ++i) y[i] = state_[i]->Value();
+    kernel_.Derivatives(y.data(), dy.data());
+    return dy[row_];
+}
+
+void CompartmentJacobian::Jacobian(vector<double>& J) {
+    size_t n = kernel_.Size();
+    y_.resize(n);
+    for (size_t i = 0; i < n; ++i) y_[i] = state_[i]->Value();
+    kernel_.Jacobian(y_.data(), J);
+}
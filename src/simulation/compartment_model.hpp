@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "integration.hpp"
+#include "parameters.hpp"
+
+// Index standing for "out" (elimination) as a flux target, and for an
+// unassigned optional role.
+const size_t kNoCompartment = static_cast<size_t>(-1);
+
+// Value of a model entry: a constant times a product and quotient of
+// ModelParameters keys (e.g. "keo / tau_e"), resolved when a kernel is built
+// so cohorts, sweeps and the optimizer keep varying the parameters.
+struct ModelExpression {
+    double constant{1.0};
+    std::vector<std::string> numerator{};
+    std::vector<std::string> denominator{};
+
+    double Evaluate(const ModelParameters& params) const;
+};
+
+struct Compartment {
+    std::string name;
+    ModelExpression volume{};  // 1 for compartments tracked as amounts
+};
+
+// One flux of a compartment model. A transfer (->) moves amount from `from`
+// to `to`: rate = k * amount for linear fluxes and Vmax x^n / (K^n + x^n)
+// (amount per hour, x the value of `from`) for Hill fluxes, divided by each
+// side's volume. A signal (=>) only drives `to` by k x or the Hill term and
+// leaves `from` untouched, as Ce drives tolerance.
+struct CompartmentFlux {
+    size_t from{0};
+    size_t to{kNoCompartment};
+    bool transfer{true};
+    bool hill{false};
+    ModelExpression rate{};  // k, or Vmax of a Hill flux
+    ModelExpression K{};
+    ModelExpression n{};
+};
+
+// A PK/PD model given as compartments and fluxes instead of the hard-wired
+// A -> C <-> P -> Ce chain of dynamics.cpp. Roles tie compartments to what
+// the rest of the simulation reads: doses go into `dose`, toxicity and
+// saturation watch `central`, the effect reads `effect` and `tolerance`.
+struct CompartmentModel {
+    std::string source;  // file it was read from, or "built-in"
+    std::vector<Compartment> compartments{};
+    std::vector<CompartmentFlux> fluxes{};
+    size_t dose{kNoCompartment};
+    size_t central{kNoCompartment};
+    size_t peripheral{kNoCompartment};  // optional; reported as P
+    size_t effect{kNoCompartment};
+    size_t tolerance{kNoCompartment};
+
+    size_t Size() const { return compartments.size(); }
+};
+
+// Reads a model description:
+//
+//   [compartments]          name [= volume], in state order
+//   [roles]                 dose|central|peripheral|effect|tolerance = name
+//   [fluxes]                from -> to = k            (to may be "out")
+//                           from -> to = mm Vmax Km
+//                           from => to = hill Vmax K n
+//
+// Values are numbers, ModelParameters keys, or products and quotients of
+// them. Errors are reported with their line and leave model unspecified.
+bool LoadCompartmentModel(const std::string& filename, CompartmentModel& model);
+
+// The model of dynamics.cpp written as a compartment model; with it the
+// kernel reproduces PkPdKernel's trajectories up to rounding.
+CompartmentModel BuiltinCompartmentModel();
+
+void PrintCompartmentModel(const CompartmentModel& model, std::ostream& out);
+
+// Sparse right-hand side of a compartment model for one parameter set,
+// split as dy/dt = L y + N(y): the linear fluxes form the constant matrix L
+// (CSR), the Hill fluxes the nonlinear part N, which only ever touches a
+// few rows. Evaluations cost O(nonzeros), not O(n^2).
+class CompartmentKernel : public SystemKernel {
+public:
+    CompartmentKernel(const CompartmentModel& model, const ModelParameters& params);
+
+    size_t Size() const override { return n_; }
+    void Derivatives(const double* y, double* dy) const override;
+    double EnglandStep(const double* y0, double h, double accuracy, double* y1) const override;
+
+    // Rows of N that can be non-zero, ascending.
+    const std::vector<size_t>& NonlinearRows() const { return nonlinear_rows_; }
+    // N(y) compacted to NonlinearRows(): g[k] is the rate into row
+    // NonlinearRows()[k].
+    void Nonlinear(const double* y, double* g) const;
+    // L as a dense row-major n x n matrix.
+    void LinearMatrix(std::vector<double>& L) const;
+    // df/dy at y, dense and row-major.
+    void Jacobian(const double* y, std::vector<double>& J) const;
+
+private:
+    struct HillTerm {
+        size_t from;
+        size_t to;         // kNoCompartment for "out"
+        size_t from_slot;  // index in nonlinear_rows_ of `from`, or kNoCompartment for signals
+        size_t to_slot;    // index in nonlinear_rows_ of `to`, or kNoCompartment for "out"
+        double from_scale;  // -1 / V_from, 0 for signals
+        double to_scale;    // 1 / V_to, 1 for signals
+        double Vmax;
+        double K;
+        double n;
+        double K_n;  // K^n
+    };
+
+    double HillRate(const HillTerm& term, double x) const;
+    double HillSlope(const HillTerm& term, double x) const;
+
+    size_t n_;
+    std::vector<size_t> row_start_{};  // n + 1 offsets into columns_ / values_
+    std::vector<size_t> columns_{};
+    std::vector<double> values_{};
+    std::vector<HillTerm> hill_{};
+    std::vector<size_t> nonlinear_rows_{};
+    mutable std::vector<double> work_{};  // RungeKuttaEnglandStep scratch
+};
+
+// Integrator input for a compartment state. Steps evaluate the whole state
+// through the kernel, so this is only reached when a stepper runs without
+// one; it gathers the state each call.
+class CompartmentBlock : public ContinuousBlock {
+public:
+    CompartmentBlock(const CompartmentKernel& kernel, const std::vector<Integrator*>& state, size_t row)
+        : kernel_(kernel), state_(state), row_(row) {}
+    double Value() override;
+
+private:
+    const CompartmentKernel& kernel_;
+    const std::vector<Integrator*>& state_;
+    size_t row_;
+};
+
+// Analytic Jacobian of a compartment model at the current values of its
+// integrators, for Rosenbrock4 and the stiffness detection.
+class CompartmentJacobian : public JacobianSource {
+public:
+    CompartmentJacobian(const CompartmentKernel& kernel, const std::vector<Integrator*>& state)
+        : kernel_(kernel), state_(state) {}
+    void Jacobian(std::vector<double>& J) override;
+
+private:
+    const CompartmentKernel& kernel_;
+    const std::vector<Integrator*>& state_;
+    std::vector<double> y_{};
+};
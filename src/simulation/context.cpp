@@ -0,0 +1,585 @@
+#include "context.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+#include "behavior_random.hpp"
+#include "monitoring.hpp"
+
+namespace {
+
+// Stability boundary of the explicit method on the negative real axis
+// (|R(z)| <= 1 for the fourth-order solution it propagates).
+const double kExplicitStabilityLimit = 2.78;
+// Hysteresis for the auto solver: go implicit when the explicit step sits
+// near its stability limit, come back once it would be well inside it.
+const double kStiffFraction = 0.7;
+const double kNonStiffFraction = 0.35;
+const int kStiffnessVotes = 5;
+// Accepted steps between two stiffness probes while no switch is pending.
+const unsigned long kStiffnessProbeInterval = 8;
+// Width of the bracket a state event is located to [h].
+const double kStateEventTolerance = 1e-6;
+
+// Infinity norm of J, an upper bound on its spectral radius.
+double JacobianNorm(const std::vector<double>& J, size_t n) {
+    double norm = 0.0;
+    for (size_t row = 0; row < n; ++row) {
+        double sum = 0.0;
+        for (size_t col = 0; col < n; ++col) sum += std::fabs(J[row * n + col]);
+        norm = std::max(norm, sum);
+    }
+    return norm;
+}
+
+// Event types a snapshot can restore; false for anything else.
+bool ClassifyEvent(ScheduledEvent* event, SnapshotEventKind& kind) {
+    if (dynamic_cast<StatusMonitor*>(event)) {
+        kind = SnapshotEventKind::StatusMonitor;
+    } else if (dynamic_cast<PatientAssessment*>(event)) {
+        kind = SnapshotEventKind::PatientAssessment;
+    } else if (dynamic_cast<NaloxoneRescue*>(event)) {
+        kind = SnapshotEventKind::NaloxoneRescue;
+    } else if (dynamic_cast<DosingEvent*>(event)) {
+        kind = SnapshotEventKind::DosingEvent;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+SimulationContext::SimulationContext(const ModelParameters& params, std::ostream& out)
+    : params_(params),
+      out_(&out),
+      step_(params.sim_step_max),
+      implicit_step_(params.sim_step_max),
+      implicit_active_(params.solver == SolverKind::Implicit),
+      dA_dt_(params_, state_),
+      dC_dt_(params_, state_),
+      dP_dt_(params_, state_),
+      dCe_dt_(params_, state_),
+      dTol_dt_(params_, state_),
+      A_(dA_dt_, params.current_dose),  // Start with initial dose in stomach
+      C_(dC_dt_, 0.0),
+      P_(dP_dt_, 0.0),
+      Ce_(dCe_dt_, 0.0),
+      Tol_(dTol_dt_, 0.0),
+      kernel_(MakeModelKernel(params_)),
+      jacobian_(params_, state_),
+      linear_(params_) {
+    stepper_.SetCounters(&perf_);
+    implicit_stepper_.SetCounters(&perf_);
+    exponential_stepper_.SetCounters(&perf_);
+    AttachBuiltin();
+
+    petri_state_.pain_level = 2;  // Start with moderate pain
+    petri_state_.motivation = 1.0;
+    petri_state_.relief_state = false;
+    petri_state_.current_dose = params_.current_dose;  // Initialize from config
+
+    CreateEvent<StatusMonitor>().Activate(time_ + params_.output_interval);
+    double first_assessment = params_.assessment_interval;
+    if (params_.stochastic_behavior) first_assessment *= DrawBehavior(params_, 0).interval_scale;
+    CreateEvent<PatientAssessment>().Activate(time_ + first_assessment);
+
+    if (params_.solver == SolverKind::Exponential) UseCompartmentModel(BuiltinCompartmentModel());
+}
+
+void SimulationContext::AttachBuiltin() {
+    state_.A = &A_;
+    state_.C = &C_;
+    state_.P = &P_;
+    state_.Ce = &Ce_;
+    state_.Tol = &Tol_;
+    stepper_.Attach({&A_, &C_, &P_, &Ce_, &Tol_});
+    stepper_.SetKernel(kernel_.get());
+    implicit_stepper_.Attach({&A_, &C_, &P_, &Ce_, &Tol_}, jacobian_);
+    implicit_stepper_.SetKernel(kernel_.get());
+    stiffness_jacobian_ = &jacobian_;
+}
+
+void SimulationContext::UseCompartmentModel(const CompartmentModel& model) {
+    params_.linear_ratio = 0.0;
+    model_ = model;
+    compartment_kernel_.reset(new CompartmentKernel(model_, params_));
+    compartment_blocks_.clear();
+    compartments_.clear();
+
+    // Role compartments keep the integrators everything else reads.
+    size_t n = model_.Size();
+    model_state_.assign(n, nullptr);
+    if (model_.peripheral != kNoCompartment) model_state_[model_.peripheral] = &P_;
+    model_state_[model_.dose] = &A_;
+    model_state_[model_.central] = &C_;
+    model_state_[model_.effect] = &Ce_;
+    model_state_[model_.tolerance] = &Tol_;
+    for (size_t i = 0; i < n; ++i) {
+        if (model_state_[i]) continue;
+        compartment_blocks_.emplace_back(new CompartmentBlock(*compartment_kernel_, model_state_, i));
+        compartments_.emplace_back(new Integrator(*compartment_blocks_.back(), 0.0));
+        model_state_[i] = compartments_.back().get();
+    }
+    for (Integrator* integrator : model_state_) *integrator = 0.0;
+    *model_state_[model_.dose] = params_.current_dose;
+    P_ = 0.0;
+
+    // A compartment holding two roles is read through both.
+    state_.A = model_state_[model_.dose];
+    state_.C = model_state_[model_.central];
+    state_.P = model_.peripheral != kNoCompartment ? model_state_[model_.peripheral] : &P_;
+    state_.Ce = model_state_[model_.effect];
+    state_.Tol = model_state_[model_.tolerance];
+
+    compartment_jacobian_.reset(new CompartmentJacobian(*compartment_kernel_, model_state_));
+    stepper_.Attach(model_state_);
+    stepper_.SetKernel(compartment_kernel_.get());
+    implicit_stepper_.Attach(model_state_, *compartment_jacobian_);
+    implicit_stepper_.SetKernel(compartment_kernel_.get());
+    exponential_stepper_.Attach(model_state_, *compartment_kernel_);
+    stiffness_jacobian_ = compartment_jacobian_.get();
+}
+
+void SimulationContext::EnableSensitivities(const std::vector<SensitivityParameter>& parameters) {
+    params_.solver = SolverKind::Explicit;
+    params_.linear_ratio = 0.0;
+    implicit_active_ = false;
+    if (compartment_kernel_) {
+        // The sensitivity equations are those of the built-in model.
+        compartment_kernel_.reset();
+        AttachBuiltin();
+    }
+    sensitivities_.reset(new ForwardSensitivities(params_, state_, parameters));
+
+    std::vector<Integrator*> integrators = {&A_, &C_, &P_, &Ce_, &Tol_};
+    for (Integrator* S : sensitivities_->Integrators()) integrators.push_back(S);
+    stepper_.Attach(integrators, 5);
+}
+
+void SimulationContext::Run() {
+    RunUntil(EndTime());
+}
+
+void SimulationContext::RunUntil(double until) {
+    while (!stopped_ && !awaiting_responder_ && time_ < EndTime()) {
+        double next = calendar_.Empty() ? EndTime() : std::min(calendar_.NextTime(), EndTime());
+        {
+            PERF_COUNT(PerfTimer timer(perf_.integration_seconds));
+            TraceSpan span(*this, TraceSpanKind::Integrate);
+            IntegrateTo(next);
+        }
+        if (time_ >= EndTime() || time_ >= until) break;
+
+        while (!stopped_ && !awaiting_responder_ && !calendar_.Empty() && calendar_.NextTime() <= time_) {
+            ScheduledEvent* event = calendar_.PopNext();
+            PERF_COUNT(SnapshotEventKind kind = SnapshotEventKind::StatusMonitor);
+            PERF_COUNT(++perf_.events[ClassifyEvent(event, kind) ? static_cast<int>(kind) : kPerfEventKinds - 1]);
+            PERF_COUNT(PerfTimer timer(perf_.event_seconds));
+            event->Behavior();
+            ++events_processed_;
+        }
+    }
+}
+
+void SimulationContext::DispatchResponder(double arrival) {
+    awaiting_responder_ = false;
+    log(LogLevel::Events) << "\n>>> EMERGENCY RESPONSE DISPATCHED (ETA: " << ((arrival - time_) * 60)
+                          << " minutes) <<<" << std::endl;
+    for (TrajectorySink* sink : sinks_) sink->OnNaloxone(time_, NaloxoneOutcome::Dispatched, 0.0);
+    AcquireEvent<NaloxoneRescue>().Activate(arrival);
+}
+
+SolverStats SimulationContext::solver_stats() const {
+    SolverStats stats = stats_;
+    stats.rhs_evaluations = restored_rhs_evaluations_ + stepper_.Evaluations() + implicit_stepper_.Evaluations() +
+                            exponential_stepper_.Evaluations();
+    stats.propagator_updates = exponential_stepper_.PropagatorUpdates();
+    stats.jacobian_evaluations =
+        restored_jacobian_evaluations_ + implicit_stepper_.JacobianEvaluations() + stiffness_jacobians_;
+    return stats;
+}
+
+bool SimulationContext::Checkpoint(SimulationSnapshot& snapshot) {
+    if (sensitivities_) return false;
+    if (compartment_kernel_ && model_state_ != std::vector<Integrator*>{&A_, &C_, &P_, &Ce_, &Tol_}) return false;
+    snapshot.events.clear();
+    for (const auto& entry : calendar_.Pending()) {
+        SimulationSnapshot::PendingEvent pending;
+        pending.time = entry.first;
+        if (!ClassifyEvent(entry.second, pending.kind)) return false;
+        snapshot.events.push_back(pending);
+    }
+
+    snapshot.time = time_;
+    snapshot.state[0] = A_.Value();
+    snapshot.state[1] = C_.Value();
+    snapshot.state[2] = P_.Value();
+    snapshot.state[3] = Ce_.Value();
+    snapshot.state[4] = Tol_.Value();
+    snapshot.step = step_;
+    snapshot.implicit_step = implicit_step_;
+    snapshot.implicit_active = implicit_active_;
+    snapshot.stiffness_votes = stiffness_votes_;
+    snapshot.stopped = stopped_;
+    snapshot.peak_C = peak_C_;
+    snapshot.stats = solver_stats();
+    snapshot.petri_state = petri_state_;
+    snapshot.monitor_flags = monitor_flags_;
+    return true;
+}
+
+void SimulationContext::Restore(const SimulationSnapshot& snapshot) {
+    time_ = snapshot.time;
+    A_ = snapshot.state[0];
+    C_ = snapshot.state[1];
+    P_ = snapshot.state[2];
+    Ce_ = snapshot.state[3];
+    Tol_ = snapshot.state[4];
+    step_ = snapshot.step;
+    implicit_step_ = snapshot.implicit_step;
+    implicit_active_ = snapshot.implicit_active;
+    stiffness_votes_ = snapshot.stiffness_votes;
+    stopped_ = snapshot.stopped;
+    peak_C_ = snapshot.peak_C;
+    stats_ = snapshot.stats;
+    restored_rhs_evaluations_ = snapshot.stats.rhs_evaluations;
+    restored_jacobian_evaluations_ = snapshot.stats.jacobian_evaluations;
+    stiffness_jacobians_ = 0;
+    linear_taken_ = 0;
+    linear_planned_ = 0;
+    petri_state_ = snapshot.petri_state;
+    monitor_flags_ = snapshot.monitor_flags;
+
+    // Events created so far are reused for the snapshot's pending ones.
+    calendar_.Clear();
+    for (const auto& pending : snapshot.events) {
+        ScheduledEvent* event = nullptr;
+        switch (pending.kind) {
+            case SnapshotEventKind::StatusMonitor:
+                event = &AcquireEvent<StatusMonitor>();
+                break;
+            case SnapshotEventKind::PatientAssessment:
+                event = &AcquireEvent<PatientAssessment>();
+                break;
+            case SnapshotEventKind::NaloxoneRescue:
+                event = &AcquireEvent<NaloxoneRescue>();
+                break;
+            case SnapshotEventKind::DosingEvent:
+                event = &AcquireEvent<DosingEvent>();
+                break;
+        }
+        event->Activate(pending.time);
+    }
+}
+
+void SimulationContext::IntegrateTo(double target) {
+    if (params_.linear_ratio > 0.0 && time_ < target && PropagateLinear(target)) return;
+
+    double before[kStateEventCount];
+    std::vector<int> fired;
+
+    while (time_ < target) {
+        unsigned long rejected = stats_.rejected_steps;
+        double start = time_;
+        bool implicit = implicit_active_;
+        bool landed = false;
+        if (params_.state_events) EvaluateStateEvents(*this, before);
+
+        if (implicit) {
+            landed = StepImplicit(target);
+        } else if (params_.solver == SolverKind::Exponential) {
+            landed = StepExponential(target);
+        } else {
+            double step_max = params_.solver == SolverKind::Explicit ? params_.sim_step_max
+                                                                      : params_.implicit_step_max;
+            landed = StepExplicit(target, step_max);
+        }
+        bool crossed = params_.state_events && LocateStateEvents(start, before, implicit, fired);
+
+        ++stats_.accepted_steps;
+        PERF_COUNT(if (!landed && !crossed) perf_.CountStep(time_ - start));
+        if (implicit) stats_.implicit_time += time_ - start;
+        double C = state_.C->Value();
+        if (C > peak_C_) peak_C_ = C;
+        if (tracer_) tracer_->AddSample(time_, time_ - start, C / params_.Km, state_.Tol->Value());
+
+        // Steps cut short by an event say nothing about the step size the
+        // problem allows.
+        if (params_.solver == SolverKind::Auto && !landed && !crossed) {
+            DetectStiffness(stats_.rejected_steps != rejected);
+        }
+
+        if (crossed) {
+            // Handlers may schedule events (naloxone) before target, so hand
+            // control back to Run() to pick the next stop again.
+            for (int event : fired) {
+                ++stats_.state_events;
+                HandleStateEvent(*this, static_cast<StateEvent>(event));
+            }
+            return;
+        }
+    }
+}
+
+bool SimulationContext::PropagateLinear(double target) {
+    double y[5] = {A_.Value(), C_.Value(), P_.Value(), Ce_.Value(), Tol_.Value()};
+
+    // The next segment of the planned jump is taken as long as nothing but
+    // the samples touched the state since the last one.
+    bool planned = false;
+    if (linear_taken_ > 0 && linear_taken_ < linear_planned_ && linear_ends_[linear_taken_] == target &&
+        linear_ends_[linear_taken_ - 1] == time_) {
+        const double* last = linear_.State(linear_taken_ - 1);
+        planned = std::equal(y, y + 5, last);
+    }
+
+    if (!planned) {
+        linear_taken_ = 0;
+        linear_planned_ = 0;
+        // A cheap test first: the interval starts in the regime.
+        if (C_.Value() / params_.Km > params_.linear_ratio) {
+            ++stats_.numerical_intervals;
+            return false;
+        }
+
+        // The jump runs to the next event that changes the state. The
+        // StatusMonitor only samples it, every output_interval from its next
+        // time, and is fed from the closed form on the way.
+        double horizon = EndTime();
+        double sample = HUGE_VAL;
+        calendar_.ForEach([&](double time, ScheduledEvent* event) {
+            if (dynamic_cast<StatusMonitor*>(event)) {
+                sample = std::min(sample, time);
+            } else {
+                horizon = std::min(horizon, time);
+            }
+        });
+        linear_ends_.clear();
+        if (params_.output_interval > 0.0) {
+            for (; sample < horizon; sample += params_.output_interval) linear_ends_.push_back(sample);
+        }
+        linear_ends_.push_back(horizon);
+        if (linear_ends_.front() != target) linear_ends_.assign(1, target);
+
+        double before[kStateEventCount];
+        if (params_.state_events) EvaluateStateEvents(params_, y[1], y[3], y[4], before);
+        // A threshold crossed inside the jump has to be located by the
+        // integrator, so the jump ends at the last sample before one.
+        auto accept_sample = [&](const double sample[5]) {
+            if (!params_.state_events) return true;
+            double after[kStateEventCount];
+            EvaluateStateEvents(params_, sample[1], sample[3], sample[4], after);
+            for (int k = 0; k < kStateEventCount; ++k) {
+                if (before[k] <= 0.0 && after[k] > 0.0) return false;
+            }
+            std::copy(after, after + kStateEventCount, before);
+            return true;
+        };
+
+        LinearInterval info;
+        linear_planned_ = linear_.Propagate(time_, linear_ends_, y, info, accept_sample);
+
+        std::ostream& out = log(LogLevel::Trace);
+        std::ios::fmtflags flags = out.flags();
+        std::streamsize precision = out.precision();
+        double end = linear_planned_ > 0 ? linear_ends_[linear_planned_ - 1] : target;
+        out << std::fixed << std::setprecision(2) << "  [regime] t=" << time_ << "-" << end << "h "
+            << (linear_planned_ > 0 ? "linear" : "numerical") << " (" << linear_planned_ << " of "
+            << linear_ends_.size() << " samples), C/Km " << std::setprecision(4) << info.max_ratio
+            << std::scientific << std::setprecision(1) << ", bound " << info.error_bound << std::endl;
+        out.flags(flags);
+        out.precision(precision);
+
+        if (linear_planned_ == 0) {
+            ++stats_.numerical_intervals;
+            return false;
+        }
+    }
+
+    size_t k = linear_taken_++;
+    const double* next = linear_.State(k);
+    double start = time_;
+    A_ = next[0];
+    C_ = next[1];
+    P_ = next[2];
+    Ce_ = next[3];
+    Tol_ = next[4];
+    time_ = target;
+    ++stats_.linear_intervals;
+    stats_.linear_time += target - start;
+    stats_.linear_error_bound += linear_.ErrorBound(k) - (k > 0 ? linear_.ErrorBound(k - 1) : 0.0);
+    if (linear_.PeakC(k) > peak_C_) peak_C_ = linear_.PeakC(k);
+    if (tracer_) tracer_->AddSample(time_, target - start, C_.Value() / params_.Km, Tol_.Value());
+    return true;
+}
+
+bool SimulationContext::LocateStateEvents(double start, const double before[], bool implicit,
+                                          std::vector<int>& fired) {
+    double after[kStateEventCount];
+    auto crossed = [&]() {
+        EvaluateStateEvents(*this, after);
+        for (int k = 0; k < kStateEventCount; ++k) {
+            if (before[k] <= 0.0 && after[k] > 0.0) return true;
+        }
+        return false;
+    };
+    if (!crossed()) return false;
+
+    // Bisect on the step length: every trial re-integrates from the start of
+    // the step, so the located state is as accurate as a regular step.
+    double h = time_ - start;
+    double lo = 0.0;
+    double hi = h;
+    double current = h;  // step length the integrators currently hold
+    while (hi - lo > kStateEventTolerance) {
+        double mid = 0.5 * (lo + hi);
+        Restep(mid, implicit);
+        current = mid;
+        if (crossed()) {
+            hi = mid;
+        } else {
+            lo = mid;
+        }
+    }
+    if (current != hi) Restep(hi, implicit);
+    if (hi < h) time_ = start + hi;
+
+    EvaluateStateEvents(*this, after);
+    fired.clear();
+    for (int k = 0; k < kStateEventCount; ++k) {
+        if (before[k] <= 0.0 && after[k] > 0.0) fired.push_back(k);
+    }
+    return true;
+}
+
+void SimulationContext::Restep(double h, bool implicit) {
+    if (implicit) {
+        implicit_stepper_.Reject();
+        implicit_stepper_.Step(h, params_.sim_accuracy);
+    } else if (params_.solver == SolverKind::Exponential) {
+        exponential_stepper_.Reject();
+        exponential_stepper_.Step(h, params_.sim_accuracy);
+    } else {
+        stepper_.Reject();
+        stepper_.Step(h, params_.sim_accuracy);
+    }
+}
+
+bool SimulationContext::StepExplicit(double target, double step_max) {
+    const double step_min = params_.sim_step_min;
+
+    double remaining = target - time_;
+    double h = std::min(step_, remaining);
+    bool last = h >= remaining;
+
+    // Halve until the error fits; at step_min the step is taken anyway.
+    double error_ratio = stepper_.Step(h, params_.sim_accuracy);
+    while (error_ratio > 1.0 && h > step_min) {
+        stepper_.Reject();
+        ++stats_.rejected_steps;
+        h = std::max(h / 2.0, step_min);
+        step_ = h;
+        last = false;
+        error_ratio = stepper_.Step(h, params_.sim_accuracy);
+    }
+
+    // Land exactly on the target so events see the scheduled time.
+    time_ = last ? target : time_ + h;
+
+    if (error_ratio < 1.0 / 64.0 && h >= step_) {
+        step_ = std::min(step_ * 2.0, step_max);
+    }
+    return last;
+}
+
+bool SimulationContext::StepExponential(double target) {
+    const double step_min = params_.sim_step_min;
+
+    double remaining = target - time_;
+    double h = std::min(step_, remaining);
+    bool last = h >= remaining;
+
+    // Halving and doubling keep h on a grid of step_max / 2^k, for which
+    // the stepper has its matrix functions cached.
+    double error_ratio = exponential_stepper_.Step(h, params_.sim_accuracy);
+    while (error_ratio > 1.0 && h > step_min) {
+        exponential_stepper_.Reject();
+        ++stats_.rejected_steps;
+        h = std::max(h / 2.0, step_min);
+        step_ = h;
+        last = false;
+        error_ratio = exponential_stepper_.Step(h, params_.sim_accuracy);
+    }
+
+    time_ = last ? target : time_ + h;
+
+    // The estimate is third order: doubling h multiplies it by about 8.
+    if (error_ratio < 1.0 / 16.0 && h >= step_) {
+        step_ = std::min(step_ * 2.0, params_.implicit_step_max);
+    }
+    return last;
+}
+
+bool SimulationContext::StepImplicit(double target) {
+    const double step_min = params_.sim_step_min;
+    const double step_max = params_.implicit_step_max;
+
+    double remaining = target - time_;
+    double h = std::min(implicit_step_, remaining);
+    bool last = h >= remaining;
+
+    // Standard controller for an order-4 method with order-3 error estimate.
+    double error_ratio = implicit_stepper_.Step(h, params_.sim_accuracy);
+    while (error_ratio > 1.0 && h > step_min) {
+        implicit_stepper_.Reject();
+        ++stats_.rejected_steps;
+        double shrink = std::isinf(error_ratio) ? 0.25 : std::max(0.9 * std::pow(error_ratio, -1.0 / 3.0), 0.25);
+        h = std::max(h * shrink, step_min);
+        implicit_step_ = h;
+        last = false;
+        error_ratio = implicit_stepper_.Step(h, params_.sim_accuracy);
+    }
+
+    time_ = last ? target : time_ + h;
+
+    double grow = error_ratio > 0.0 ? std::min(0.9 * std::pow(error_ratio, -0.25), 4.0) : 4.0;
+    double proposed = std::min(h * grow, step_max);
+    // A step shortened to hit an event keeps the size the controller had.
+    implicit_step_ = last ? std::max(implicit_step_, proposed) : std::max(proposed, step_min);
+    return last;
+}
+
+void SimulationContext::DetectStiffness(bool rejected) {
+    // The spectral radius moves with the state, not from step to step, so a
+    // Jacobian is only paid for every kStiffnessProbeInterval-th step, after
+    // a rejection, and on every step once a vote is pending. Keying the
+    // probes to the step count and the votes keeps them in the same place
+    // when a run is restored from a snapshot.
+    bool probe = rejected || stiffness_votes_ > 0 || stats_.accepted_steps % kStiffnessProbeInterval == 0;
+    if (!probe) return;
+    stiffness_jacobian_->Jacobian(stiffness_J_);
+    ++stiffness_jacobians_;
+    double radius = JacobianNorm(stiffness_J_, compartment_kernel_ ? model_state_.size() : 5);
+
+    bool vote;
+    if (implicit_active_) {
+        // Would the explicit method be comfortably stable at this step size?
+        vote = implicit_step_ * radius < kNonStiffFraction * kExplicitStabilityLimit;
+    } else {
+        // Is the explicit step being held back by stability?
+        vote = rejected || step_ * radius >= kStiffFraction * kExplicitStabilityLimit;
+    }
+    stiffness_votes_ = vote ? stiffness_votes_ + 1 : 0;
+    if (stiffness_votes_ < kStiffnessVotes) return;
+
+    stiffness_votes_ = 0;
+    ++stats_.stiffness_switches;
+    if (implicit_active_) {
+        step_ = std::max(std::min(implicit_step_, params_.implicit_step_max), params_.sim_step_min);
+    } else {
+        implicit_step_ = step_;
+    }
+    implicit_active_ = !implicit_active_;
+}
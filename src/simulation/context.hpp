@@ -0,0 +1,283 @@
+#pragma once
+
+#include <iostream>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "../logging/log_level.hpp"
+#include "behavior.hpp"
+#include "calendar.hpp"
+#include "compartment_model.hpp"
+#include "dynamics.hpp"
+#include "exponential_integrator.hpp"
+#include "forward_sensitivity.hpp"
+#include "integration.hpp"
+#include "linear_propagator.hpp"
+#include "model_kernel.hpp"
+#include "monitoring_support.hpp"
+#include "outcome_detection.hpp"
+#include "parameters.hpp"
+#include "perf_counters.hpp"
+#include "trace.hpp"
+#include "trajectory_sink.hpp"
+
+// Integration work done by one run.
+struct SolverStats {
+    unsigned long accepted_steps{0};
+    unsigned long rejected_steps{0};
+    unsigned long rhs_evaluations{0};
+    unsigned long jacobian_evaluations{0};
+    unsigned long stiffness_switches{0};
+    unsigned long state_events{0};  // threshold crossings located inside steps
+    double implicit_time{0.0};  // simulated hours advanced by the implicit method
+    // Closed-form propagation (linear_ratio > 0): intervals between events
+    // that were jumped over or had to be integrated, and the summed error
+    // estimates of the jumps.
+    unsigned long linear_intervals{0};
+    unsigned long numerical_intervals{0};
+    double linear_time{0.0};
+    double linear_error_bound{0.0};
+    // Step sizes the exponential solver computed exp(hL) for (not kept in
+    // snapshots).
+    unsigned long propagator_updates{0};
+};
+
+// Scheduled event types a snapshot can hold.
+enum class SnapshotEventKind : int {
+    StatusMonitor = 0,
+    PatientAssessment = 1,
+    NaloxoneRescue = 2,
+    DosingEvent = 3,
+};
+
+// Everything a run carries from one instant to the next: the clock, the
+// continuous state and step-size control, the pending events, the Petri net
+// marking (with the dose history) and the monitor flags. Parameters are not
+// part of it, so a snapshot can continue under different ones.
+struct SimulationSnapshot {
+    struct PendingEvent {
+        SnapshotEventKind kind;
+        double time;
+    };
+
+    double time{0.0};
+    double state[5]{};  // A, C, P, Ce, Tol
+    double step{0.0};
+    double implicit_step{0.0};
+    bool implicit_active{false};
+    int stiffness_votes{0};
+    bool stopped{false};
+    double peak_C{0.0};
+    SolverStats stats{};
+    PetriNetState petri_state{};
+    MonitorFlags monitor_flags{};
+    std::vector<PendingEvent> events{};  // in the order they will run
+};
+
+// One self-contained simulation run: owns the clock, the event calendar, the
+// continuous state (A, C, P, Ce, Tol), the Petri net marking and the monitor
+// flags. Nothing is shared between contexts, so any number of them can run
+// back to back or concurrently on different threads.
+class SimulationContext {
+public:
+    explicit SimulationContext(const ModelParameters& params, std::ostream& out = std::cout);
+
+    SimulationContext(const SimulationContext&) = delete;
+    SimulationContext& operator=(const SimulationContext&) = delete;
+
+    void Run();
+    // Runs until the first stop at or after `until` (an event time or the
+    // end) and returns with the events due then still pending. Run() or a
+    // restored snapshot taken here continues exactly as an uninterrupted run.
+    void RunUntil(double until);
+    void Stop() { stopped_ = true; }
+
+    // Fails (returns false) when an event of another type is pending,
+    // sensitivities are enabled or a compartment model has other states than
+    // A, C, P, Ce, Tol, none of which a snapshot can hold.
+    bool Checkpoint(SimulationSnapshot& snapshot);
+    // Replaces the whole run state, pending events included, with the
+    // snapshot's; meant for a context that has not run yet. The parameters
+    // stay this context's own.
+    void Restore(const SimulationSnapshot& snapshot);
+
+    double Time() const { return time_; }
+    double EndTime() const { return params_.sim_duration; }
+    bool Stopped() const { return stopped_; }
+    // Highest C seen at any accepted integration step.
+    double PeakConcentration() const { return peak_C_; }
+    // Calendar events run by this context (not counting a restored prefix).
+    unsigned long EventsProcessed() const { return events_processed_; }
+    SolverStats solver_stats() const;
+    // Zero unless built with PERF_COUNTERS; block_evaluations follow the
+    // order A, C, P, Ce, Tol, then any sensitivities.
+    const PerfCounters& perf_counters() const { return perf_; }
+
+    void Schedule(ScheduledEvent& event, double time) { calendar_.Schedule(event, time); }
+    void CancelEvent(ScheduledEvent& event) { calendar_.Cancel(event); }
+
+    // Events created here live as long as the context.
+    template <typename T, typename... Args>
+    T& CreateEvent(Args&&... args) {
+        T* event = new T(*this, std::forward<Args>(args)...);
+        events_.emplace_back(event);
+        return *event;
+    }
+
+    // An event of type T that is not scheduled, reusing one created earlier
+    // when there is one, so recurring one-shot events (naloxone rescues,
+    // restored events) do not allocate each time.
+    template <typename T>
+    T& AcquireEvent() {
+        for (const auto& event : events_) {
+            T* idle = dynamic_cast<T*>(event.get());
+            if (idle && !idle->Scheduled()) return *idle;
+        }
+        return CreateEvent<T>();
+    }
+
+    // With shared responders (sim responders) an overdose places a call
+    // instead of dispatching a dedicated team after naloxone_response_delay,
+    // and the run pauses until DispatchResponder assigns one.
+    void UseSharedResponders() { shared_responders_ = true; }
+    bool shared_responders() const { return shared_responders_; }
+    void RequestResponder() { awaiting_responder_ = true; }
+    bool AwaitingResponder() const { return awaiting_responder_; }
+    // The responder arrives at `arrival` (>= Time()); Run() continues.
+    void DispatchResponder(double arrival);
+
+    const ModelParameters& params() const { return params_; }
+    // The right-hand side and effect specialized for these parameters.
+    const ModelKernel& kernel() const { return *kernel_; }
+    SimulationState& state() { return state_; }
+    const SimulationState& state() const { return state_; }
+    PetriNetState& petri_state() { return petri_state_; }
+    const PetriNetState& petri_state() const { return petri_state_; }
+    MonitorFlags& monitor_flags() { return monitor_flags_; }
+    std::ostream& out() { return *out_; }
+
+    // out() when level is enabled, otherwise a stream that discards (and
+    // skips formatting of) everything written to it.
+    std::ostream& log(LogLevel level) { return level <= log_level_ ? *out_ : null_out_; }
+    void SetLogLevel(LogLevel level) { log_level_ = level; }
+    LogLevel log_level() const { return log_level_; }
+
+    // Sinks are not owned and must outlive Run().
+    void AddTrajectorySink(TrajectorySink& sink) { sinks_.push_back(&sink); }
+    const std::vector<TrajectorySink*>& trajectory_sinks() const { return sinks_; }
+
+    // Records integration segments, handler spans and per-step counters
+    // into recorder (not owned, must outlive Run()).
+    void SetTracer(TraceRecorder& recorder) { tracer_ = &recorder; }
+    // nullptr unless tracing.
+    TraceRecorder* tracer() { return tracer_; }
+
+    // Integrates d state / d p for the given parameters alongside the state,
+    // from now on. The sensitivities are only defined for the explicit
+    // method without closed-form intervals, so both are forced. Call before
+    // Run().
+    void EnableSensitivities(const std::vector<SensitivityParameter>& parameters);
+    // nullptr unless EnableSensitivities was called.
+    ForwardSensitivities* sensitivities() { return sensitivities_.get(); }
+
+    // Integrates model instead of the built-in equations from now on; its
+    // role compartments become A, C, P, Ce and Tol for the rest of the run,
+    // and the dose compartment starts with the initial dose. Closed-form
+    // intervals assume the built-in model and are switched off. Call before
+    // Run(). The exponential solver uses the built-in model unless given one.
+    void UseCompartmentModel(const CompartmentModel& model);
+    // nullptr while the built-in equations are integrated.
+    const CompartmentModel* compartment_model() const { return compartment_kernel_ ? &model_ : nullptr; }
+
+    // Fed by PatientAssessment when outcome_detection is set.
+    OutcomeDetector& outcome_detector() { return outcome_detector_; }
+    const OutcomePrediction& outcome_prediction() const { return outcome_detector_.prediction(); }
+
+private:
+    // Steppers on A, C, P, Ce, Tol through the built-in kernel.
+    void AttachBuiltin();
+    void IntegrateTo(double target);
+    // Reaches target in closed form when the interval is in the linear
+    // regime; returns false, leaving the state alone, when it is not. A jump
+    // is planned up to the next event other than a StatusMonitor sample and
+    // taken one sample at a time.
+    bool PropagateLinear(double target);
+    // One accepted step towards target; return true when the step was cut
+    // short to land on target.
+    bool StepExplicit(double target, double step_max);
+    bool StepImplicit(double target);
+    bool StepExponential(double target);
+    void DetectStiffness(bool rejected);
+    // Checks the step just taken from start for threshold crossings. On a
+    // crossing the step is shortened to end just past the earliest one and
+    // the crossed events are returned in fired.
+    bool LocateStateEvents(double start, const double before[], bool implicit, std::vector<int>& fired);
+    void Restep(double h, bool implicit);
+
+    ModelParameters params_;
+    std::ostream* out_;
+    std::ostream null_out_{nullptr};
+    LogLevel log_level_{LogLevel::Trace};
+    double time_{0.0};
+    double step_{};
+    double implicit_step_{};
+    bool implicit_active_{false};
+    int stiffness_votes_{0};
+    // Jacobians probed by DetectStiffness, and the buffer they go into.
+    unsigned long stiffness_jacobians_{0};
+    std::vector<double> stiffness_J_{};
+    SolverStats stats_{};
+    // Evaluations done before a restored snapshot was taken.
+    unsigned long restored_rhs_evaluations_{0};
+    unsigned long restored_jacobian_evaluations_{0};
+    bool stopped_{false};
+    bool shared_responders_{false};
+    bool awaiting_responder_{false};
+    double peak_C_{0.0};
+    unsigned long events_processed_{0};
+    PerfCounters perf_{};
+
+    AbsorptionDynamics dA_dt_;
+    CentralDynamics dC_dt_;
+    PeripheralDynamics dP_dt_;
+    EffectSiteDynamics dCe_dt_;
+    ToleranceDynamics dTol_dt_;
+
+    Integrator A_;
+    Integrator C_;
+    Integrator P_;
+    Integrator Ce_;
+    Integrator Tol_;
+
+    SimulationState state_{};
+    PetriNetState petri_state_{};
+    MonitorFlags monitor_flags_{};
+    OutcomeDetector outcome_detector_{};
+
+    std::unique_ptr<ModelKernel> kernel_;
+    PkPdJacobian jacobian_;
+    LinearPropagator linear_;
+    // Segment end times of the planned jump, how many of them the plan
+    // covers and how many have been taken.
+    std::vector<double> linear_ends_{};
+    size_t linear_taken_{0};
+    size_t linear_planned_{0};
+    std::unique_ptr<ForwardSensitivities> sensitivities_{};
+    // Compartment model: the role states are the integrators above, the
+    // others are owned here; model_state_ lists all of them in model order.
+    CompartmentModel model_{};
+    std::unique_ptr<CompartmentKernel> compartment_kernel_{};
+    std::unique_ptr<CompartmentJacobian> compartment_jacobian_{};
+    std::vector<std::unique_ptr<CompartmentBlock>> compartment_blocks_{};
+    std::vector<std::unique_ptr<Integrator>> compartments_{};
+    std::vector<Integrator*> model_state_{};
+    JacobianSource* stiffness_jacobian_{nullptr};
+    RungeKuttaEngland stepper_{};
+    Rosenbrock4 implicit_stepper_{};
+    ExponentialRK4 exponential_stepper_{};
+    Calendar calendar_{};
+    std::vector<std::unique_ptr<ScheduledEvent>> events_{};
+    std::vector<TrajectorySink*> sinks_{};
+    TraceRecorder* tracer_{nullptr};
+};
@@ -3,4 +3,14 @@
 #include "behavior.hpp"
 #include "parameters.hpp"
 
-bool ShouldIncreaseDose(double effect, const ModelParameters& params, PetriNetState& petri_state);
+#include <ostream>
+
+// With stochastic_behavior the motivation threshold becomes a probability:
+// the patient escalates when escalation_draw (uniform on (0, 1)) is below
+// EscalationProbability; otherwise the draw is ignored.
+bool ShouldIncreaseDose(double effect, const ModelParameters& params, PetriNetState& petri_state,
+                        double escalation_draw, std::ostream& out);
+
+// Logistic in motivation, 1/2 at motivation_threshold, steepness
+// escalation_slope.
+double EscalationProbability(double motivation, const ModelParameters& params);
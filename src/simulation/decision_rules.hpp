@@ -0,0 +1,64 @@
+#pragma once
+
+#include <algorithm>
+
+#include "parameters.hpp"
+
+// The Petri-net rules as pure functions of the marking. The scalar
+// transitions (pain_assessment, dose_management, forward_sensitivity) and the
+// batched engine all evaluate them from here, so the two engines cannot drift.
+
+constexpr double kMinEscalationFactor = 0.01;
+constexpr double kMaxEscalationFactor = 0.50;
+
+// 0 = no pain ... 3 = severe, from the (perceived) effect in %.
+inline int PainLevelFromEffect(double effect) {
+    return effect > 80.0 ? 0 : effect > 60.0 ? 1 : effect > 40.0 ? 2 : 3;
+}
+
+inline bool ReliefAtPainLevel(int pain_level) { return pain_level <= 1; }
+
+inline double MotivationCap(int pain_level) {
+    return 5.0 + (2.0 * (static_cast<double>(pain_level) / 3.0));
+}
+
+// Motivation after dt hours at pain_level: grows with pain, decays under
+// relief, then held between 0.5 and MotivationCap.
+inline double UpdatedMotivation(double motivation, int pain_level, bool relief, double dt,
+                                const ModelParameters& params) {
+    double pain_severity = static_cast<double>(pain_level) / 3.0;
+    motivation += params.motivation_pain_rate * pain_severity * dt;
+    if (relief && pain_level <= 1) motivation *= 1.0 - params.motivation_decay_rate;
+    motivation = std::min(motivation, MotivationCap(pain_level));
+    return std::max(motivation, 0.5);
+}
+
+// An escalation spends motivation_dose_reduction, never below zero.
+inline double MotivationAfterEscalation(double motivation, const ModelParameters& params) {
+    return std::max(motivation - params.motivation_dose_reduction, 0.0);
+}
+
+// base + factor * Tol (Tol clamped at 0), clamped to [0.01, 0.50].
+inline double EscalationFactor(double Tol, const ModelParameters& params) {
+    double factor = params.base_escalation_factor + params.tolerance_escalation_factor * std::max(Tol, 0.0);
+    return std::min(std::max(factor, kMinEscalationFactor), kMaxEscalationFactor);
+}
+
+inline bool ExceedsMaxDose(double dose, const ModelParameters& params) {
+    return params.max_dose > 0.0 && dose > params.max_dose;
+}
+
+// The escalated dose, capped at max_dose; a dose already above the cap is kept.
+inline double EscalatedDose(double dose, double factor, const ModelParameters& params) {
+    double escalated = dose * (1.0 + factor);
+    return ExceedsMaxDose(escalated, params) ? std::max(dose, params.max_dose) : escalated;
+}
+
+inline bool Tapering(double t, const ModelParameters& params) {
+    return params.taper_factor > 0.0 && t >= params.taper_start;
+}
+
+// The dose a maintenance transition at time t gives.
+inline double MaintainedDose(double dose, double t, const ModelParameters& params) {
+    return Tapering(t, params) ? dose * (1.0 - params.taper_factor) : dose;
+}
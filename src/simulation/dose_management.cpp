@@ -1,82 +1,124 @@
 #include "dose_management.hpp"
 
-#include <simlib.h>
-
+#include <algorithm>
 #include <iomanip>
 #include <iostream>
 
-using std::cout;
+#include "context.hpp"
+#include "decision_rules.hpp"
+
 using std::endl;
 using std::fixed;
 using std::setprecision;
 
-void ExecuteDoseIncrease(const ModelParameters& params, SimulationState& cont_state, PetriNetState& petri_state) {
-    cout << "\n>>> DECISION: INCREASE DOSE (Transition T2) <<<" << endl;
+void ExecuteDoseIncrease(SimulationContext& ctx) {
+    TraceSpan span(ctx, TraceSpanKind::DoseIncrease);
+    const ModelParameters& params = ctx.params();
+    SimulationState& cont_state = ctx.state();
+    PetriNetState& petri_state = ctx.petri_state();
+    std::ostream& out = ctx.log(LogLevel::Events);
+
+    out << "\n>>> DECISION: INCREASE DOSE (Transition T2) <<<" << endl;
     
     if (!cont_state.A || !cont_state.C || !cont_state.Ce || !cont_state.Tol) {
         std::cerr << "ERROR: State not initialized!" << endl;
         petri_state.patient_alive = false;
-        Stop();
+        ctx.Stop();
         return;
     }
     
-    double Tol_val = cont_state.Tol->Value();
-    if (Tol_val < 0.0) Tol_val = 0.0;
-    
-    double escalation_factor = params.base_escalation_factor +
-                               params.tolerance_escalation_factor * Tol_val;
-    
-    if (escalation_factor < 0.01) escalation_factor = 0.01;
-    if (escalation_factor > 0.50) escalation_factor = 0.50;
+    double Tol_val = std::max(cont_state.Tol->Value(), 0.0);
+    double escalation_factor = EscalationFactor(Tol_val, params);
     
     double old_dose = petri_state.current_dose;
-    double new_dose = old_dose * (1.0 + escalation_factor);
+    double new_dose = EscalatedDose(old_dose, escalation_factor, params);
+    bool capped = ExceedsMaxDose(old_dose * (1.0 + escalation_factor), params);
     
-    cout << "Tolerance Level: " << fixed << setprecision(4) << Tol_val << endl;
-    cout << "Escalation Factor: " << (escalation_factor * 100.0) << "%" << endl;
-    cout << "Old Dose: " << setprecision(2) << old_dose << " mg" << endl;
-    cout << "New Dose: " << new_dose << " mg" << endl;
-    cout << "Dose Increase: +" << (new_dose - old_dose) << " mg (+";
-    cout << setprecision(2) << ((new_dose / old_dose - 1.0) * 100.0) << "%" << endl;
+    out << "Tolerance Level: " << fixed << setprecision(4) << Tol_val << endl;
+    out << "Escalation Factor: " << (escalation_factor * 100.0) << "%" << endl;
+    out << "Old Dose: " << setprecision(2) << old_dose << " mg" << endl;
+    out << "New Dose: " << new_dose << " mg" << endl;
+    if (capped) out << "Capped at max_dose = " << params.max_dose << " mg" << endl;
+    out << "Dose Increase: +" << (new_dose - old_dose) << " mg (+";
+    out << setprecision(2) << ((new_dose / old_dose - 1.0) * 100.0) << "%" << endl;
     
     double current_A = cont_state.A->Value();
     if (current_A > 0.1) {
-        cout << "WARNING: Previous dose still absorbing (" << current_A 
-             << " mg in stomach). Dose stacking!" << endl;
+        out << "WARNING: Previous dose still absorbing (" << current_A 
+            << " mg in stomach). Dose stacking!" << endl;
     }
     
     *cont_state.A = current_A + new_dose;
+    if (ForwardSensitivities* sensitivities = ctx.sensitivities()) {
+        sensitivities->EscalateDose(old_dose);
+        sensitivities->AddDose();
+    }
     
     petri_state.current_dose = new_dose;
     
-    petri_state.motivation -= params.motivation_dose_reduction;
-    if (petri_state.motivation < 0.0) petri_state.motivation = 0.0;
+    petri_state.motivation = MotivationAfterEscalation(petri_state.motivation, params);
     
     petri_state.time_since_last_dose = 0.0;
     petri_state.relief_state = true;
     
-    RecordDoseEvent(new_dose, params, cont_state, petri_state);
+    RecordDoseEvent(ctx, new_dose);
     
-    cout << "================================================" << endl;
+    out << "================================================" << endl;
 }
 
-void MaintainDose(const ModelParameters& params, SimulationState& cont_state, PetriNetState& petri_state) {
-    cout << "\n>>> DECISION: MAINTAIN CURRENT DOSE (Transition T3) <<<" << endl;
-    cout << "Current dose: " << petri_state.current_dose << " mg" << endl;
+void MaintainDose(SimulationContext& ctx) {
+    const ModelParameters& params = ctx.params();
+    SimulationState& cont_state = ctx.state();
+    PetriNetState& petri_state = ctx.petri_state();
+    std::ostream& out = ctx.log(LogLevel::Events);
+
+    out << "\n>>> DECISION: MAINTAIN CURRENT DOSE (Transition T3) <<<" << endl;
+    if (Tapering(ctx.Time(), params)) {
+        petri_state.current_dose = MaintainedDose(petri_state.current_dose, ctx.Time(), params);
+        if (ForwardSensitivities* sensitivities = ctx.sensitivities()) {
+            sensitivities->ScaleDose(1.0 - params.taper_factor);
+        }
+        out << "Tapered by " << (params.taper_factor * 100.0) << "%" << endl;
+    }
+    out << "Current dose: " << petri_state.current_dose << " mg" << endl;
     
     double current_A = cont_state.A->Value();
     *cont_state.A = current_A + petri_state.current_dose;
+    if (ForwardSensitivities* sensitivities = ctx.sensitivities()) sensitivities->AddDose();
     
     petri_state.time_since_last_dose = 0.0;
     
-    RecordDoseEvent(petri_state.current_dose, params, cont_state, petri_state);
+    RecordDoseEvent(ctx, petri_state.current_dose);
     
-    cout << "================================================" << endl;
+    out << "================================================" << endl;
+}
+
+void TakeExtraDose(SimulationContext& ctx) {
+    SimulationState& cont_state = ctx.state();
+    PetriNetState& petri_state = ctx.petri_state();
+    std::ostream& out = ctx.log(LogLevel::Events);
+
+    out << "\n>>> DECISION: EXTRA DOSE (unplanned) <<<" << endl;
+    out << "Current dose: " << petri_state.current_dose << " mg" << endl;
+
+    *cont_state.A = cont_state.A->Value() + petri_state.current_dose;
+    if (ForwardSensitivities* sensitivities = ctx.sensitivities()) sensitivities->AddDose();
+
+    petri_state.time_since_last_dose = 0.0;
+
+    RecordDoseEvent(ctx, petri_state.current_dose);
+
+    out << "================================================" << endl;
 }
 
-void RecordDoseEvent(double dose, const ModelParameters& params, SimulationState& cont_state, PetriNetState& petri_state) {
+void RecordDoseEvent(SimulationContext& ctx, double dose) {
+    const ModelParameters& params = ctx.params();
+    SimulationState& cont_state = ctx.state();
+    PetriNetState& petri_state = ctx.petri_state();
+    std::ostream& out = ctx.log(LogLevel::Events);
+
     PetriNetState::DoseRecord record;
-    record.time = Time;
+    record.time = ctx.Time();
     record.dose = dose;
     record.C = cont_state.C->Value();
     record.Ce = cont_state.Ce->Value();
@@ -84,13 +126,16 @@ void RecordDoseEvent(double dose, const ModelParameters& params, SimulationState
     record.effect = CalculateEffect(cont_state.Ce->Value(), cont_state.Tol->Value(), params);
     
     petri_state.dose_history.push_back(record);
+    for (TrajectorySink* sink : ctx.trajectory_sinks()) {
+        sink->OnDose(record, petri_state.dose_history.size());
+    }
     
-    cout << "\n--- DOSE ADMINISTERED ---" << endl;
-    cout << "Time: " << record.time << " h" << endl;
-    cout << "Dose: " << record.dose << " mg" << endl;
-    cout << "C(t): " << record.C << " mg/L" << endl;
-    cout << "Ce(t): " << record.Ce << " mg/L" << endl;
-    cout << "Tol(t): " << record.Tol << endl;
-    cout << "Effect: " << record.effect << "%" << endl;
-    cout << "Total doses given: " << petri_state.dose_history.size() << endl;
+    out << "\n--- DOSE ADMINISTERED ---" << endl;
+    out << "Time: " << record.time << " h" << endl;
+    out << "Dose: " << record.dose << " mg" << endl;
+    out << "C(t): " << record.C << " mg/L" << endl;
+    out << "Ce(t): " << record.Ce << " mg/L" << endl;
+    out << "Tol(t): " << record.Tol << endl;
+    out << "Effect: " << record.effect << "%" << endl;
+    out << "Total doses given: " << petri_state.dose_history.size() << endl;
 }
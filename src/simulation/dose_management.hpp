@@ -4,6 +4,10 @@
 #include "dynamics.hpp"
 #include "parameters.hpp"
 
-void ExecuteDoseIncrease(const ModelParameters& params, SimulationState& cont_state, PetriNetState& petri_state);
-void MaintainDose(const ModelParameters& params, SimulationState& cont_state, PetriNetState& petri_state);
-void RecordDoseEvent(double dose, const ModelParameters& params, SimulationState& cont_state, PetriNetState& petri_state);
+class SimulationContext;
+
+void ExecuteDoseIncrease(SimulationContext& ctx);
+void MaintainDose(SimulationContext& ctx);
+// Unplanned dose at the current level (stochastic behavior); no taper.
+void TakeExtraDose(SimulationContext& ctx);
+void RecordDoseEvent(SimulationContext& ctx, double dose);
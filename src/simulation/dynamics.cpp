@@ -31,3 +31,26 @@ double ToleranceDynamics::Value() {
     double signal = ToleranceSignal(state_.Ce->Value(), params_);
     return params_.kin * signal - params_.kout * state_.Tol->Value();
 }
+
+void PkPdJacobian::Jacobian(std::vector<double>& J) {
+    const size_t n = 5;
+    J.assign(n * n, 0.0);
+    double C = state_.C->Value();
+    double Ce = state_.Ce->Value();
+    double ke = params_.keo / params_.tau_e;
+
+    J[0 * n + 0] = -params_.ka;
+
+    J[1 * n + 0] = params_.ka / params_.Vd;
+    J[1 * n + 1] = -MichaelisMentenSlope(C, params_) / params_.Vd - params_.kcp;
+    J[1 * n + 2] = params_.kpc;
+
+    J[2 * n + 1] = params_.kcp;
+    J[2 * n + 2] = -params_.kpc;
+
+    J[3 * n + 1] = ke;
+    J[3 * n + 3] = -ke;
+
+    J[4 * n + 3] = params_.kin * ToleranceSignalSlope(Ce, params_);
+    J[4 * n + 4] = -params_.kout;
+}
@@ -1,7 +1,8 @@
 #pragma once
 
-#include <simlib.h>
+#include <vector>
 
+#include "integration.hpp"
 #include "parameters.hpp"
 
 struct SimulationState {
@@ -12,11 +13,24 @@ struct SimulationState {
     Integrator* Tol{};
 };
 
+// Physiological noise of the SDE mode (sim ensemble). A, C and Tol follow
+// dX = f(X) dt + sigma X dW, f being the equations below and the three Wiener
+// processes independent: inter-occasion variability as relative fluctuations
+// with standard deviation sigma * sqrt(t) over t hours (sigma in 1/sqrt(h)).
+struct PhysiologicalNoise {
+    double A{0.0};
+    double C{0.0};
+    double Tol{0.0};
+};
+
 double MichaelisMentenElimination(double concentration, const ModelParameters& params);
+// d/dC of MichaelisMentenElimination.
+double MichaelisMentenSlope(double concentration, const ModelParameters& params);
 double CalculateEffect(double Ce_val, double Tol_val, const ModelParameters& params);
 double ToleranceSignal(double Ce_val, const ModelParameters& params);
+double ToleranceSignalSlope(double Ce_val, const ModelParameters& params);
 
-class AbsorptionDynamics : public aContiBlock {
+class AbsorptionDynamics : public ContinuousBlock {
 public:
     AbsorptionDynamics(const ModelParameters& params, SimulationState& state)
         : params_(params), state_(state) {}
@@ -27,7 +41,7 @@ private:
     SimulationState& state_;
 };
 
-class CentralDynamics : public aContiBlock {
+class CentralDynamics : public ContinuousBlock {
 public:
     CentralDynamics(const ModelParameters& params, SimulationState& state)
         : params_(params), state_(state) {}
@@ -38,7 +52,7 @@ private:
     SimulationState& state_;
 };
 
-class PeripheralDynamics : public aContiBlock {
+class PeripheralDynamics : public ContinuousBlock {
 public:
     PeripheralDynamics(const ModelParameters& params, SimulationState& state)
         : params_(params), state_(state) {}
@@ -49,7 +63,7 @@ private:
     SimulationState& state_;
 };
 
-class EffectSiteDynamics : public aContiBlock {
+class EffectSiteDynamics : public ContinuousBlock {
 public:
     EffectSiteDynamics(const ModelParameters& params, SimulationState& state)
         : params_(params), state_(state) {}
@@ -60,7 +74,7 @@ private:
     SimulationState& state_;
 };
 
-class ToleranceDynamics : public aContiBlock {
+class ToleranceDynamics : public ContinuousBlock {
 public:
     ToleranceDynamics(const ModelParameters& params, SimulationState& state)
         : params_(params), state_(state) {}
@@ -70,3 +84,15 @@ private:
     const ModelParameters& params_;
     SimulationState& state_;
 };
+
+// Analytic Jacobian of the five equations above, in the order A, C, P, Ce, Tol.
+class PkPdJacobian : public JacobianSource {
+public:
+    PkPdJacobian(const ModelParameters& params, SimulationState& state)
+        : params_(params), state_(state) {}
+    void Jacobian(std::vector<double>& J) override;
+
+private:
+    const ModelParameters& params_;
+    SimulationState& state_;
+};
@@ -0,0 +1,207 @@
+#include "exponential_integrator.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using std::fabs;
+using std::vector;
+
+namespace {
+
+// Step sizes whose matrix functions are kept.
+const size_t kCacheSize = 32;
+// Step sizes this close (relative) share matrix functions; the difference
+// is far below any integration tolerance.
+const double kSameStep = 1e-9;
+// Taylor terms of the phi functions after scaling to norm <= 1/2; the first
+// omitted term is below 1e-16.
+const int kTaylorTerms = 14;
+
+// C = A B for dense row-major n x n matrices.
+void Multiply(const vector<double>& A, const vector<double>& B, vector<double>& C, size_t n) {
+    C.assign(n * n, 0.0);
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t k = 0; k < n; ++k) {
+            double a = A[i * n + k];
+            if (a == 0.0) continue;
+            for (size_t j = 0; j < n; ++j) C[i * n + j] += a * B[k * n + j];
+        }
+    }
+}
+
+// y = A x for dense n x n A.
+void Apply(const vector<double>& A, const double* x, double* y, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        double sum = 0.0;
+        for (size_t j = 0; j < n; ++j) sum += A[i * n + j] * x[j];
+        y[i] = sum;
+    }
+}
+
+// y += T g for an n x m block T.
+void ApplyThin(const vector<double>& T, const double* g, double* y, size_t n, size_t m) {
+    for (size_t i = 0; i < n; ++i) {
+        double sum = 0.0;
+        for (size_t k = 0; k < m; ++k) sum += T[i * m + k] * g[k];
+        y[i] += sum;
+    }
+}
+
+}  // namespace
+
+void ExponentialRK4::Attach(const vector<Integrator*>& integrators, const CompartmentKernel& kernel) {
+    integrators_ = integrators;
+    kernel_ = &kernel;
+    n_ = integrators_.size();
+    rows_ = kernel.NonlinearRows();
+    m_ = rows_.size();
+    kernel.LinearMatrix(L_);
+    cache_.clear();
+    cache_.reserve(kCacheSize);
+    next_slot_ = 0;
+    y0_.assign(n_, 0.0);
+    a_.assign(n_, 0.0);
+    b_.assign(n_, 0.0);
+    c_.assign(n_, 0.0);
+    E2y0_.assign(n_, 0.0);
+    gu_.assign(m_, 0.0);
+    ga_.assign(m_, 0.0);
+    gb_.assign(m_, 0.0);
+    gc_.assign(m_, 0.0);
+    g_.assign(m_, 0.0);
+}
+
+const ExponentialRK4::Propagator& ExponentialRK4::PropagatorFor(double h) {
+    for (const Propagator& propagator : cache_) {
+        if (fabs(propagator.h - h) <= kSameStep * h) return propagator;
+    }
+    if (cache_.size() < kCacheSize) {
+        cache_.push_back(Propagator());
+        ComputePropagator(h, cache_.back());
+        return cache_.back();
+    }
+    Propagator& slot = cache_[next_slot_];
+    next_slot_ = (next_slot_ + 1) % kCacheSize;
+    ComputePropagator(h, slot);
+    return slot;
+}
+
+void ExponentialRK4::ComputePropagator(double h, Propagator& propagator) {
+    ++updates_;
+    size_t n = n_;
+    double norm = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        double sum = 0.0;
+        for (size_t j = 0; j < n; ++j) sum += fabs(h * L_[i * n + j]);
+        norm = std::max(norm, sum);
+    }
+    // At least one squaring, so the functions of hL/2 come out on the way.
+    int squarings = 1;
+    while (norm / std::ldexp(1.0, squarings) > 0.5) ++squarings;
+    double scale = h / std::ldexp(1.0, squarings);
+
+    // phi_k(X) = sum_j X^j / (j + k)! for X = hL / 2^s.
+    vector<double> X(n * n), power(n * n, 0.0), next;
+    for (size_t k = 0; k < n * n; ++k) X[k] = scale * L_[k];
+    for (size_t i = 0; i < n; ++i) power[i * n + i] = 1.0;
+    vector<double> phi[4];
+    for (int k = 0; k < 4; ++k) phi[k].assign(n * n, 0.0);
+    double factorial[kTaylorTerms + 4];
+    factorial[0] = 1.0;
+    for (int j = 1; j < kTaylorTerms + 4; ++j) factorial[j] = factorial[j - 1] * j;
+    for (int j = 0; j < kTaylorTerms; ++j) {
+        for (int k = 0; k < 4; ++k) {
+            double weight = 1.0 / factorial[j + k];
+            for (size_t e = 0; e < n * n; ++e) phi[k][e] += weight * power[e];
+        }
+        if (j + 1 < kTaylorTerms) {
+            Multiply(power, X, next, n);
+            power.swap(next);
+        }
+    }
+
+    // phi_k(2Z) = 2^-k (phi_0(Z) phi_k(Z) + sum_{j=1..k} phi_j(Z) / (k - j)!).
+    vector<double> product[4];
+    vector<double> E2, Q;
+    for (int step = 0; step < squarings; ++step) {
+        if (step == squarings - 1) {
+            E2 = phi[0];
+            Q = phi[1];
+        }
+        for (int k = 0; k < 4; ++k) Multiply(phi[0], phi[k], product[k], n);
+        for (size_t e = 0; e < n * n; ++e) {
+            double p1 = phi[1][e], p2 = phi[2][e], p3 = phi[3][e];
+            phi[0][e] = product[0][e];
+            phi[1][e] = (product[1][e] + p1) / 2.0;
+            phi[2][e] = (product[2][e] + p1 + p2) / 4.0;
+            phi[3][e] = (product[3][e] + p1 / 2.0 + p2 + p3) / 8.0;
+        }
+    }
+
+    propagator.h = h;
+    propagator.E2 = E2;
+    propagator.E = phi[0];
+    propagator.Q.assign(n * m_, 0.0);
+    propagator.f1.assign(n * m_, 0.0);
+    propagator.f2.assign(n * m_, 0.0);
+    propagator.f3.assign(n * m_, 0.0);
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t k = 0; k < m_; ++k) {
+            size_t e = i * n + rows_[k];
+            size_t t = i * m_ + k;
+            propagator.Q[t] = 0.5 * h * Q[e];
+            propagator.f1[t] = h * (phi[1][e] - 3.0 * phi[2][e] + 4.0 * phi[3][e]);
+            propagator.f2[t] = h * (phi[2][e] - 2.0 * phi[3][e]);
+            propagator.f3[t] = h * (4.0 * phi[3][e] - phi[2][e]);
+        }
+    }
+}
+
+double ExponentialRK4::Step(double h, double accuracy) {
+    for (size_t i = 0; i < n_; ++i) y0_[i] = integrators_[i]->value_;
+    const Propagator& p = PropagatorFor(h);
+
+    evaluations_ += 4;
+    PERF_COUNT(if (counters_) counters_->CountEvaluations(n_, 4));
+    PERF_COUNT(if (counters_) counters_->kernel_evaluations += 4);
+
+    kernel_->Nonlinear(y0_.data(), gu_.data());
+    Apply(p.E2, y0_.data(), E2y0_.data(), n_);
+
+    a_ = E2y0_;
+    ApplyThin(p.Q, gu_.data(), a_.data(), n_, m_);
+    kernel_->Nonlinear(a_.data(), ga_.data());
+
+    b_ = E2y0_;
+    ApplyThin(p.Q, ga_.data(), b_.data(), n_, m_);
+    kernel_->Nonlinear(b_.data(), gb_.data());
+
+    Apply(p.E2, a_.data(), c_.data(), n_);
+    for (size_t k = 0; k < m_; ++k) g_[k] = 2.0 * gb_[k] - gu_[k];
+    ApplyThin(p.Q, g_.data(), c_.data(), n_, m_);
+    kernel_->Nonlinear(c_.data(), gc_.data());
+
+    // y1 in a_, the error estimate 2 f2 (N(a) + N(b) - N(y0) - N(c)) in b_.
+    Apply(p.E, y0_.data(), a_.data(), n_);
+    ApplyThin(p.f1, gu_.data(), a_.data(), n_, m_);
+    ApplyThin(p.f3, gc_.data(), a_.data(), n_, m_);
+    for (size_t k = 0; k < m_; ++k) g_[k] = 2.0 * (ga_[k] + gb_[k]);
+    ApplyThin(p.f2, g_.data(), a_.data(), n_, m_);
+    for (size_t k = 0; k < m_; ++k) g_[k] = 2.0 * (ga_[k] + gb_[k] - gu_[k] - gc_[k]);
+    std::fill(b_.begin(), b_.end(), 0.0);
+    ApplyThin(p.f2, g_.data(), b_.data(), n_, m_);
+
+    double error_ratio = 0.0;
+    for (size_t i = 0; i < n_; ++i) {
+        double tolerance = accuracy * (1.0 + fabs(a_[i]));
+        double ratio = fabs(b_[i]) / tolerance;
+        if (std::isnan(ratio)) ratio = HUGE_VAL;
+        if (ratio > error_ratio) error_ratio = ratio;
+        integrators_[i]->value_ = a_[i];
+    }
+    return error_ratio;
+}
+
+void ExponentialRK4::Reject() {
+    for (size_t i = 0; i < n_; ++i) integrators_[i]->value_ = y0_[i];
+}
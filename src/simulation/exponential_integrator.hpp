@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "compartment_model.hpp"
+#include "integration.hpp"
+#include "perf_counters.hpp"
+
+// Exponential Runge-Kutta method of Cox and Matthews (ETDRK4) for the split
+// y' = L y + N(y) of a CompartmentKernel. The linear fluxes are propagated
+// exactly through exp(hL) and the phi functions, so fast transfers (transit
+// chains, quick equilibration) never limit the step; only the Hill fluxes
+// are approximated, to fourth order. The error estimate is the difference
+// to the second-order exponential solution built from the same stages, so
+// a model without nonlinear fluxes is solved exactly at any step size.
+//
+// The matrix functions depend on h only. They are computed by scaling and
+// squaring and kept for the last few step sizes; a halving/doubling step
+// controller keeps h on a grid, so they are rarely recomputed. N enters only
+// through its few non-zero rows, so a step costs three dense and seven thin
+// matrix-vector products plus four evaluations of the Hill fluxes.
+class ExponentialRK4 {
+public:
+    // The kernel must outlive the stepper and cover every integrator.
+    void Attach(const std::vector<Integrator*>& integrators, const CompartmentKernel& kernel);
+    void SetCounters(PerfCounters* counters) { counters_ = counters; }
+
+    // Same contract as RungeKuttaEngland::Step.
+    double Step(double h, double accuracy);
+    void Reject();
+
+    // Evaluations of N (four per step).
+    unsigned long Evaluations() const { return evaluations_; }
+    // Step sizes the matrix functions had to be computed for.
+    unsigned long PropagatorUpdates() const { return updates_; }
+
+private:
+    // exp(hL/2), exp(hL) as dense n x n, and the n x m blocks (m = non-zero
+    // rows of N) of (h/2) phi1(hL/2) and the ETDRK4 weights.
+    struct Propagator {
+        double h{0.0};
+        std::vector<double> E2{}, E{};
+        std::vector<double> Q{}, f1{}, f2{}, f3{};
+    };
+
+    const Propagator& PropagatorFor(double h);
+    void ComputePropagator(double h, Propagator& propagator);
+
+    std::vector<Integrator*> integrators_{};
+    const CompartmentKernel* kernel_{nullptr};
+    PerfCounters* counters_{nullptr};
+    size_t n_{0};
+    size_t m_{0};
+    std::vector<size_t> rows_{};  // non-zero rows of N
+    std::vector<double> L_{};
+    std::vector<Propagator> cache_{};
+    size_t next_slot_{0};
+    std::vector<double> y0_{}, a_{}, b_{}, c_{}, E2y0_{};
+    std::vector<double> gu_{}, ga_{}, gb_{}, gc_{}, g_{};
+    unsigned long evaluations_{0};
+    unsigned long updates_{0};
+};
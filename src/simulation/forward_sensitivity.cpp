@@ -0,0 +1,244 @@
+#include "forward_sensitivity.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "decision_rules.hpp"
+
+namespace {
+
+struct ParameterKey {
+    SensitivityParameter parameter;
+    const char* key;
+};
+
+const ParameterKey kParameterKeys[] = {
+    {SensitivityParameter::ka, "ka"},
+    {SensitivityParameter::Vd, "Vd"},
+    {SensitivityParameter::kcp, "kcp"},
+    {SensitivityParameter::kpc, "kpc"},
+    {SensitivityParameter::Vmax, "Vmax"},
+    {SensitivityParameter::Km, "Km"},
+    {SensitivityParameter::keo, "keo"},
+    {SensitivityParameter::tau_e, "tau_e"},
+    {SensitivityParameter::kin, "kin"},
+    {SensitivityParameter::kout, "kout"},
+    {SensitivityParameter::EC50_signal, "EC50_signal"},
+    {SensitivityParameter::EC50_base, "EC50_base"},
+    {SensitivityParameter::Emax, "Emax"},
+    {SensitivityParameter::n_Hill, "n_Hill"},
+    {SensitivityParameter::initial_dose, "initial_dose"},
+    {SensitivityParameter::base_escalation_factor, "base_escalation_factor"},
+    {SensitivityParameter::tolerance_escalation_factor, "tolerance_escalation_factor"},
+};
+
+const size_t kNone = static_cast<size_t>(-1);
+
+}  // namespace
+
+bool FindSensitivityParameter(const std::string& key, SensitivityParameter& parameter) {
+    for (const auto& entry : kParameterKeys) {
+        if (key == entry.key) {
+            parameter = entry.parameter;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* SensitivityParameterKey(SensitivityParameter parameter) {
+    for (const auto& entry : kParameterKeys) {
+        if (entry.parameter == parameter) return entry.key;
+    }
+    return "";
+}
+
+void StatePartials(SensitivityParameter parameter, const ModelParameters& p, const double y[5], double dfdp[5]) {
+    const double A = y[0], C = y[1], P = y[2], Ce = y[3], Tol = y[4];
+    std::fill(dfdp, dfdp + 5, 0.0);
+    double C_pos = C < 0.0 ? 0.0 : C;  // MichaelisMentenElimination is 0 below 0
+    switch (parameter) {
+        case SensitivityParameter::ka:
+            dfdp[0] = -A;
+            dfdp[1] = A / p.Vd;
+            break;
+        case SensitivityParameter::Vd:
+            dfdp[1] = -(p.ka * A - MichaelisMentenElimination(C, p)) / (p.Vd * p.Vd);
+            break;
+        case SensitivityParameter::kcp:
+            dfdp[1] = -C;
+            dfdp[2] = C;
+            break;
+        case SensitivityParameter::kpc:
+            dfdp[1] = P;
+            dfdp[2] = -P;
+            break;
+        case SensitivityParameter::Vmax:
+            dfdp[1] = -C_pos / ((p.Km + C_pos) * p.Vd);
+            break;
+        case SensitivityParameter::Km:
+            dfdp[1] = p.Vmax * C_pos / ((p.Km + C_pos) * (p.Km + C_pos) * p.Vd);
+            break;
+        case SensitivityParameter::keo:
+            dfdp[3] = (C - Ce) / p.tau_e;
+            break;
+        case SensitivityParameter::tau_e:
+            dfdp[3] = -p.keo * (C - Ce) / (p.tau_e * p.tau_e);
+            break;
+        case SensitivityParameter::kin:
+            dfdp[4] = ToleranceSignal(Ce, p);
+            break;
+        case SensitivityParameter::kout:
+            dfdp[4] = -Tol;
+            break;
+        case SensitivityParameter::EC50_signal: {
+            double Ce_pos = Ce < 0.0 ? 0.0 : Ce;
+            double denominator = p.EC50_signal + Ce_pos;
+            dfdp[4] = -p.kin * Ce_pos / (denominator * denominator);
+            break;
+        }
+        default:
+            // The effect and dosing parameters do not enter the state
+            // equations.
+            break;
+    }
+}
+
+void EffectPartials(double Ce, double Tol, const ModelParameters& p, double& dCe, double& dTol) {
+    dCe = 0.0;
+    dTol = 0.0;
+    if (Ce <= 0.0) return;
+    double Tol_pos = Tol < 0.0 ? 0.0 : Tol;
+    double EC50 = p.EC50_base * (1.0 + Tol_pos);
+    double u = std::pow(Ce, p.n_Hill);
+    double v = std::pow(EC50, p.n_Hill);
+    double denominator = (u + v) * (u + v);
+    // E = Emax u / (u + v)
+    dCe = p.Emax * v / denominator * p.n_Hill * u / Ce;
+    if (Tol >= 0.0) dTol = -p.Emax * u / denominator * p.n_Hill * v / EC50 * p.EC50_base;
+}
+
+double EffectParameterPartial(SensitivityParameter parameter, double Ce, double Tol, const ModelParameters& p) {
+    if (Ce <= 0.0) return 0.0;
+    double Tol_pos = Tol < 0.0 ? 0.0 : Tol;
+    double EC50 = p.EC50_base * (1.0 + Tol_pos);
+    double u = std::pow(Ce, p.n_Hill);
+    double v = std::pow(EC50, p.n_Hill);
+    double denominator = (u + v) * (u + v);
+    switch (parameter) {
+        case SensitivityParameter::Emax:
+            return u / (u + v);
+        case SensitivityParameter::EC50_base:
+            return -p.Emax * u / denominator * p.n_Hill * v / p.EC50_base;
+        case SensitivityParameter::n_Hill:
+            return p.Emax * u * v * (std::log(Ce) - std::log(EC50)) / denominator;
+        default:
+            return 0.0;
+    }
+}
+
+double ForwardSensitivities::Block::Value() {
+    owner_.Refresh();
+    const double* J = &owner_.J_[state_ * 5];
+    double sum = owner_.dfdp_[column_ * 5 + state_];
+    for (size_t m = 0; m < 5; ++m) {
+        if (J[m] != 0.0) sum += J[m] * owner_.S_[column_ * 5 + m]->Value();
+    }
+    return sum;
+}
+
+ForwardSensitivities::ForwardSensitivities(const ModelParameters& params, SimulationState& state,
+                                           const std::vector<SensitivityParameter>& parameters)
+    : params_(params),
+      state_(state),
+      parameters_(parameters),
+      jacobian_(params, state),
+      dose_gradient_(parameters.size(), 0.0),
+      dfdp_(parameters.size() * 5, 0.0) {
+    for (size_t column = 0; column < parameters_.size(); ++column) {
+        for (size_t row = 0; row < 5; ++row) {
+            blocks_.emplace_back(new Block(*this, row, column));
+            S_.emplace_back(new Integrator(*blocks_.back(), 0.0));
+        }
+    }
+    // A(0) and the first dose are initial_dose.
+    size_t column = ColumnOf(SensitivityParameter::initial_dose);
+    if (column != kNone) {
+        *S_[column * 5] = 1.0;
+        dose_gradient_[column] = 1.0;
+    }
+}
+
+std::vector<Integrator*> ForwardSensitivities::Integrators() {
+    std::vector<Integrator*> integrators;
+    for (auto& S : S_) integrators.push_back(S.get());
+    return integrators;
+}
+
+double ForwardSensitivities::Effect(size_t column) const {
+    double Ce = state_.Ce->Value();
+    double Tol = state_.Tol->Value();
+    double dCe, dTol;
+    EffectPartials(Ce, Tol, params_, dCe, dTol);
+    return dCe * Value(3, column) + dTol * Value(4, column) +
+           EffectParameterPartial(parameters_[column], Ce, Tol, params_);
+}
+
+void ForwardSensitivities::AddDose() {
+    for (size_t column = 0; column < parameters_.size(); ++column) {
+        *S_[column * 5] = S_[column * 5]->Value() + dose_gradient_[column];
+    }
+}
+
+void ForwardSensitivities::EscalateDose(double old_dose) {
+    double Tol = state_.Tol->Value();
+    double escalation = EscalationFactor(Tol, params_);
+    // A capped dose is a constant, or stays the old one when that was
+    // already above the cap.
+    if (ExceedsMaxDose(old_dose * (1.0 + escalation), params_)) {
+        if (old_dose < params_.max_dose) std::fill(dose_gradient_.begin(), dose_gradient_.end(), 0.0);
+        return;
+    }
+    // A clamped escalation does not move with the parameters.
+    bool clamped = escalation == kMinEscalationFactor || escalation == kMaxEscalationFactor;
+    for (size_t column = 0; column < parameters_.size(); ++column) {
+        double d_escalation = 0.0;
+        if (!clamped) {
+            if (parameters_[column] == SensitivityParameter::base_escalation_factor) d_escalation += 1.0;
+            if (Tol > 0.0) {
+                if (parameters_[column] == SensitivityParameter::tolerance_escalation_factor) d_escalation += Tol;
+                d_escalation += params_.tolerance_escalation_factor * Value(4, column);
+            }
+        }
+        dose_gradient_[column] = dose_gradient_[column] * (1.0 + escalation) + old_dose * d_escalation;
+    }
+}
+
+void ForwardSensitivities::ScaleDose(double factor) {
+    for (double& gradient : dose_gradient_) gradient *= factor;
+}
+
+void ForwardSensitivities::ScaleState(size_t state, double factor) {
+    for (size_t column = 0; column < parameters_.size(); ++column) {
+        *S_[column * 5 + state] = S_[column * 5 + state]->Value() * factor;
+    }
+}
+
+void ForwardSensitivities::Refresh() {
+    double y[5] = {state_.A->Value(), state_.C->Value(), state_.P->Value(), state_.Ce->Value(),
+                   state_.Tol->Value()};
+    if (cached_ && std::equal(y, y + 5, cached_y_)) return;
+    cached_ = true;
+    std::copy(y, y + 5, cached_y_);
+    jacobian_.Jacobian(J_);
+    for (size_t column = 0; column < parameters_.size(); ++column) {
+        StatePartials(parameters_[column], params_, y, &dfdp_[column * 5]);
+    }
+}
+
+size_t ForwardSensitivities::ColumnOf(SensitivityParameter parameter) const {
+    for (size_t column = 0; column < parameters_.size(); ++column) {
+        if (parameters_[column] == parameter) return column;
+    }
+    return kNone;
+}
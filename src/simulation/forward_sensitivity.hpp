@@ -0,0 +1,106 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "dynamics.hpp"
+#include "integration.hpp"
+#include "parameters.hpp"
+
+// ModelParameters fields the model can be differentiated with respect to:
+// everything in the state equations and the effect, the initial dose and the
+// escalation rule that sets later doses.
+enum class SensitivityParameter : int {
+    ka,
+    Vd,
+    kcp,
+    kpc,
+    Vmax,
+    Km,
+    keo,
+    tau_e,
+    kin,
+    kout,
+    EC50_signal,
+    EC50_base,
+    Emax,
+    n_Hill,
+    initial_dose,
+    base_escalation_factor,
+    tolerance_escalation_factor,
+};
+
+// Looks up a parameter by its config key.
+bool FindSensitivityParameter(const std::string& key, SensitivityParameter& parameter);
+const char* SensitivityParameterKey(SensitivityParameter parameter);
+
+// d f / d p of the five state equations at y = {A, C, P, Ce, Tol}.
+void StatePartials(SensitivityParameter parameter, const ModelParameters& params, const double y[5],
+                   double dfdp[5]);
+
+// Partial derivatives of CalculateEffect.
+void EffectPartials(double Ce, double Tol, const ModelParameters& params, double& dCe, double& dTol);
+double EffectParameterPartial(SensitivityParameter parameter, double Ce, double Tol, const ModelParameters& params);
+
+// Forward sensitivities S = d state / d p for a set of parameters, integrated
+// alongside the state as dS/dt = J S + df/dp. Dose and rescue jumps happen at
+// scheduled times, so S jumps with them through the hooks below; decisions of
+// the Petri net are held fixed, i.e. the derivatives are those of the
+// trajectory with the same sequence of decisions.
+class ForwardSensitivities {
+public:
+    ForwardSensitivities(const ModelParameters& params, SimulationState& state,
+                         const std::vector<SensitivityParameter>& parameters);
+
+    // One integrator per (state, parameter), parameter-major.
+    std::vector<Integrator*> Integrators();
+
+    size_t Count() const { return parameters_.size(); }
+    SensitivityParameter Parameter(size_t column) const { return parameters_[column]; }
+    // d state / d parameter at the current time.
+    double Value(size_t state, size_t column) const { return S_[column * 5 + state]->Value(); }
+    // d effect / d parameter at the current time.
+    double Effect(size_t column) const;
+
+    // A += current dose (MaintainDose, ExecuteDoseIncrease).
+    void AddDose();
+    // The current dose becomes old_dose (1 + escalation) with escalation =
+    // base + factor * Tol clamped to [0.01, 0.50] and the result capped at
+    // max_dose, as in ExecuteDoseIncrease.
+    void EscalateDose(double old_dose);
+    // The current dose is multiplied by a constant factor (tapering).
+    void ScaleDose(double factor);
+    // state *= factor for a constant factor (naloxone rescue).
+    void ScaleState(size_t state, double factor);
+
+private:
+    class Block : public ContinuousBlock {
+    public:
+        Block(ForwardSensitivities& owner, size_t state, size_t column)
+            : owner_(owner), state_(state), column_(column) {}
+        double Value() override;
+
+    private:
+        ForwardSensitivities& owner_;
+        size_t state_;
+        size_t column_;
+    };
+
+    // Recomputes J and df/dp when the state has moved (once per stage).
+    void Refresh();
+    size_t ColumnOf(SensitivityParameter parameter) const;
+
+    const ModelParameters& params_;
+    SimulationState& state_;
+    std::vector<SensitivityParameter> parameters_;
+    PkPdJacobian jacobian_;
+    std::vector<std::unique_ptr<Block>> blocks_;
+    std::vector<std::unique_ptr<Integrator>> S_;
+    std::vector<double> dose_gradient_;  // d current_dose / d p
+
+    bool cached_{false};
+    double cached_y_[5]{};
+    std::vector<double> J_;
+    std::vector<double> dfdp_;  // 5 per parameter
+};
@@ -0,0 +1,186 @@
+#include "integration.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using std::fabs;
+
+void RungeKuttaEngland::Attach(const std::vector<Integrator*>& integrators, size_t error_controlled) {
+    integrators_ = integrators;
+    size_t n = integrators_.size();
+    error_controlled_ = std::min(error_controlled, n);
+    y0_.assign(n, 0.0);
+    y1_.assign(n, 0.0);
+    work_.assign(7 * n, 0.0);
+}
+
+void RungeKuttaEngland::Derivatives(const double* y, double* dy) {
+    // Blocks read their inputs from the integrators.
+    size_t n = integrators_.size();
+    for (size_t i = 0; i < n; ++i) integrators_[i]->value_ = y[i];
+    size_t first = 0;
+    if (kernel_) {
+        kernel_->Derivatives(y, dy);
+        first = kernel_->Size();
+        PERF_COUNT(if (counters_) ++counters_->kernel_evaluations);
+    }
+    for (size_t i = first; i < n; ++i) dy[i] = integrators_[i]->input_.Value();
+}
+
+double RungeKuttaEngland::Step(double h, double accuracy) {
+    size_t n = integrators_.size();
+    for (size_t i = 0; i < n; ++i) y0_[i] = integrators_[i]->value_;
+
+    double error_ratio;
+    if (kernel_ && kernel_->Size() == n && error_controlled_ == n) {
+        error_ratio = kernel_->EnglandStep(y0_.data(), h, accuracy, y1_.data());
+        PERF_COUNT(if (counters_) counters_->kernel_evaluations += 6);
+    } else {
+        auto rhs = [this](const double* y, double* dy) { Derivatives(y, dy); };
+        error_ratio = RungeKuttaEnglandStep(rhs, n, error_controlled_, y0_.data(), h, accuracy, work_.data(),
+                                            y1_.data());
+    }
+    evaluations_ += 6;
+    PERF_COUNT(if (counters_) counters_->CountEvaluations(n, 6));
+
+    for (size_t i = 0; i < n; ++i) integrators_[i]->value_ = y1_[i];
+    return error_ratio;
+}
+
+void RungeKuttaEngland::Reject() {
+    for (size_t i = 0; i < integrators_.size(); ++i) integrators_[i]->value_ = y0_[i];
+}
+
+namespace {
+
+const double kGamma = 1.0 / 2.0;
+const double kA21 = 2.0;
+const double kA31 = 48.0 / 25.0;
+const double kA32 = 6.0 / 25.0;
+const double kC21 = -8.0;
+const double kC31 = 372.0 / 25.0;
+const double kC32 = 12.0 / 5.0;
+const double kC41 = -112.0 / 125.0;
+const double kC42 = -54.0 / 125.0;
+const double kC43 = -2.0 / 5.0;
+const double kB1 = 19.0 / 9.0;
+const double kB2 = 1.0 / 2.0;
+const double kB3 = 25.0 / 108.0;
+const double kB4 = 125.0 / 108.0;
+const double kE1 = 17.0 / 54.0;
+const double kE2 = 7.0 / 36.0;
+const double kE4 = 125.0 / 108.0;
+
+}  // namespace
+
+void Rosenbrock4::Attach(const std::vector<Integrator*>& integrators, JacobianSource& jacobian) {
+    integrators_ = integrators;
+    jacobian_ = &jacobian;
+    size_t n = integrators_.size();
+    y0_.assign(n, 0.0);
+    y_.assign(n, 0.0);
+    f_.assign(n, 0.0);
+    g1_.assign(n, 0.0);
+    g2_.assign(n, 0.0);
+    g3_.assign(n, 0.0);
+    g4_.assign(n, 0.0);
+    J_.assign(n * n, 0.0);
+    lu_.assign(n * n, 0.0);
+    pivot_.assign(n, 0);
+}
+
+void Rosenbrock4::Evaluate(std::vector<double>& f) {
+    ++evaluations_;
+    PERF_COUNT(if (counters_) counters_->CountEvaluations(integrators_.size(), 1));
+    if (kernel_) {
+        for (size_t i = 0; i < integrators_.size(); ++i) y_[i] = integrators_[i]->value_;
+        kernel_->Derivatives(y_.data(), f.data());
+        PERF_COUNT(if (counters_) ++counters_->kernel_evaluations);
+        return;
+    }
+    for (size_t i = 0; i < integrators_.size(); ++i) {
+        f[i] = integrators_[i]->input_.Value();
+    }
+}
+
+bool Rosenbrock4::Factor(double h) {
+    // LU with partial pivoting of (I / (gamma h) - J); n is tiny, so a plain
+    // dense elimination is all that is needed.
+    size_t n = integrators_.size();
+    for (size_t k = 0; k < n * n; ++k) lu_[k] = -J_[k];
+    for (size_t i = 0; i < n; ++i) lu_[i * n + i] += 1.0 / (kGamma * h);
+
+    for (size_t col = 0; col < n; ++col) {
+        size_t best = col;
+        for (size_t row = col + 1; row < n; ++row) {
+            if (fabs(lu_[row * n + col]) > fabs(lu_[best * n + col])) best = row;
+        }
+        if (lu_[best * n + col] == 0.0) return false;
+        pivot_[col] = best;
+        if (best != col) {
+            for (size_t k = 0; k < n; ++k) std::swap(lu_[col * n + k], lu_[best * n + k]);
+        }
+        for (size_t row = col + 1; row < n; ++row) {
+            double factor = lu_[row * n + col] / lu_[col * n + col];
+            lu_[row * n + col] = factor;
+            for (size_t k = col + 1; k < n; ++k) lu_[row * n + k] -= factor * lu_[col * n + k];
+        }
+    }
+    return true;
+}
+
+void Rosenbrock4::Solve(std::vector<double>& b) const {
+    size_t n = integrators_.size();
+    for (size_t col = 0; col < n; ++col) {
+        if (pivot_[col] != col) std::swap(b[col], b[pivot_[col]]);
+        for (size_t row = col + 1; row < n; ++row) b[row] -= lu_[row * n + col] * b[col];
+    }
+    for (size_t row = n; row-- > 0;) {
+        for (size_t k = row + 1; k < n; ++k) b[row] -= lu_[row * n + k] * b[k];
+        b[row] /= lu_[row * n + row];
+    }
+}
+
+double Rosenbrock4::Step(double h, double accuracy) {
+    size_t n = integrators_.size();
+    for (size_t i = 0; i < n; ++i) y0_[i] = integrators_[i]->value_;
+
+    ++jacobians_;
+    jacobian_->Jacobian(J_);
+    if (!Factor(h)) {
+        return HUGE_VAL;
+    }
+
+    Evaluate(g1_);
+    Solve(g1_);
+
+    for (size_t i = 0; i < n; ++i) integrators_[i]->value_ = y0_[i] + kA21 * g1_[i];
+    Evaluate(f_);
+    for (size_t i = 0; i < n; ++i) g2_[i] = f_[i] + kC21 * g1_[i] / h;
+    Solve(g2_);
+
+    for (size_t i = 0; i < n; ++i) integrators_[i]->value_ = y0_[i] + kA31 * g1_[i] + kA32 * g2_[i];
+    Evaluate(f_);
+    for (size_t i = 0; i < n; ++i) g3_[i] = f_[i] + (kC31 * g1_[i] + kC32 * g2_[i]) / h;
+    Solve(g3_);
+
+    // The fourth stage reuses the third evaluation (the method's a4j equal a3j).
+    for (size_t i = 0; i < n; ++i) g4_[i] = f_[i] + (kC41 * g1_[i] + kC42 * g2_[i] + kC43 * g3_[i]) / h;
+    Solve(g4_);
+
+    double error_ratio = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        double y1 = y0_[i] + kB1 * g1_[i] + kB2 * g2_[i] + kB3 * g3_[i] + kB4 * g4_[i];
+        double err = kE1 * g1_[i] + kE2 * g2_[i] + kE4 * g4_[i];
+        double tolerance = accuracy * (1.0 + fabs(y1));
+        double ratio = fabs(err) / tolerance;
+        if (std::isnan(ratio)) ratio = HUGE_VAL;
+        if (ratio > error_ratio) error_ratio = ratio;
+        integrators_[i]->value_ = y1;
+    }
+    return error_ratio;
+}
+
+void Rosenbrock4::Reject() {
+    for (size_t i = 0; i < integrators_.size(); ++i) integrators_[i]->value_ = y0_[i];
+}
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "perf_counters.hpp"
+
+// Right-hand side of one state equation. Replaces SIMLIB's aContiBlock so the
+// continuous subsystem no longer depends on process-global integrator lists.
+class ContinuousBlock {
+public:
+    virtual ~ContinuousBlock() = default;
+    virtual double Value() = 0;
+};
+
+class Integrator {
+public:
+    Integrator(ContinuousBlock& input, double initial_value)
+        : input_(input), value_(initial_value) {}
+
+    double Value() const { return value_; }
+    Integrator& operator=(double value) {
+        value_ = value;
+        return *this;
+    }
+
+private:
+    friend class RungeKuttaEngland;
+    friend class Rosenbrock4;
+    friend class ExponentialRK4;
+
+    ContinuousBlock& input_;
+    double value_;
+};
+
+// Right-hand side of the first Size() attached integrators as one function
+// of a contiguous state vector, used instead of their ContinuousBlocks.
+class SystemKernel {
+public:
+    virtual ~SystemKernel() = default;
+    virtual size_t Size() const = 0;
+    virtual void Derivatives(const double* y, double* dy) const = 0;
+    // RungeKuttaEnglandStep over exactly these equations, all error
+    // controlled; implementations inline their derivatives into it.
+    virtual double EnglandStep(const double* y0, double h, double accuracy, double* y1) const = 0;
+};
+
+// One Runge-Kutta-England step of n equations from y0, where rhs(y, dy)
+// evaluates all derivatives at y. Writes the new state to y1 and returns
+// max(|err| / tolerance) over the first error_controlled equations. work
+// holds 7 n doubles.
+template <class Rhs>
+inline double RungeKuttaEnglandStep(Rhs& rhs, size_t n, size_t error_controlled, const double* y0, double h,
+                                    double accuracy, double* work, double* y1) {
+    double* y = work;
+    double* k1 = work + n;
+    double* k2 = k1 + n;
+    double* k3 = k2 + n;
+    double* k4 = k3 + n;
+    double* k5 = k4 + n;
+    double* k6 = k5 + n;
+    // Derivatives must all see the same stage values, so evaluate first and
+    // only then move on to the next stage.
+    auto evaluate = [&](double* k) {
+        rhs(static_cast<const double*>(y), k);
+        for (size_t i = 0; i < n; ++i) k[i] = h * k[i];
+    };
+
+    for (size_t i = 0; i < n; ++i) y[i] = y0[i];
+    evaluate(k1);
+    for (size_t i = 0; i < n; ++i) y[i] = y0[i] + k1[i] / 2.0;
+    evaluate(k2);
+    for (size_t i = 0; i < n; ++i) y[i] = y0[i] + (k1[i] + k2[i]) / 4.0;
+    evaluate(k3);
+    for (size_t i = 0; i < n; ++i) y[i] = y0[i] - k2[i] + 2.0 * k3[i];
+    evaluate(k4);
+    for (size_t i = 0; i < n; ++i) y[i] = y0[i] + (7.0 * k1[i] + 10.0 * k2[i] + k4[i]) / 27.0;
+    evaluate(k5);
+    for (size_t i = 0; i < n; ++i) {
+        y[i] = y0[i] + (28.0 * k1[i] - 125.0 * k2[i] + 546.0 * k3[i] + 54.0 * k4[i] - 378.0 * k5[i]) / 625.0;
+    }
+    evaluate(k6);
+
+    double error_ratio = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        y1[i] = y0[i] + (k1[i] + 4.0 * k3[i] + k4[i]) / 6.0;
+        if (i >= error_controlled) continue;
+        double err = (-42.0 * k1[i] - 224.0 * k3[i] - 21.0 * k4[i] + 162.0 * k5[i] + 125.0 * k6[i]) / 336.0;
+        double tolerance = accuracy * (1.0 + std::fabs(y1[i]));
+        double ratio = std::fabs(err) / tolerance;
+        if (ratio > error_ratio) error_ratio = ratio;
+    }
+    return error_ratio;
+}
+
+// Runge-Kutta-England 4th order method with embedded error estimate (the
+// default SIMLIB method). Operates on the integrators of one context only.
+class RungeKuttaEngland {
+public:
+    // Only the first error_controlled integrators enter the error estimate;
+    // the rest (sensitivities) are advanced with the steps chosen for them.
+    void Attach(const std::vector<Integrator*>& integrators, size_t error_controlled = SIZE_MAX);
+    // Evaluates the first kernel->Size() integrators through kernel (not
+    // owned; nullptr restores their blocks). When the kernel covers every
+    // integrator, a step runs entirely inside it.
+    void SetKernel(const SystemKernel* kernel) { kernel_ = kernel; }
+    // Evaluations are added to counters (not owned) in PERF_COUNTERS builds.
+    void SetCounters(PerfCounters* counters) { counters_ = counters; }
+
+    // Advances all integrators by h and returns max(|err| / tolerance) over
+    // the error-controlled ones; a ratio above 1 means the step should be
+    // rejected.
+    double Step(double h, double accuracy);
+    // Restores the values from before the last Step().
+    void Reject();
+
+    // Right-hand side evaluations so far (six per Step).
+    unsigned long Evaluations() const { return evaluations_; }
+
+private:
+    void Derivatives(const double* y, double* dy);
+
+    std::vector<Integrator*> integrators_{};
+    size_t error_controlled_{0};
+    const SystemKernel* kernel_{nullptr};
+    PerfCounters* counters_{nullptr};
+    std::vector<double> y0_{}, y1_{}, work_{};
+    unsigned long evaluations_{0};
+};
+
+// Analytic df/dy of a set of integrators at their current values, row-major
+// in attach order (J[i * n + j] = d f_i / d y_j).
+class JacobianSource {
+public:
+    virtual ~JacobianSource() = default;
+    virtual void Jacobian(std::vector<double>& J) = 0;
+};
+
+// Linearly implicit Rosenbrock method in Kaps-Rentrop form with Shampine's
+// coefficients: order 4 with an embedded order-3 error estimate, A-stable.
+// Each step costs one Jacobian, one LU factorization of (I/(gamma h) - J),
+// three right-hand side evaluations and four back-substitutions, and the
+// step size is limited by accuracy only, not by stability.
+class Rosenbrock4 {
+public:
+    void Attach(const std::vector<Integrator*>& integrators, JacobianSource& jacobian);
+    // As RungeKuttaEngland::SetKernel; the kernel must cover every integrator.
+    void SetKernel(const SystemKernel* kernel) { kernel_ = kernel; }
+    void SetCounters(PerfCounters* counters) { counters_ = counters; }
+
+    // Same contract as RungeKuttaEngland::Step.
+    double Step(double h, double accuracy);
+    void Reject();
+
+    unsigned long Evaluations() const { return evaluations_; }
+    unsigned long JacobianEvaluations() const { return jacobians_; }
+
+private:
+    void Evaluate(std::vector<double>& f);
+    bool Factor(double h);
+    void Solve(std::vector<double>& b) const;
+
+    std::vector<Integrator*> integrators_{};
+    JacobianSource* jacobian_{nullptr};
+    const SystemKernel* kernel_{nullptr};
+    PerfCounters* counters_{nullptr};
+    std::vector<double> y0_{}, y_{}, f_{}, g1_{}, g2_{}, g3_{}, g4_{};
+    std::vector<double> J_{}, lu_{};
+    std::vector<size_t> pivot_{};
+    unsigned long evaluations_{0};
+    unsigned long jacobians_{0};
+};
@@ -9,6 +9,12 @@ double MichaelisMentenElimination(double concentration, const ModelParameters& p
     return (params.Vmax * concentration) / (params.Km + concentration);
 }
 
+double MichaelisMentenSlope(double concentration, const ModelParameters& params) {
+    if (concentration < 0) return 0.0;
+    double denominator = params.Km + concentration;
+    return params.Vmax * params.Km / (denominator * denominator);
+}
+
 double CalculateEffect(double Ce_val, double Tol_val, const ModelParameters& params) {
     if (Ce_val < 0) Ce_val = 0;
     if (Tol_val < 0) Tol_val = 0;
@@ -24,3 +30,9 @@ double ToleranceSignal(double Ce_val, const ModelParameters& params) {
     if (Ce_val < 0) Ce_val = 0;
     return Ce_val / (params.EC50_signal + Ce_val);
 }
+
+double ToleranceSignalSlope(double Ce_val, const ModelParameters& params) {
+    if (Ce_val < 0) return 0.0;
+    double denominator = params.EC50_signal + Ce_val;
+    return params.EC50_signal / (denominator * denominator);
+}
@@ -0,0 +1,296 @@
+#include "linear_propagator.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "context.hpp"
+#include "dynamics.hpp"
+#include "report.hpp"
+
+namespace {
+
+const int kN = 4;
+// The grid has four steps per block of at most kBlock hours: Simpson's rule
+// over each pair of steps, checked against the rule over the whole block.
+const double kBlock = 1.0;
+const int kSteps = 4;
+const int kTaylorTerms = 14;
+
+// Keeps the StatusMonitor samples of a run.
+class SampleRecorder : public TrajectorySink {
+public:
+    void OnSample(double, double, double C, double, double Ce, double Tol, double) override {
+        samples.push_back({C, Ce, Tol});
+    }
+
+    struct Sample {
+        double C, Ce, Tol;
+    };
+    std::vector<Sample> samples;
+};
+
+void Multiply(const double a[16], const double b[16], double out[16]) {
+    double result[16];
+    for (int i = 0; i < kN; ++i) {
+        for (int j = 0; j < kN; ++j) {
+            double sum = 0.0;
+            for (int k = 0; k < kN; ++k) sum += a[i * kN + k] * b[k * kN + j];
+            result[i * kN + j] = sum;
+        }
+    }
+    std::copy(result, result + 16, out);
+}
+
+// exp(M t) by scaling and squaring of a truncated Taylor series; after
+// scaling ||M t|| <= 1/2, where 14 terms are exact to rounding.
+void Exponential(const double M[16], double t, double out[16]) {
+    double norm = 0.0;
+    for (int i = 0; i < kN; ++i) {
+        double row = 0.0;
+        for (int j = 0; j < kN; ++j) row += std::fabs(M[i * kN + j] * t);
+        norm = std::max(norm, row);
+    }
+    int squarings = 0;
+    while (norm > 0.5) {
+        norm /= 2.0;
+        ++squarings;
+    }
+    double scale = t / std::ldexp(1.0, squarings);
+
+    double X[16];
+    double term[16];
+    for (int k = 0; k < 16; ++k) {
+        X[k] = M[k] * scale;
+        term[k] = (k % (kN + 1) == 0) ? 1.0 : 0.0;
+        out[k] = term[k];
+    }
+    for (int n = 1; n <= kTaylorTerms; ++n) {
+        Multiply(term, X, term);
+        for (int k = 0; k < 16; ++k) {
+            term[k] /= n;
+            out[k] += term[k];
+        }
+    }
+    for (int s = 0; s < squarings; ++s) Multiply(out, out, out);
+}
+
+}  // namespace
+
+LinearPropagator::LinearPropagator(const ModelParameters& params) : params_(params) {}
+
+void LinearPropagator::Prepare(double C_ref, double delta) {
+    const ModelParameters& p = params_;
+    kel_ = p.Vmax / ((p.Km + C_ref) * p.Vd);
+    delta_ = delta;
+    double ke = p.keo / p.tau_e;
+    const double M[16] = {
+        -p.ka,       0.0,            0.0,    0.0,
+        p.ka / p.Vd, -(kel_ + p.kcp), p.kpc, 0.0,
+        0.0,         p.kcp,          -p.kpc, 0.0,
+        0.0,         ke,             0.0,    -ke,
+    };
+    Exponential(M, delta, E_);
+
+    // E^k e_C: how a unit of C added k grid steps before the end of a block
+    // has spread over the compartments by then.
+    std::fill(spread_[0], spread_[0] + 4, 0.0);
+    spread_[0][1] = 1.0;
+    for (int k = 1; k <= kSteps; ++k) Apply(spread_[k - 1], spread_[k]);
+}
+
+void LinearPropagator::Apply(const double x[4], double out[4]) const {
+    for (int i = 0; i < kN; ++i) {
+        out[i] = E_[i * kN + 0] * x[0] + E_[i * kN + 1] * x[1] + E_[i * kN + 2] * x[2] + E_[i * kN + 3] * x[3];
+    }
+}
+
+size_t LinearPropagator::Propagate(double start, const std::vector<double>& ends, const double y[5],
+                                   LinearInterval& info, const std::function<bool(const double y[5])>& accept_sample) {
+    info = LinearInterval();
+    const ModelParameters& p = params_;
+    info.max_ratio = y[1] / p.Km;
+    if (ends.empty() || info.max_ratio > p.linear_ratio) return 0;
+
+    states_.resize(5 * ends.size());
+    peaks_.resize(ends.size());
+    bounds_.resize(ends.size());
+
+    double x[5];
+    std::copy(y, y + 5, x);
+    double from = start;
+    double drift = 0.0;  // estimated error of C left by the correction, summed over the blocks
+    double peak_C = x[1];
+    double grid[kSteps + 1][4];
+    double sample[5];
+    bool refresh = true;
+
+    // Left after the correction is about h (dg/dC) times the correction,
+    // h g, with g about rate C h dC/dt and dg/dC about rate C, where
+    // rate = Vmax / ((Km + C)^2 Vd): the first block keeps that at half its
+    // budget; later ones follow the error the last segment saw.
+    double dC = p.ka * x[0] / p.Vd - p.Vmax * x[1] / ((p.Km + x[1]) * p.Vd) - p.kcp * x[1] + p.kpc * x[2];
+    double rate = p.Vmax / ((p.Km + x[1]) * (p.Km + x[1]) * p.Vd);
+    double block = kBlock;
+    if (rate * x[1] * dC != 0.0) {
+        block = std::min(kBlock, std::sqrt(0.5 * p.linear_tolerance / std::fabs(dC)) / (rate * x[1]));
+    }
+
+    size_t taken = 0;
+    for (; taken < ends.size(); ++taken) {
+        double end = ends[taken];
+        if (end <= from) break;
+        int blocks = std::max(1, static_cast<int>(std::ceil((end - from) / block - 1e-12)));
+        double h = (end - from) / blocks;
+        double delta = h / kSteps;
+        double budget = 0.5 * p.linear_tolerance * h;
+        double worst = -1.0;  // largest error over the budget of a freshly frozen block
+        bool rejected = false;
+        if (delta != delta_) refresh = true;
+
+        for (int b = 0; b < blocks; ++b) {
+            // The rate is frozen at the C predicted for the middle of the block
+            // and kept, with its exponential, while the error stays small.
+            bool fresh = refresh;
+            if (refresh) {
+                double rate_C = p.ka * x[0] / p.Vd - p.Vmax * x[1] / ((p.Km + x[1]) * p.Vd) - p.kcp * x[1] +
+                                p.kpc * x[2];
+                Prepare(std::max(0.0, x[1] + 0.5 * h * rate_C), delta);
+            }
+            std::copy(x, x + 4, grid[0]);
+            for (int j = 0; j < kSteps; ++j) Apply(grid[j], grid[j + 1]);
+
+            // Frozen at kel_, elimination misses g(C) = (kel_ - Vmax / ((Km + C) Vd)) C.
+            // Fed back along the frozen trajectory, it adds
+            // integral of E(t - s) e_C g(C(s)) ds, by Simpson on the grid.
+            // What remains is the quadrature error (Richardson) and the
+            // change of g along the correction itself.
+            double g[kSteps + 1];
+            double slope = 0.0;
+            for (int j = 0; j <= kSteps; ++j) {
+                double C = grid[j][1];
+                g[j] = (kel_ - p.Vmax / ((p.Km + C) * p.Vd)) * C;
+                slope = std::max(slope, std::fabs(kel_ - p.Vmax * p.Km / ((p.Km + C) * (p.Km + C) * p.Vd)));
+            }
+            double mid[4], fine[4], coarse[4];
+            for (int i = 0; i < kN; ++i) {
+                mid[i] = delta / 3.0 * (g[0] * spread_[2][i] + 4.0 * g[1] * spread_[1][i] + g[2] * spread_[0][i]);
+                fine[i] = delta / 3.0 * (g[0] * spread_[4][i] + 4.0 * g[1] * spread_[3][i] + 2.0 * g[2] * spread_[2][i] +
+                                         4.0 * g[3] * spread_[1][i] + g[4] * spread_[0][i]);
+                coarse[i] = 2.0 * delta / 3.0 * (g[0] * spread_[4][i] + 4.0 * g[2] * spread_[2][i] + g[4] * spread_[0][i]);
+            }
+            // The correction grows from zero over the block, so its change of g
+            // is taken at half its largest value.
+            double error = std::fabs(fine[1] - coarse[1]) / 15.0 +
+                           0.5 * h * slope * std::max(std::fabs(mid[1]), std::fabs(fine[1]));
+            drift += error;
+            if (fresh) worst = std::max(worst, error / budget);
+            refresh = error > 0.5 * budget;
+
+            for (int i = 0; i < kN; ++i) {
+                grid[2][i] += mid[i];
+                grid[4][i] += fine[i];
+            }
+            for (int j = 0; j <= kSteps; ++j) {
+                peak_C = std::max(peak_C, grid[j][1]);
+                info.max_ratio = std::max(info.max_ratio, grid[j][1] / p.Km);
+            }
+            if (info.max_ratio > p.linear_ratio) {
+                rejected = true;
+                break;
+            }
+
+            // Tol(t + 2h) = e^{-kout 2h} Tol(t) + integral of e^{-kout (2h - s)} kin S(Ce)
+            // by Simpson over each pair of grid steps; over the block the
+            // difference to Simpson with step 2h estimates the error (Richardson).
+            const double decay1 = std::exp(-p.kout * delta);
+            const double decay2 = decay1 * decay1;
+            const double decay4 = decay2 * decay2;
+            double s0 = p.kin * ToleranceSignal(grid[0][3], p), s1 = p.kin * ToleranceSignal(grid[1][3], p),
+                   s2 = p.kin * ToleranceSignal(grid[2][3], p), s3 = p.kin * ToleranceSignal(grid[3][3], p),
+                   s4 = p.kin * ToleranceSignal(grid[4][3], p);
+            double Tol_mid = decay2 * x[4] + delta / 3.0 * (decay2 * s0 + 4.0 * decay1 * s1 + s2);
+            double Tol_fine = decay2 * Tol_mid + delta / 3.0 * (decay2 * s2 + 4.0 * decay1 * s3 + s4);
+            double Tol_coarse = decay4 * x[4] + 2.0 * delta / 3.0 * (decay4 * s0 + 4.0 * decay2 * s2 + s4);
+            info.quadrature_error += std::fabs(Tol_fine - Tol_coarse) / 15.0;
+
+            std::copy(grid[2], grid[2] + 4, sample);
+            sample[4] = Tol_mid;
+            if (!accept_sample(sample)) {
+                rejected = true;
+                break;
+            }
+            std::copy(grid[4], grid[4] + 4, sample);
+            sample[4] = Tol_fine;
+            if (!accept_sample(sample)) {
+                rejected = true;
+                break;
+            }
+            std::copy(sample, sample + 5, x);
+        }
+        if (rejected) break;
+        from = end;
+
+        // The Ce error feeds Tol through the signal slope, at most
+        // 1/EC50_signal. The integrator's error grows with the jump too, so
+        // the tolerance is per hour.
+        double elapsed = end - start;
+        double bound = drift * (1.0 + elapsed * p.kin / p.EC50_signal);
+        double tolerance = p.linear_tolerance * std::max(elapsed, 1.0);
+        if (bound > tolerance || info.quadrature_error > tolerance) break;
+
+        std::copy(x, x + 5, &states_[5 * taken]);
+        peaks_[taken] = peak_C;
+        bounds_[taken] = bound;
+        info.error_bound = bound;
+        info.peak_C = peak_C;
+
+        // Block errors grow with h^3 against a budget growing with h. Only
+        // freshly frozen blocks tell what h allows, and the length is kept
+        // while it fits, so the exponential can be reused.
+        if (worst > 1.0) {
+            block = h * std::max(0.2, 0.9 / std::sqrt(worst));
+        } else if (worst >= 0.0 && worst < 0.25) {
+            block = std::min(kBlock, 2.0 * h);
+        } else {
+            block = h;
+        }
+    }
+    return taken;
+}
+
+LinearValidation ValidateLinearAgainstIntegrated(const ModelParameters& params) {
+    ModelParameters reference_params = params;
+    reference_params.linear_ratio = 0.0;
+
+    std::ostream quiet(nullptr);
+    SampleRecorder reference_samples;
+    SimulationContext reference(reference_params, quiet);
+    reference.AddTrajectorySink(reference_samples);
+    reference.Run();
+
+    SampleRecorder linear_samples;
+    SimulationContext linear(params, quiet);
+    linear.AddTrajectorySink(linear_samples);
+    linear.Run();
+
+    LinearValidation validation;
+    SolverStats stats = linear.solver_stats();
+    validation.linear_intervals = stats.linear_intervals;
+    validation.linear_time = stats.linear_time;
+    validation.error_bound = stats.linear_error_bound;
+
+    RunSummary expected = SummarizeRun(reference);
+    RunSummary actual = SummarizeRun(linear);
+    validation.outcome_matches =
+        expected.patient_alive == actual.patient_alive && expected.escalations == actual.escalations;
+
+    size_t count = std::min(reference_samples.samples.size(), linear_samples.samples.size());
+    for (size_t i = 0; i < count; ++i) {
+        const SampleRecorder::Sample& a = reference_samples.samples[i];
+        const SampleRecorder::Sample& b = linear_samples.samples[i];
+        validation.max_deviation_C = std::max(validation.max_deviation_C, std::fabs(a.C - b.C));
+        validation.max_deviation_Ce = std::max(validation.max_deviation_Ce, std::fabs(a.Ce - b.Ce));
+        validation.max_deviation_Tol = std::max(validation.max_deviation_Tol, std::fabs(a.Tol - b.Tol));
+    }
+    return validation;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "parameters.hpp"
+
+// What one closed-form jump saw.
+struct LinearInterval {
+    double max_ratio{0.0};         // highest C/Km sampled on the jump
+    double peak_C{0.0};
+    double error_bound{0.0};       // estimated |C - C_exact| left by the frozen elimination rate
+    double quadrature_error{0.0};  // estimated |Tol - Tol_exact| from the quadrature
+};
+
+// Closed-form propagation for the linear regime C << Km, where
+// Michaelis-Menten elimination is effectively first order. With the
+// elimination rate frozen at Vmax / (Km + C_ref), A, C, P and Ce form a linear
+// system advanced with its matrix exponential on a uniform grid of samples.
+// The elimination the frozen rate misses is added back to first order along
+// the way, so one exponential serves many blocks. Tol depends on Ce through
+// the saturating tolerance signal and is integrated by Simpson's rule along
+// Ce(t).
+class LinearPropagator {
+public:
+    explicit LinearPropagator(const ModelParameters& params);
+
+    // Advances y = {A, C, P, Ce, Tol} from time start through consecutive
+    // segments ending at the times in ends (increasing). A segment is taken while every sample
+    // up to its end stays below linear_ratio, both error estimates stay below
+    // linear_tolerance per hour since the start and accept_sample approves
+    // every sampled state. Returns how many segments were taken; State(k) is
+    // y at ends[k] and ErrorBound(k) the estimate accumulated up to it. y with
+    // C above linear_ratio is rejected before anything is computed.
+    size_t Propagate(double start, const std::vector<double>& ends, const double y[5], LinearInterval& info,
+                     const std::function<bool(const double y[5])>& accept_sample);
+
+    const double* State(size_t k) const { return &states_[5 * k]; }
+    double PeakC(size_t k) const { return peaks_[k]; }
+    double ErrorBound(size_t k) const { return bounds_[k]; }
+
+private:
+    // Exponential of one grid step of delta hours for elimination frozen at
+    // C_ref, and its powers applied to a unit of C.
+    void Prepare(double C_ref, double delta);
+    // out = E_ x for {A, C, P, Ce}.
+    void Apply(const double x[4], double out[4]) const;
+
+    const ModelParameters& params_;
+    double kel_{0.0};
+    double delta_{0.0};
+    double E_[16]{};
+    double spread_[5][4]{};
+    std::vector<double> states_;   // 5 values per segment taken
+    std::vector<double> peaks_;
+    std::vector<double> bounds_;
+};
+
+// Deviation of a run using closed-form intervals from the same run fully
+// integrated, over the samples both take every output_interval.
+struct LinearValidation {
+    unsigned long linear_intervals{0};
+    double linear_time{0.0};
+    double error_bound{0.0};  // sum of the per-interval estimates
+    double max_deviation_C{0.0};
+    double max_deviation_Ce{0.0};
+    double max_deviation_Tol{0.0};
+    bool outcome_matches{true};  // alive flag and escalation count agree
+};
+
+LinearValidation ValidateLinearAgainstIntegrated(const ModelParameters& params);
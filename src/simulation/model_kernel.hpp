@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <memory>
+
+#include "integration.hpp"
+#include "parameters.hpp"
+
+// Hill exponent policies of PkPdKernel: x^n by repeated multiplication when
+// n is a small integer fixed at compile time, std::pow otherwise.
+template <int N>
+struct IntegerHill {
+    static double Power(double x, double n) { return x * IntegerHill<N - 1>::Power(x, n); }
+};
+
+template <>
+struct IntegerHill<1> {
+    static double Power(double x, double) { return x; }
+};
+
+struct GeneralHill {
+    static double Power(double x, double n) { return std::pow(x, n); }
+};
+
+// The five state equations of dynamics.cpp (A, C, P, Ce, Tol) plus the Hill
+// effect, with the parameters copied in at construction.
+class ModelKernel : public SystemKernel {
+public:
+    size_t Size() const override { return 5; }
+    // CalculateEffect.
+    virtual double Effect(double Ce, double Tol) const = 0;
+};
+
+// The whole right-hand side as one inlined function over a contiguous state
+// vector. The arithmetic is that of the ContinuousBlocks operation for
+// operation, so trajectories are unchanged; only the five virtual calls per
+// evaluation, the state pointer chasing and the parameter loads go away.
+template <class Hill>
+class PkPdKernel final : public ModelKernel {
+public:
+    explicit PkPdKernel(const ModelParameters& params)
+        : ka_(params.ka),
+          Vd_(params.Vd),
+          kcp_(params.kcp),
+          kpc_(params.kpc),
+          Vmax_(params.Vmax),
+          Km_(params.Km),
+          keo_tau_(params.keo / params.tau_e),
+          kin_(params.kin),
+          kout_(params.kout),
+          EC50_signal_(params.EC50_signal),
+          EC50_base_(params.EC50_base),
+          n_Hill_(params.n_Hill),
+          Emax_(params.Emax) {}
+
+    void Derivatives(const double* y, double* dy) const override { Rates(y, dy); }
+
+    double EnglandStep(const double* y0, double h, double accuracy, double* y1) const override {
+        double work[7 * 5];
+        auto rhs = [this](const double* y, double* dy) { Rates(y, dy); };
+        return RungeKuttaEnglandStep(rhs, 5, 5, y0, h, accuracy, work, y1);
+    }
+
+    double Effect(double Ce, double Tol) const override {
+        if (Ce < 0) Ce = 0;
+        if (Tol < 0) Tol = 0;
+        double EC50_current = EC50_base_ * (1.0 + Tol);
+        double Ce_n = Hill::Power(Ce, n_Hill_);
+        double EC50_n = Hill::Power(EC50_current, n_Hill_);
+        return Emax_ * Ce_n / (EC50_n + Ce_n);
+    }
+
+private:
+    void Rates(const double* y, double* dy) const {
+        double A = y[0], C = y[1], P = y[2], Ce = y[3], Tol = y[4];
+        double elimination = C < 0 ? 0.0 : (Vmax_ * C) / (Km_ + C);
+        double Ce_signal = Ce < 0 ? 0.0 : Ce;
+        dy[0] = -ka_ * A;
+        dy[1] = (ka_ * A) / Vd_ - elimination / Vd_ - kcp_ * C + kpc_ * P;
+        dy[2] = kcp_ * C - kpc_ * P;
+        dy[3] = keo_tau_ * (C - Ce);
+        dy[4] = kin_ * (Ce_signal / (EC50_signal_ + Ce_signal)) - kout_ * Tol;
+    }
+
+    double ka_, Vd_, kcp_, kpc_, Vmax_, Km_, keo_tau_, kin_, kout_, EC50_signal_;
+    double EC50_base_, n_Hill_, Emax_;
+};
+
+// Instantiation for the exponent in params: integer exponents 1 to 4 are
+// unrolled, anything else goes through std::pow.
+inline std::unique_ptr<ModelKernel> MakeModelKernel(const ModelParameters& params) {
+    ModelKernel* kernel;
+    if (params.n_Hill == 1.0) {
+        kernel = new PkPdKernel<IntegerHill<1>>(params);
+    } else if (params.n_Hill == 2.0) {
+        kernel = new PkPdKernel<IntegerHill<2>>(params);
+    } else if (params.n_Hill == 3.0) {
+        kernel = new PkPdKernel<IntegerHill<3>>(params);
+    } else if (params.n_Hill == 4.0) {
+        kernel = new PkPdKernel<IntegerHill<4>>(params);
+    } else {
+        kernel = new PkPdKernel<GeneralHill>(params);
+    }
+    return std::unique_ptr<ModelKernel>(kernel);
+}
@@ -3,107 +3,247 @@
 #include <iomanip>
 #include <iostream>
 
-using std::cout;
+#include "context.hpp"
+#include "monitoring_support.hpp"
+
 using std::endl;
 using std::fixed;
 using std::setprecision;
 using std::setw;
 
-bool CheckToxicity(const SimulationState& state, const ModelParameters& params) {
+namespace {
+
+void ReportCriticalOverdose(SimulationContext& ctx, double effect) {
+    const ModelParameters& params = ctx.params();
+    const SimulationState& state = ctx.state();
+    std::ostream& out = ctx.log(LogLevel::Events);
+
+    for (TrajectorySink* sink : ctx.trajectory_sinks()) {
+        sink->OnToxicity(ctx.Time(), ToxicityKind::CriticalOverdose, state.C->Value(), effect);
+    }
+    out << "\n!!! CRITICAL OVERDOSE at t=" << ctx.Time() << " hours !!!" << endl;
+    out << "    C(t) = " << state.C->Value() << " mg/L (critical threshold: "
+        << params.C_critical << " mg/L)" << endl;
+}
+
+void ReportRespiratoryArrest(SimulationContext& ctx, double effect) {
+    const SimulationState& state = ctx.state();
+    std::ostream& out = ctx.log(LogLevel::Events);
+
+    for (TrajectorySink* sink : ctx.trajectory_sinks()) {
+        sink->OnToxicity(ctx.Time(), ToxicityKind::RespiratoryArrest, state.C->Value(), effect);
+    }
+    out << "\n!!! RESPIRATORY ARREST at t=" << ctx.Time() << " hours !!!" << endl;
+    out << "    Respiratory depression = " << effect << "%" << endl;
+}
+
+void ReportToxicWarning(SimulationContext& ctx, double effect) {
+    const SimulationState& state = ctx.state();
+    std::ostream& out = ctx.log(LogLevel::Events);
+
+    for (TrajectorySink* sink : ctx.trajectory_sinks()) {
+        sink->OnToxicity(ctx.Time(), ToxicityKind::ToxicWarning, state.C->Value(), effect);
+    }
+    out << "\n>>> WARNING: Toxic concentration reached at t=" << ctx.Time()
+        << " hours <<<" << endl;
+    out << "    C(t) = " << state.C->Value() << " mg/L" << endl;
+}
+
+void StateEventValues(const ModelParameters& params, double C, double effect, double values[kStateEventCount]) {
+    values[static_cast<int>(StateEvent::CriticalConcentration)] = C - params.C_critical;
+    values[static_cast<int>(StateEvent::RespiratoryArrest)] = effect - params.Effect_resp_critical;
+    values[static_cast<int>(StateEvent::ToxicConcentration)] = C - params.C_toxic;
+    values[static_cast<int>(StateEvent::SaturationOnset)] = C / params.Km - 1.0;
+    values[static_cast<int>(StateEvent::SaturationPlateau)] = C / params.Km - 3.0;
+}
+
+}  // namespace
+
+bool CheckToxicity(SimulationContext& ctx) {
+    const ModelParameters& params = ctx.params();
+    const SimulationState& state = ctx.state();
+
     double effect = CalculateEffect(state.Ce->Value(), state.Tol->Value(), params);
 
     if (state.C->Value() > params.C_critical) {
-        cout << "\n!!! CRITICAL OVERDOSE at t=" << Time << " hours !!!" << endl;
-        cout << "    C(t) = " << state.C->Value() << " mg/L (critical threshold: "
-             << params.C_critical << " mg/L)" << endl;
+        ReportCriticalOverdose(ctx, effect);
         return true;
     }
 
     if (effect > params.Effect_resp_critical) {
-        cout << "\n!!! RESPIRATORY ARREST at t=" << Time << " hours !!!" << endl;
-        cout << "    Respiratory depression = " << effect << "%" << endl;
+        ReportRespiratoryArrest(ctx, effect);
         return true;
     }
 
     if (state.C->Value() > params.C_toxic) {
-        cout << "\n>>> WARNING: Toxic concentration reached at t=" << Time
-             << " hours <<<" << endl;
-        cout << "    C(t) = " << state.C->Value() << " mg/L" << endl;
+        ReportToxicWarning(ctx, effect);
     }
 
     return false;
 }
 
-void StatusMonitor::Behavior() {
-    double effect = CalculateEffect(state_.Ce->Value(), state_.Tol->Value(), params_);
+void HandleOverdose(SimulationContext& ctx) {
+    const ModelParameters& params = ctx.params();
+    PetriNetState& petri_state = ctx.petri_state();
+    std::ostream& out = ctx.log(LogLevel::Events);
+
+    // A patient already waiting for naloxone keeps its first call: polling
+    // again before the responder arrives must not place a second one.
+    if (!petri_state.patient_alive) return;
+
+    petri_state.patient_alive = false;
+    petri_state.time_overdose_detected = ctx.Time();
+
+    if (params.naloxone_available && ctx.shared_responders()) {
+        out << "\n>>> EMERGENCY CALL PLACED (waiting for a responder) <<<" << endl;
+        ctx.RequestResponder();
+        return;
+    }
+
+    if (params.naloxone_available) {
+        double response_time = params.naloxone_response_delay;
+        out << "\n>>> EMERGENCY RESPONSE DISPATCHED (ETA: " 
+            << (response_time * 60) << " minutes) <<<" << endl;
 
-    cout << fixed << setprecision(2);
-    cout << "t=" << setw(6) << Time << "h | "
-         << "A=" << setw(6) << state_.A->Value() << " mg | "
-         << "C=" << setw(6) << state_.C->Value() << " mg/L | "
-         << "P=" << setw(6) << state_.P->Value() << " mg/L | "
-         << "Ce=" << setw(6) << state_.Ce->Value() << " mg/L | "
-         << "Tol=" << setw(5) << state_.Tol->Value() << " | "
-         << "Effect=" << setw(5) << effect << "%" << endl;
-
-    if (CheckToxicity(state_, params_)) {
-        petri_state_.patient_alive = false;
-        petri_state_.time_overdose_detected = Time;
-        
-        if (params_.naloxone_available) {
-            double response_time = params_.naloxone_response_delay;
-            cout << "\n>>> EMERGENCY RESPONSE DISPATCHED (ETA: " 
-                 << (response_time * 60) << " minutes) <<<" << endl;
-            
-            NaloxoneRescue* rescue_event = new NaloxoneRescue(params_, state_, petri_state_);
-            rescue_event->Activate(Time + response_time);
-            
-            Activate(Time + params_.output_interval);
-            return;
+        for (TrajectorySink* sink : ctx.trajectory_sinks()) {
+            sink->OnNaloxone(ctx.Time(), NaloxoneOutcome::Dispatched, 0.0);
         }
-        
-        Stop();
+
+        ctx.AcquireEvent<NaloxoneRescue>().Activate(ctx.Time() + response_time);
         return;
     }
 
-    Activate(Time + params_.output_interval);
+    ctx.Stop();
+}
+
+void EvaluateStateEvents(SimulationContext& ctx, double values[kStateEventCount]) {
+    const SimulationState& state = ctx.state();
+    double effect = ctx.kernel().Effect(state.Ce->Value(), state.Tol->Value());
+    StateEventValues(ctx.params(), state.C->Value(), effect, values);
+}
+
+void EvaluateStateEvents(const ModelParameters& params, double C, double Ce, double Tol,
+                         double values[kStateEventCount]) {
+    StateEventValues(params, C, CalculateEffect(Ce, Tol, params), values);
+}
+
+void HandleStateEvent(SimulationContext& ctx, StateEvent event) {
+    const SimulationState& state = ctx.state();
+    PetriNetState& petri_state = ctx.petri_state();
+    double effect = CalculateEffect(state.Ce->Value(), state.Tol->Value(), ctx.params());
+
+    switch (event) {
+        case StateEvent::CriticalConcentration:
+        case StateEvent::RespiratoryArrest:
+            // Both thresholds can be crossed in the same instant, and a
+            // patient already waiting for naloxone is not dispatched twice.
+            if (!petri_state.patient_alive || ctx.Stopped()) return;
+            if (event == StateEvent::CriticalConcentration) {
+                ReportCriticalOverdose(ctx, effect);
+            } else {
+                ReportRespiratoryArrest(ctx, effect);
+            }
+            HandleOverdose(ctx);
+            break;
+        case StateEvent::ToxicConcentration:
+            ReportToxicWarning(ctx, effect);
+            break;
+        case StateEvent::SaturationOnset:
+        case StateEvent::SaturationPlateau:
+            MonitorSaturation(ctx);
+            break;
+    }
+}
+
+StatusMonitor::StatusMonitor(SimulationContext& ctx)
+    : ScheduledEvent(ctx),
+      params_(ctx.params()),
+      state_(ctx.state()),
+      petri_state_(ctx.petri_state()) {}
+
+void StatusMonitor::Behavior() {
+    TraceSpan span(ctx_, TraceSpanKind::StatusMonitor);
+    std::ostream& out = ctx_.log(LogLevel::Events);
+    double effect = CalculateEffect(state_.Ce->Value(), state_.Tol->Value(), params_);
+
+    out << fixed << setprecision(2);
+    out << "t=" << setw(6) << ctx_.Time() << "h | "
+        << "A=" << setw(6) << state_.A->Value() << " mg | "
+        << "C=" << setw(6) << state_.C->Value() << " mg/L | "
+        << "P=" << setw(6) << state_.P->Value() << " mg/L | "
+        << "Ce=" << setw(6) << state_.Ce->Value() << " mg/L | "
+        << "Tol=" << setw(5) << state_.Tol->Value() << " | "
+        << "Effect=" << setw(5) << effect << "%" << endl;
+
+    for (TrajectorySink* sink : ctx_.trajectory_sinks()) {
+        sink->OnSample(ctx_.Time(), state_.A->Value(), state_.C->Value(), state_.P->Value(),
+                       state_.Ce->Value(), state_.Tol->Value(), effect);
+    }
+
+    // With state events the thresholds are located by the integrator instead.
+    if (!params_.state_events && CheckToxicity(ctx_)) {
+        HandleOverdose(ctx_);
+        if (ctx_.Stopped()) return;
+    }
+
+    Activate(ctx_.Time() + params_.output_interval);
 }
 
+DosingEvent::DosingEvent(SimulationContext& ctx)
+    : ScheduledEvent(ctx), params_(ctx.params()), state_(ctx.state()) {}
+
 void DosingEvent::Behavior() {
-    cout << "\n>>> DOSE ADMINISTERED at t=" << Time << " hours: "
-         << params_.current_dose << " mg <<<" << endl;
+    ctx_.log(LogLevel::Events) << "\n>>> DOSE ADMINISTERED at t=" << ctx_.Time() << " hours: "
+               << params_.current_dose << " mg <<<" << endl;
 
     *state_.A = state_.A->Value() + params_.current_dose;
 
-    Activate(Time + params_.dosing_interval);
+    Activate(ctx_.Time() + params_.dosing_interval);
 }
 
+NaloxoneRescue::NaloxoneRescue(SimulationContext& ctx)
+    : ScheduledEvent(ctx),
+      params_(ctx.params()),
+      state_(ctx.state()),
+      petri_state_(ctx.petri_state()) {}
+
 void NaloxoneRescue::Behavior() {
-    double time_since_OD = Time - petri_state_.time_overdose_detected;
+    TraceSpan span(ctx_, TraceSpanKind::NaloxoneRescue);
+    std::ostream& out = ctx_.log(LogLevel::Events);
+    double time_since_OD = ctx_.Time() - petri_state_.time_overdose_detected;
     
-    cout << "\n>>> NALOXONE RESCUE TEAM ARRIVED at t=" << Time << " hours <<<" << endl;
-    cout << "Time since overdose: " << fixed << setprecision(2) 
-         << (time_since_OD * 60) << " minutes" << endl;
+    out << "\n>>> NALOXONE RESCUE TEAM ARRIVED at t=" << ctx_.Time() << " hours <<<" << endl;
+    out << "Time since overdose: " << fixed << setprecision(2) 
+        << (time_since_OD * 60) << " minutes" << endl;
+    for (TrajectorySink* sink : ctx_.trajectory_sinks()) {
+        sink->OnNaloxone(ctx_.Time(), NaloxoneOutcome::Arrived, time_since_OD);
+    }
     
     if (time_since_OD > params_.naloxone_effective_window) {
-        cout << "\n!!! NALOXONE WINDOW EXPIRED (>" 
-             << (params_.naloxone_effective_window * 60)
-             << " min) - RESCUE FAILED !!!" << endl;
-        cout << "Patient Status: DECEASED" << endl;
-        cout << "Cause: Response time (" << (time_since_OD * 60) 
-             << " min) exceeded therapeutic window" << endl;
-        Stop();
+        for (TrajectorySink* sink : ctx_.trajectory_sinks()) {
+            sink->OnNaloxone(ctx_.Time(), NaloxoneOutcome::WindowExpired, time_since_OD);
+        }
+        out << "\n!!! NALOXONE WINDOW EXPIRED (>" 
+            << (params_.naloxone_effective_window * 60)
+            << " min) - RESCUE FAILED !!!" << endl;
+        out << "Patient Status: DECEASED" << endl;
+        out << "Cause: Response time (" << (time_since_OD * 60) 
+            << " min) exceeded therapeutic window" << endl;
+        ctx_.Stop();
         return;
     }
     
-    PatientAssessment* assessment = new PatientAssessment(params_, state_, petri_state_);
-    assessment->CheckAndApplyNaloxonePublic();
-    delete assessment;
+    CheckAndApplyNaloxone(ctx_);
     
+    NaloxoneOutcome outcome = petri_state_.patient_alive ? NaloxoneOutcome::Revived : NaloxoneOutcome::Failed;
+    for (TrajectorySink* sink : ctx_.trajectory_sinks()) {
+        sink->OnNaloxone(ctx_.Time(), outcome, time_since_OD);
+    }
+
     if (petri_state_.patient_alive) {
-        cout << "\n>>> RESCUE SUCCESSFUL - Patient REVIVED <<<" << endl;
+        out << "\n>>> RESCUE SUCCESSFUL - Patient REVIVED <<<" << endl;
     } else {
-        cout << "\n!!! RESCUE FAILED - Patient DECEASED !!!" << endl;
-        Stop();
+        out << "\n!!! RESCUE FAILED - Patient DECEASED !!!" << endl;
+        ctx_.Stop();
     }
 }
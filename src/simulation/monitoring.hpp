@@ -1,18 +1,39 @@
 #pragma once
 
-#include <simlib.h>
-
 #include <iostream>
 
-#include "dynamics.hpp"
 #include "behavior.hpp"
+#include "calendar.hpp"
+#include "dynamics.hpp"
+
+class SimulationContext;
+
+bool CheckToxicity(SimulationContext& ctx);
+// Marks the patient as overdosed now and dispatches naloxone if available,
+// otherwise stops the run.
+void HandleOverdose(SimulationContext& ctx);
+
+// Threshold crossings located inside integration steps when state_events is
+// enabled, instead of being polled by StatusMonitor and PatientAssessment.
+enum class StateEvent : int {
+    CriticalConcentration = 0,  // C rises above C_critical
+    RespiratoryArrest = 1,      // Effect rises above Effect_resp_critical
+    ToxicConcentration = 2,     // C rises above C_toxic
+    SaturationOnset = 3,        // C/Km rises above 1
+    SaturationPlateau = 4,      // C/Km rises above 3
+};
+const int kStateEventCount = 5;
 
-bool CheckToxicity(const SimulationState& state, const ModelParameters& params);
+// Signed distance to each threshold at the current state; an event fires
+// when its value goes from <= 0 to > 0 within a step.
+void EvaluateStateEvents(SimulationContext& ctx, double values[kStateEventCount]);
+void EvaluateStateEvents(const ModelParameters& params, double C, double Ce, double Tol,
+                         double values[kStateEventCount]);
+void HandleStateEvent(SimulationContext& ctx, StateEvent event);
 
-class StatusMonitor : public Event {
+class StatusMonitor : public ScheduledEvent {
 public:
-    StatusMonitor(const ModelParameters& params, SimulationState& state, PetriNetState& petri_state)
-        : params_(params), state_(state), petri_state_(petri_state) {}
+    explicit StatusMonitor(SimulationContext& ctx);
     void Behavior() override;
 
 private:
@@ -21,10 +42,9 @@ private:
     PetriNetState& petri_state_;
 };
 
-class DosingEvent : public Event {
+class DosingEvent : public ScheduledEvent {
 public:
-    DosingEvent(const ModelParameters& params, SimulationState& state)
-        : params_(params), state_(state) {}
+    explicit DosingEvent(SimulationContext& ctx);
     void Behavior() override;
 
 private:
@@ -32,10 +52,9 @@ private:
     SimulationState& state_;
 };
 
-class NaloxoneRescue : public Event {
+class NaloxoneRescue : public ScheduledEvent {
 public:
-    NaloxoneRescue(const ModelParameters& params, SimulationState& state, PetriNetState& petri_state)
-        : params_(params), state_(state), petri_state_(petri_state) {}
+    explicit NaloxoneRescue(SimulationContext& ctx);
     void Behavior() override;
 
 private:
@@ -1,53 +1,65 @@
 #include "monitoring_support.hpp"
 
-#include <simlib.h>
-
 #include <iomanip>
 #include <iostream>
 
-using std::cout;
+#include "context.hpp"
+
 using std::endl;
 
-void MonitorSaturation(const ModelParameters& params, SimulationState& cont_state) {
+void MonitorSaturation(SimulationContext& ctx) {
+    const ModelParameters& params = ctx.params();
+    SimulationState& cont_state = ctx.state();
+    MonitorFlags& flags = ctx.monitor_flags();
+    std::ostream& out = ctx.log(LogLevel::Events);
+
     double C_val = cont_state.C->Value();
     double saturation_ratio = C_val / params.Km;
     
-    static bool phase2_flagged = false;
-    static bool phase3_flagged = false;
-    
-    if (!phase2_flagged && saturation_ratio > 1.0) {
-        phase2_flagged = true;
-        cout << "\n╔═══════════════════════════════════════════════════════════╗" << endl;
-        cout << "║ PHASE TRANSITION: SATURATION ZONE ENTERED (Phase 2)      ║" << endl;
-        cout << "║ Time: " << Time << " hours  |  C/Km ratio: " << saturation_ratio << endl;
-        cout << "║ Concentration: " << C_val << " mg/L                              ║" << endl;
-        cout << "║ Status: NONLINEAR KINETICS ACTIVE                        ║" << endl;
-        cout << "╚═══════════════════════════════════════════════════════════╝\n" << endl;
+    if (!flags.phase2_flagged && saturation_ratio > 1.0) {
+        flags.phase2_flagged = true;
+        for (TrajectorySink* sink : ctx.trajectory_sinks()) {
+            sink->OnPhaseTransition(ctx.Time(), 2, saturation_ratio, C_val);
+        }
+        out << "\n╔═══════════════════════════════════════════════════════════╗" << endl;
+        out << "║ PHASE TRANSITION: SATURATION ZONE ENTERED (Phase 2)      ║" << endl;
+        out << "║ Time: " << ctx.Time() << " hours  |  C/Km ratio: " << saturation_ratio << endl;
+        out << "║ Concentration: " << C_val << " mg/L                              ║" << endl;
+        out << "║ Status: NONLINEAR KINETICS ACTIVE                        ║" << endl;
+        out << "╚═══════════════════════════════════════════════════════════╝\n" << endl;
     }
     
-    if (!phase3_flagged && saturation_ratio > 3.0) {
-        phase3_flagged = true;
-        cout << "\n╔═══════════════════════════════════════════════════════════╗" << endl;
-        cout << "║ PHASE TRANSITION: CATASTROPHIC ZONE (Phase 3)            ║" << endl;
-        cout << "║ Time: " << Time << " hours  |  C/Km ratio: " << saturation_ratio << endl;
-        cout << "║ PATIENT IN CRITICAL DANGER                               ║" << endl;
-        cout << "╚═══════════════════════════════════════════════════════════╝\n" << endl;
+    if (!flags.phase3_flagged && saturation_ratio > 3.0) {
+        flags.phase3_flagged = true;
+        for (TrajectorySink* sink : ctx.trajectory_sinks()) {
+            sink->OnPhaseTransition(ctx.Time(), 3, saturation_ratio, C_val);
+        }
+        out << "\n╔═══════════════════════════════════════════════════════════╗" << endl;
+        out << "║ PHASE TRANSITION: CATASTROPHIC ZONE (Phase 3)            ║" << endl;
+        out << "║ Time: " << ctx.Time() << " hours  |  C/Km ratio: " << saturation_ratio << endl;
+        out << "║ PATIENT IN CRITICAL DANGER                               ║" << endl;
+        out << "╚═══════════════════════════════════════════════════════════╝\n" << endl;
     }
 }
 
-void CheckAndApplyNaloxone(const ModelParameters& params, SimulationState& cont_state, PetriNetState& petri_state) {
+void CheckAndApplyNaloxone(SimulationContext& ctx) {
+    const ModelParameters& params = ctx.params();
+    SimulationState& cont_state = ctx.state();
+    PetriNetState& petri_state = ctx.petri_state();
+    std::ostream& out = ctx.log(LogLevel::Events);
+
     if (petri_state.patient_alive) {
         return;
     }
     
     if (!params.naloxone_available) {
-        cout << "\n!!! Naloxone NOT AVAILABLE - Patient cannot be rescued !!!" << endl;
+        out << "\n!!! Naloxone NOT AVAILABLE - Patient cannot be rescued !!!" << endl;
         return;
     }
     
-    cout << "\n╔═══════════════════════════════════════════════════════════╗" << endl;
-    cout << "║ T6: NALOXONE RESCUE ACTIVATED                            ║" << endl;
-    cout << "╚═══════════════════════════════════════════════════════════╝" << endl;
+    out << "\n╔═══════════════════════════════════════════════════════════╗" << endl;
+    out << "║ T6: NALOXONE RESCUE ACTIVATED                            ║" << endl;
+    out << "╚═══════════════════════════════════════════════════════════╝" << endl;
     
     double C_before = cont_state.C->Value();
     double Ce_before = cont_state.Ce->Value();
@@ -59,10 +71,16 @@ void CheckAndApplyNaloxone(const ModelParameters& params, SimulationState& cont_
     *cont_state.Ce = Ce_before * 0.1;
     
     *cont_state.Tol = Tol_before * 0.7;
+
+    if (ForwardSensitivities* sensitivities = ctx.sensitivities()) {
+        sensitivities->ScaleState(1, 1.0 - blockade_factor);
+        sensitivities->ScaleState(3, 0.1);
+        sensitivities->ScaleState(4, 0.7);
+    }
     
-    cout << "C(t): " << C_before << " → " << cont_state.C->Value() << " mg/L" << endl;
-    cout << "Ce(t): " << Ce_before << " → " << cont_state.Ce->Value() << " mg/L" << endl;
-    cout << "Tol(t): " << Tol_before << " → " << cont_state.Tol->Value() << endl;
+    out << "C(t): " << C_before << " → " << cont_state.C->Value() << " mg/L" << endl;
+    out << "Ce(t): " << Ce_before << " → " << cont_state.Ce->Value() << " mg/L" << endl;
+    out << "Tol(t): " << Tol_before << " → " << cont_state.Tol->Value() << endl;
     
     petri_state.patient_alive = true;
     
@@ -70,8 +88,8 @@ void CheckAndApplyNaloxone(const ModelParameters& params, SimulationState& cont_
     petri_state.relief_state = false;
     petri_state.motivation = 3.0;
     
-    cout << "\nPatient REVIVED but experiencing ACUTE WITHDRAWAL" << endl;
-    cout << "Status: ALIVE but in severe distress" << endl;
-    cout << "Requires: ICU monitoring, serial naloxone dosing" << endl;
-    cout << "Risk: Re-overdose in 1-2 hours if opioid still circulating" << endl;
+    out << "\nPatient REVIVED but experiencing ACUTE WITHDRAWAL" << endl;
+    out << "Status: ALIVE but in severe distress" << endl;
+    out << "Requires: ICU monitoring, serial naloxone dosing" << endl;
+    out << "Risk: Re-overdose in 1-2 hours if opioid still circulating" << endl;
 }
@@ -4,5 +4,13 @@
 #include "dynamics.hpp"
 #include "parameters.hpp"
 
-void MonitorSaturation(const ModelParameters& params, SimulationState& cont_state);
-void CheckAndApplyNaloxone(const ModelParameters& params, SimulationState& cont_state, PetriNetState& petri_state);
+class SimulationContext;
+
+// Phase transitions already reported during this run.
+struct MonitorFlags {
+    bool phase2_flagged{false};
+    bool phase3_flagged{false};
+};
+
+void MonitorSaturation(SimulationContext& ctx);
+void CheckAndApplyNaloxone(SimulationContext& ctx);
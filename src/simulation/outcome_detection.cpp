@@ -0,0 +1,140 @@
+#include "outcome_detection.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+#include "context.hpp"
+#include "report.hpp"
+
+const char* PredictedOutcomeName(PredictedOutcome outcome) {
+    switch (outcome) {
+        case PredictedOutcome::None:
+            return "none";
+        case PredictedOutcome::Stable:
+            return "stable";
+        case PredictedOutcome::Collapse:
+            return "collapse";
+    }
+    return "none";
+}
+
+bool OutcomeDetector::Observe(const ModelParameters& params, double t, double effect, double C, double Tol,
+                              AssessmentDecision decision) {
+    if (prediction_.outcome != PredictedOutcome::None) return true;
+
+    window_.push_back(Observation{t, effect, C, Tol, decision == AssessmentDecision::Increase});
+    size_t size = params.outcome_window > 2.0 ? static_cast<size_t>(params.outcome_window) : 2;
+    while (window_.size() > size) window_.pop_front();
+    if (window_.size() < size) return false;
+
+    if (DetectCollapse(params) || DetectStable(params)) {
+        prediction_.time = t;
+        return true;
+    }
+    return false;
+}
+
+double OutcomeDetector::Slope(double Observation::*value) const {
+    double n = static_cast<double>(window_.size());
+    double mean_t = 0.0, mean_value = 0.0;
+    for (const Observation& o : window_) {
+        mean_t += o.t / n;
+        mean_value += o.*value / n;
+    }
+    double covariance = 0.0, variance = 0.0;
+    for (const Observation& o : window_) {
+        covariance += (o.t - mean_t) * (o.*value - mean_value);
+        variance += (o.t - mean_t) * (o.t - mean_t);
+    }
+    return variance > 0.0 ? covariance / variance : 0.0;
+}
+
+bool OutcomeDetector::DetectStable(const ModelParameters& params) {
+    double floor = params.effect_relief_threshold + params.stable_margin;
+    double max_change = 0.0;
+    for (size_t i = 0; i < window_.size(); ++i) {
+        const Observation& o = window_[i];
+        // In the plateau regime elimination is capacity-limited, so a slow
+        // drift of C can run away faster than any linear trend suggests.
+        if (o.escalated || o.effect < floor || o.C / params.Km > params.collapse_ratio) return false;
+        if (i > 0) {
+            double change = std::fabs(o.C - window_[i - 1].C) / std::max(o.C, 1e-12);
+            if (change > params.stable_tolerance) return false;
+            max_change = std::max(max_change, change);
+        }
+    }
+
+    // Least-squares trends, extrapolated only in the unsafe direction: a
+    // falling effect that would reach the relief threshold, or a slow
+    // accumulation of C that would reach C_toxic, before the end.
+    double remaining = params.sim_duration - window_.back().t;
+    double final_effect = window_.back().effect + std::min(Slope(&Observation::effect), 0.0) * remaining;
+    double final_C = window_.back().C + std::max(Slope(&Observation::C), 0.0) * remaining;
+    if (final_effect < floor || final_C >= params.C_toxic) return false;
+
+    std::ostringstream reason;
+    reason << std::fixed << std::setprecision(2) << "periodic cycle (C changes <= " << max_change * 100.0
+           << "% per assessment), effect " << window_.back().effect << "% extrapolates to " << final_effect
+           << "% and C " << window_.back().C << " to " << final_C << " mg/L at t=" << params.sim_duration
+           << "h, above the relief threshold and below C_toxic";
+    prediction_.outcome = PredictedOutcome::Stable;
+    prediction_.reason = reason.str();
+    return true;
+}
+
+bool OutcomeDetector::DetectCollapse(const ModelParameters& params) {
+    const Observation& last = window_.back();
+    if (last.C / params.Km <= params.collapse_ratio) return false;
+    for (size_t i = 1; i < window_.size(); ++i) {
+        if (window_[i].C <= window_[i - 1].C || window_[i].Tol <= window_[i - 1].Tol) return false;
+    }
+    // A rise that slows down is settling onto a plateau, not running away.
+    size_t n = window_.size();
+    if (window_[n - 1].C - window_[n - 2].C < window_[1].C - window_[0].C) return false;
+
+    double cycles = static_cast<double>(window_.size() - 1);
+    std::ostringstream reason;
+    reason << std::fixed << std::setprecision(2) << "C/Km " << last.C / params.Km << " > " << params.collapse_ratio
+           << " with C rising " << (last.C - window_.front().C) / cycles << " mg/L and Tol "
+           << std::setprecision(4) << (last.Tol - window_.front().Tol) / cycles << " per assessment for "
+           << window_.size() << " assessments";
+    prediction_.outcome = PredictedOutcome::Collapse;
+    prediction_.reason = reason.str();
+    return true;
+}
+
+OutcomeValidation ValidateOutcomeDetection(const ModelParameters& params) {
+    ModelParameters detecting_params = params;
+    detecting_params.outcome_detection = true;
+    ModelParameters reference_params = params;
+    reference_params.outcome_detection = false;
+
+    std::ostream quiet(nullptr);
+    SimulationContext detecting(detecting_params, quiet);
+    detecting.Run();
+    SimulationContext reference(reference_params, quiet);
+    reference.Run();
+
+    OutcomeValidation validation;
+    validation.prediction = detecting.outcome_prediction();
+    RunSummary early = SummarizeRun(detecting);
+    RunSummary full = SummarizeRun(reference);
+    validation.actual_alive = full.patient_alive;
+    validation.actual_time_of_death = full.time_of_death;
+    validation.escalations_at_prediction = early.escalations;
+    validation.actual_escalations = full.escalations;
+    validation.hours_saved = full.end_time - early.end_time;
+    switch (validation.prediction.outcome) {
+        case PredictedOutcome::None:
+            break;
+        case PredictedOutcome::Stable:
+            validation.correct = full.patient_alive && full.escalations == early.escalations;
+            break;
+        case PredictedOutcome::Collapse:
+            validation.correct = !full.patient_alive;
+            break;
+    }
+    return validation;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <deque>
+#include <string>
+
+#include "parameters.hpp"
+#include "trajectory_sink.hpp"
+
+// Outcome an early-stopped run was predicted to reach.
+enum class PredictedOutcome : int {
+    None = 0,      // the run went its full length
+    Stable = 1,    // periodic cycle above the relief threshold; no further escalation
+    Collapse = 2,  // plateau regime with C and tolerance still rising; overdose
+};
+
+const char* PredictedOutcomeName(PredictedOutcome outcome);
+
+struct OutcomePrediction {
+    PredictedOutcome outcome{PredictedOutcome::None};
+    double time{0.0};  // hours; when the outcome was recognized
+    std::string reason{};
+};
+
+// Opt-in (outcome_detection = 1) stage of PatientAssessment that ends a run
+// once its outcome no longer depends on the rest of the horizon. Both rules
+// look at the last outcome_window assessments:
+//
+//   Stable    no escalation in the window, C/Km at most collapse_ratio, C
+//             at assessment changing by at most stable_tolerance (relative)
+//             from one cycle to the next, and, extrapolated linearly to the
+//             end of the run, the effect still stable_margin above
+//             effect_relief_threshold (so ShouldIncreaseDose can never fire
+//             again) and C below C_toxic.
+//   Collapse  C/Km above collapse_ratio with C and Tol rising at every
+//             assessment of the window, and C rising no slower at its end
+//             than at its start: elimination is saturated and the Petri
+//             net keeps escalating into it.
+//
+// The history is not part of a SimulationSnapshot; it restarts on Restore.
+class OutcomeDetector {
+public:
+    // Records one assessment; returns true once the outcome is determined.
+    bool Observe(const ModelParameters& params, double t, double effect, double C, double Tol,
+                 AssessmentDecision decision);
+
+    const OutcomePrediction& prediction() const { return prediction_; }
+
+private:
+    struct Observation {
+        double t;
+        double effect;
+        double C;
+        double Tol;
+        bool escalated;
+    };
+
+    // Least-squares slope of value over time across the window, per hour.
+    double Slope(double Observation::*value) const;
+    bool DetectStable(const ModelParameters& params);
+    bool DetectCollapse(const ModelParameters& params);
+
+    std::deque<Observation> window_{};
+    OutcomePrediction prediction_{};
+};
+
+// A run with outcome detection checked against the same run taken to its
+// full length without it.
+struct OutcomeValidation {
+    OutcomePrediction prediction{};
+    bool actual_alive{true};
+    double actual_time_of_death{0.0};
+    int escalations_at_prediction{0};
+    int actual_escalations{0};
+    // Stable: the full run survives without another escalation. Collapse:
+    // the full run dies. No prediction is trivially correct.
+    bool correct{true};
+    double hours_saved{0.0};
+};
+
+OutcomeValidation ValidateOutcomeDetection(const ModelParameters& params);
@@ -3,6 +3,9 @@
 #include "behavior.hpp"
 #include "parameters.hpp"
 
-void UpdatePainLevel(double effect, PetriNetState& petri_state);
+#include <ostream>
+
+void UpdatePainLevel(double effect, PetriNetState& petri_state, std::ostream& out);
 void UpdatePainLevelContinuous(double effect, PetriNetState& petri_state);
-void UpdateMotivation(double dt, const ModelParameters& params, PetriNetState& petri_state);
+void UpdateMotivation(double dt, const ModelParameters& params, PetriNetState& petri_state,
+                      std::ostream& out);
@@ -2,9 +2,96 @@
 
 #include <iostream>
 
-using std::cout;
 using std::endl;
 
+namespace {
+
+struct ParameterField {
+    const char* key;
+    double ModelParameters::*member;
+};
+
+const ParameterField kParameterFields[] = {
+    {"ka", &ModelParameters::ka},
+    {"Vd", &ModelParameters::Vd},
+    {"Vp", &ModelParameters::Vp},
+    {"kcp", &ModelParameters::kcp},
+    {"kpc", &ModelParameters::kpc},
+    {"Vmax", &ModelParameters::Vmax},
+    {"Km", &ModelParameters::Km},
+    {"keo", &ModelParameters::keo},
+    {"tau_e", &ModelParameters::tau_e},
+    {"Emax", &ModelParameters::Emax},
+    {"EC50_base", &ModelParameters::EC50_base},
+    {"n_Hill", &ModelParameters::n_Hill},
+    {"kin", &ModelParameters::kin},
+    {"kout", &ModelParameters::kout},
+    {"EC50_signal", &ModelParameters::EC50_signal},
+    {"C_toxic", &ModelParameters::C_toxic},
+    {"C_critical", &ModelParameters::C_critical},
+    {"Effect_resp_critical", &ModelParameters::Effect_resp_critical},
+    {"initial_dose", &ModelParameters::current_dose},
+    {"dosing_interval", &ModelParameters::dosing_interval},
+    {"duration", &ModelParameters::sim_duration},
+    {"step_min", &ModelParameters::sim_step_min},
+    {"step_max", &ModelParameters::sim_step_max},
+    {"accuracy", &ModelParameters::sim_accuracy},
+    {"output_interval", &ModelParameters::output_interval},
+    {"implicit_step_max", &ModelParameters::implicit_step_max},
+    {"linear_ratio", &ModelParameters::linear_ratio},
+    {"linear_tolerance", &ModelParameters::linear_tolerance},
+    {"outcome_window", &ModelParameters::outcome_window},
+    {"stable_tolerance", &ModelParameters::stable_tolerance},
+    {"stable_margin", &ModelParameters::stable_margin},
+    {"collapse_ratio", &ModelParameters::collapse_ratio},
+    {"assessment_interval", &ModelParameters::assessment_interval},
+    {"relief_threshold", &ModelParameters::relief_threshold},
+    {"effect_relief_threshold", &ModelParameters::effect_relief_threshold},
+    {"motivation_threshold", &ModelParameters::motivation_threshold},
+    {"motivation_pain_rate", &ModelParameters::motivation_pain_rate},
+    {"motivation_dose_reduction", &ModelParameters::motivation_dose_reduction},
+    {"motivation_decay_rate", &ModelParameters::motivation_decay_rate},
+    {"min_dosing_interval", &ModelParameters::min_dosing_interval},
+    {"base_escalation_factor", &ModelParameters::base_escalation_factor},
+    {"tolerance_escalation_factor", &ModelParameters::tolerance_escalation_factor},
+    {"max_dose", &ModelParameters::max_dose},
+    {"taper_factor", &ModelParameters::taper_factor},
+    {"taper_start", &ModelParameters::taper_start},
+    {"behavior_seed", &ModelParameters::behavior_seed},
+    {"behavior_stream", &ModelParameters::behavior_stream},
+    {"assessment_jitter", &ModelParameters::assessment_jitter},
+    {"escalation_slope", &ModelParameters::escalation_slope},
+    {"pain_noise", &ModelParameters::pain_noise},
+    {"missed_dose_probability", &ModelParameters::missed_dose_probability},
+    {"extra_dose_probability", &ModelParameters::extra_dose_probability},
+    {"naloxone_effective_window", &ModelParameters::naloxone_effective_window},
+    {"naloxone_blockade_strength", &ModelParameters::naloxone_blockade_strength},
+    {"naloxone_response_delay", &ModelParameters::naloxone_response_delay},
+};
+
+const ParameterField* FindParameterField(const std::string& key) {
+    for (const auto& field : kParameterFields) {
+        if (key == field.key) return &field;
+    }
+    return nullptr;
+}
+
+}  // namespace
+
+const char* SolverName(SolverKind solver) {
+    switch (solver) {
+        case SolverKind::Explicit:
+            return "explicit Runge-Kutta-England";
+        case SolverKind::Implicit:
+            return "implicit Rosenbrock";
+        case SolverKind::Auto:
+            return "auto (explicit/implicit)";
+        case SolverKind::Exponential:
+            return "exponential Runge-Kutta (ETDRK4)";
+    }
+    return "unknown";
+}
+
 ModelParameters LoadModelParameters(const ConfigReader& config) {
     ModelParameters params{};
     params.ka = config.get("ka", 2.0);
@@ -32,6 +119,20 @@ ModelParameters LoadModelParameters(const ConfigReader& config) {
     params.sim_step_max = config.get("step_max", 0.1);
     params.sim_accuracy = config.get("accuracy", 1e-6);
     params.output_interval = config.get("output_interval", 1.0);
+    int solver = static_cast<int>(config.get("solver", 0.0));
+    params.solver = (solver == 1)   ? SolverKind::Implicit
+                    : (solver == 2) ? SolverKind::Auto
+                    : (solver == 3) ? SolverKind::Exponential
+                                    : SolverKind::Explicit;
+    params.implicit_step_max = config.get("implicit_step_max", 12.0);
+    params.state_events = config.get("state_events", false);
+    params.linear_ratio = config.get("linear_ratio", 0.0);
+    params.linear_tolerance = config.get("linear_tolerance", 1e-5);
+    params.outcome_detection = config.get("outcome_detection", false);
+    params.outcome_window = config.get("outcome_window", 6.0);
+    params.stable_tolerance = config.get("stable_tolerance", 0.01);
+    params.stable_margin = config.get("stable_margin", 2.0);
+    params.collapse_ratio = config.get("collapse_ratio", 3.0);
     
     params.petri_net_enabled = config.get("petri_net_enabled", true);
     params.assessment_interval = config.get("assessment_interval", 12.0);
@@ -44,6 +145,17 @@ ModelParameters LoadModelParameters(const ConfigReader& config) {
     params.min_dosing_interval = config.get("min_dosing_interval", 6.0);
     params.base_escalation_factor = config.get("base_escalation_factor", 0.10);
     params.tolerance_escalation_factor = config.get("tolerance_escalation_factor", 0.15);
+    params.max_dose = config.get("max_dose", 0.0);
+    params.taper_factor = config.get("taper_factor", 0.0);
+    params.taper_start = config.get("taper_start", 0.0);
+    params.stochastic_behavior = config.get("stochastic_behavior", false);
+    params.behavior_seed = config.get("behavior_seed", 1.0);
+    params.behavior_stream = config.get("behavior_stream", 0.0);
+    params.assessment_jitter = config.get("assessment_jitter", 0.25);
+    params.escalation_slope = config.get("escalation_slope", 4.0);
+    params.pain_noise = config.get("pain_noise", 5.0);
+    params.missed_dose_probability = config.get("missed_dose_probability", 0.05);
+    params.extra_dose_probability = config.get("extra_dose_probability", 0.02);
     
     params.naloxone_available = config.get("naloxone_available", false);
     params.naloxone_effective_window = config.get("naloxone_effective_window", 5.0);
@@ -53,23 +165,74 @@ ModelParameters LoadModelParameters(const ConfigReader& config) {
     return params;
 }
 
-void PrintModelParameters(const ModelParameters& params) {
-    cout << "Model Parameters:" << endl;
-    cout << "  Absorption: ka = " << params.ka << " /h" << endl;
-    cout << "  Distribution: Vd = " << params.Vd << " L, Vp = " << params.Vp << " L" << endl;
-    cout << "  Transfer: kcp = " << params.kcp << " /h, kpc = " << params.kpc << " /h" << endl;
-    cout << "  Elimination (M-M): Vmax = " << params.Vmax << " mg/h, Km = " << params.Km << " mg/L" << endl;
-    cout << "  Effect-site: keo = " << params.keo << " /h, tau_e = " << params.tau_e << " h" << endl;
-    cout << "  PD: Emax = " << params.Emax << "%, EC50 = " << params.EC50_base << " mg/L, n = " << params.n_Hill << endl;
-    cout << "  Tolerance: kin = " << params.kin << " /h, kout = " << params.kout << " /h" << endl;
-    cout << "  Dosing: " << params.current_dose << " mg every " << params.dosing_interval << " hours" << endl;
-    cout << "  Toxicity: C_toxic = " << params.C_toxic << " mg/L, C_critical = " << params.C_critical << " mg/L" << endl;
-    cout << "  Behavioral: assessment every " << params.assessment_interval << " h, relief threshold = " << params.effect_relief_threshold << "%" << endl;
-    cout << "  Escalation: base = " << (params.base_escalation_factor * 100) << "%, tolerance factor = " << (params.tolerance_escalation_factor * 100) << "%" << endl;
-    cout << "  Naloxone: " << (params.naloxone_available ? "AVAILABLE" : "NOT AVAILABLE") 
+void PrintModelParameters(const ModelParameters& params, std::ostream& out) {
+    out << "Model Parameters:" << endl;
+    out << "  Absorption: ka = " << params.ka << " /h" << endl;
+    out << "  Distribution: Vd = " << params.Vd << " L, Vp = " << params.Vp << " L" << endl;
+    out << "  Transfer: kcp = " << params.kcp << " /h, kpc = " << params.kpc << " /h" << endl;
+    out << "  Elimination (M-M): Vmax = " << params.Vmax << " mg/h, Km = " << params.Km << " mg/L" << endl;
+    out << "  Effect-site: keo = " << params.keo << " /h, tau_e = " << params.tau_e << " h" << endl;
+    out << "  PD: Emax = " << params.Emax << "%, EC50 = " << params.EC50_base << " mg/L, n = " << params.n_Hill << endl;
+    out << "  Tolerance: kin = " << params.kin << " /h, kout = " << params.kout << " /h" << endl;
+    out << "  Dosing: " << params.current_dose << " mg every " << params.dosing_interval << " hours" << endl;
+    out << "  Toxicity: C_toxic = " << params.C_toxic << " mg/L, C_critical = " << params.C_critical << " mg/L" << endl;
+    out << "  Behavioral: assessment every " << params.assessment_interval << " h, relief threshold = " << params.effect_relief_threshold << "%" << endl;
+    out << "  Escalation: base = " << (params.base_escalation_factor * 100) << "%, tolerance factor = " << (params.tolerance_escalation_factor * 100) << "%" << endl;
+    if (params.max_dose > 0.0) {
+        out << "  Dose cap: " << params.max_dose << " mg" << endl;
+    }
+    if (params.taper_factor > 0.0) {
+        out << "  Taper: maintenance doses -" << (params.taper_factor * 100) << "% each from t = "
+            << params.taper_start << " h" << endl;
+    }
+    if (params.stochastic_behavior) {
+        out << "  Stochastic behavior: seed " << params.behavior_seed << ", stream " << params.behavior_stream
+            << ", timing +-" << (params.assessment_jitter * 100) << "%, escalation slope "
+            << params.escalation_slope << ", pain noise " << params.pain_noise << "%, missed "
+            << (params.missed_dose_probability * 100) << "%, extra " << (params.extra_dose_probability * 100)
+            << "%" << endl;
+    }
+    out << "  Naloxone: " << (params.naloxone_available ? "AVAILABLE" : "NOT AVAILABLE") 
          << " (response delay: " << (params.naloxone_response_delay * 60) << " min, "
          << "window: " << (params.naloxone_effective_window * 60) << " min, blockade: " 
          << (params.naloxone_blockade_strength * 100) << "%)" << endl;
-    cout << "  Simulation: " << params.sim_duration << " hours, output every " << params.output_interval << " hours" << endl;
-    cout << endl;
+    out << "  Simulation: " << params.sim_duration << " hours, output every " << params.output_interval << " hours" << endl;
+    if (params.solver != SolverKind::Explicit) {
+        out << "  Solver: " << SolverName(params.solver) << ", step up to " << params.implicit_step_max << " h" << endl;
+    }
+    if (params.state_events) {
+        out << "  State events: toxicity and C/Km thresholds located within integration steps" << endl;
+    }
+    if (params.linear_ratio > 0.0) {
+        out << "  Linear regime: closed form while C/Km <= " << params.linear_ratio
+            << ", tolerance " << params.linear_tolerance << endl;
+    }
+    if (params.outcome_detection) {
+        out << "  Outcome detection: over " << params.outcome_window << " assessments, stable cycle within "
+            << (params.stable_tolerance * 100) << "% and " << params.stable_margin
+            << "% above relief, collapse past C/Km = " << params.collapse_ratio << endl;
+    }
+    out << endl;
+}
+
+bool SetModelParameter(ModelParameters& params, const std::string& key, double value) {
+    const ParameterField* field = FindParameterField(key);
+    if (!field) return false;
+    params.*(field->member) = value;
+    return true;
+}
+
+bool GetModelParameter(const ModelParameters& params, const std::string& key, double& value) {
+    const ParameterField* field = FindParameterField(key);
+    if (!field) return false;
+    value = params.*(field->member);
+    return true;
+}
+
+std::vector<std::string> ModelParameterKeys() {
+    std::vector<std::string> keys;
+    for (const auto& field : kParameterFields) {
+        keys.push_back(field.key);
+    }
+    return keys;
 }
@@ -3,6 +3,16 @@
 #include "../config/config_reader.hpp"
 
 #include <iostream>
+#include <string>
+#include <vector>
+
+// Integrator used for the continuous subsystem.
+enum class SolverKind : int {
+    Explicit = 0,  // Runge-Kutta-England between step_min and step_max (SIMLIB default)
+    Implicit = 1,  // Rosenbrock4 with the analytic Jacobian, up to implicit_step_max
+    Auto = 2,      // switches between the two as stiffness comes and goes
+    Exponential = 3,  // ETDRK4 on the compartment model, linear fluxes exact, up to implicit_step_max
+};
 
 struct ModelParameters {
     double ka{};
@@ -30,6 +40,16 @@ struct ModelParameters {
     double sim_step_max{};
     double sim_accuracy{};
     double output_interval{};
+    SolverKind solver{SolverKind::Explicit};
+    double implicit_step_max{};  // step cap of the implicit, auto and exponential solvers
+    bool state_events{};  // locate toxicity and C/Km thresholds inside steps instead of polling
+    double linear_ratio{};  // C/Km below which intervals are propagated in closed form; 0 = never
+    double linear_tolerance{};  // error estimate per hour a closed-form interval may not exceed
+    bool outcome_detection{};  // stop once the outcome is determined (OutcomeDetector)
+    double outcome_window{};  // assessments both detection rules look back over
+    double stable_tolerance{};  // relative change of C per assessment a stable cycle may show
+    double stable_margin{};  // effect (%) the extrapolated end of a stable run keeps above the relief threshold
+    double collapse_ratio{};  // C/Km beyond which rising C and Tol mean collapse
     
     // Behavioral parameters (Petri net / discrete subsystem)
     bool petri_net_enabled{};
@@ -43,6 +63,17 @@ struct ModelParameters {
     double min_dosing_interval{};
     double base_escalation_factor{};
     double tolerance_escalation_factor{};
+    double max_dose{};  // cap on the dose ExecuteDoseIncrease can reach; 0 = none
+    double taper_factor{};  // fraction every maintenance dose is reduced by after taper_start; 0 = none
+    double taper_start{};  // hours
+    bool stochastic_behavior{};  // random assessment timing, escalation and dose taking (behavior_random.hpp)
+    double behavior_seed{};  // key of the run's random stream
+    double behavior_stream{};  // stream of the run; cohorts use the patient index
+    double assessment_jitter{};  // intervals vary uniformly by +- this fraction of assessment_interval
+    double escalation_slope{};  // P(escalate) = 1 / (1 + exp(-slope (motivation - motivation_threshold)))
+    double pain_noise{};  // sd (effect %) of the patient's perception of the effect
+    double missed_dose_probability{};  // per maintenance dose
+    double extra_dose_probability{};  // per assessment without a dose decision
     
     // Naloxone rescue parameters
     bool naloxone_available{};
@@ -52,4 +83,11 @@ struct ModelParameters {
 };
 
 ModelParameters LoadModelParameters(const ConfigReader& config);
-void PrintModelParameters(const ModelParameters& params);
+const char* SolverName(SolverKind solver);
+void PrintModelParameters(const ModelParameters& params, std::ostream& out = std::cout);
+
+// Access to numeric fields by their config key (e.g. "initial_dose", "Vmax").
+// Returns false for unknown keys and for the boolean switches.
+bool SetModelParameter(ModelParameters& params, const std::string& key, double value);
+bool GetModelParameter(const ModelParameters& params, const std::string& key, double& value);
+std::vector<std::string> ModelParameterKeys();
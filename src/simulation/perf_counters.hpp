@@ -0,0 +1,65 @@
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+// Instrumentation of one run. Only builds with PERF_COUNTERS defined
+// (make PERF=1) update it: everywhere else PERF_COUNT(...) expands to nothing,
+// so the integration loop carries no counting code and the counters stay
+// zero.
+#ifdef PERF_COUNTERS
+#define PERF_COUNT(statement) statement
+const bool kPerfCountersEnabled = true;
+#else
+#define PERF_COUNT(statement)
+const bool kPerfCountersEnabled = false;
+#endif
+
+// Scheduled event types told apart by the counters; matches
+// SnapshotEventKind, plus everything else.
+const int kPerfEventKinds = 5;
+
+struct PerfCounters {
+    // Right-hand side evaluations per attached integrator (attach order),
+    // and how many of the whole-system evaluations went through a kernel.
+    std::vector<unsigned long> block_evaluations{};
+    unsigned long kernel_evaluations{0};
+    // Accepted steps that were not shortened to land on an event.
+    unsigned long free_steps{0};
+    double min_step{HUGE_VAL};
+    double max_step{0.0};
+    unsigned long events[kPerfEventKinds]{};
+    // Wall time inside the integrator and inside event handlers, where all
+    // per-run text (status lines, assessments, alarms) is formatted.
+    double integration_seconds{0.0};
+    double event_seconds{0.0};
+
+    void CountEvaluations(size_t blocks, unsigned long times) {
+        if (block_evaluations.size() < blocks) block_evaluations.resize(blocks, 0);
+        for (size_t i = 0; i < blocks; ++i) block_evaluations[i] += times;
+    }
+
+    void CountStep(double h) {
+        ++free_steps;
+        if (h < min_step) min_step = h;
+        if (h > max_step) max_step = h;
+    }
+};
+
+// Adds the wall time of its scope to seconds.
+class PerfTimer {
+public:
+    explicit PerfTimer(double& seconds) : seconds_(seconds), start_(std::chrono::steady_clock::now()) {}
+    ~PerfTimer() {
+        seconds_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+    }
+
+    PerfTimer(const PerfTimer&) = delete;
+    PerfTimer& operator=(const PerfTimer&) = delete;
+
+private:
+    double& seconds_;
+    std::chrono::steady_clock::time_point start_;
+};
@@ -0,0 +1,289 @@
+#include "periodic_orbit.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "dynamics.hpp"
+#include "integration.hpp"
+
+namespace {
+
+const int kStates = 5;
+const int kMaxIterations = 30;
+const int kMaxBacktracks = 8;
+// Relative perturbation of the finite-difference monodromy matrix.
+const double kPerturbation = 1e-6;
+
+// The one-interval map x -> Phi(x): dose into A, then integrate the five
+// state equations for dosing_interval with the same Runge-Kutta-England
+// method and step control as SimulationContext.
+class DosingCycle {
+public:
+    explicit DosingCycle(const ModelParameters& params)
+        : params_(params),
+          dA_dt_(params_, state_),
+          dC_dt_(params_, state_),
+          dP_dt_(params_, state_),
+          dCe_dt_(params_, state_),
+          dTol_dt_(params_, state_),
+          A_(dA_dt_, 0.0),
+          C_(dC_dt_, 0.0),
+          P_(dP_dt_, 0.0),
+          Ce_(dCe_dt_, 0.0),
+          Tol_(dTol_dt_, 0.0) {
+        state_.A = &A_;
+        state_.C = &C_;
+        state_.P = &P_;
+        state_.Ce = &Ce_;
+        state_.Tol = &Tol_;
+        stepper_.Attach({&A_, &C_, &P_, &Ce_, &Tol_});
+    }
+
+    // With record the steps are chosen adaptively and kept; without, the kept
+    // steps are replayed, so that perturbed trajectories differ only by the
+    // perturbation and finite differences of the map are smooth.
+    void Map(const double x[kStates], double out[kStates], bool record) {
+        A_ = x[0] + params_.current_dose;
+        C_ = x[1];
+        P_ = x[2];
+        Ce_ = x[3];
+        Tol_ = x[4];
+        ResetExtremes();
+
+        if (record) {
+            steps_.clear();
+            double t = 0.0;
+            double step = params_.sim_step_max;
+            while (t < params_.dosing_interval) {
+                double remaining = params_.dosing_interval - t;
+                double h = std::min(step, remaining);
+                bool last = h >= remaining;
+                double error_ratio = stepper_.Step(h, params_.sim_accuracy);
+                while (error_ratio > 1.0 && h > params_.sim_step_min) {
+                    stepper_.Reject();
+                    h = std::max(h / 2.0, params_.sim_step_min);
+                    step = h;
+                    last = false;
+                    error_ratio = stepper_.Step(h, params_.sim_accuracy);
+                }
+                t = last ? params_.dosing_interval : t + h;
+                steps_.push_back(h);
+                if (error_ratio < 1.0 / 64.0 && h >= step) step = std::min(step * 2.0, params_.sim_step_max);
+                TrackExtremes();
+            }
+        } else {
+            for (double h : steps_) {
+                stepper_.Step(h, params_.sim_accuracy);
+                TrackExtremes();
+            }
+        }
+
+        out[0] = A_.Value();
+        out[1] = C_.Value();
+        out[2] = P_.Value();
+        out[3] = Ce_.Value();
+        out[4] = Tol_.Value();
+    }
+
+    double C_min, C_max, Ce_min, Ce_max, effect_min, effect_max;
+
+private:
+    void ResetExtremes() {
+        C_min = C_max = C_.Value();
+        Ce_min = Ce_max = Ce_.Value();
+        effect_min = effect_max = CalculateEffect(Ce_.Value(), Tol_.Value(), params_);
+    }
+
+    void TrackExtremes() {
+        double effect = CalculateEffect(Ce_.Value(), Tol_.Value(), params_);
+        C_min = std::min(C_min, C_.Value());
+        C_max = std::max(C_max, C_.Value());
+        Ce_min = std::min(Ce_min, Ce_.Value());
+        Ce_max = std::max(Ce_max, Ce_.Value());
+        effect_min = std::min(effect_min, effect);
+        effect_max = std::max(effect_max, effect);
+    }
+
+    ModelParameters params_;
+    SimulationState state_{};
+    AbsorptionDynamics dA_dt_;
+    CentralDynamics dC_dt_;
+    PeripheralDynamics dP_dt_;
+    EffectSiteDynamics dCe_dt_;
+    ToleranceDynamics dTol_dt_;
+    Integrator A_;
+    Integrator C_;
+    Integrator P_;
+    Integrator Ce_;
+    Integrator Tol_;
+    RungeKuttaEngland stepper_{};
+    std::vector<double> steps_{};
+};
+
+double Residual(const double x[kStates], const double fx[kStates]) {
+    double residual = 0.0;
+    for (int i = 0; i < kStates; ++i) residual = std::max(residual, std::fabs(fx[i] - x[i]) / (1.0 + std::fabs(x[i])));
+    return residual;
+}
+
+// d Phi / d x by forward differences over the recorded steps of x.
+void Monodromy(DosingCycle& cycle, const double x[kStates], const double fx[kStates], double M[kStates * kStates]) {
+    for (int j = 0; j < kStates; ++j) {
+        double perturbed[kStates];
+        std::copy(x, x + kStates, perturbed);
+        double h = kPerturbation * (1.0 + std::fabs(x[j]));
+        perturbed[j] += h;
+        double fp[kStates];
+        cycle.Map(perturbed, fp, false);
+        for (int i = 0; i < kStates; ++i) M[i * kStates + j] = (fp[i] - fx[i]) / h;
+    }
+}
+
+// Solves a x = b in place by Gaussian elimination with partial pivoting.
+bool SolveLinear(double a[kStates * kStates], double b[kStates]) {
+    for (int k = 0; k < kStates; ++k) {
+        int pivot = k;
+        for (int i = k + 1; i < kStates; ++i) {
+            if (std::fabs(a[i * kStates + k]) > std::fabs(a[pivot * kStates + k])) pivot = i;
+        }
+        if (a[pivot * kStates + k] == 0.0) return false;
+        if (pivot != k) {
+            for (int j = 0; j < kStates; ++j) std::swap(a[k * kStates + j], a[pivot * kStates + j]);
+            std::swap(b[k], b[pivot]);
+        }
+        for (int i = k + 1; i < kStates; ++i) {
+            double factor = a[i * kStates + k] / a[k * kStates + k];
+            for (int j = k; j < kStates; ++j) a[i * kStates + j] -= factor * a[k * kStates + j];
+            b[i] -= factor * b[k];
+        }
+    }
+    for (int k = kStates - 1; k >= 0; --k) {
+        double sum = b[k];
+        for (int j = k + 1; j < kStates; ++j) sum -= a[k * kStates + j] * b[j];
+        b[k] = sum / a[k * kStates + k];
+    }
+    return true;
+}
+
+double DriftTime(const ModelParameters& params, const PeriodicOrbit& orbit, double Tol_start, double Tol) {
+    // Tol is affine over a cycle, Tol_n - Tol* = a^n (Tol_0 - Tol*), with
+    // a = exp(-kout T) its multiplier.
+    double Tol_star = orbit.trough[4];
+    double a = orbit.multipliers[4].real();
+    double ratio = (Tol - Tol_star) / (Tol_start - Tol_star);
+    if (ratio <= 0.0 || a <= 0.0 || a >= 1.0) return 0.0;
+    return std::max(0.0, std::log(ratio) / std::log(a) * params.dosing_interval);
+}
+
+}  // namespace
+
+PeriodicOrbit SolvePeriodicOrbit(const ModelParameters& params) {
+    PeriodicOrbit orbit;
+    if (params.current_dose >= params.Vmax * params.dosing_interval) {
+        orbit.exceeds_capacity = true;
+        return orbit;
+    }
+
+    DosingCycle cycle(params);
+    double x[kStates] = {0.0, 0.0, 0.0, 0.0, 0.0};
+    double fx[kStates];
+    cycle.Map(x, fx, true);
+    double residual = Residual(x, fx);
+    const double tolerance = 10.0 * params.sim_accuracy;
+
+    // Damped Newton on G(x) = Phi(x) - x.
+    while (residual > tolerance && orbit.iterations < kMaxIterations) {
+        ++orbit.iterations;
+        double J[kStates * kStates];
+        Monodromy(cycle, x, fx, J);
+        double dx[kStates];
+        for (int i = 0; i < kStates; ++i) {
+            J[i * kStates + i] -= 1.0;
+            dx[i] = x[i] - fx[i];
+        }
+        if (!SolveLinear(J, dx)) break;
+
+        double lambda = 1.0;
+        double trial[kStates];
+        double f_trial[kStates];
+        double trial_residual = residual;
+        for (int backtrack = 0; backtrack <= kMaxBacktracks; ++backtrack, lambda /= 2.0) {
+            for (int i = 0; i < kStates; ++i) trial[i] = std::max(x[i] + lambda * dx[i], 0.0);
+            cycle.Map(trial, f_trial, true);
+            trial_residual = Residual(trial, f_trial);
+            if (trial_residual < residual) break;
+        }
+        std::copy(trial, trial + kStates, x);
+        std::copy(f_trial, f_trial + kStates, fx);
+        residual = trial_residual;
+    }
+
+    orbit.converged = residual <= tolerance;
+    orbit.residual = residual;
+    std::copy(x, x + kStates, orbit.trough);
+
+    // Extremes along the orbit and the monodromy at it.
+    cycle.Map(x, fx, true);
+    orbit.C_min = cycle.C_min;
+    orbit.C_max = cycle.C_max;
+    orbit.Ce_min = cycle.Ce_min;
+    orbit.Ce_max = cycle.Ce_max;
+    orbit.effect_min = cycle.effect_min;
+    orbit.effect_max = cycle.effect_max;
+
+    double M[kStates * kStates];
+    Monodromy(cycle, x, fx, M);
+    // A feeds C, C and P feed each other, C feeds Ce, Ce feeds Tol, and
+    // nothing feeds back: the monodromy matrix is block lower triangular with
+    // blocks {A}, {C, P}, {Ce}, {Tol}, and its eigenvalues are theirs.
+    double trace = M[1 * kStates + 1] + M[2 * kStates + 2];
+    double det = M[1 * kStates + 1] * M[2 * kStates + 2] - M[1 * kStates + 2] * M[2 * kStates + 1];
+    std::complex<double> root = std::sqrt(std::complex<double>(trace * trace / 4.0 - det, 0.0));
+    orbit.multipliers[0] = M[0];
+    orbit.multipliers[1] = trace / 2.0 + root;
+    orbit.multipliers[2] = trace / 2.0 - root;
+    orbit.multipliers[3] = M[3 * kStates + 3];
+    orbit.multipliers[4] = M[4 * kStates + 4];
+    for (const auto& multiplier : orbit.multipliers) {
+        orbit.spectral_radius = std::max(orbit.spectral_radius, std::abs(multiplier));
+    }
+    return orbit;
+}
+
+std::vector<ToleranceDriftPoint> ContinueOnTolerance(const ModelParameters& params, const PeriodicOrbit& orbit,
+                                                     double Tol_start, int points) {
+    // PK does not depend on Tol, so the fast orbit is the same at every point
+    // of the slow manifold; only the effect along it changes.
+    std::vector<ToleranceDriftPoint> drift;
+    double Tol_end = orbit.trough[4] + 0.01 * (Tol_start - orbit.trough[4]);
+    for (int k = 0; k < points; ++k) {
+        double fraction = points > 1 ? static_cast<double>(k) / (points - 1) : 1.0;
+        ToleranceDriftPoint point;
+        point.Tol = Tol_start + fraction * (Tol_end - Tol_start);
+        point.time = DriftTime(params, orbit, Tol_start, point.Tol);
+        point.effect_trough = CalculateEffect(orbit.Ce_min, point.Tol, params);
+        point.effect_peak = CalculateEffect(orbit.Ce_max, point.Tol, params);
+        drift.push_back(point);
+    }
+    return drift;
+}
+
+double TimeToReliefLoss(const ModelParameters& params, const PeriodicOrbit& orbit, double Tol_start) {
+    double threshold = params.effect_relief_threshold;
+    double Tol_star = orbit.trough[4];
+    if (CalculateEffect(orbit.Ce_max, Tol_start, params) < threshold) return 0.0;
+    if (CalculateEffect(orbit.Ce_max, Tol_star, params) >= threshold) return -1.0;
+
+    // The peak effect falls monotonically as Tol rises towards Tol*.
+    double lo = Tol_start;
+    double hi = Tol_star;
+    for (int i = 0; i < 60; ++i) {
+        double mid = 0.5 * (lo + hi);
+        if (CalculateEffect(orbit.Ce_max, mid, params) >= threshold) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return DriftTime(params, orbit, Tol_start, hi);
+}
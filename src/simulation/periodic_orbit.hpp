@@ -0,0 +1,48 @@
+#pragma once
+
+#include <complex>
+#include <vector>
+
+#include "parameters.hpp"
+
+// Periodic orbit of the continuous model under a fixed regimen: current_dose
+// into A every dosing_interval, with no behavioural changes. Found by Newton
+// shooting on the one-interval map from trough to trough.
+struct PeriodicOrbit {
+    bool converged{false};
+    // current_dose / dosing_interval >= Vmax: elimination cannot keep up and
+    // C grows without bound, so there is no orbit to find.
+    bool exceeds_capacity{false};
+    int iterations{0};
+    double residual{0.0};  // max |x_next - x| / (1 + |x|) at the solution
+
+    double trough[5]{};  // {A, C, P, Ce, Tol} just before a dose
+    double C_min{0.0}, C_max{0.0};
+    double Ce_min{0.0}, Ce_max{0.0};
+    double effect_min{0.0}, effect_max{0.0};
+
+    // Eigenvalues of the monodromy matrix, in the order A, C/P (pair), Ce,
+    // Tol; the orbit is stable when all lie inside the unit circle.
+    std::complex<double> multipliers[5];
+    double spectral_radius{0.0};
+};
+
+PeriodicOrbit SolvePeriodicOrbit(const ModelParameters& params);
+
+// One point of the slow drift of Tol towards its periodic value, with the
+// fast variables already on their orbit.
+struct ToleranceDriftPoint {
+    double time{0.0};  // hours of dosing since Tol was Tol_start
+    double Tol{0.0};
+    double effect_trough{0.0};
+    double effect_peak{0.0};
+};
+
+// Continues the orbit along the slow manifold parameterized by Tol, from
+// Tol_start to within 1% of the periodic value, in `points` steps.
+std::vector<ToleranceDriftPoint> ContinueOnTolerance(const ModelParameters& params, const PeriodicOrbit& orbit,
+                                                     double Tol_start, int points);
+
+// Hours of dosing until the peak effect drops below effect_relief_threshold,
+// starting from Tol_start; negative if it never does.
+double TimeToReliefLoss(const ModelParameters& params, const PeriodicOrbit& orbit, double Tol_start);
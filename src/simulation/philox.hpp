@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+// Philox4x32-10, the counter-based generator of Salmon et al. ("Parallel
+// random numbers: as easy as 1, 2, 3", SC'11). Output is a pure function of
+// a 128-bit counter and a 64-bit key, so a run's draws can be addressed
+// directly (no state to carry, skip or split between threads), and a round
+// is two 32x32->64 multiplies and a few XORs, which vectorize across lanes.
+
+const uint32_t kPhiloxM0 = 0xD2511F53u;
+const uint32_t kPhiloxM1 = 0xCD9E8D57u;
+const uint32_t kPhiloxW0 = 0x9E3779B9u;  // key schedule (golden ratio)
+const uint32_t kPhiloxW1 = 0xBB67AE85u;  // key schedule (sqrt(3) - 1)
+const int kPhiloxRounds = 10;
+
+// One round on counter c under round key (k0, k1); branch-free so a loop of
+// it over lanes vectorizes.
+inline void PhiloxRound(uint32_t& c0, uint32_t& c1, uint32_t& c2, uint32_t& c3, uint32_t k0, uint32_t k1) {
+    uint64_t p0 = static_cast<uint64_t>(kPhiloxM0) * c0;
+    uint64_t p1 = static_cast<uint64_t>(kPhiloxM1) * c2;
+    uint32_t n0 = static_cast<uint32_t>(p1 >> 32) ^ c1 ^ k0;
+    uint32_t n2 = static_cast<uint32_t>(p0 >> 32) ^ c3 ^ k1;
+    c1 = static_cast<uint32_t>(p1);
+    c3 = static_cast<uint32_t>(p0);
+    c0 = n0;
+    c2 = n2;
+}
+
+// out = Philox4x32-10(counter, key).
+inline void Philox4x32(const uint32_t counter[4], uint64_t key, uint32_t out[4]) {
+    uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+    uint32_t k0 = static_cast<uint32_t>(key);
+    uint32_t k1 = static_cast<uint32_t>(key >> 32);
+    for (int round = 0; round < kPhiloxRounds; ++round) {
+        PhiloxRound(c0, c1, c2, c3, k0, k1);
+        k0 += kPhiloxW0;
+        k1 += kPhiloxW1;
+    }
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+}
+
+// Uniform on (0, 1) from one output word.
+inline double PhiloxUniform(uint32_t word) {
+    return (static_cast<double>(word) + 0.5) * (1.0 / 4294967296.0);
+}
+
+// Two standard normals from two output words (Box-Muller).
+inline void PhiloxNormalPair(uint32_t a, uint32_t b, double normal[2]) {
+    const double kTwoPi = 6.283185307179586;
+    double r = std::sqrt(-2.0 * std::log(PhiloxUniform(a)));
+    double phi = kTwoPi * PhiloxUniform(b);
+    normal[0] = r * std::cos(phi);
+    normal[1] = r * std::sin(phi);
+}
+
+// Four standard normals from one output block.
+inline void PhiloxNormals(const uint32_t word[4], double normal[4]) {
+    PhiloxNormalPair(word[0], word[1], normal);
+    PhiloxNormalPair(word[2], word[3], normal + 2);
+}
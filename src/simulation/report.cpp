@@ -0,0 +1,158 @@
+#include "report.hpp"
+
+#include <iomanip>
+#include <iostream>
+
+#include "context.hpp"
+
+using std::endl;
+
+void PrintInitialConditions(SimulationContext& ctx) {
+    PrintInitialConditions(ctx, ctx.log(LogLevel::Events));
+}
+
+void PrintInitialConditions(SimulationContext& ctx, std::ostream& out) {
+    const SimulationState& state = ctx.state();
+
+    out << "Initial Conditions:" << endl;
+    out << "  A(0) = " << state.A->Value() << " mg (first dose)" << endl;
+    out << "  C(0) = " << state.C->Value() << " mg/L" << endl;
+    out << "  P(0) = " << state.P->Value() << " mg/L" << endl;
+    out << "  Ce(0) = " << state.Ce->Value() << " mg/L" << endl;
+    out << "  Tol(0) = " << state.Tol->Value() << endl;
+    out << endl;
+    out << "========================================================================" << endl;
+    out << "                        SIMULATION OUTPUT" << endl;
+    out << "========================================================================" << endl;
+    out << endl;
+}
+
+void PrintSimulationSummary(SimulationContext& ctx) {
+    PrintSimulationSummary(ctx, ctx.log(LogLevel::Summary));
+}
+
+void PrintSimulationSummary(SimulationContext& ctx, std::ostream& out) {
+    const ModelParameters& params = ctx.params();
+    const SimulationState& state = ctx.state();
+    const PetriNetState& petri_state = ctx.petri_state();
+
+    out << endl;
+    out << "========================================================================" << endl;
+    out << "                        SIMULATION SUMMARY" << endl;
+    out << "========================================================================" << endl;
+    out << endl;
+    out << "Final State (t=" << ctx.Time() << " hours):" << endl;
+    out << "  A(t) = " << state.A->Value() << " mg" << endl;
+    out << "  C(t) = " << state.C->Value() << " mg/L" << endl;
+    out << "  P(t) = " << state.P->Value() << " mg/L" << endl;
+    out << "  Ce(t) = " << state.Ce->Value() << " mg/L" << endl;
+    out << "  Tol(t) = " << state.Tol->Value() << endl;
+    out << "  Effect = " << CalculateEffect(state.Ce->Value(), state.Tol->Value(), params) << "%" << endl;
+    out << endl;
+
+    double saturation_ratio = state.C->Value() / params.Km;
+    out << "Pharmacokinetic Analysis:" << endl;
+    out << "  Saturation ratio (C/Km) = " << saturation_ratio << endl;
+    if (saturation_ratio < 0.5) {
+        out << "  Status: LINEAR REGIME - First-order elimination dominates" << endl;
+    } else if (saturation_ratio < 3.0) {
+        out << "  Status: SATURATION ZONE - Nonlinear kinetics active" << endl;
+        out << "  WARNING: Approaching dangerous territory!" << endl;
+    } else {
+        out << "  Status: PLATEAU REGIME - Zero-order elimination (capacity exhausted)" << endl;
+        out << "  CRITICAL: System in deadly spiral zone!" << endl;
+    }
+    out << endl;
+
+    double EC50_current = params.EC50_base * (1.0 + state.Tol->Value());
+    double tolerance_factor = EC50_current / params.EC50_base;
+    out << "Pharmacodynamic Analysis:" << endl;
+    out << "  Current EC50 = " << EC50_current << " mg/L (baseline: " << params.EC50_base << " mg/L)" << endl;
+    out << "  Tolerance multiplier = " << tolerance_factor << "x" << endl;
+    out << "  Required dose for same effect = " << tolerance_factor * params.current_dose << " mg" << endl;
+    out << endl;
+
+    if (params.solver != SolverKind::Explicit) {
+        SolverStats stats = ctx.solver_stats();
+        out << "Numerical Solver:" << endl;
+        out << "  Method: " << SolverName(params.solver) << endl;
+        out << "  Steps: " << stats.accepted_steps << " accepted, " << stats.rejected_steps << " rejected" << endl;
+        if (params.solver == SolverKind::Exponential) {
+            out << "  Nonlinear evaluations: " << stats.rhs_evaluations << ", exp(hL) computed for "
+                << stats.propagator_updates << " step sizes" << endl;
+        } else {
+            out << "  RHS evaluations: " << stats.rhs_evaluations << ", Jacobians: " << stats.jacobian_evaluations
+                << endl;
+            out << "  Stiffness switches: " << stats.stiffness_switches << ", implicit for " << stats.implicit_time
+                << " of " << ctx.Time() << " hours" << endl;
+        }
+        out << endl;
+    }
+
+    if (params.linear_ratio > 0.0) {
+        SolverStats stats = ctx.solver_stats();
+        out << "Linear Regime:" << endl;
+        out << "  Intervals: " << stats.linear_intervals << " closed form, " << stats.numerical_intervals
+            << " integrated" << endl;
+        out << "  Closed form for " << stats.linear_time << " of " << ctx.Time() << " hours" << endl;
+        std::ios::fmtflags flags = out.flags();
+        std::streamsize precision = out.precision();
+        out << "  Accumulated error bound: " << std::scientific << std::setprecision(2) << stats.linear_error_bound
+            << endl;
+        out.flags(flags);
+        out.precision(precision);
+        out << endl;
+    }
+
+    out << "Behavioral Analysis (Petri Net):" << endl;
+    out << "  Patient Status: " << (petri_state.patient_alive ? "ALIVE" : "DECEASED") << endl;
+    out << "  Final Pain Level: " << petri_state.pain_level << " (0=None, 1=Mild, 2=Moderate, 3=Severe)" << endl;
+    out << "  Total Dose Escalations: " << petri_state.dose_history.size() << endl;
+    if (!petri_state.dose_history.empty()) {
+        auto first_dose = petri_state.dose_history.front().dose;
+        auto last_dose = petri_state.dose_history.back().dose;
+        out << "  Dose Escalation: " << first_dose << " mg → " << last_dose << " mg (" 
+            << ((last_dose / first_dose - 1.0) * 100) << "% increase)" << endl;
+    }
+    out << endl;
+
+    const OutcomePrediction& prediction = ctx.outcome_prediction();
+    if (prediction.outcome != PredictedOutcome::None) {
+        out << "Outcome Detection:" << endl;
+        out << "  Stopped early at t=" << prediction.time << " of " << params.sim_duration << " hours" << endl;
+        out << "  Predicted outcome: " << (prediction.outcome == PredictedOutcome::Stable ? "STABLE (ALIVE)"
+                                                                                          : "COLLAPSE (DECEASED)")
+            << endl;
+        out << "  Reason: " << prediction.reason << endl;
+        out << endl;
+    }
+
+    out << "========================================================================" << endl;
+}
+
+RunSummary SummarizeRun(SimulationContext& ctx) {
+    const ModelParameters& params = ctx.params();
+    const PetriNetState& petri_state = ctx.petri_state();
+
+    RunSummary summary;
+    summary.patient_alive = petri_state.patient_alive;
+    summary.time_of_death = petri_state.patient_alive ? 0.0 : petri_state.time_overdose_detected;
+    summary.end_time = ctx.Time();
+    summary.peak_saturation_ratio = ctx.PeakConcentration() / params.Km;
+    summary.final_Tol = ctx.state().Tol->Value();
+    summary.doses = static_cast<int>(petri_state.dose_history.size());
+    const OutcomePrediction& prediction = ctx.outcome_prediction();
+    summary.predicted = prediction.outcome;
+    summary.prediction_reason = prediction.reason;
+    if (prediction.outcome == PredictedOutcome::Collapse && summary.patient_alive) {
+        summary.patient_alive = false;
+        summary.time_of_death = prediction.time;
+    }
+
+    double previous_dose = params.current_dose;
+    for (const auto& record : petri_state.dose_history) {
+        if (record.dose > previous_dose) ++summary.escalations;
+        previous_dose = record.dose;
+    }
+    return summary;
+}
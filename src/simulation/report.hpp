@@ -0,0 +1,32 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+
+#include "outcome_detection.hpp"
+
+class SimulationContext;
+
+// Scalar outcome of one run, as reported by batch modes.
+struct RunSummary {
+    bool patient_alive{true};
+    double time_of_death{0.0};  // only meaningful when !patient_alive
+    double end_time{0.0};
+    double peak_saturation_ratio{0.0};  // max C/Km over the run
+    double final_Tol{0.0};
+    int escalations{0};  // dose_history entries that raised the dose
+    int doses{0};
+    // Set when outcome detection ended the run early. A predicted collapse
+    // counts as a death at the time it was recognized.
+    PredictedOutcome predicted{PredictedOutcome::None};
+    std::string prediction_reason{};
+};
+
+RunSummary SummarizeRun(SimulationContext& ctx);
+
+// Initial conditions are logged at LogLevel::Events, the summary at
+// LogLevel::Summary, unless given an explicit stream.
+void PrintInitialConditions(SimulationContext& ctx);
+void PrintInitialConditions(SimulationContext& ctx, std::ostream& out);
+void PrintSimulationSummary(SimulationContext& ctx);
+void PrintSimulationSummary(SimulationContext& ctx, std::ostream& out);
@@ -0,0 +1,207 @@
+#include "snapshot.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+const char kMagic[8] = {'P', 'K', 'P', 'D', 'S', 'N', 'A', 'P'};
+// Version 2 added PetriNetState::assessments; version 1 files still load,
+// with the counter at 0.
+const uint32_t kFormatVersion = 2;
+// Guards against reading a damaged length as a huge allocation.
+const uint64_t kMaxRecords = 1u << 26;
+
+class SnapshotWriter {
+public:
+    explicit SnapshotWriter(std::ostream& out) : out_(out) {}
+
+    template <typename T>
+    void Put(const T& value) {
+        out_.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+    void PutBool(bool value) { Put<uint8_t>(value ? 1 : 0); }
+
+private:
+    std::ostream& out_;
+};
+
+class SnapshotReader {
+public:
+    explicit SnapshotReader(std::istream& in) : in_(in) {}
+
+    template <typename T>
+    T Get() {
+        T value{};
+        in_.read(reinterpret_cast<char*>(&value), sizeof(T));
+        return value;
+    }
+    bool GetBool() { return Get<uint8_t>() != 0; }
+    bool Good() const { return static_cast<bool>(in_); }
+
+private:
+    std::istream& in_;
+};
+
+void WriteStats(SnapshotWriter& w, const SolverStats& stats) {
+    w.Put<uint64_t>(stats.accepted_steps);
+    w.Put<uint64_t>(stats.rejected_steps);
+    w.Put<uint64_t>(stats.rhs_evaluations);
+    w.Put<uint64_t>(stats.jacobian_evaluations);
+    w.Put<uint64_t>(stats.stiffness_switches);
+    w.Put<uint64_t>(stats.state_events);
+    w.Put<double>(stats.implicit_time);
+    w.Put<uint64_t>(stats.linear_intervals);
+    w.Put<uint64_t>(stats.numerical_intervals);
+    w.Put<double>(stats.linear_time);
+    w.Put<double>(stats.linear_error_bound);
+}
+
+void ReadStats(SnapshotReader& r, SolverStats& stats) {
+    stats.accepted_steps = r.Get<uint64_t>();
+    stats.rejected_steps = r.Get<uint64_t>();
+    stats.rhs_evaluations = r.Get<uint64_t>();
+    stats.jacobian_evaluations = r.Get<uint64_t>();
+    stats.stiffness_switches = r.Get<uint64_t>();
+    stats.state_events = r.Get<uint64_t>();
+    stats.implicit_time = r.Get<double>();
+    stats.linear_intervals = r.Get<uint64_t>();
+    stats.numerical_intervals = r.Get<uint64_t>();
+    stats.linear_time = r.Get<double>();
+    stats.linear_error_bound = r.Get<double>();
+}
+
+}  // namespace
+
+bool SaveSnapshot(const std::string& filename, const SimulationSnapshot& snapshot) {
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Error: Cannot open snapshot file for writing: " << filename << std::endl;
+        return false;
+    }
+    SnapshotWriter w(file);
+    file.write(kMagic, sizeof(kMagic));
+    w.Put(kFormatVersion);
+
+    w.Put<double>(snapshot.time);
+    for (double value : snapshot.state) w.Put<double>(value);
+    w.Put<double>(snapshot.step);
+    w.Put<double>(snapshot.implicit_step);
+    w.PutBool(snapshot.implicit_active);
+    w.Put<int32_t>(snapshot.stiffness_votes);
+    w.PutBool(snapshot.stopped);
+    w.Put<double>(snapshot.peak_C);
+    WriteStats(w, snapshot.stats);
+
+    const PetriNetState& petri = snapshot.petri_state;
+    w.Put<int32_t>(petri.pain_level);
+    w.PutBool(petri.relief_state);
+    w.Put<double>(petri.motivation);
+    w.Put<double>(petri.time_since_last_dose);
+    w.PutBool(petri.patient_alive);
+    w.Put<double>(petri.current_dose);
+    w.Put<double>(petri.time_overdose_detected);
+    w.Put<uint32_t>(petri.assessments);
+    w.Put<uint64_t>(petri.dose_history.size());
+    for (const auto& record : petri.dose_history) {
+        w.Put<double>(record.time);
+        w.Put<double>(record.dose);
+        w.Put<double>(record.C);
+        w.Put<double>(record.Ce);
+        w.Put<double>(record.Tol);
+        w.Put<double>(record.effect);
+    }
+
+    w.PutBool(snapshot.monitor_flags.phase2_flagged);
+    w.PutBool(snapshot.monitor_flags.phase3_flagged);
+
+    w.Put<uint64_t>(snapshot.events.size());
+    for (const auto& event : snapshot.events) {
+        w.Put<int32_t>(static_cast<int32_t>(event.kind));
+        w.Put<double>(event.time);
+    }
+
+    if (!file) {
+        std::cerr << "Error: Failed writing snapshot file: " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool LoadSnapshot(const std::string& filename, SimulationSnapshot& snapshot) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Error: Cannot open snapshot file: " << filename << std::endl;
+        return false;
+    }
+    SnapshotReader r(file);
+    char magic[sizeof(kMagic)] = {};
+    file.read(magic, sizeof(magic));
+    uint32_t version = r.Get<uint32_t>();
+    if (!r.Good() || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 || version < 1 ||
+        version > kFormatVersion) {
+        std::cerr << "Error: Not a snapshot file (or unsupported version): " << filename << std::endl;
+        return false;
+    }
+
+    snapshot = SimulationSnapshot();
+    snapshot.time = r.Get<double>();
+    for (double& value : snapshot.state) value = r.Get<double>();
+    snapshot.step = r.Get<double>();
+    snapshot.implicit_step = r.Get<double>();
+    snapshot.implicit_active = r.GetBool();
+    snapshot.stiffness_votes = r.Get<int32_t>();
+    snapshot.stopped = r.GetBool();
+    snapshot.peak_C = r.Get<double>();
+    ReadStats(r, snapshot.stats);
+
+    PetriNetState& petri = snapshot.petri_state;
+    petri.pain_level = r.Get<int32_t>();
+    petri.relief_state = r.GetBool();
+    petri.motivation = r.Get<double>();
+    petri.time_since_last_dose = r.Get<double>();
+    petri.patient_alive = r.GetBool();
+    petri.current_dose = r.Get<double>();
+    petri.time_overdose_detected = r.Get<double>();
+    if (version >= 2) petri.assessments = r.Get<uint32_t>();
+    uint64_t doses = r.Get<uint64_t>();
+    if (!r.Good() || doses > kMaxRecords) {
+        std::cerr << "Error: Corrupt snapshot file: " << filename << std::endl;
+        return false;
+    }
+    petri.dose_history.resize(doses);
+    for (auto& record : petri.dose_history) {
+        record.time = r.Get<double>();
+        record.dose = r.Get<double>();
+        record.C = r.Get<double>();
+        record.Ce = r.Get<double>();
+        record.Tol = r.Get<double>();
+        record.effect = r.Get<double>();
+    }
+
+    snapshot.monitor_flags.phase2_flagged = r.GetBool();
+    snapshot.monitor_flags.phase3_flagged = r.GetBool();
+
+    uint64_t events = r.Get<uint64_t>();
+    if (!r.Good() || events > kMaxRecords) {
+        std::cerr << "Error: Corrupt snapshot file: " << filename << std::endl;
+        return false;
+    }
+    for (uint64_t i = 0; i < events; ++i) {
+        int32_t kind = r.Get<int32_t>();
+        double time = r.Get<double>();
+        if (kind < 0 || kind > static_cast<int32_t>(SnapshotEventKind::DosingEvent)) {
+            std::cerr << "Error: Corrupt snapshot file: " << filename << std::endl;
+            return false;
+        }
+        snapshot.events.push_back({static_cast<SnapshotEventKind>(kind), time});
+    }
+
+    if (!r.Good()) {
+        std::cerr << "Error: Truncated snapshot file: " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <string>
+
+#include "context.hpp"
+
+// Binary snapshot files: a magic string, a format version and the fields of
+// SimulationSnapshot in declaration order, in native byte order (a snapshot
+// is meant to be resumed on the machine that wrote it). Doubles are stored
+// bit for bit, so a restored run continues exactly.
+bool SaveSnapshot(const std::string& filename, const SimulationSnapshot& snapshot);
+bool LoadSnapshot(const std::string& filename, SimulationSnapshot& snapshot);
@@ -0,0 +1,35 @@
+#include "trace.hpp"
+
+#include "context.hpp"
+
+const char* TraceSpanName(TraceSpanKind kind) {
+    switch (kind) {
+        case TraceSpanKind::Integrate:
+            return "Integrate";
+        case TraceSpanKind::PatientAssessment:
+            return "PatientAssessment";
+        case TraceSpanKind::DoseIncrease:
+            return "ExecuteDoseIncrease";
+        case TraceSpanKind::StatusMonitor:
+            return "StatusMonitor";
+        case TraceSpanKind::NaloxoneRescue:
+            return "NaloxoneRescue";
+    }
+    return "unknown";
+}
+
+TraceRecorder::TraceRecorder(size_t reserve) : origin_(std::chrono::steady_clock::now()) {
+    spans_.reserve(reserve / 4);
+    samples_.reserve(reserve);
+}
+
+TraceSpan::TraceSpan(SimulationContext& ctx, TraceSpanKind kind)
+    : ctx_(ctx), recorder_(ctx.tracer()), kind_(kind) {
+    if (!recorder_) return;
+    sim_start_ = ctx.Time();
+    wall_start_ = recorder_->WallNow();
+}
+
+TraceSpan::~TraceSpan() {
+    if (recorder_) recorder_->AddSpan(kind_, wall_start_, sim_start_, ctx_.Time());
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+class SimulationContext;
+
+// Spans a trace can hold; names are given by TraceSpanName().
+enum class TraceSpanKind : int {
+    Integrate = 0,        // integration segment between two stops of the run
+    PatientAssessment = 1,
+    DoseIncrease = 2,     // ExecuteDoseIncrease
+    StatusMonitor = 3,
+    NaloxoneRescue = 4,
+};
+
+const char* TraceSpanName(TraceSpanKind kind);
+
+// In-memory timeline of one run for the Chrome trace-event / Perfetto
+// exporter (WriteChromeTrace). Every record carries both the wall-clock and
+// the simulated time it happened at, so the same run can be viewed on either
+// axis. Nothing is formatted or written while the run is going: records go
+// into preallocated vectors and are only turned into JSON at the end.
+class TraceRecorder {
+public:
+    struct Span {
+        TraceSpanKind kind;
+        double wall_start;  // microseconds since the recorder was created
+        double wall_duration;
+        double sim_start;   // hours
+        double sim_duration;
+    };
+
+    // One accepted step (or closed-form interval) ending at sim_time.
+    struct Sample {
+        double wall_time;
+        double sim_time;
+        double step;
+        double saturation_ratio;  // C / Km
+        double Tol;
+    };
+
+    explicit TraceRecorder(size_t reserve = 1 << 16);
+
+    // Microseconds of wall time since construction.
+    double WallNow() const {
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - origin_).count();
+    }
+
+    void AddSpan(TraceSpanKind kind, double wall_start, double sim_start, double sim_end) {
+        spans_.push_back(Span{kind, wall_start, WallNow() - wall_start, sim_start, sim_end - sim_start});
+    }
+    void AddSample(double sim_time, double step, double saturation_ratio, double Tol) {
+        samples_.push_back(Sample{WallNow(), sim_time, step, saturation_ratio, Tol});
+    }
+
+    const std::vector<Span>& spans() const { return spans_; }
+    const std::vector<Sample>& samples() const { return samples_; }
+
+private:
+    std::chrono::steady_clock::time_point origin_;
+    std::vector<Span> spans_{};
+    std::vector<Sample> samples_{};
+};
+
+// Records the scope as a span in the context's recorder, if it has one.
+class TraceSpan {
+public:
+    TraceSpan(SimulationContext& ctx, TraceSpanKind kind);
+    ~TraceSpan();
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    SimulationContext& ctx_;
+    TraceRecorder* recorder_;
+    TraceSpanKind kind_;
+    double sim_start_{0.0};
+    double wall_start_{0.0};
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+
+#include "behavior.hpp"
+
+enum class AssessmentDecision : int {
+    None = -1,  // Petri net disabled or patient died during the assessment
+    Stable = 0,
+    Increase = 1,
+    Maintain = 2,
+};
+
+enum class NaloxoneOutcome : int {
+    Dispatched = 0,
+    Arrived = 1,
+    Revived = 2,
+    WindowExpired = 3,
+    Failed = 4,
+};
+
+enum class ToxicityKind : int {
+    ToxicWarning = 0,
+    CriticalOverdose = 1,
+    RespiratoryArrest = 2,
+};
+
+// Receives the samples and events of one run alongside (or instead of) the
+// text log. All callbacks default to no-ops.
+class TrajectorySink {
+public:
+    virtual ~TrajectorySink() = default;
+
+    virtual void OnSample(double /*t*/, double /*A*/, double /*C*/, double /*P*/, double /*Ce*/,
+                          double /*Tol*/, double /*effect*/) {}
+    virtual void OnAssessment(double /*t*/, double /*effect*/, const PetriNetState& /*petri_state*/,
+                              AssessmentDecision /*decision*/) {}
+    virtual void OnDose(const PetriNetState::DoseRecord& /*record*/, size_t /*total_doses*/) {}
+    virtual void OnPhaseTransition(double /*t*/, int /*phase*/, double /*saturation_ratio*/, double /*C*/) {}
+    virtual void OnNaloxone(double /*t*/, NaloxoneOutcome /*outcome*/, double /*time_since_overdose*/) {}
+    virtual void OnToxicity(double /*t*/, ToxicityKind /*kind*/, double /*C*/, double /*effect*/) {}
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Layout of the live telemetry segment, a POSIX shared-memory object
+// (/dev/shm/<name> on Linux) shared by TelemetryPublisher and
+// TelemetryReader and read directly by viewer.py --live:
+//
+//   TelemetryHeader
+//   lanes x (TelemetryLane, capacity x TelemetrySlot)
+//
+// Each lane is a single-producer ring owned by one simulating thread. The
+// producer never waits: it overwrites the oldest slot, stamping the slot
+// odd while writing and even when done (seqlock), so a reader that fell
+// behind detects the overwritten slots, counts them as overruns and skips
+// ahead. All fields are little-endian, as written by the host.
+
+const char kTelemetryMagic[8] = {'P', 'K', 'P', 'D', 'T', 'E', 'L', 'E'};
+const uint32_t kTelemetryVersion = 1;
+
+enum class TelemetryKind : uint32_t {
+    Sample = 0,      // values: A, C, P, Ce, Tol, Effect
+    Assessment = 1,  // values: effect, motivation, current_dose, pain_level, relief_state, decision
+    Dose = 2,        // values: dose, C, Ce, Tol, effect, total_doses
+    Phase = 3,       // values: phase, C/Km, C
+    Naloxone = 4,    // values: outcome, time_since_overdose
+    Toxicity = 5,    // values: kind, C, effect
+    RunStart = 6,    // values: sim_duration
+    RunEnd = 7,      // values: alive, time_of_death, peak C/Km, final Tol, escalations, doses
+};
+
+// One published sample or event; t is simulated hours.
+struct TelemetryRecord {
+    uint32_t kind;
+    uint32_t run;  // run index within the job (sweep point, cohort patient)
+    double t;
+    double values[6];
+};
+
+struct TelemetrySlot {
+    std::atomic<uint64_t> stamp;  // 2 s + 1 while record s is written, 2 s + 2 once complete
+    TelemetryRecord record;
+};
+
+struct alignas(64) TelemetryLane {
+    std::atomic<uint64_t> written;  // records published to this lane so far
+};
+
+struct alignas(64) TelemetryHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t lanes;
+    uint64_t capacity;  // slots per lane, a power of two
+    uint64_t slot_size;
+    uint64_t total_runs;  // runs the job will publish, for progress display
+    std::atomic<uint32_t> lanes_in_use;
+    std::atomic<uint32_t> finished;  // set once the publisher is done
+    std::atomic<uint64_t> unassigned;  // records dropped because every lane was taken
+};
+
+// viewer.py reads the segment with these sizes hard-coded.
+static_assert(sizeof(TelemetryHeader) == 64, "telemetry header layout changed");
+static_assert(sizeof(TelemetryLane) == 64, "telemetry lane layout changed");
+static_assert(sizeof(TelemetrySlot) == 72, "telemetry slot layout changed");
+
+inline size_t TelemetryLaneBytes(uint64_t capacity) {
+    return sizeof(TelemetryLane) + capacity * sizeof(TelemetrySlot);
+}
+
+inline size_t TelemetrySegmentBytes(uint32_t lanes, uint64_t capacity) {
+    return sizeof(TelemetryHeader) + lanes * TelemetryLaneBytes(capacity);
+}
+
+// shm_open() names start with a slash; "pkpd" and "/pkpd" are the same segment.
+inline std::string TelemetryObjectName(const std::string& name) {
+    return name.empty() || name[0] != '/' ? "/" + name : name;
+}
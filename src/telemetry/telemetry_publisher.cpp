@@ -0,0 +1,155 @@
+#include "telemetry_publisher.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <new>
+
+void TelemetryChannel::Publish(const TelemetryRecord& record) {
+    uint64_t sequence = next_++;
+    TelemetrySlot& slot = slots_[sequence & mask_];
+    slot.stamp.store(2 * sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(&slot.record, &record, sizeof(record));
+    slot.stamp.store(2 * sequence + 2, std::memory_order_release);
+    lane_->written.store(next_, std::memory_order_release);
+}
+
+void TelemetryChannel::RunStart(uint32_t run, double sim_duration) {
+    TelemetryRecord record{};
+    record.kind = static_cast<uint32_t>(TelemetryKind::RunStart);
+    record.run = run;
+    record.values[0] = sim_duration;
+    Publish(record);
+}
+
+void TelemetryChannel::RunEnd(uint32_t run, const RunSummary& summary) {
+    TelemetryRecord record{};
+    record.kind = static_cast<uint32_t>(TelemetryKind::RunEnd);
+    record.run = run;
+    record.t = summary.end_time;
+    record.values[0] = summary.patient_alive ? 1.0 : 0.0;
+    record.values[1] = summary.time_of_death;
+    record.values[2] = summary.peak_saturation_ratio;
+    record.values[3] = summary.final_Tol;
+    record.values[4] = summary.escalations;
+    record.values[5] = summary.doses;
+    Publish(record);
+}
+
+TelemetryPublisher::~TelemetryPublisher() {
+    Close();
+}
+
+bool TelemetryPublisher::Open(const std::string& name, uint32_t lanes, uint64_t total_runs, uint64_t capacity) {
+    // At least 8 slots keep every lane a multiple of 64 bytes long.
+    uint64_t rounded = 8;
+    while (rounded < capacity) rounded <<= 1;
+    lanes = lanes > 0 ? lanes : 1;
+
+    object_name_ = TelemetryObjectName(name);
+    bytes_ = TelemetrySegmentBytes(lanes, rounded);
+    // A segment left by an earlier run is replaced, not reused: readers
+    // still mapping it keep the old one.
+    shm_unlink(object_name_.c_str());
+    int fd = shm_open(object_name_.c_str(), O_CREAT | O_RDWR | O_EXCL, 0644);
+    if (fd < 0 || ftruncate(fd, static_cast<off_t>(bytes_)) != 0) {
+        std::cerr << "Error: Cannot create telemetry segment " << object_name_ << ": " << std::strerror(errno)
+                  << std::endl;
+        if (fd >= 0) close(fd);
+        return false;
+    }
+    memory_ = mmap(nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory_ == MAP_FAILED) {
+        std::cerr << "Error: Cannot map telemetry segment " << object_name_ << ": " << std::strerror(errno)
+                  << std::endl;
+        memory_ = nullptr;
+        shm_unlink(object_name_.c_str());
+        return false;
+    }
+
+    // The segment comes back zero-filled, which is a valid state for every
+    // atomic in it; the magic goes in last so readers never see a partial
+    // header.
+    header_ = new (memory_) TelemetryHeader();
+    header_->version = kTelemetryVersion;
+    header_->lanes = lanes;
+    header_->capacity = rounded;
+    header_->slot_size = sizeof(TelemetrySlot);
+    header_->total_runs = total_runs;
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(header_->magic, kTelemetryMagic, sizeof(kTelemetryMagic));
+    return true;
+}
+
+void TelemetryPublisher::Close() {
+    if (!memory_) return;
+    header_->finished.store(1, std::memory_order_release);
+    munmap(memory_, bytes_);
+    memory_ = nullptr;
+    header_ = nullptr;
+    channels_.clear();
+}
+
+TelemetryChannel* TelemetryPublisher::Channel() {
+    if (!header_) return nullptr;
+    std::thread::id id = std::this_thread::get_id();
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& entry : channels_) {
+        if (entry.first == id) return &entry.second;
+    }
+    if (channels_.size() >= header_->lanes) return nullptr;
+
+    // Lanes are reserved up front, so the vector never reallocates.
+    if (channels_.empty()) channels_.reserve(header_->lanes);
+    char* base = static_cast<char*>(memory_) + sizeof(TelemetryHeader) +
+                 channels_.size() * TelemetryLaneBytes(header_->capacity);
+    TelemetryLane* lane = reinterpret_cast<TelemetryLane*>(base);
+    TelemetrySlot* slots = reinterpret_cast<TelemetrySlot*>(base + sizeof(TelemetryLane));
+    channels_.emplace_back(id, TelemetryChannel(lane, slots, header_->capacity));
+    header_->lanes_in_use.store(static_cast<uint32_t>(channels_.size()), std::memory_order_release);
+    return &channels_.back().second;
+}
+
+void TelemetrySink::Publish(TelemetryKind kind, double t, std::initializer_list<double> values) {
+    TelemetryRecord record{};
+    record.kind = static_cast<uint32_t>(kind);
+    record.run = run_;
+    record.t = t;
+    size_t i = 0;
+    for (double value : values) record.values[i++] = value;
+    channel_.Publish(record);
+}
+
+void TelemetrySink::OnSample(double t, double A, double C, double P, double Ce, double Tol, double effect) {
+    Publish(TelemetryKind::Sample, t, {A, C, P, Ce, Tol, effect});
+}
+
+void TelemetrySink::OnAssessment(double t, double effect, const PetriNetState& petri_state,
+                                 AssessmentDecision decision) {
+    Publish(TelemetryKind::Assessment, t,
+            {effect, petri_state.motivation, petri_state.current_dose, static_cast<double>(petri_state.pain_level),
+             petri_state.relief_state ? 1.0 : 0.0, static_cast<double>(decision)});
+}
+
+void TelemetrySink::OnDose(const PetriNetState::DoseRecord& record, size_t total_doses) {
+    Publish(TelemetryKind::Dose, record.time,
+            {record.dose, record.C, record.Ce, record.Tol, record.effect, static_cast<double>(total_doses)});
+}
+
+void TelemetrySink::OnPhaseTransition(double t, int phase, double saturation_ratio, double C) {
+    Publish(TelemetryKind::Phase, t, {static_cast<double>(phase), saturation_ratio, C});
+}
+
+void TelemetrySink::OnNaloxone(double t, NaloxoneOutcome outcome, double time_since_overdose) {
+    Publish(TelemetryKind::Naloxone, t, {static_cast<double>(outcome), time_since_overdose});
+}
+
+void TelemetrySink::OnToxicity(double t, ToxicityKind kind, double C, double effect) {
+    Publish(TelemetryKind::Toxicity, t, {static_cast<double>(kind), C, effect});
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../simulation/report.hpp"
+#include "../simulation/trajectory_sink.hpp"
+#include "telemetry.hpp"
+
+// Producer end of one lane. Publish() is wait-free; only the thread the
+// lane was handed to may call it.
+class TelemetryChannel {
+public:
+    TelemetryChannel(TelemetryLane* lane, TelemetrySlot* slots, uint64_t capacity)
+        : lane_(lane), slots_(slots), mask_(capacity - 1) {}
+
+    void Publish(const TelemetryRecord& record);
+
+    void RunStart(uint32_t run, double sim_duration);
+    void RunEnd(uint32_t run, const RunSummary& summary);
+
+private:
+    TelemetryLane* lane_;
+    TelemetrySlot* slots_;
+    uint64_t mask_;
+    uint64_t next_{0};
+};
+
+// Creates the shared-memory segment and hands one lane to each publishing
+// thread. On Close() the segment is marked finished but left in place, so a
+// reader that attaches late (runs can be shorter than its poll interval)
+// still gets the last `capacity` records of each lane; the next run under
+// the same name replaces it.
+class TelemetryPublisher {
+public:
+    TelemetryPublisher() = default;
+    ~TelemetryPublisher();
+
+    TelemetryPublisher(const TelemetryPublisher&) = delete;
+    TelemetryPublisher& operator=(const TelemetryPublisher&) = delete;
+
+    // capacity is rounded up to a power of two.
+    bool Open(const std::string& name, uint32_t lanes, uint64_t total_runs, uint64_t capacity = 1 << 14);
+    void Close();
+
+    // The calling thread's lane, assigned on first use; nullptr once all
+    // lanes are taken (the thread's records are then only counted).
+    TelemetryChannel* Channel();
+    void CountUnassigned() {
+        if (header_) header_->unassigned.fetch_add(1, std::memory_order_relaxed);
+    }
+
+private:
+    std::string object_name_{};
+    void* memory_{nullptr};
+    size_t bytes_{0};
+    TelemetryHeader* header_{nullptr};
+    std::mutex mutex_{};
+    std::vector<std::pair<std::thread::id, TelemetryChannel>> channels_{};
+};
+
+// Publishes the samples and events of one run.
+class TelemetrySink : public TrajectorySink {
+public:
+    TelemetrySink(TelemetryChannel& channel, uint32_t run) : channel_(channel), run_(run) {}
+
+    void OnSample(double t, double A, double C, double P, double Ce, double Tol, double effect) override;
+    void OnAssessment(double t, double effect, const PetriNetState& petri_state,
+                      AssessmentDecision decision) override;
+    void OnDose(const PetriNetState::DoseRecord& record, size_t total_doses) override;
+    void OnPhaseTransition(double t, int phase, double saturation_ratio, double C) override;
+    void OnNaloxone(double t, NaloxoneOutcome outcome, double time_since_overdose) override;
+    void OnToxicity(double t, ToxicityKind kind, double C, double effect) override;
+
+private:
+    void Publish(TelemetryKind kind, double t, std::initializer_list<double> values);
+
+    TelemetryChannel& channel_;
+    uint32_t run_;
+};
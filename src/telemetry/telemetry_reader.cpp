@@ -0,0 +1,82 @@
+#include "telemetry_reader.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+
+TelemetryReader::~TelemetryReader() {
+    Close();
+}
+
+bool TelemetryReader::Open(const std::string& name) {
+    Close();
+    int fd = shm_open(TelemetryObjectName(name).c_str(), O_RDONLY, 0);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(TelemetryHeader)) {
+        close(fd);
+        return false;
+    }
+    bytes_ = static_cast<size_t>(info.st_size);
+    void* memory = mmap(nullptr, bytes_, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) return false;
+    memory_ = memory;
+    header_ = static_cast<const TelemetryHeader*>(memory_);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (std::memcmp(header_->magic, kTelemetryMagic, sizeof(kTelemetryMagic)) != 0 ||
+        header_->version != kTelemetryVersion || header_->slot_size != sizeof(TelemetrySlot) ||
+        TelemetrySegmentBytes(header_->lanes, header_->capacity) > bytes_) {
+        Close();
+        return false;
+    }
+    next_.assign(header_->lanes, 0);
+    overruns_ = 0;
+    return true;
+}
+
+void TelemetryReader::Close() {
+    if (memory_) munmap(const_cast<void*>(memory_), bytes_);
+    memory_ = nullptr;
+    header_ = nullptr;
+    next_.clear();
+}
+
+size_t TelemetryReader::Poll(std::vector<TelemetryRecord>& records) {
+    if (!header_) return 0;
+    size_t before = records.size();
+    uint64_t capacity = header_->capacity;
+    uint32_t lanes = header_->lanes_in_use.load(std::memory_order_acquire);
+    for (uint32_t l = 0; l < lanes && l < header_->lanes; ++l) {
+        const char* base = static_cast<const char*>(memory_) + sizeof(TelemetryHeader) + l * TelemetryLaneBytes(capacity);
+        const TelemetryLane* lane = reinterpret_cast<const TelemetryLane*>(base);
+        const TelemetrySlot* slots = reinterpret_cast<const TelemetrySlot*>(base + sizeof(TelemetryLane));
+
+        uint64_t written = lane->written.load(std::memory_order_acquire);
+        uint64_t& next = next_[l];
+        if (written - next > capacity) {
+            overruns_ += written - capacity - next;
+            next = written - capacity;
+        }
+        while (next < written) {
+            const TelemetrySlot& slot = slots[next & (capacity - 1)];
+            uint64_t stamp = slot.stamp.load(std::memory_order_acquire);
+            TelemetryRecord record;
+            std::memcpy(&record, &slot.record, sizeof(record));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (stamp != 2 * next + 2 || slot.stamp.load(std::memory_order_relaxed) != stamp) {
+                // Overwritten by a later lap while we were catching up.
+                ++overruns_;
+                ++next;
+                continue;
+            }
+            records.push_back(record);
+            ++next;
+        }
+    }
+    return records.size() - before;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "telemetry.hpp"
+
+// Consumer end of a telemetry segment: maps it read-only and follows every
+// lane. The publisher is never slowed down by a reader; records it
+// overwrote before they were read are counted in Overruns() and skipped.
+class TelemetryReader {
+public:
+    TelemetryReader() = default;
+    ~TelemetryReader();
+
+    TelemetryReader(const TelemetryReader&) = delete;
+    TelemetryReader& operator=(const TelemetryReader&) = delete;
+
+    // False while the segment does not exist (yet) or is not a telemetry
+    // segment of this version.
+    bool Open(const std::string& name);
+    void Close();
+
+    // Appends the records published since the last call, lane by lane, and
+    // returns how many were appended.
+    size_t Poll(std::vector<TelemetryRecord>& records);
+
+    uint64_t Overruns() const { return overruns_; }
+    uint64_t TotalRuns() const { return header_ ? header_->total_runs : 0; }
+    uint64_t Unassigned() const { return header_ ? header_->unassigned.load(std::memory_order_relaxed) : 0; }
+    // The publisher has closed the segment; one more Poll() gets the rest.
+    bool Finished() const { return header_ && header_->finished.load(std::memory_order_acquire) != 0; }
+
+private:
+    const void* memory_{nullptr};
+    size_t bytes_{0};
+    const TelemetryHeader* header_{nullptr};
+    std::vector<uint64_t> next_{};  // next sequence to read, per lane
+    uint64_t overruns_{0};
+};
@@ -0,0 +1,82 @@
+"""Reader for the live telemetry segment of `sim --telemetry <name>`.
+
+Mirrors src/telemetry/telemetry_reader.cpp: the segment is mapped from
+/dev/shm and every lane is followed independently. Records the publisher
+overwrote before they were read are counted in `overruns` and skipped; the
+publisher never waits for a reader.
+"""
+import mmap
+import os
+import struct
+
+MAGIC = b"PKPDTELE"
+VERSION = 1
+HEADER_BYTES = 64
+LANE_BYTES = 64
+SLOT_BYTES = 72
+
+HEADER = struct.Struct("<8sIIQQQIIQ")
+SLOT = struct.Struct("<QIId6d")
+
+KIND_NAMES = {
+    0: "sample",
+    1: "assessment",
+    2: "dose",
+    3: "phase",
+    4: "naloxone",
+    5: "toxicity",
+    6: "run_start",
+    7: "run_end",
+}
+
+SAMPLE, ASSESSMENT, DOSE, PHASE, NALOXONE, TOXICITY, RUN_START, RUN_END = range(8)
+
+
+class TelemetryReader:
+    def __init__(self, name):
+        path = "/dev/shm/" + name.lstrip("/")
+        fd = os.open(path, os.O_RDONLY)
+        try:
+            self._map = mmap.mmap(fd, 0, mmap.MAP_SHARED, mmap.PROT_READ)
+        finally:
+            os.close(fd)
+        magic, version, self.lanes, self.capacity, slot_size, self.total_runs, _, _, _ = \
+            HEADER.unpack_from(self._map, 0)
+        if magic != MAGIC or version != VERSION or slot_size != SLOT_BYTES:
+            raise ValueError(f"{path} is not a version {VERSION} telemetry segment")
+        self._next = [0] * self.lanes
+        self.overruns = 0
+
+    def _header(self):
+        return HEADER.unpack_from(self._map, 0)
+
+    @property
+    def finished(self):
+        return self._header()[7] != 0
+
+    def poll(self):
+        """Returns the (kind, run, t, values) records published since the last call."""
+        records = []
+        lanes_in_use = min(self._header()[6], self.lanes)
+        lane_bytes = LANE_BYTES + self.capacity * SLOT_BYTES
+        for lane in range(lanes_in_use):
+            base = HEADER_BYTES + lane * lane_bytes
+            (written,) = struct.unpack_from("<Q", self._map, base)
+            nxt = self._next[lane]
+            if written - nxt > self.capacity:
+                self.overruns += written - self.capacity - nxt
+                nxt = written - self.capacity
+            while nxt < written:
+                offset = base + LANE_BYTES + (nxt & (self.capacity - 1)) * SLOT_BYTES
+                stamp, kind, run, t, *values = SLOT.unpack_from(self._map, offset)
+                (stamp_after,) = struct.unpack_from("<Q", self._map, offset)
+                if stamp != 2 * nxt + 2 or stamp_after != stamp:
+                    self.overruns += 1
+                else:
+                    records.append((kind, run, t, values))
+                nxt += 1
+            self._next[lane] = nxt
+        return records
+
+    def close(self):
+        self._map.close()
@@ -1,5 +1,8 @@
 #!/usr/bin/env python3
+import json
 import re
+import sys
+import time
 from pathlib import Path
 
 import matplotlib.pyplot as plt
@@ -227,8 +230,120 @@ def parse_out(path: Path):
     return continuous_df, assessments_df, doses_df, naloxone_df, phase_df, critical_df
 
 
+DECISION_NAMES = {0: "STABLE", 1: "INCREASE", 2: "MAINTAIN"}
+NALOXONE_NAMES = {1: "ATTEMPTING NALOXONE RESCUE", 2: "RESCUE SUCCESSFUL", 3: "RESCUE FAILED", 4: "RESCUE FAILED"}
+PHASE_NAMES = {2: "SATURATION ZONE ENTERED", 3: "CATASTROPHIC ZONE"}
+TOXICITY_NAMES = {0: "TOXIC_WARNING", 1: "CRITICAL_OVERDOSE", 2: "RESPIRATORY_ARREST"}
+
+
+SAMPLED_COLUMNS = ["A", "C", "P", "Ce", "Tol", "Effect"]
+MAX_PLOT_POINTS = 4000
+
+
+def load_continuous(directory: Path, t_range=None, max_points=MAX_PLOT_POINTS):
+    """Sampled columns of a `sim --binary` directory within t_range (hours).
+
+    When the range holds more than max_points samples, the finest pyramid
+    level that fits is read instead of the raw columns: one row per bucket,
+    with `t` at the bucket centre, `<col>_min`/`<col>_max` for the envelope and
+    the LTTB-selected sample in `<col>_t`, `<col>`. Only the rows in range are
+    read, so the cost depends on the zoom, not on the length of the run.
+    """
+    header = json.loads((directory / "header.json").read_text())
+    time_column = np.load(directory / "time.npy", mmap_mode="r")
+    lo, hi = (-np.inf, np.inf) if t_range is None else t_range
+    first = int(np.searchsorted(time_column, lo, side="left"))
+    last = int(np.searchsorted(time_column, hi, side="right"))
+
+    level = None
+    for candidate in header.get("pyramid", []):
+        level = candidate
+        if (last - first) / candidate["bucket"] <= max_points:
+            break
+    if level is None or last - first <= max_points:
+        frame = {"t": np.asarray(time_column[first:last])}
+        for name in SAMPLED_COLUMNS:
+            frame[name] = np.asarray(np.load(directory / f"{name}.npy", mmap_mode="r")[first:last])
+        return pd.DataFrame(frame)
+
+    records = np.load(directory / level["file"], mmap_mode="r")
+    start = max(first // level["bucket"], 0)
+    stop = min((last + level["bucket"] - 1) // level["bucket"], len(records))
+    frame = pd.DataFrame(np.asarray(records[start:stop]))
+    frame.insert(0, "t", (frame["t0"] + frame["t1"]) / 2)
+    return frame
+
+
+def series(continuous_df, name):
+    """Times and values of one sampled column; pyramid levels keep a time per column."""
+    return continuous_df.get(f"{name}_t", continuous_df["t"]), continuous_df[name]
+
+
+def draw_envelope(ax, continuous_df):
+    """Shade the min/max range of C per pyramid bucket, so short peaks stay visible."""
+    for collection in list(ax.collections):
+        if collection.get_gid() == "C_envelope":
+            collection.remove()
+    if "C_min" in continuous_df:
+        ax.fill_between(continuous_df["t"], continuous_df["C_min"], continuous_df["C_max"],
+                        color="tab:blue", alpha=0.2, linewidth=0, gid="C_envelope")
+
+
+def load_binary(directory: Path, t_range=None):
+    """Load a `sim --binary` output directory into the same frames as parse_out()."""
+    def events(name):
+        return pd.DataFrame(np.load(directory / f"{name}.npy"))
+
+    continuous_df = load_continuous(directory, t_range)
+
+    assessments_df = events("assessments").rename(columns={"time": "t"})
+    if not assessments_df.empty:
+        assessments_df["decision"] = assessments_df["decision"].map(DECISION_NAMES)
+
+    doses_df = events("doses")
+    if not doses_df.empty:
+        doses_df = doses_df[["time", "dose"]]
+
+    naloxone_df = events("naloxone")
+    if not naloxone_df.empty:
+        naloxone_df = naloxone_df[naloxone_df["outcome"].isin(list(NALOXONE_NAMES))]
+        naloxone_df = pd.DataFrame({
+            "time": naloxone_df["time"],
+            "event": naloxone_df["outcome"].map(NALOXONE_NAMES),
+        })
+
+    phase_df = events("phases")
+    if not phase_df.empty:
+        phase_df = pd.DataFrame({"time": phase_df["time"], "phase": phase_df["phase"].map(PHASE_NAMES)})
+
+    critical_df = events("toxicity")
+    if not critical_df.empty:
+        critical_df = pd.DataFrame({"time": critical_df["time"], "type": critical_df["kind"].map(TOXICITY_NAMES)})
+
+    return continuous_df, assessments_df, doses_df, naloxone_df, phase_df, critical_df
+
+
 # ---------- Plotting ----------
 
+PLOTTED_COLUMNS = {"A (absorption)": "A", "C (blood)": "C", "P (peripheral)": "P",
+                   "Ce (effect-site)": "Ce", "Tolerance": "Tol", "Effect (%)": "Effect"}
+
+
+def follow_zoom(fig, directory: Path):
+    """Reload the sampled columns at the matching pyramid level whenever the time axis is zoomed or panned."""
+    def reload(ax):
+        frame = load_continuous(directory, ax.get_xlim())
+        for axis in fig.axes:
+            for line in axis.get_lines():
+                name = PLOTTED_COLUMNS.get(line.get_label())
+                if name:
+                    line.set_data(*series(frame, name))
+                if name == "C":
+                    draw_envelope(axis, frame)
+        fig.canvas.draw_idle()
+
+    fig.axes[0].callbacks.connect("xlim_changed", reload)
+
 def plot_overview(continuous_df, assessments_df, doses_df, naloxone_df, phase_df, critical_df):
     """Create comprehensive 6-panel visualization of simulation data."""
     fig, axes = plt.subplots(6, 1, figsize=(18, 16), sharex=True)
@@ -239,7 +354,7 @@ def plot_overview(continuous_df, assessments_df, doses_df, naloxone_df, phase_df
 
     # 1) Absorption Compartment (A) - shows dose stacking
     ax = axes[0]
-    ax.plot(continuous_df["t"], continuous_df["A"], label="A (absorption)", color="tab:cyan", linewidth=2)
+    ax.plot(*series(continuous_df, "A"), label="A (absorption)", color="tab:cyan", linewidth=2)
     ax.set_ylabel("Amount in GI [mg]", fontsize=11, fontweight='bold')
     ax.legend(loc="upper right")
     ax.set_title("Gastrointestinal Absorption Compartment", fontsize=12, fontweight='bold')
@@ -252,9 +367,10 @@ def plot_overview(continuous_df, assessments_df, doses_df, naloxone_df, phase_df
 
     # 2) PK: Central (C), Peripheral (P), and Effect-site (Ce)
     ax = axes[1]
-    ax.plot(continuous_df["t"], continuous_df["C"], label="C (blood)", color="tab:blue", linewidth=2)
-    ax.plot(continuous_df["t"], continuous_df["P"], label="P (peripheral)", color="tab:purple", linewidth=2, alpha=0.7)
-    ax.plot(continuous_df["t"], continuous_df["Ce"], label="Ce (effect-site)", color="tab:orange", linewidth=2)
+    ax.plot(*series(continuous_df, "C"), label="C (blood)", color="tab:blue", linewidth=2)
+    ax.plot(*series(continuous_df, "P"), label="P (peripheral)", color="tab:purple", linewidth=2, alpha=0.7)
+    ax.plot(*series(continuous_df, "Ce"), label="Ce (effect-site)", color="tab:orange", linewidth=2)
+    draw_envelope(ax, continuous_df)
     ax.set_ylabel("Concentration [mg/L]", fontsize=11, fontweight='bold')
     ax.legend(loc="upper right")
     ax.set_title("Pharmacokinetics: Multi-Compartment Distribution", fontsize=12, fontweight='bold')
@@ -270,7 +386,7 @@ def plot_overview(continuous_df, assessments_df, doses_df, naloxone_df, phase_df
 
     # 3) Tolerance Development
     ax = axes[2]
-    ax.plot(continuous_df["t"], continuous_df["Tol"], label="Tolerance", color="tab:red", linewidth=2)
+    ax.plot(*series(continuous_df, "Tol"), label="Tolerance", color="tab:red", linewidth=2)
     ax.set_ylabel("Tolerance [a.u.]", fontsize=11, fontweight='bold')
     ax.legend(loc="upper left")
     ax.set_title("Tolerance Development (Receptor Desensitization)", fontsize=12, fontweight='bold')
@@ -286,7 +402,7 @@ def plot_overview(continuous_df, assessments_df, doses_df, naloxone_df, phase_df
 
     # 4) Effect and Pain with Motivation overlay
     ax = axes[3]
-    ax.plot(continuous_df["t"], continuous_df["Effect"], label="Effect (%)", 
+    ax.plot(*series(continuous_df, "Effect"), label="Effect (%)", 
            color="tab:green", linewidth=2.5)
     
     # Add therapeutic window shading
@@ -451,15 +567,124 @@ def plot_overview(continuous_df, assessments_df, doses_df, naloxone_df, phase_df
     return fig
 
 
+# ---------- Live telemetry ----------
+
+def open_telemetry(name):
+    """Wait for the segment of a `sim ... --telemetry <name>` run to appear."""
+    from telemetry import TelemetryReader
+
+    announced = False
+    while True:
+        try:
+            return TelemetryReader(name)
+        except (FileNotFoundError, ValueError):
+            if not announced:
+                print(f"Waiting for telemetry segment {name}...")
+                announced = True
+            time.sleep(0.2)
+
+
+def live_view(name, refresh=0.25):
+    """Plot a running simulation from its telemetry segment as records arrive.
+
+    A single run shows C, Ce, Tol and Effect with its doses and alarms; jobs of
+    many runs (sweep, cohort) show progress, outcomes and the death-time
+    distribution. The view keeps updating until the publisher finishes.
+    """
+    from telemetry import SAMPLE, DOSE, TOXICITY, RUN_END
+
+    reader = open_telemetry(name)
+    samples = []
+    doses = []
+    alarms = []
+    ends = []
+
+    plt.ion()
+    fig, axes = plt.subplots(4, 1, figsize=(14, 10), sharex=reader.total_runs <= 1)
+    while True:
+        finished = reader.finished
+        for kind, run, t, values in reader.poll():
+            if kind == SAMPLE:
+                samples.append((t, *values))
+            elif kind == DOSE:
+                doses.append((t, values[0]))
+            elif kind == TOXICITY:
+                alarms.append((t, TOXICITY_NAMES.get(int(values[0]), "?")))
+            elif kind == RUN_END:
+                ends.append((run, t, values[0] != 0.0, values[1], values[2], values[3]))
+
+        for ax in axes:
+            ax.clear()
+            ax.grid(True, alpha=0.3)
+        if reader.total_runs <= 1:
+            df = pd.DataFrame(samples, columns=["t", "A", "C", "P", "Ce", "Tol", "Effect"])
+            for ax, column, unit in zip(axes, ["C", "Ce", "Tol", "Effect"], ["mg/L", "mg/L", "", "%"]):
+                ax.plot(df["t"], df[column], linewidth=1.5)
+                ax.set_ylabel(f"{column} {unit}".strip())
+                for t, _ in doses:
+                    ax.axvline(t, color="tab:green", alpha=0.2)
+                for t, _ in alarms:
+                    ax.axvline(t, color="tab:red", alpha=0.6, linestyle="--")
+            axes[-1].set_xlabel("Time [h]")
+            status = f"t = {df['t'].iloc[-1]:.1f} h" if not df.empty else "waiting for samples"
+        else:
+            ends_df = pd.DataFrame(ends, columns=["run", "end_time", "alive", "time_of_death", "peak_ratio",
+                                                  "final_Tol"])
+            done = len(ends_df)
+            alive = int(ends_df["alive"].sum()) if done else 0
+            axes[0].barh(["done"], [done], color="tab:blue")
+            axes[0].set_xlim(0, max(reader.total_runs, 1))
+            axes[0].set_title(f"{done}/{reader.total_runs} runs")
+            axes[1].bar(["alive", "deceased"], [alive, done - alive], color=["tab:green", "tab:red"])
+            deaths = ends_df.loc[~ends_df["alive"], "time_of_death"] if done else []
+            axes[2].hist(deaths, bins=40, color="tab:red", alpha=0.7)
+            axes[2].set_xlabel("Time of death [h]")
+            if done:
+                axes[3].hist(ends_df["peak_ratio"], bins=40, color="tab:purple", alpha=0.7)
+            axes[3].set_xlabel("Peak C/Km")
+            status = f"{done}/{reader.total_runs} runs"
+        fig.suptitle(f"Live telemetry '{name}': {status}, {reader.overruns} records lost to overruns"
+                     + (" (finished)" if finished else ""))
+        plt.pause(refresh)
+        if finished:
+            break
+
+    plt.ioff()
+    plt.show()
+
+
 def main():
-    if not OUT_PATH.exists():
-        raise SystemExit(f"out.txt not found at {OUT_PATH}")
-    
-    # Extract config name from output file
-    config_name = extract_config_name(OUT_PATH)
-    
-    print("Parsing simulation output...")
-    continuous_df, assessments_df, doses_df, naloxone_df, phase_df, critical_df = parse_out(OUT_PATH)
+    if len(sys.argv) > 2 and sys.argv[1] == "--live":
+        live_view(sys.argv[2])
+        return
+
+    args = sys.argv[1:]
+    t_range = None
+    if "--range" in args:
+        # Only this window of a binary trajectory is loaded, at the matching pyramid level
+        i = args.index("--range")
+        t_range = (float(args[i + 1]), float(args[i + 2]))
+        del args[i:i + 3]
+    show = "--show" in args
+    if show:
+        args.remove("--show")
+
+    out_path = Path(args[0]) if args else OUT_PATH
+    if not out_path.exists():
+        raise SystemExit(f"Simulation output not found at {out_path}")
+
+    if out_path.is_dir():
+        # Binary trajectory directory written by `sim <config> --binary <dir>`
+        header = json.loads((out_path / "header.json").read_text())
+        config_name = Path(header["source"]).stem or "ims"
+        print("Loading binary trajectory...")
+        continuous_df, assessments_df, doses_df, naloxone_df, phase_df, critical_df = load_binary(out_path, t_range)
+    else:
+        # Extract config name from output file
+        config_name = extract_config_name(out_path)
+
+        print("Parsing simulation output...")
+        continuous_df, assessments_df, doses_df, naloxone_df, phase_df, critical_df = parse_out(out_path)
 
     print(f"📊 Data Summary:")
     print(f"  • {len(continuous_df)} continuous time points")
@@ -472,7 +697,8 @@ def main():
 
     if not continuous_df.empty:
         print(f"📈 Simulation Range: {continuous_df['t'].min():.1f} - {continuous_df['t'].max():.1f} hours")
-        print(f"   Peak C: {continuous_df['C'].max():.2f} mg/L at t={continuous_df.loc[continuous_df['C'].idxmax(), 't']:.1f}h")
+        peak_C = "C_max" if "C_max" in continuous_df else "C"
+        print(f"   Peak C: {continuous_df[peak_C].max():.2f} mg/L at t={continuous_df.loc[continuous_df[peak_C].idxmax(), 't']:.1f}h")
         print(f"   Peak Effect: {continuous_df['Effect'].max():.1f}% at t={continuous_df.loc[continuous_df['Effect'].idxmax(), 't']:.1f}h")
         print(f"   Final Tolerance: {continuous_df['Tol'].iloc[-1]:.4f}")
         print()
@@ -486,6 +712,8 @@ def main():
 
     print("Creating comprehensive visualization...")
     fig = plot_overview(continuous_df, assessments_df, doses_df, naloxone_df, phase_df, critical_df)
+    if t_range is not None:
+        fig.axes[0].set_xlim(*t_range)
 
     # Generate output filenames based on config
     overview_png = f"{config_name}_overview.png"
@@ -512,6 +740,11 @@ def main():
         doses_df.to_csv(doses_csv, index=False)
         print(f"   • {doses_csv}")
 
+    if show:
+        if out_path.is_dir():
+            follow_zoom(fig, out_path)
+        plt.show()
+
 
 if __name__ == "__main__":
     main()
\ No newline at end of file